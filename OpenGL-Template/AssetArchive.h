@@ -0,0 +1,332 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "Lz4.h"
+#include "MappedFile.h"
+
+enum class AssetCompression : uint16_t {
+    NONE = 0,
+    LZ4 = 1
+};
+
+/// table of contents record of one file inside an AssetArchive
+struct ArchiveEntry
+{
+    uint64_t offset; // from the start of the archive, a multiple of the archive alignment
+    uint64_t size; // stored bytes
+    uint64_t originalSize; // bytes after decompression
+    uint32_t nameOffset; // into the name table
+    uint16_t nameLength;
+    AssetCompression compression;
+};
+
+/// a file that is written into an archive by AssetArchive::write
+struct ArchiveInput
+{
+    std::string name; // path relative to the working directory with '/' separators (E.g.: shader/simple.vert)
+    std::vector<unsigned char> data;
+    AssetCompression compression = AssetCompression::NONE;
+};
+
+/// <summary>
+///
+/// Packed, memory mapped archive of the shaders and textures.
+/// <para>Layout: 32 byte header | table of contents (ArchiveEntry, sorted by name) | name table | data. Every entry
+/// starts at a multiple of the alignment, so its bytes can be handed to the driver or to SIMD code straight from the
+/// mapping. The archive is opened with MappedFile, view() returns the stored bytes without copying them.
+/// LZ4 compressed entries are decompressed on the first view() and kept until close().</para>
+/// <para>view() may be called from several threads, the loose files are used for names that are not in the archive
+/// (see Shader::setAssetArchive and TextureLoader::setArchive). tools/assetPacker.cpp creates the archive.</para>
+///
+/// </summary>
+class AssetArchive
+{
+public:
+    static const uint32_t MAGIC = 0x4B415047; // "GPAK"
+    static const uint32_t VERSION = 1;
+    static const uint32_t DEFAULT_ALIGNMENT = 64;
+
+    AssetArchive() = default;
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    /*
+    * @brief	map the archive and validate its table of contents
+    *
+    * @return	returns false and prints the reason if the file is not a valid archive
+    */
+    bool open(const char* path)
+    {
+        close();
+        if (!file.open(path))
+        {
+            return false;
+        }
+        const unsigned char* bytes = file.data();
+        size_t size = file.size();
+        if (size < HEADER_SIZE || read<uint32_t>(bytes) != MAGIC || read<uint32_t>(bytes + 4) != VERSION)
+        {
+            std::cout << "ERROR Asset archive: not an archive of version " << VERSION << " (Path: " << path << " )" << std::endl;
+            close();
+            return false;
+        }
+        uint32_t count = read<uint32_t>(bytes + 8);
+        uint32_t nameTableSize = read<uint32_t>(bytes + 16);
+        uint64_t tableEnd = HEADER_SIZE + static_cast<uint64_t>(count) * ENTRY_SIZE;
+        if (tableEnd + nameTableSize > size)
+        {
+            std::cout << "ERROR Asset archive: table of contents is truncated (Path: " << path << " )" << std::endl;
+            close();
+            return false;
+        }
+        alignment = read<uint32_t>(bytes + 12);
+        names = reinterpret_cast<const char*>(bytes + tableEnd);
+
+        entries.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const unsigned char* record = bytes + HEADER_SIZE + static_cast<size_t>(i) * ENTRY_SIZE;
+            ArchiveEntry& entry = entries[i];
+            entry.offset = read<uint64_t>(record);
+            entry.size = read<uint64_t>(record + 8);
+            entry.originalSize = read<uint64_t>(record + 16);
+            entry.nameOffset = read<uint32_t>(record + 24);
+            entry.nameLength = read<uint16_t>(record + 28);
+            entry.compression = static_cast<AssetCompression>(read<uint16_t>(record + 30));
+            bool valid = entry.offset <= size && entry.size <= size - entry.offset
+                && static_cast<uint64_t>(entry.nameOffset) + entry.nameLength <= nameTableSize
+                && (entry.compression == AssetCompression::LZ4 || (entry.compression == AssetCompression::NONE && entry.size == entry.originalSize));
+            if (!valid || (i > 0 && getName(entries[i - 1]) >= getName(entry)))
+            {
+                std::cout << "ERROR Asset archive: entry " << i << " is invalid (Path: " << path << " )" << std::endl;
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decompressed.clear();
+        entries.clear();
+        names = NULL;
+        alignment = 0;
+        file.close();
+    }
+
+    bool isOpen() const
+    {
+        return file.isOpen();
+    }
+
+    /*
+    * @brief	binary search in the table of contents
+    *
+    * @return	returns NULL if the archive doesn't contain the name
+    */
+    const ArchiveEntry* find(std::string_view name) const
+    {
+        std::vector<ArchiveEntry>::const_iterator entry = std::lower_bound(entries.begin(), entries.end(), name,
+            [this](const ArchiveEntry& entry, std::string_view name) { return getName(entry) < name; });
+        return entry != entries.end() && getName(*entry) == name ? &*entry : NULL;
+    }
+
+    /*
+    * @brief	bytes of an entry, uncompressed entries point directly into the mapping
+    *
+    * @return	returns a view with data() == NULL if the archive doesn't contain the name or it can't be decompressed
+    */
+    std::string_view view(std::string_view name)
+    {
+        const ArchiveEntry* entry = find(name);
+        if (entry == NULL)
+        {
+            return std::string_view();
+        }
+        const char* stored = reinterpret_cast<const char*>(file.data() + entry->offset);
+        if (entry->compression == AssetCompression::NONE)
+        {
+            return std::string_view(stored, static_cast<size_t>(entry->size));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<std::vector<unsigned char>>& bytes = decompressed[entry];
+        if (bytes == NULL)
+        {
+            // +1 so data() is never NULL for empty files
+            std::unique_ptr<std::vector<unsigned char>> output = std::make_unique<std::vector<unsigned char>>(static_cast<size_t>(entry->originalSize) + 1);
+            if (!Lz4::decompress(reinterpret_cast<const unsigned char*>(stored), static_cast<size_t>(entry->size), output->data(), static_cast<size_t>(entry->originalSize)))
+            {
+                std::cout << "ERROR Asset archive: entry is corrupted (Name: " << name << " )" << std::endl;
+                decompressed.erase(entry);
+                return std::string_view();
+            }
+            bytes = std::move(output);
+        }
+        return std::string_view(reinterpret_cast<const char*>(bytes->data()), static_cast<size_t>(entry->originalSize));
+    }
+
+    const std::vector<ArchiveEntry>& getEntries() const
+    {
+        return entries;
+    }
+
+    std::string_view getName(const ArchiveEntry& entry) const
+    {
+        return std::string_view(names + entry.nameOffset, entry.nameLength);
+    }
+
+    uint32_t getAlignment() const
+    {
+        return alignment;
+    }
+
+    /*
+    * @brief	advise the OS to read the whole archive ahead, useful right before a loading screen
+    */
+    void prefetch() const
+    {
+        file.prefetch();
+    }
+
+    /*
+    * @brief	write an archive, LZ4 entries that don't get smaller are stored uncompressed
+    *
+    * @param	alignment	power of two every entry offset is a multiple of
+    */
+    static bool write(const char* path, std::vector<ArchiveInput> inputs, uint32_t alignment = DEFAULT_ALIGNMENT)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        {
+            std::cout << "ERROR Asset archive: alignment " << alignment << " is not a power of two" << std::endl;
+            return false;
+        }
+        std::sort(inputs.begin(), inputs.end(), [](const ArchiveInput& a, const ArchiveInput& b) { return a.name < b.name; });
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            if (inputs[i].name.size() > 0xFFFF || (i > 0 && inputs[i - 1].name == inputs[i].name))
+            {
+                std::cout << "ERROR Asset archive: name is too long or used twice (Name: " << inputs[i].name << " )" << std::endl;
+                return false;
+            }
+        }
+
+        std::string nameTable;
+        std::vector<ArchiveEntry> table(inputs.size());
+        std::vector<std::vector<unsigned char>> compressed(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            ArchiveEntry& entry = table[i];
+            entry.nameOffset = static_cast<uint32_t>(nameTable.size());
+            entry.nameLength = static_cast<uint16_t>(inputs[i].name.size());
+            nameTable += inputs[i].name;
+            entry.originalSize = inputs[i].data.size();
+            entry.size = entry.originalSize;
+            entry.compression = AssetCompression::NONE;
+            if (inputs[i].compression == AssetCompression::LZ4)
+            {
+                Lz4::compress(inputs[i].data.data(), inputs[i].data.size(), compressed[i]);
+                if (compressed[i].size() < inputs[i].data.size())
+                {
+                    entry.size = compressed[i].size();
+                    entry.compression = AssetCompression::LZ4;
+                }
+            }
+        }
+
+        uint64_t offset = HEADER_SIZE + table.size() * ENTRY_SIZE + nameTable.size();
+        for (ArchiveEntry& entry : table)
+        {
+            offset = alignUp(offset, alignment);
+            entry.offset = offset;
+            offset += entry.size;
+        }
+
+        std::ofstream output(path, std::ios::binary);
+        std::vector<unsigned char> header(HEADER_SIZE, 0);
+        store<uint32_t>(header.data(), MAGIC);
+        store<uint32_t>(header.data() + 4, VERSION);
+        store<uint32_t>(header.data() + 8, static_cast<uint32_t>(table.size()));
+        store<uint32_t>(header.data() + 12, alignment);
+        store<uint32_t>(header.data() + 16, static_cast<uint32_t>(nameTable.size()));
+        output.write(reinterpret_cast<const char*>(header.data()), HEADER_SIZE);
+        for (const ArchiveEntry& entry : table)
+        {
+            unsigned char record[ENTRY_SIZE];
+            store<uint64_t>(record, entry.offset);
+            store<uint64_t>(record + 8, entry.size);
+            store<uint64_t>(record + 16, entry.originalSize);
+            store<uint32_t>(record + 24, entry.nameOffset);
+            store<uint16_t>(record + 28, entry.nameLength);
+            store<uint16_t>(record + 30, static_cast<uint16_t>(entry.compression));
+            output.write(reinterpret_cast<const char*>(record), ENTRY_SIZE);
+        }
+        output.write(nameTable.data(), static_cast<std::streamsize>(nameTable.size()));
+
+        uint64_t position = HEADER_SIZE + table.size() * ENTRY_SIZE + nameTable.size();
+        const char padding[256] = {};
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            while (position < table[i].offset)
+            {
+                uint64_t count = std::min<uint64_t>(sizeof(padding), table[i].offset - position);
+                output.write(padding, static_cast<std::streamsize>(count));
+                position += count;
+            }
+            const std::vector<unsigned char>& data = table[i].compression == AssetCompression::LZ4 ? compressed[i] : inputs[i].data;
+            output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            position += data.size();
+        }
+        if (!output)
+        {
+            std::cout << "ERROR couldn't write File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const size_t HEADER_SIZE = 32;
+    static const size_t ENTRY_SIZE = 32;
+
+    MappedFile file;
+    std::vector<ArchiveEntry> entries;
+    const char* names = NULL;
+    uint32_t alignment = 0;
+
+    // decompressed LZ4 entries, guarded by mutex
+    std::mutex mutex;
+    std::map<const ArchiveEntry*, std::unique_ptr<std::vector<unsigned char>>> decompressed;
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    template<typename T>
+    static T read(const unsigned char* bytes)
+    {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    static void store(unsigned char* bytes, T value)
+    {
+        std::memcpy(bytes, &value, sizeof(T));
+    }
+};
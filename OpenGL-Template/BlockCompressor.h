@@ -0,0 +1,506 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include "MipGenerator.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+/// <summary>
+///
+/// CPU encoder for the block compressed formats BC1 (RGB, 8 bytes per 4x4 block), BC3 (BC1 color + BC4 alpha,
+/// 16 bytes) and BC7 (mode 6 only: one RGBA subset with 4 bit indices, 16 bytes).
+/// <para>Endpoints are fitted along the principal axis of the block colors, BC1 refines them once with least
+/// squares. The encoder is meant for offline conversion (tools/textureCompressor.cpp), not for load time.</para>
+///
+/// </summary>
+class BlockCompressor
+{
+public:
+    /*
+    * @param	rgba	16 RGBA8 pixels, row by row
+    * @param	output	8 bytes
+    */
+    static void encodeBC1(const unsigned char* rgba, unsigned char* output)
+    {
+        float colors[16][3];
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                colors[i][c] = rgba[i * 4 + c];
+            }
+        }
+        float minColor[3], maxColor[3];
+        fitEndpoints<3>(colors, minColor, maxColor);
+
+        // inset the endpoints a bit, the extremes are rarely hit exactly after quantization
+        for (int c = 0; c < 3; c++)
+        {
+            float inset = (maxColor[c] - minColor[c]) / 16.0f;
+            minColor[c] = std::min(255.0f, minColor[c] + inset);
+            maxColor[c] = std::max(0.0f, maxColor[c] - inset);
+        }
+
+        unsigned int indices[16];
+        uint16_t color0 = packRGB565(maxColor), color1 = packRGB565(minColor);
+        float error = fitIndicesBC1(colors, color0, color1, indices);
+
+        // least squares refinement of the endpoints for the chosen indices
+        static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float a = WEIGHTS[indices[i]], b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += a * colors[i][c];
+                bx[c] += b * colors[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f)
+        {
+            float refined0[3], refined1[3];
+            for (int c = 0; c < 3; c++)
+            {
+                refined0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+                refined1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+            }
+            unsigned int refinedIndices[16];
+            uint16_t refinedColor0 = packRGB565(refined0), refinedColor1 = packRGB565(refined1);
+            float refinedError = fitIndicesBC1(colors, refinedColor0, refinedColor1, refinedIndices);
+            if (refinedError < error)
+            {
+                color0 = refinedColor0;
+                color1 = refinedColor1;
+                std::memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+
+        // color0 > color1 selects the four color mode
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            for (unsigned int& index : indices)
+            {
+                index ^= 1; // 0 <-> 1 and 2 <-> 3
+            }
+        }
+        uint32_t indexBits = 0;
+        if (color0 != color1)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                indexBits |= indices[i] << (2 * i);
+            }
+        }
+        output[0] = static_cast<unsigned char>(color0 & 0xFF);
+        output[1] = static_cast<unsigned char>(color0 >> 8);
+        output[2] = static_cast<unsigned char>(color1 & 0xFF);
+        output[3] = static_cast<unsigned char>(color1 >> 8);
+        std::memcpy(output + 4, &indexBits, 4);
+    }
+
+    /*
+    * @param	rgba	16 RGBA8 pixels, row by row
+    * @param	output	16 bytes, BC4 alpha block followed by the BC1 color block
+    */
+    static void encodeBC3(const unsigned char* rgba, unsigned char* output)
+    {
+        unsigned char alpha0 = 0, alpha1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, rgba[i * 4 + 3]);
+            alpha1 = std::min(alpha1, rgba[i * 4 + 3]);
+        }
+        output[0] = alpha0;
+        output[1] = alpha1;
+        uint64_t indexBits = 0;
+        if (alpha0 > alpha1)
+        {
+            // eight value mode: index 0 = alpha0, 1 = alpha1, 2..7 interpolate from alpha0 to alpha1
+            int palette[8] = { alpha0, alpha1 };
+            for (int i = 1; i < 7; i++)
+            {
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int alpha = rgba[i * 4 + 3];
+                uint64_t best = 0;
+                int bestError = 256;
+                for (int j = 0; j < 8; j++)
+                {
+                    int error = std::abs(palette[j] - alpha);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = static_cast<uint64_t>(j);
+                    }
+                }
+                indexBits |= best << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            output[2 + i] = static_cast<unsigned char>(indexBits >> (8 * i));
+        }
+        encodeBC1(rgba, output + 8);
+    }
+
+    /*
+    * @param	rgba	16 RGBA8 pixels, row by row
+    * @param	output	16 bytes, a mode 6 block
+    */
+    static void encodeBC7(const unsigned char* rgba, unsigned char* output)
+    {
+        static const int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        float colors[16][4];
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                colors[i][c] = rgba[i * 4 + c];
+            }
+        }
+        float endpoint0[4], endpoint1[4];
+        fitEndpoints<4>(colors, endpoint0, endpoint1);
+
+        // endpoints are 7 bits per channel plus one shared p-bit per endpoint, try all four p-bit combinations
+        int bestError = -1;
+        int bestQuantized[2][4] = {};
+        int bestPBits[2] = {};
+        unsigned int bestIndices[16] = {};
+        for (int pBits = 0; pBits < 4; pBits++)
+        {
+            int p[2] = { pBits & 1, pBits >> 1 };
+            int quantized[2][4];
+            int expanded[2][4];
+            for (int c = 0; c < 4; c++)
+            {
+                const float* endpoints[2] = { endpoint0, endpoint1 };
+                for (int e = 0; e < 2; e++)
+                {
+                    quantized[e][c] = std::min(127, std::max(0, static_cast<int>(std::lround((endpoints[e][c] - p[e]) / 2.0f))));
+                    expanded[e][c] = (quantized[e][c] << 1) | p[e];
+                }
+            }
+            int palette[16][4];
+            for (int j = 0; j < 16; j++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    palette[j][c] = ((64 - WEIGHTS[j]) * expanded[0][c] + WEIGHTS[j] * expanded[1][c] + 32) >> 6;
+                }
+            }
+            int error = 0;
+            unsigned int indices[16];
+            for (int i = 0; i < 16; i++)
+            {
+                int bestPixelError = -1;
+                for (unsigned int j = 0; j < 16; j++)
+                {
+                    int pixelError = 0;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int difference = palette[j][c] - rgba[i * 4 + c];
+                        pixelError += difference * difference;
+                    }
+                    if (bestPixelError < 0 || pixelError < bestPixelError)
+                    {
+                        bestPixelError = pixelError;
+                        indices[i] = j;
+                    }
+                }
+                error += bestPixelError;
+            }
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                std::memcpy(bestQuantized, quantized, sizeof(quantized));
+                bestPBits[0] = p[0];
+                bestPBits[1] = p[1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+
+        // the most significant bit of the first index is implicit 0, swap the endpoints if it is set
+        if (bestIndices[0] & 8)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+            }
+            std::swap(bestPBits[0], bestPBits[1]);
+            for (unsigned int& index : bestIndices)
+            {
+                index = 15 - index;
+            }
+        }
+
+        uint64_t bits[2] = { 0, 0 };
+        unsigned int position = 0;
+        writeBits(bits, position, 1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writeBits(bits, position, bestQuantized[0][c], 7);
+            writeBits(bits, position, bestQuantized[1][c], 7);
+        }
+        writeBits(bits, position, bestPBits[0], 1);
+        writeBits(bits, position, bestPBits[1], 1);
+        writeBits(bits, position, bestIndices[0], 3);
+        for (int i = 1; i < 16; i++)
+        {
+            writeBits(bits, position, bestIndices[i], 4);
+        }
+        std::memcpy(output, bits, 16);
+    }
+
+    /*
+    * @brief	compress an RGBA8 image and its mip chain (generated by MipGenerator), the block rows are encoded in parallel
+    *
+    * @param	internalFormat	GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_BPTC_UNORM or their sRGB variants
+    * @param	pool	optional, encodes on the calling thread if NULL
+    */
+    static bool compress(GLenum internalFormat, const unsigned char* rgba, int width, int height, bool mipmaps, CompressedImage& image, ThreadPool* pool = NULL,
+        const MipSettings& mipSettings = MipSettings())
+    {
+        void (*encode)(const unsigned char*, unsigned char*) = getEncoder(internalFormat);
+        if (encode == NULL)
+        {
+            std::cout << "ERROR BlockCompressor: the format 0x" << std::hex << internalFormat << std::dec << " has no encoder" << std::endl;
+            return false;
+        }
+        unsigned int blockSize = TextureContainer::getBlockSize(internalFormat);
+        image.internalFormat = internalFormat;
+        image.width = width;
+        image.height = height;
+        image.levels.clear();
+        image.data.clear();
+
+        MipChain mips;
+        if (mipmaps)
+        {
+            MipGenerator::generate(rgba, width, height, mipSettings, mips, pool);
+        }
+        for (size_t levelIndex = 0; ; levelIndex++)
+        {
+            CompressedLevel compressed;
+            compressed.offset = image.data.size();
+            compressed.size = TextureContainer::getLevelSize(internalFormat, width, height);
+            compressed.width = width;
+            compressed.height = height;
+            image.data.resize(compressed.offset + compressed.size);
+            image.levels.push_back(compressed);
+
+            int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+            unsigned char* blocks = image.data.data() + compressed.offset;
+            const unsigned char* pixels = mipmaps ? mips.data.data() + mips.levels[levelIndex].offset : rgba;
+            int levelWidth = width, levelHeight = height;
+            auto encodeRow = [&](size_t blockY)
+            {
+                unsigned char block[64];
+                for (int blockX = 0; blockX < blocksX; blockX++)
+                {
+                    // blocks at the right and top edge repeat the last row and column
+                    for (int y = 0; y < 4; y++)
+                    {
+                        int sourceY = std::min(static_cast<int>(blockY) * 4 + y, levelHeight - 1);
+                        for (int x = 0; x < 4; x++)
+                        {
+                            int sourceX = std::min(blockX * 4 + x, levelWidth - 1);
+                            std::memcpy(block + (y * 4 + x) * 4, pixels + (static_cast<size_t>(sourceY) * levelWidth + sourceX) * 4, 4);
+                        }
+                    }
+                    encode(block, blocks + (blockY * blocksX + blockX) * blockSize);
+                }
+            };
+            if (pool != NULL)
+            {
+                pool->parallelFor(0, blocksY, encodeRow, 1);
+            }
+            else
+            {
+                for (int blockY = 0; blockY < blocksY; blockY++)
+                {
+                    encodeRow(blockY);
+                }
+            }
+
+            if (!mipmaps || levelIndex + 1 == mips.levels.size())
+            {
+                break;
+            }
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return true;
+    }
+
+private:
+    static void (*getEncoder(GLenum internalFormat))(const unsigned char*, unsigned char*)
+    {
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            return encodeBC1;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return encodeBC3;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return encodeBC7;
+        default:
+            return NULL;
+        }
+    }
+
+    /*
+    * @brief	end points of the colors along their principal axis (power iteration on the covariance matrix)
+    */
+    template<int N>
+    static void fitEndpoints(const float (*colors)[N], float* minColor, float* maxColor)
+    {
+        float mean[N] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < N; c++)
+            {
+                mean[c] += colors[i][c] / 16.0f;
+            }
+        }
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            for (int a = 0; a < N; a++)
+            {
+                for (int b = 0; b < N; b++)
+                {
+                    covariance[a][b] += (colors[i][a] - mean[a]) * (colors[i][b] - mean[b]);
+                }
+            }
+        }
+        float axis[N];
+        for (int c = 0; c < N; c++)
+        {
+            axis[c] = 1.0f;
+        }
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int a = 0; a < N; a++)
+            {
+                for (int b = 0; b < N; b++)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length = std::max(length, std::fabs(next[a]));
+            }
+            if (length < 1e-6f)
+            {
+                break;
+            }
+            for (int c = 0; c < N; c++)
+            {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float minT = 0.0f, maxT = 0.0f, axisLength = 0.0f;
+        for (int c = 0; c < N; c++)
+        {
+            axisLength += axis[c] * axis[c];
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; c++)
+            {
+                t += (colors[i][c] - mean[c]) * axis[c];
+            }
+            t /= axisLength;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (int c = 0; c < N; c++)
+        {
+            minColor[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT));
+            maxColor[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT));
+        }
+    }
+
+    static uint16_t packRGB565(const float* color)
+    {
+        int r = static_cast<int>(std::lround(color[0] * 31.0f / 255.0f));
+        int g = static_cast<int>(std::lround(color[1] * 63.0f / 255.0f));
+        int b = static_cast<int>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    static void unpackRGB565(uint16_t color, float* rgb)
+    {
+        int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+        rgb[0] = static_cast<float>(r << 3 | r >> 2);
+        rgb[1] = static_cast<float>(g << 2 | g >> 4);
+        rgb[2] = static_cast<float>(b << 3 | b >> 2);
+    }
+
+    /*
+    * @brief	choose the nearest of the four palette colors for every pixel
+    *
+    * @return	returns the squared error of the block
+    */
+    static float fitIndicesBC1(const float (*colors)[3], uint16_t color0, uint16_t color1, unsigned int* indices)
+    {
+        float palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        float total = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float bestError = -1.0f;
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                float error = 0.0f;
+                for (int c = 0; c < 3; c++)
+                {
+                    float difference = palette[j][c] - colors[i][c];
+                    error += difference * difference;
+                }
+                if (bestError < 0.0f || error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = j;
+                }
+            }
+            total += bestError;
+        }
+        return total;
+    }
+
+    static void writeBits(uint64_t* bits, unsigned int& position, uint64_t value, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++, position++)
+        {
+            bits[position / 64] |= ((value >> i) & 1) << (position % 64);
+        }
+    }
+};
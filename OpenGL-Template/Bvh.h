@@ -0,0 +1,628 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+/// node of the hierarchy, 32 bytes. Inner nodes have count 0 and their children at first and first + 1,
+/// leaves reference count entries of the primitive order starting at first
+struct BvhNode
+{
+    glm::vec3 minimum;
+    unsigned int first;
+    glm::vec3 maximum;
+    unsigned int count;
+
+    bool isLeaf() const
+    {
+        return count > 0;
+    }
+};
+
+struct BvhRayHit
+{
+    unsigned int index = ~0U; // object index, ~0U if nothing was hit
+    float distance = std::numeric_limits<float>::infinity(); // along the ray, in units of the direction length
+};
+
+/// <summary>
+///
+/// Bounding volume hierarchy over axis aligned boxes (BoundingBoxes of FrustumCuller.h) for the scene queries:
+/// hierarchical frustum culling, ray casts and nearest object queries, all of them skip whole subtrees and are
+/// sublinear in the object count.
+/// <para>build() splits the nodes with the surface area heuristic over SAH_BINS bins along the largest axis of the
+/// centroid bounds. Large nodes are binned in parallel and the two subtrees of a node are built as separate tasks
+/// on the ThreadPool, so the build scales with the cores.</para>
+/// <para>refit() updates the bounds bottom up after objects moved, the tree structure is kept. That is much cheaper
+/// than a rebuild, but the quality of the tree degrades when the objects move far, rebuild then.</para>
+///
+/// </summary>
+class Bvh
+{
+public:
+    static const unsigned int MAX_LEAF_SIZE = 4;
+    static const unsigned int MAX_DEPTH = 64;
+
+    /*
+    * @param	pool	optional, builds on the calling thread if NULL
+    */
+    void build(const BoundingBoxes& boxes, ThreadPool* pool = NULL)
+    {
+        size_t count = boxes.size();
+        order.resize(count);
+        primitiveBounds.resize(count);
+        references.resize(count);
+        nodes.clear();
+        if (count == 0)
+        {
+            return;
+        }
+        nodes.resize(2 * count - 1); // a binary tree with at most count leaves
+        forRange(pool, count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                references[i].box = getBox(boxes, i);
+                references[i].index = static_cast<unsigned int>(i);
+            }
+        });
+
+        nodeCount = 1;
+        buildNode(pool, 0, 0, count, 0);
+        nodes.resize(nodeCount);
+        // the references are in leaf order now, the leaves read their boxes sequentially
+        forRange(pool, count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                order[i] = references[i].index;
+                primitiveBounds[i] = references[i].box;
+            }
+        });
+        references = std::vector<Reference>();
+    }
+
+    /*
+    * @brief	update the bounds after the boxes changed, boxes has to hold the same objects as at build()
+    */
+    void refit(const BoundingBoxes& boxes)
+    {
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            primitiveBounds[i] = getBox(boxes, order[i]);
+        }
+        // children are always stored behind their parent, so a reverse sweep visits them first
+        for (size_t n = nodes.size(); n-- > 0; )
+        {
+            BvhNode& node = nodes[n];
+            if (node.isLeaf())
+            {
+                node.minimum = primitiveBounds[node.first].minimum;
+                node.maximum = primitiveBounds[node.first].maximum;
+                for (unsigned int i = 1; i < node.count; i++)
+                {
+                    node.minimum = glm::min(node.minimum, primitiveBounds[node.first + i].minimum);
+                    node.maximum = glm::max(node.maximum, primitiveBounds[node.first + i].maximum);
+                }
+            }
+            else
+            {
+                node.minimum = glm::min(nodes[node.first].minimum, nodes[node.first + 1].minimum);
+                node.maximum = glm::max(nodes[node.first].maximum, nodes[node.first + 1].maximum);
+            }
+        }
+    }
+
+    /*
+    * @brief	hierarchical frustum culling: subtrees completely inside are taken without further tests, planes a
+    *			node is completely in front of are not tested again for its children. The nearer child is visited
+    *			first, so the visible objects come roughly front to back and the depth test rejects more fragments
+    *
+    * @param	visible	is grown to hold every object, the first returned count entries are the visible indices
+    *
+    * @return	returns the number of visible objects
+    */
+    size_t cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+    {
+        if (visible.size() < order.size())
+        {
+            visible.resize(order.size());
+        }
+        size_t visibleCount = 0;
+        if (nodes.empty())
+        {
+            return 0;
+        }
+        const unsigned int ALL_PLANES = (1 << 6) - 1;
+        struct Entry
+        {
+            unsigned int node;
+            unsigned int planes; // bit p set: the node can still intersect plane p
+        };
+        Entry stack[MAX_DEPTH + 1];
+        unsigned int stackSize = 0;
+        stack[stackSize++] = { 0, ALL_PLANES };
+        while (stackSize > 0)
+        {
+            Entry entry = stack[--stackSize];
+            const BvhNode& node = nodes[entry.node];
+            unsigned int planes = classify(frustum, node.minimum, node.maximum, entry.planes);
+            if (planes == OUTSIDE)
+            {
+                continue;
+            }
+            if (planes == 0 || node.isLeaf())
+            {
+                unsigned int first = planes == 0 ? getFirstPrimitive(entry.node) : node.first;
+                unsigned int last = planes == 0 ? getLastPrimitive(entry.node) : node.first + node.count;
+                for (unsigned int i = first; i < last; i++)
+                {
+                    visible[visibleCount] = order[i];
+                    visibleCount += planes == 0 || classify(frustum, primitiveBounds[i].minimum, primitiveBounds[i].maximum, planes) != OUTSIDE ? 1 : 0;
+                }
+                continue;
+            }
+            // the normal of the near plane is the view direction, push the farther child first
+            const BvhNode& left = nodes[node.first];
+            const BvhNode& right = nodes[node.first + 1];
+            glm::vec3 offset = (left.minimum + left.maximum) - (right.minimum + right.maximum);
+            bool leftFirst = glm::dot(glm::vec3(frustum.planes[4]), offset) <= 0.0f;
+            stack[stackSize++] = { leftFirst ? node.first + 1 : node.first, planes };
+            stack[stackSize++] = { leftFirst ? node.first : node.first + 1, planes };
+        }
+        return visibleCount;
+    }
+
+    /*
+    * @brief	closest box hit by the ray origin + t * direction with 0 <= t <= maxDistance, the closer child is
+    *			visited first and nodes behind the closest hit so far are skipped
+    *
+    * @return	returns false if the ray misses every box
+    */
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& hit) const
+    {
+        hit = BvhRayHit();
+        if (nodes.empty())
+        {
+            return false;
+        }
+        glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        float closest = maxDistance;
+        unsigned int stack[MAX_DEPTH + 1];
+        unsigned int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            if (intersect(origin, inverse, node.minimum, node.maximum, closest) > closest)
+            {
+                continue;
+            }
+            if (node.isLeaf())
+            {
+                for (unsigned int i = node.first; i < node.first + node.count; i++)
+                {
+                    float distance = intersect(origin, inverse, primitiveBounds[i].minimum, primitiveBounds[i].maximum, closest);
+                    if (distance <= closest)
+                    {
+                        closest = distance;
+                        hit.index = order[i];
+                        hit.distance = distance;
+                    }
+                }
+                continue;
+            }
+            const BvhNode& left = nodes[node.first];
+            const BvhNode& right = nodes[node.first + 1];
+            float leftDistance = intersect(origin, inverse, left.minimum, left.maximum, closest);
+            float rightDistance = intersect(origin, inverse, right.minimum, right.maximum, closest);
+            // push the far child first so the near one is popped next
+            if (leftDistance <= rightDistance)
+            {
+                pushIfHit(stack, stackSize, node.first + 1, rightDistance, closest);
+                pushIfHit(stack, stackSize, node.first, leftDistance, closest);
+            }
+            else
+            {
+                pushIfHit(stack, stackSize, node.first, leftDistance, closest);
+                pushIfHit(stack, stackSize, node.first + 1, rightDistance, closest);
+            }
+        }
+        return hit.index != ~0U;
+    }
+
+    /*
+    * @brief	object whose box is closest to point, 0 if point is inside a box
+    *
+    * @return	returns false if no box is within maxDistance
+    */
+    bool nearest(const glm::vec3& point, float maxDistance, unsigned int& index, float& distance) const
+    {
+        index = ~0U;
+        float closest = maxDistance * maxDistance; // squared distances during the search
+        unsigned int stack[MAX_DEPTH + 1];
+        unsigned int stackSize = 0;
+        if (!nodes.empty())
+        {
+            stack[stackSize++] = 0;
+        }
+        while (stackSize > 0)
+        {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            if (getDistanceSquared(point, node.minimum, node.maximum) > closest)
+            {
+                continue;
+            }
+            if (node.isLeaf())
+            {
+                for (unsigned int i = node.first; i < node.first + node.count; i++)
+                {
+                    float candidate = getDistanceSquared(point, primitiveBounds[i].minimum, primitiveBounds[i].maximum);
+                    if (candidate <= closest)
+                    {
+                        closest = candidate;
+                        index = order[i];
+                    }
+                }
+                continue;
+            }
+            float leftDistance = getDistanceSquared(point, nodes[node.first].minimum, nodes[node.first].maximum);
+            float rightDistance = getDistanceSquared(point, nodes[node.first + 1].minimum, nodes[node.first + 1].maximum);
+            if (leftDistance <= rightDistance)
+            {
+                pushIfHit(stack, stackSize, node.first + 1, rightDistance, closest);
+                pushIfHit(stack, stackSize, node.first, leftDistance, closest);
+            }
+            else
+            {
+                pushIfHit(stack, stackSize, node.first, leftDistance, closest);
+                pushIfHit(stack, stackSize, node.first + 1, rightDistance, closest);
+            }
+        }
+        distance = std::sqrt(closest);
+        return index != ~0U;
+    }
+
+    const std::vector<BvhNode>& getNodes() const
+    {
+        return nodes;
+    }
+
+    /*
+    * @brief	SAH cost of the tree relative to the root area, lower is better (E.g.: to decide between refit and rebuild)
+    */
+    float getCost() const
+    {
+        if (nodes.empty())
+        {
+            return 0.0f;
+        }
+        float cost = 0.0f;
+        for (const BvhNode& node : nodes)
+        {
+            cost += getArea(node.minimum, node.maximum) * (node.isLeaf() ? static_cast<float>(node.count) : TRAVERSAL_COST);
+        }
+        return cost / std::max(getArea(nodes[0].minimum, nodes[0].maximum), 1e-20f);
+    }
+
+private:
+    static const unsigned int SAH_BINS = 16;
+    static const size_t PARALLEL_SIZE = 1 << 14; // nodes with more objects are binned and split up in parallel
+    static const unsigned int OUTSIDE = ~0U;
+    static constexpr float TRAVERSAL_COST = 1.0f; // relative to one box test
+
+    struct Box
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+    };
+
+    struct Reference
+    {
+        Box box;
+        unsigned int index;
+
+        // twice the center, the factor doesn't matter for binning
+        glm::vec3 getCentroid() const
+        {
+            return box.minimum + box.maximum;
+        }
+    };
+
+    struct Bin
+    {
+        glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 maximum = glm::vec3(-std::numeric_limits<float>::max());
+        size_t count = 0;
+
+        void grow(const glm::vec3& boxMinimum, const glm::vec3& boxMaximum)
+        {
+            minimum = glm::min(minimum, boxMinimum);
+            maximum = glm::max(maximum, boxMaximum);
+        }
+    };
+
+    std::vector<BvhNode> nodes;
+    std::vector<unsigned int> order; // object indices in leaf order
+    std::vector<Box> primitiveBounds; // boxes in leaf order
+    std::vector<Reference> references; // only during the build, partitioned into leaf order
+    std::atomic<unsigned int> nodeCount{ 0 };
+
+    static Box getBox(const BoundingBoxes& boxes, size_t index)
+    {
+        glm::vec3 center(boxes.centerX[index], boxes.centerY[index], boxes.centerZ[index]);
+        glm::vec3 extent(boxes.extentX[index], boxes.extentY[index], boxes.extentZ[index]);
+        return { center - extent, center + extent };
+    }
+
+    static float getArea(const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        glm::vec3 size = glm::max(maximum - minimum, glm::vec3(0.0f));
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    /*
+    * @brief	call function(begin, end) for parts of [0, count), in parallel if count is large
+    */
+    template<class Function>
+    static void forRange(ThreadPool* pool, size_t count, const Function& function)
+    {
+        if (pool == NULL || count < PARALLEL_SIZE)
+        {
+            function(0, count);
+            return;
+        }
+        size_t parts = (count + PARALLEL_SIZE - 1) / PARALLEL_SIZE;
+        pool->parallelFor(0, parts, [&](size_t part)
+        {
+            function(part * count / parts, (part + 1) * count / parts);
+        }, 1);
+    }
+
+    /*
+    * @brief	bounds and centroid bounds of references[begin, end)
+    */
+    void computeBounds(ThreadPool* pool, size_t begin, size_t end, Bin& bounds, Bin& centroidBounds) const
+    {
+        size_t count = end - begin;
+        if (pool == NULL || count < PARALLEL_SIZE)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                glm::vec3 centroid = references[i].getCentroid();
+                bounds.grow(references[i].box.minimum, references[i].box.maximum);
+                centroidBounds.grow(centroid, centroid);
+            }
+            return;
+        }
+        size_t parts = (count + PARALLEL_SIZE - 1) / PARALLEL_SIZE;
+        std::vector<Bin> partBounds(parts), partCentroids(parts);
+        pool->parallelFor(0, parts, [&](size_t part)
+        {
+            computeBounds(NULL, begin + part * count / parts, begin + (part + 1) * count / parts, partBounds[part], partCentroids[part]);
+        }, 1);
+        for (size_t part = 0; part < parts; part++)
+        {
+            bounds.grow(partBounds[part].minimum, partBounds[part].maximum);
+            centroidBounds.grow(partCentroids[part].minimum, partCentroids[part].maximum);
+        }
+    }
+
+    /*
+    * @brief	bin references[begin, end) by their centroid along axis
+    */
+    void binReferences(ThreadPool* pool, size_t begin, size_t end, int axis, float origin, float scale, Bin* bins) const
+    {
+        size_t count = end - begin;
+        if (pool == NULL || count < PARALLEL_SIZE)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                Bin& bin = bins[getBin(references[i].getCentroid()[axis], origin, scale)];
+                bin.grow(references[i].box.minimum, references[i].box.maximum);
+                bin.count++;
+            }
+            return;
+        }
+        size_t parts = (count + PARALLEL_SIZE - 1) / PARALLEL_SIZE;
+        std::vector<Bin> partBins(parts * SAH_BINS);
+        pool->parallelFor(0, parts, [&](size_t part)
+        {
+            binReferences(NULL, begin + part * count / parts, begin + (part + 1) * count / parts, axis, origin, scale, &partBins[part * SAH_BINS]);
+        }, 1);
+        for (size_t part = 0; part < parts; part++)
+        {
+            for (unsigned int b = 0; b < SAH_BINS; b++)
+            {
+                const Bin& local = partBins[part * SAH_BINS + b];
+                bins[b].grow(local.minimum, local.maximum);
+                bins[b].count += local.count;
+            }
+        }
+    }
+
+    static unsigned int getBin(float centroid, float origin, float scale)
+    {
+        int bin = static_cast<int>((centroid - origin) * scale);
+        return static_cast<unsigned int>(std::min(std::max(bin, 0), static_cast<int>(SAH_BINS) - 1));
+    }
+
+    void buildNode(ThreadPool* pool, unsigned int nodeIndex, size_t begin, size_t end, unsigned int depth)
+    {
+        Bin bounds, centroidBounds;
+        computeBounds(pool, begin, end, bounds, centroidBounds);
+        BvhNode& node = nodes[nodeIndex];
+        node.minimum = bounds.minimum;
+        node.maximum = bounds.maximum;
+        node.first = static_cast<unsigned int>(begin);
+        node.count = static_cast<unsigned int>(end - begin);
+        size_t count = end - begin;
+        if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+        {
+            return;
+        }
+
+        // largest axis of the centroids, objects with equal centroids are split in the middle of the range
+        glm::vec3 extent = centroidBounds.maximum - centroidBounds.minimum;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        size_t middle = begin + count / 2;
+        if (extent[axis] > 0.0f)
+        {
+            float origin = centroidBounds.minimum[axis];
+            float scale = SAH_BINS / extent[axis];
+            Bin bins[SAH_BINS];
+            binReferences(pool, begin, end, axis, origin, scale, bins);
+
+            // sweep from the right for the areas right of every split, then from the left for the costs
+            float rightArea[SAH_BINS];
+            size_t rightCount[SAH_BINS];
+            Bin right;
+            size_t accumulated = 0;
+            for (unsigned int b = SAH_BINS - 1; b > 0; b--)
+            {
+                right.grow(bins[b].minimum, bins[b].maximum);
+                accumulated += bins[b].count;
+                rightArea[b] = getArea(right.minimum, right.maximum);
+                rightCount[b] = accumulated;
+            }
+            Bin left;
+            accumulated = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            unsigned int bestSplit = 0;
+            for (unsigned int b = 1; b < SAH_BINS; b++)
+            {
+                left.grow(bins[b - 1].minimum, bins[b - 1].maximum);
+                accumulated += bins[b - 1].count;
+                if (accumulated == 0 || rightCount[b] == 0)
+                {
+                    continue;
+                }
+                float cost = getArea(left.minimum, left.maximum) * accumulated + rightArea[b] * rightCount[b];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+            // small nodes stay leaves when no split is cheaper than testing all of their objects
+            float leafCost = getArea(bounds.minimum, bounds.maximum) * count;
+            float splitCost = TRAVERSAL_COST * getArea(bounds.minimum, bounds.maximum) + bestCost;
+            if (count <= 4 * MAX_LEAF_SIZE && (bestSplit == 0 || splitCost >= leafCost))
+            {
+                return;
+            }
+            if (bestSplit != 0)
+            {
+                middle = std::partition(references.begin() + begin, references.begin() + end, [&](const Reference& reference)
+                {
+                    return getBin(reference.getCentroid()[axis], origin, scale) < bestSplit;
+                }) - references.begin();
+            }
+        }
+
+        unsigned int children = nodeCount.fetch_add(2);
+        node.first = children;
+        node.count = 0;
+        if (pool != NULL && count >= PARALLEL_SIZE)
+        {
+            pool->parallelFor(0, 2, [&](size_t child)
+            {
+                buildNode(pool, children + static_cast<unsigned int>(child), child == 0 ? begin : middle, child == 0 ? middle : end, depth + 1);
+            }, 1);
+        }
+        else
+        {
+            buildNode(pool, children, begin, middle, depth + 1);
+            buildNode(pool, children + 1, middle, end, depth + 1);
+        }
+    }
+
+    unsigned int getFirstPrimitive(unsigned int nodeIndex) const
+    {
+        while (!nodes[nodeIndex].isLeaf())
+        {
+            nodeIndex = nodes[nodeIndex].first;
+        }
+        return nodes[nodeIndex].first;
+    }
+
+    unsigned int getLastPrimitive(unsigned int nodeIndex) const
+    {
+        while (!nodes[nodeIndex].isLeaf())
+        {
+            nodeIndex = nodes[nodeIndex].first + 1;
+        }
+        return nodes[nodeIndex].first + nodes[nodeIndex].count;
+    }
+
+    /*
+    * @brief	test a box against the planes in the mask
+    *
+    * @return	returns OUTSIDE or the mask of the planes the box intersects, 0 if it's completely inside
+    */
+    static unsigned int classify(const Frustum& frustum, const glm::vec3& minimum, const glm::vec3& maximum, unsigned int planes)
+    {
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        glm::vec3 extent = (maximum - minimum) * 0.5f;
+        unsigned int intersecting = 0;
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            if ((planes & (1U << p)) == 0)
+            {
+                continue;
+            }
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = (plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w);
+            float reach = (std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y) + std::fabs(plane.z) * extent.z;
+            if (distance + reach < 0.0f)
+            {
+                return OUTSIDE;
+            }
+            if (distance - reach < 0.0f)
+            {
+                intersecting |= 1U << p;
+            }
+        }
+        return intersecting;
+    }
+
+    /*
+    * @brief	slab test
+    *
+    * @return	returns the entry distance, infinity if the ray misses the box or enters it after maxDistance
+    */
+    static float intersect(const glm::vec3& origin, const glm::vec3& inverse, const glm::vec3& minimum, const glm::vec3& maximum, float maxDistance)
+    {
+        float entry = 0.0f, exit = maxDistance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float near = (minimum[axis] - origin[axis]) * inverse[axis];
+            float far = (maximum[axis] - origin[axis]) * inverse[axis];
+            // a ray parallel to the slab gives 0 * inf = NaN if it starts on the slab, the comparisons ignore it
+            entry = std::max(entry, std::min(near, far));
+            exit = std::min(exit, std::max(near, far));
+        }
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+    }
+
+    static float getDistanceSquared(const glm::vec3& point, const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        glm::vec3 offset = glm::max(glm::max(minimum - point, point - maximum), glm::vec3(0.0f));
+        return glm::dot(offset, offset);
+    }
+
+    static void pushIfHit(unsigned int* stack, unsigned int& stackSize, unsigned int node, float distance, float closest)
+    {
+        if (distance <= closest)
+        {
+            stack[stackSize++] = node;
+        }
+    }
+};
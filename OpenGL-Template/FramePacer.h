@@ -0,0 +1,227 @@
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+enum class FramePacingMode {
+    VSYNC,    // let the swap chain block on the display refresh
+    CAPPED,   // sleep until the next frame slot of the configured frame rate
+    UNCAPPED  // render as fast as possible
+};
+
+/// <summary>
+///
+/// Paces the render loop without burning a core.
+/// <para>In CAPPED mode the pacer sleeps on a high resolution OS timer until shortly before the frame deadline
+/// and only spins for the remaining sub-millisecond. The spin window adapts to the observed wake-up latency.</para>
+/// <para>Every frame the pacer measures the wall time and the CPU time the render thread actually consumed.</para>
+///
+/// </summary>
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacer(FramePacingMode mode = FramePacingMode::CAPPED, unsigned int frameRate = 60)
+    {
+#ifdef _WIN32
+        timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (timer == NULL)
+        {
+            // high resolution timers need Windows 10 1803, fall back to the default timer resolution
+            timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+        }
+#endif
+        setMode(mode, frameRate);
+        frameStart = Clock::now();
+        nextFrame = frameStart;
+        cpuStart = getThreadCpuTime();
+    }
+
+    ~FramePacer()
+    {
+#ifdef _WIN32
+        if (timer != NULL)
+        {
+            CloseHandle(timer);
+        }
+#endif
+    }
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void setMode(FramePacingMode mode, unsigned int frameRate)
+    {
+        Mode = mode;
+        targetFrameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(1U, frameRate)));
+        nextFrame = Clock::now();
+    }
+
+    FramePacingMode getMode() const
+    {
+        return Mode;
+    }
+
+    /*
+    * @brief	swap interval that has to be passed to glfwSwapInterval for the current mode
+    */
+    int getSwapInterval() const
+    {
+        return Mode == FramePacingMode::VSYNC ? 1 : 0;
+    }
+
+    /*
+    * @brief	blocks until the next frame should start and closes the measurement of the previous frame
+    */
+    void waitForNextFrame()
+    {
+        Clock::time_point workEnd = Clock::now();
+        if (Mode == FramePacingMode::CAPPED)
+        {
+            nextFrame += targetFrameTime;
+            if (nextFrame < workEnd)
+            {
+                // we missed the deadline, do not try to catch up with a burst of frames
+                nextFrame = workEnd;
+            }
+            waitUntil(nextFrame);
+        }
+
+        Clock::time_point now = Clock::now();
+        double cpuNow = getThreadCpuTime();
+        FrameTime = std::chrono::duration<double>(now - frameStart).count();
+        WorkTime = std::chrono::duration<double>(workEnd - frameStart).count();
+        CpuTime = cpuNow - cpuStart;
+        frameStart = now;
+        cpuStart = cpuNow;
+    }
+
+    /*
+    * @brief	wall time in seconds between the start of the last two frames
+    */
+    double getFrameTime() const
+    {
+        return FrameTime;
+    }
+
+    /*
+    * @brief	wall time in seconds the last frame spent before it started waiting
+    */
+    double getWorkTime() const
+    {
+        return WorkTime;
+    }
+
+    /*
+    * @brief	CPU time in seconds the render thread consumed during the last frame, including spinning
+    */
+    double getCpuTime() const
+    {
+        return CpuTime;
+    }
+
+    /*
+    * @brief	current length of the spin window in seconds
+    */
+    double getSpinThreshold() const
+    {
+        return std::chrono::duration<double>(spinThreshold).count();
+    }
+
+private:
+    FramePacingMode Mode = FramePacingMode::CAPPED;
+    Clock::duration targetFrameTime;
+    Clock::time_point frameStart;
+    Clock::time_point nextFrame;
+    double cpuStart = 0.0;
+
+    double FrameTime = 0.0;
+    double WorkTime = 0.0;
+    double CpuTime = 0.0;
+
+    // estimated wake-up latency of the OS timer, the spin window is derived from it
+    Clock::duration sleepLatency = std::chrono::microseconds(250);
+    Clock::duration spinThreshold = std::chrono::microseconds(500);
+
+#ifdef _WIN32
+    HANDLE timer = NULL;
+#endif
+
+    void waitUntil(Clock::time_point deadline)
+    {
+        Clock::time_point wake = deadline - spinThreshold;
+        Clock::time_point now = Clock::now();
+        if (now < wake)
+        {
+            sleepFor(wake - now);
+            Clock::time_point woken = Clock::now();
+            Clock::duration latency = woken > wake ? woken - wake : Clock::duration::zero();
+            sleepLatency = (sleepLatency * 7 + latency) / 8;
+            spinThreshold = std::min<Clock::duration>(std::max<Clock::duration>(sleepLatency * 2, std::chrono::microseconds(100)), std::chrono::milliseconds(2));
+        }
+        while (Clock::now() < deadline)
+        {
+            // spin for the last fraction of a millisecond
+        }
+    }
+
+    void sleepFor(Clock::duration duration)
+    {
+        long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+#ifdef _WIN32
+        if (timer != NULL)
+        {
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -(nanoseconds / 100); // relative time in 100ns units
+            if (SetWaitableTimerEx(timer, &dueTime, 0, NULL, NULL, NULL, 0))
+            {
+                WaitForSingleObject(timer, INFINITE);
+                return;
+            }
+        }
+        Sleep(static_cast<DWORD>(nanoseconds / 1000000));
+#else
+        timespec request;
+        request.tv_sec = static_cast<time_t>(nanoseconds / 1000000000LL);
+        request.tv_nsec = static_cast<long>(nanoseconds % 1000000000LL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, 0, &request, &request) == EINTR)
+        {
+        }
+#endif
+    }
+
+    static double getThreadCpuTime()
+    {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        {
+            return 0.0;
+        }
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        return (k.QuadPart + u.QuadPart) * 1e-7;
+#else
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+    }
+};
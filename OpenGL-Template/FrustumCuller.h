@@ -0,0 +1,394 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_AVX
+#include <immintrin.h>
+#endif
+
+/// six planes with inward normals, a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    /*
+    * @brief	extract the planes from projection * view (Gribb/Hartmann), they are normalized so the plane
+    *			distances are world units and can be compared with bounding sphere radii
+    */
+    static Frustum fromMatrix(const glm::mat4& viewProjection)
+    {
+        // glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+        {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // left
+        frustum.planes[1] = rows[3] - rows[0]; // right
+        frustum.planes[2] = rows[3] + rows[1]; // bottom
+        frustum.planes[3] = rows[3] - rows[1]; // top
+        frustum.planes[4] = rows[3] + rows[2]; // near, OpenGL clip space depth is -w to w
+        frustum.planes[5] = rows[3] - rows[2]; // far
+        for (glm::vec4& plane : frustum.planes)
+        {
+            float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+            plane = plane / length;
+        }
+        return frustum;
+    }
+};
+
+/// bounding spheres in structure of arrays layout, four floats per object
+struct BoundingSpheres
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    size_t size() const
+    {
+        return x.size();
+    }
+
+    void resize(size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        radius.resize(count);
+    }
+
+    void set(size_t index, const glm::vec3& center, float sphereRadius)
+    {
+        x[index] = center.x;
+        y[index] = center.y;
+        z[index] = center.z;
+        radius[index] = sphereRadius;
+    }
+
+    /*
+    * @return	returns the index of the new sphere
+    */
+    size_t add(const glm::vec3& center, float sphereRadius)
+    {
+        resize(size() + 1);
+        set(size() - 1, center, sphereRadius);
+        return size() - 1;
+    }
+};
+
+/// axis aligned bounding boxes in structure of arrays layout, stored as center and half extent
+struct BoundingBoxes
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    size_t size() const
+    {
+        return centerX.size();
+    }
+
+    void resize(size_t count)
+    {
+        centerX.resize(count);
+        centerY.resize(count);
+        centerZ.resize(count);
+        extentX.resize(count);
+        extentY.resize(count);
+        extentZ.resize(count);
+    }
+
+    void set(size_t index, const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        glm::vec3 extent = (maximum - minimum) * 0.5f;
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extent.x;
+        extentY[index] = extent.y;
+        extentZ[index] = extent.z;
+    }
+
+    /*
+    * @return	returns the index of the new box
+    */
+    size_t add(const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        resize(size() + 1);
+        set(size() - 1, minimum, maximum);
+        return size() - 1;
+    }
+};
+
+/// <summary>
+///
+/// Frustum culling of bounding spheres and boxes, the result is the compact list of the visible indices in
+/// ascending order.
+/// <para>The volumes are stored as structure of arrays, so one register holds the same coordinate of 8 (AVX) or
+/// 4 (SSE2) objects and every plane is tested against all of them with a few multiply adds. The SIMD path is used
+/// when the compiler targets it (OPENGL_TEMPLATE_NATIVE enables AVX), the scalar loop is the reference.</para>
+/// <para>The test is conservative: a volume is only culled if it lies completely behind one plane. Large volumes
+/// near the frustum corners can pass although they are outside.</para>
+///
+/// </summary>
+class FrustumCuller
+{
+public:
+    /*
+    * @brief	cull bounding spheres
+    *
+    * @param	visible	is grown to hold every object, the first returned count entries are the visible indices
+    * @param	simd	false: scalar reference implementation
+    *
+    * @return	returns the number of visible spheres
+    */
+    static size_t cull(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned int>& visible, bool simd = true)
+    {
+        size_t count = spheres.size();
+        if (visible.size() < count)
+        {
+            visible.resize(count);
+        }
+        unsigned int* output = visible.data();
+        size_t visibleCount = 0;
+        size_t i = 0;
+        if (simd)
+        {
+#if defined(FRUSTUM_CULLER_AVX)
+            __m256 planes[6][4];
+            loadPlanes(frustum, planes);
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+                __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+                __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+                __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+                __m256 outside = _mm256_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+                        _mm256_add_ps(_mm256_mul_ps(planes[p][2], z), planes[p][3]));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+                }
+                visibleCount = appendVisible(output, visibleCount, i, ~_mm256_movemask_ps(outside) & 0xFF, 8);
+            }
+#endif
+#if defined(FRUSTUM_CULLER_SSE2)
+            __m128 planes4[6][4];
+            loadPlanes(frustum, planes4);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(&spheres.x[i]);
+                __m128 y = _mm_loadu_ps(&spheres.y[i]);
+                __m128 z = _mm_loadu_ps(&spheres.z[i]);
+                __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+                __m128 outside = _mm_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes4[p][0], x), _mm_mul_ps(planes4[p][1], y)),
+                        _mm_add_ps(_mm_mul_ps(planes4[p][2], z), planes4[p][3]));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+                }
+                visibleCount = appendVisible(output, visibleCount, i, ~_mm_movemask_ps(outside) & 0xF, 4);
+            }
+#endif
+        }
+        for (; i < count; i++)
+        {
+            output[visibleCount] = static_cast<unsigned int>(i);
+            visibleCount += isVisible(frustum, glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]) ? 1 : 0;
+        }
+        return visibleCount;
+    }
+
+    /*
+    * @brief	cull axis aligned bounding boxes, a box is outside a plane if its corner furthest along the plane
+    *			normal is behind it: dot(normal, center) + w + dot(|normal|, extent) < 0
+    *
+    * @param	visible	is grown to hold every object, the first returned count entries are the visible indices
+    * @param	simd	false: scalar reference implementation
+    *
+    * @return	returns the number of visible boxes
+    */
+    static size_t cull(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned int>& visible, bool simd = true)
+    {
+        size_t count = boxes.size();
+        if (visible.size() < count)
+        {
+            visible.resize(count);
+        }
+        unsigned int* output = visible.data();
+        size_t visibleCount = 0;
+        size_t i = 0;
+        if (simd)
+        {
+#if defined(FRUSTUM_CULLER_AVX)
+            __m256 planes[6][4], absolute[6][3];
+            loadPlanes(frustum, planes);
+            loadAbsoluteNormals(frustum, absolute);
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(&boxes.centerX[i]);
+                __m256 y = _mm256_loadu_ps(&boxes.centerY[i]);
+                __m256 z = _mm256_loadu_ps(&boxes.centerZ[i]);
+                __m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+                __m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+                __m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+                __m256 outside = _mm256_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+                        _mm256_add_ps(_mm256_mul_ps(planes[p][2], z), planes[p][3]));
+                    __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absolute[p][0], ex), _mm256_mul_ps(absolute[p][1], ey)), _mm256_mul_ps(absolute[p][2], ez));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_LT_OQ));
+                }
+                visibleCount = appendVisible(output, visibleCount, i, ~_mm256_movemask_ps(outside) & 0xFF, 8);
+            }
+#endif
+#if defined(FRUSTUM_CULLER_SSE2)
+            __m128 planes4[6][4], absolute4[6][3];
+            loadPlanes(frustum, planes4);
+            loadAbsoluteNormals(frustum, absolute4);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(&boxes.centerX[i]);
+                __m128 y = _mm_loadu_ps(&boxes.centerY[i]);
+                __m128 z = _mm_loadu_ps(&boxes.centerZ[i]);
+                __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+                __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+                __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+                __m128 outside = _mm_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes4[p][0], x), _mm_mul_ps(planes4[p][1], y)),
+                        _mm_add_ps(_mm_mul_ps(planes4[p][2], z), planes4[p][3]));
+                    __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absolute4[p][0], ex), _mm_mul_ps(absolute4[p][1], ey)), _mm_mul_ps(absolute4[p][2], ez));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+                }
+                visibleCount = appendVisible(output, visibleCount, i, ~_mm_movemask_ps(outside) & 0xF, 4);
+            }
+#endif
+        }
+        for (; i < count; i++)
+        {
+            glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+            glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+            output[visibleCount] = static_cast<unsigned int>(i);
+            visibleCount += isVisible(frustum, center, extent) ? 1 : 0;
+        }
+        return visibleCount;
+    }
+
+    /*
+    * @brief	test a single sphere, same arithmetic as the SIMD loops
+    */
+    static bool isVisible(const Frustum& frustum, const glm::vec3& center, float radius)
+    {
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            if ((plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w) < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+    * @brief	test a single box given as center and half extent, same arithmetic as the SIMD loops
+    */
+    static bool isVisible(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extent)
+    {
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            float distance = (plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w);
+            float reach = (std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y) + std::fabs(plane.z) * extent.z;
+            if (distance + reach < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    /*
+    * @brief	branchless compaction: every lane writes its index, the count only advances for the visible ones
+    */
+    static size_t appendVisible(unsigned int* output, size_t visibleCount, size_t first, int mask, int lanes)
+    {
+        if (mask == 0)
+        {
+            return visibleCount; // the common case in a large scene, most objects are outside
+        }
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            output[visibleCount] = static_cast<unsigned int>(first + lane);
+            visibleCount += (mask >> lane) & 1;
+        }
+        return visibleCount;
+    }
+
+#if defined(FRUSTUM_CULLER_AVX)
+    static void loadPlanes(const Frustum& frustum, __m256 (&planes)[6][4])
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+            }
+        }
+    }
+
+    static void loadAbsoluteNormals(const Frustum& frustum, __m256 (&normals)[6][3])
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                normals[p][c] = _mm256_set1_ps(std::fabs(frustum.planes[p][c]));
+            }
+        }
+    }
+#endif
+#if defined(FRUSTUM_CULLER_SSE2)
+    static void loadPlanes(const Frustum& frustum, __m128 (&planes)[6][4])
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+            }
+        }
+    }
+
+    static void loadAbsoluteNormals(const Frustum& frustum, __m128 (&normals)[6][3])
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                normals[p][c] = _mm_set1_ps(std::fabs(frustum.planes[p][c]));
+            }
+        }
+    }
+#endif
+};
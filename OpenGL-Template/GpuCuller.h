@@ -0,0 +1,243 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+#include "Shader.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/// DrawElementsIndirectCommand of glMultiDrawElementsIndirect, mirrored by DrawCommand in shader/cull.comp
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+/// <summary>
+///
+/// GPU driven culling: the bounds and model matrices of all objects live in shader storage buffers, a compute shader
+/// (shader/cull.comp) tests every object against the frustum and writes one indirect draw command per visible object,
+/// which is drawn without the CPU ever seeing the result. The CPU cost per frame is a few uniforms, one dispatch and
+/// one draw call, independent of the object count.
+/// <para>Every command draws one instance with baseInstance = object index, so the per instance mat4 attribute of
+/// the instanced VAO fetches the model of its object from getModelBuffer(); the vertex shader stays the same.</para>
+/// <para>With OpenGL 4.6 or GL_ARB_indirect_parameters the visible commands are appended and drawn with
+/// glMultiDrawElementsIndirectCount. Without, every object keeps its command slot (culled ones with zero instances) and
+/// glMultiDrawElementsIndirect draws all slots. Compute shaders need OpenGL 4.3, check isSupported().</para>
+/// <para>Usage per frame: cull() -> bind the program and the instanced VAO with getModelBuffer() at binding 1 -> draw()</para>
+///
+/// </summary>
+class GpuCuller
+{
+public:
+    /*
+    * @brief	look up the draw count entry point, call once after glad was loaded with the same loader
+    *
+    * @return	returns true if compute shaders are available
+    */
+    static bool loadExtensions(GLADloadproc load)
+    {
+        multiDrawElementsIndirectCount() = NULL;
+        if (GLAD_GL_VERSION_4_6)
+        {
+            multiDrawElementsIndirectCount() = glMultiDrawElementsIndirectCount;
+        }
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count && multiDrawElementsIndirectCount() == NULL; i++)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (strcmp(extension, "GL_ARB_indirect_parameters") == 0)
+            {
+                multiDrawElementsIndirectCount() = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load("glMultiDrawElementsIndirectCountARB");
+            }
+        }
+        return isSupported();
+    }
+
+    static bool isSupported()
+    {
+        return GLAD_GL_VERSION_4_3 != 0;
+    }
+
+    /*
+    * @return	returns true if the visible commands are compacted and drawn with glMultiDrawElementsIndirectCount
+    */
+    static bool hasDrawCount()
+    {
+        return multiDrawElementsIndirectCount() != NULL;
+    }
+
+    /*
+    * @param	bounds		bounding sphere of every object, in world space after the model matrix
+    * @param	models		model matrix of every object
+    * @param	animated	objects with a non zero entry are drawn with model * animation (see cull()), empty for none
+    * @param	indexCount	indices of the mesh every object draws
+    */
+    GpuCuller(const char* shaderPath, const BoundingSpheres& bounds, const std::vector<glm::mat4>& models, const std::vector<unsigned int>& animated,
+        unsigned int indexCount)
+        : program(shaderPath), objectCount(static_cast<unsigned int>(bounds.size())), indexCount(indexCount), compact(hasDrawCount())
+    {
+        std::vector<glm::vec4> spheres(objectCount);
+        for (unsigned int i = 0; i < objectCount; i++)
+        {
+            spheres[i] = glm::vec4(bounds.x[i], bounds.y[i], bounds.z[i], bounds.radius[i]);
+        }
+        std::vector<unsigned int> flags(animated);
+        flags.resize(objectCount, 0);
+        // zero sized buffers can't be bound as storage, every buffer holds at least one element
+        size_t count = std::max(objectCount, 1U);
+        spheres.resize(count);
+        flags.resize(count);
+        std::vector<glm::mat4> matrices(models);
+        matrices.resize(count);
+
+        glGenBuffers(BUFFER_COUNT, buffers);
+        createBuffer(BOUNDS, count * sizeof(glm::vec4), spheres.data());
+        createBuffer(MODELS, count * sizeof(glm::mat4), matrices.data());
+        createBuffer(ANIMATED, count * sizeof(unsigned int), flags.data());
+        createBuffer(FRAME_MODELS, count * sizeof(glm::mat4), matrices.data());
+        createBuffer(COMMANDS, count * sizeof(DrawElementsIndirectCommand), NULL);
+        createBuffer(PARAMETERS, sizeof(unsigned int), NULL);
+
+        planesLocation = program.getSetLocation("planes");
+        animationLocation = program.getSetLocation("animation");
+        program.set("objectCount", objectCount);
+        program.set("indexCount", indexCount);
+        program.set("compact", compact ? 1U : 0U);
+    }
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    ~GpuCuller()
+    {
+        glDeleteBuffers(BUFFER_COUNT, buffers);
+        program.remove();
+    }
+
+    /*
+    * @brief	dispatch the culling, the commands are ready for draw() afterwards
+    *
+    * @param	animation	multiplied from the right to the model of the animated objects
+    */
+    void cull(const Frustum& frustum, const glm::mat4& animation)
+    {
+        if (compact)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[PARAMETERS]);
+            glClearBufferSubData(GL_COPY_WRITE_BUFFER, GL_R32UI, 0, sizeof(unsigned int), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            program.set(planesLocation + p, frustum.planes[p].x, frustum.planes[p].y, frustum.planes[p].z, frustum.planes[p].w);
+        }
+        program.setMat4(animationLocation, animation);
+        program.use();
+        for (unsigned int buffer = 0; buffer < BUFFER_COUNT; buffer++)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, buffer, buffers[buffer]);
+        }
+        glDispatchCompute((objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+        // the commands are read by the indirect draw, the models as vertex attributes
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
+
+    /*
+    * @brief	draw the commands of the last cull(), the program and the VAO have to be bound
+    */
+    void draw()
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMANDS]);
+        if (compact)
+        {
+            glBindBuffer(GL_PARAMETER_BUFFER, buffers[PARAMETERS]);
+            multiDrawElementsIndirectCount()(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, 0, objectCount, 0);
+            glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        }
+        else
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, objectCount, 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    /*
+    * @brief	per instance model matrices written by cull(), bind with a stride of sizeof(glm::mat4)
+    */
+    unsigned int getModelBuffer() const
+    {
+        return buffers[FRAME_MODELS];
+    }
+
+    /*
+    * @brief	reads the result of the last cull() back, waits for the GPU. Only meant for statistics at the end
+    */
+    unsigned int readVisibleCount() const
+    {
+        unsigned int visible = 0;
+        if (compact)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffers[PARAMETERS]);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(unsigned int), &visible);
+        }
+        else
+        {
+            std::vector<DrawElementsIndirectCommand> commands(objectCount);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffers[COMMANDS]);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, objectCount * sizeof(DrawElementsIndirectCommand), commands.data());
+            for (const DrawElementsIndirectCommand& command : commands)
+            {
+                visible += command.instanceCount;
+            }
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return visible;
+    }
+
+private:
+    /// shader storage bindings of shader/cull.comp
+    enum Buffer : unsigned int {
+        BOUNDS = 0,
+        MODELS,
+        ANIMATED,
+        FRAME_MODELS,
+        COMMANDS,
+        PARAMETERS,
+        BUFFER_COUNT
+    };
+    static const unsigned int WORKGROUP_SIZE = 64; // local_size_x of shader/cull.comp
+
+    Shader program;
+    unsigned int buffers[BUFFER_COUNT];
+    unsigned int objectCount;
+    unsigned int indexCount;
+    bool compact;
+    unsigned int planesLocation;
+    unsigned int animationLocation;
+
+    static PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC& multiDrawElementsIndirectCount()
+    {
+        static PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC function = NULL;
+        return function;
+    }
+
+    /*
+    * @brief	immutable storage, only written by the GPU after the initial data
+    */
+    void createBuffer(Buffer buffer, size_t size, const void* data)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[buffer]);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+};
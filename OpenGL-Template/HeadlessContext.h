@@ -0,0 +1,212 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#if defined(__linux__)
+#define HEADLESS_EGL
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/// <summary>
+///
+/// Offscreen OpenGL context for machines without a display or GPU.
+/// <para>The context is created through EGL on the Mesa surfaceless platform, on hosts without a GPU Mesa
+/// falls back to llvmpipe. There is no default framebuffer, everything is rendered into an FBO instead.</para>
+/// <para>Usage: create() -> load glad with getProcAddress -> attachFramebuffer()</para>
+///
+/// </summary>
+class HeadlessContext
+{
+public:
+    unsigned int Width = 0;
+    unsigned int Height = 0;
+    unsigned int FBO = 0;
+
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    ~HeadlessContext()
+    {
+        destroy();
+    }
+
+    /*
+    * @brief	create an offscreen context and make it current, prefers OpenGL 4.6 core and falls back down to 4.4,
+    *			the oldest version with everything the template uses (glBufferStorage, glVertexAttribFormat)
+    *
+    * @return	returns false if no context could be created
+    */
+    bool create(unsigned int width, unsigned int height)
+    {
+        Width = width;
+        Height = height;
+#ifdef HEADLESS_EGL
+        PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (eglGetPlatformDisplayEXT != NULL)
+        {
+            display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (display == EGL_NO_DISPLAY)
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            std::cout << "ERROR Headless: couldn't initialize EGL (Errorcode: 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR Headless: EGL doesn't support desktop OpenGL" << std::endl;
+            return false;
+        }
+
+        // configless contexts are fine, we never render to an EGL surface
+        EGLConfig config = (EGLConfig)0;
+        EGLint configCount = 0;
+        const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+        const EGLint versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 4 } };
+        for (const EGLint* version : versions)
+        {
+            const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, version[0],
+                EGL_CONTEXT_MINOR_VERSION, version[1],
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+            if (context != EGL_NO_CONTEXT)
+            {
+                break;
+            }
+        }
+        if (context == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR Headless: couldn't create an OpenGL 4.4 core context, the renderer needs glBufferStorage (4.4)" << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "ERROR Headless: surfaceless contexts are not supported" << std::endl;
+            return false;
+        }
+        return true;
+#else
+        std::cout << "ERROR Headless rendering is only supported on Linux (EGL)" << std::endl;
+        return false;
+#endif
+    }
+
+    /*
+    * @brief	loader function that has to be passed to gladLoadGLLoader
+    */
+    static void* getProcAddress(const char* name)
+    {
+#ifdef HEADLESS_EGL
+        return (void*)eglGetProcAddress(name);
+#else
+        return NULL;
+#endif
+    }
+
+    /*
+    * @brief	create the color and depth attachments and bind them as the render target, requires a loaded glad
+    */
+    bool attachFramebuffer()
+    {
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        glGenRenderbuffers(1, &colorRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR Headless: framebuffer is incomplete" << std::endl;
+            return false;
+        }
+        // without a default framebuffer the viewport starts out as 0x0
+        glViewport(0, 0, Width, Height);
+        return true;
+    }
+
+    /*
+    * @brief	write the color attachment as binary PPM (P6)
+    *
+    * @param	path	Path of the image file (E.g.: frame.ppm)
+    */
+    bool saveFramebuffer(const char* path)
+    {
+        std::vector<unsigned char> pixels(static_cast<size_t>(Width) * Height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR couldn't write File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        file << "P6\n" << Width << " " << Height << "\n255\n";
+        // OpenGL stores the bottom row first
+        for (unsigned int y = Height; y > 0; y--)
+        {
+            file.write(reinterpret_cast<const char*>(&pixels[static_cast<size_t>(y - 1) * Width * 3]), static_cast<std::streamsize>(Width) * 3);
+        }
+        return true;
+    }
+
+    void destroy()
+    {
+#ifdef HEADLESS_EGL
+        if (context != EGL_NO_CONTEXT)
+        {
+            if (FBO != 0)
+            {
+                glDeleteFramebuffers(1, &FBO);
+                glDeleteRenderbuffers(1, &colorRBO);
+                glDeleteRenderbuffers(1, &depthRBO);
+                FBO = colorRBO = depthRBO = 0;
+            }
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+        }
+#endif
+    }
+
+private:
+    unsigned int colorRBO = 0;
+    unsigned int depthRBO = 0;
+
+#ifdef HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
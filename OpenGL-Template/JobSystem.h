@@ -0,0 +1,512 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+/// unit of work of the JobSystem, only used through Job pointers
+struct Job
+{
+    static const size_t INLINE_SIZE = 64; // captures up to this size are stored in the job, larger ones on the heap
+
+    void (*execute)(void* data);
+    void (*destroy)(void* data);
+    alignas(std::max_align_t) unsigned char data[INLINE_SIZE];
+    Job* parent;
+    std::atomic<int> unfinished; // the job itself and its unfinished children
+    std::atomic<int> references; // the scheduler until the job finished, the creator until wait() or detach()
+    std::vector<Job*> continuations;
+};
+
+/// <summary>
+///
+/// Chase-Lev work stealing deque of jobs (Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for
+/// Weak Memory Models"). The owner thread pushes and pops at the bottom without locks, other threads steal from the
+/// top. The capacity is fixed, push() fails when it's full.
+///
+/// </summary>
+class WorkStealingDeque
+{
+public:
+    static const int64_t CAPACITY = 4096;
+
+    WorkStealingDeque()
+        : buffer(new std::atomic<Job*>[CAPACITY])
+    {
+    }
+
+    /*
+    * @brief	owner only
+    */
+    bool push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+        {
+            return false;
+        }
+        buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        // publishes the job to the thieves, they load bottom with acquire
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+    * @brief	owner only, the most recently pushed job
+    */
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return NULL;
+        }
+        Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // the last job, a thief may take it at the same time
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = NULL;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    /*
+    * @brief	any thread, the oldest job
+    */
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return NULL;
+        }
+        Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return NULL;
+        }
+        return job;
+    }
+
+private:
+    // top and bottom are written by different threads, keep them on separate cache lines
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+    std::unique_ptr<std::atomic<Job*>[]> buffer;
+};
+
+/// <summary>
+///
+/// Work stealing scheduler for the engine side parallel work. Every worker thread owns a WorkStealingDeque, and so
+/// does the thread that created the system (the render thread). New jobs go to the deque of the creating thread,
+/// idle threads steal the oldest jobs of the others, so a recursively split range spreads itself over the cores.
+/// Threads that don't own a deque and submit() queue their jobs in a shared injection queue, which only the workers
+/// take from.
+/// <para>Dependencies: a job created with a parent keeps the parent unfinished until the child finished, so
+/// waiting on the parent waits for the whole tree. Continuations are started as soon as a job and its children
+/// finished. wait() runs other jobs while it waits, so it may be called inside jobs without blocking a worker. On the
+/// creating thread wait() only runs jobs of its own deque, so a frame never waits for a background task that it
+/// happened to pick up.</para>
+/// <para>Usage: create() -> addContinuation() / create() of children -> run() -> wait() or detach(). Every created
+/// job has to be run, except continuations which the scheduler runs, and waited for or detached. parallelFor() and
+/// submit() wrap these.</para>
+///
+/// </summary>
+class JobSystem
+{
+public:
+    /*
+    * @param	threadCount	number of worker threads, 0 = one less than the hardware threads so the render thread keeps its core
+    */
+    JobSystem(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+        // deque 0 belongs to the creating thread, 1..threadCount to the workers
+        deques.reserve(threadCount + 1);
+        for (unsigned int i = 0; i <= threadCount; i++)
+        {
+            deques.push_back(std::make_unique<WorkStealingDeque>());
+        }
+        previousContext = getContext();
+        getContext() = { this, 0 };
+        for (unsigned int i = 1; i <= threadCount; i++)
+        {
+            workers.emplace_back(&JobSystem::work, this, i);
+        }
+    }
+
+    /*
+    * @brief	finishes all queued jobs before the workers stop
+    */
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        if (getContext().system == this)
+        {
+            getContext() = previousContext;
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int getThreadCount() const
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    /*
+    * @brief	a job calling function(), it doesn't start before run()
+    *
+    * @param	parent	stays unfinished until this job finished, has to be unfinished itself
+    */
+    template<class Function>
+    Job* create(Function&& function, Job* parent = NULL)
+    {
+        typedef typename std::decay<Function>::type Stored;
+        Job* job = new Job;
+        if constexpr (sizeof(Stored) <= Job::INLINE_SIZE && alignof(Stored) <= alignof(std::max_align_t))
+        {
+            new (job->data) Stored(std::forward<Function>(function));
+            job->execute = [](void* data) { (*static_cast<Stored*>(data))(); };
+            job->destroy = [](void* data) { static_cast<Stored*>(data)->~Stored(); };
+        }
+        else
+        {
+            *reinterpret_cast<Stored**>(job->data) = new Stored(std::forward<Function>(function));
+            job->execute = [](void* data) { (**static_cast<Stored**>(data))(); };
+            job->destroy = [](void* data) { delete *static_cast<Stored**>(data); };
+        }
+        job->parent = parent;
+        job->unfinished.store(1, std::memory_order_relaxed);
+        job->references.store(2, std::memory_order_relaxed);
+        if (parent != NULL)
+        {
+            parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    /*
+    * @brief	run continuation once job and its children finished, call it before job is run
+    */
+    void addContinuation(Job* job, Job* continuation)
+    {
+        job->continuations.push_back(continuation);
+    }
+
+    /*
+    * @brief	queue the job on the calling thread, runs it right away if the deque is full
+    */
+    void run(Job* job)
+    {
+        // counted before it can be taken, so the count never drops below zero
+        queued.fetch_add(1, std::memory_order_seq_cst);
+        Context& context = getContext();
+        if (context.system == this)
+        {
+            if (!deques[context.index]->push(job))
+            {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                execute(job);
+                return;
+            }
+        }
+        else
+        {
+            inject(job);
+        }
+        notify();
+    }
+
+    /*
+    * @brief	run other jobs until the job and its children finished, then release it
+    */
+    void wait(Job* job)
+    {
+        unsigned int index = getContext().system == this ? getContext().index : NO_DEQUE;
+        while (job->unfinished.load(std::memory_order_acquire) > 0)
+        {
+            Job* next = findJob(index);
+            if (next != NULL)
+            {
+                execute(next);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        release(job);
+    }
+
+    /*
+    * @brief	give up the creator reference of a job that is never waited for
+    */
+    void detach(Job* job)
+    {
+        release(job);
+    }
+
+    /*
+    * @brief	run the task on the next free worker, never on the creating thread
+    */
+    template<class Function>
+    void submit(Function&& task)
+    {
+        Job* job = create(std::forward<Function>(task));
+        queued.fetch_add(1, std::memory_order_seq_cst);
+        inject(job);
+        notify();
+        detach(job);
+    }
+
+    /*
+    * @brief	call function(index) for every index in [begin, end), blocks until all calls returned. The range is
+    *			split in halves recursively, the thieves take the large halves
+    *
+    * @param	grainSize	indices per job, 0 = split into a few jobs per thread
+    */
+    template<class Function>
+    void parallelFor(size_t begin, size_t end, const Function& function, size_t grainSize = 0)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        size_t count = end - begin;
+        if (grainSize == 0)
+        {
+            grainSize = std::max<size_t>(1, count / (4 * (workers.size() + 1)));
+        }
+        if (count <= grainSize)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                function(i);
+            }
+            return;
+        }
+        Job* root = create([]() {});
+        splitRange(root, begin, end, function, grainSize);
+        run(root);
+        wait(root);
+    }
+
+private:
+    struct Context
+    {
+        JobSystem* system;
+        unsigned int index;
+    };
+    static const unsigned int NO_DEQUE = ~0U;
+    static const unsigned int SPIN_COUNT = 64; // failed searches before a worker sleeps
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+    std::vector<std::thread> workers;
+    std::deque<Job*> injected;
+    std::mutex injectionMutex;
+    std::atomic<size_t> injectedCount{ 0 };
+    std::atomic<size_t> queued{ 0 }; // jobs in the deques and the injection queue
+    std::atomic<unsigned int> sleeping{ 0 };
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    Context previousContext;
+
+    static Context& getContext()
+    {
+        static thread_local Context context = { NULL, NO_DEQUE };
+        return context;
+    }
+
+    void inject(Job* job)
+    {
+        std::lock_guard<std::mutex> lock(injectionMutex);
+        injected.push_back(job);
+        injectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    void notify()
+    {
+        if (sleeping.load(std::memory_order_seq_cst) > 0)
+        {
+            // the lock orders the notification after a worker that is about to sleep checked queued
+            std::lock_guard<std::mutex> lock(mutex);
+            wake.notify_one();
+        }
+    }
+
+    /*
+    * @brief	the own deque first, then the injection queue, then the other deques starting at a random one. The
+    *			creating thread (index 0) only pops its own deque, the workers take everything else
+    */
+    Job* findJob(unsigned int index)
+    {
+        if (queued.load(std::memory_order_relaxed) == 0)
+        {
+            return NULL;
+        }
+        Job* job = index != NO_DEQUE ? deques[index]->pop() : NULL;
+        if (index == 0)
+        {
+            if (job != NULL)
+            {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+        if (job == NULL && injectedCount.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard<std::mutex> lock(injectionMutex);
+            if (!injected.empty())
+            {
+                job = injected.front();
+                injected.pop_front();
+                injectedCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        if (job == NULL)
+        {
+            static thread_local uint32_t random = 0x9E3779B9u;
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            size_t dequeCount = deques.size();
+            size_t start = random % dequeCount;
+            for (size_t k = 0; k < dequeCount && job == NULL; k++)
+            {
+                size_t victim = (start + k) % dequeCount;
+                if (victim != index)
+                {
+                    job = deques[victim]->steal();
+                }
+            }
+        }
+        if (job != NULL)
+        {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    void execute(Job* job)
+    {
+        job->execute(job->data);
+        finish(job);
+    }
+
+    /*
+    * @brief	one less unfinished part, the last one starts the continuations and finishes the parent
+    */
+    void finish(Job* job)
+    {
+        if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            return;
+        }
+        for (Job* continuation : job->continuations)
+        {
+            run(continuation);
+        }
+        Job* parent = job->parent;
+        release(job);
+        if (parent != NULL)
+        {
+            finish(parent);
+        }
+    }
+
+    void release(Job* job)
+    {
+        if (job->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            job->destroy(job->data);
+            delete job;
+        }
+    }
+
+    template<class Function>
+    void splitRange(Job* root, size_t begin, size_t end, const Function& function, size_t grainSize)
+    {
+        // keep the lower half, hand the upper half to a job that splits it further
+        while (end - begin > grainSize)
+        {
+            size_t middle = begin + (end - begin) / 2;
+            Job* half = create([this, root, middle, end, &function, grainSize]()
+                {
+                    splitRange(root, middle, end, function, grainSize);
+                }, root);
+            run(half);
+            detach(half);
+            end = middle;
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            function(i);
+        }
+    }
+
+    void work(unsigned int index)
+    {
+        getContext() = { this, index };
+        unsigned int misses = 0;
+        for (;;)
+        {
+            Job* job = findJob(index);
+            if (job != NULL)
+            {
+                execute(job);
+                misses = 0;
+                continue;
+            }
+            if (++misses < SPIN_COUNT)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            wake.wait(lock, [this]() { return stopping || queued.load(std::memory_order_seq_cst) > 0; });
+            sleeping.fetch_sub(1, std::memory_order_seq_cst);
+            if (stopping && queued.load(std::memory_order_seq_cst) == 0)
+            {
+                return;
+            }
+            misses = 0;
+        }
+    }
+};
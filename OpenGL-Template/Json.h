@@ -0,0 +1,416 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class JsonType
+{
+    NONE,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT
+};
+
+/// <summary>
+///
+/// Parsed JSON document, just enough for reading glTF files.
+/// <para>Lookups of missing members and indices return a NONE value instead of failing, so nested optional
+/// properties can be read in one expression: json["accessors"][2]["byteOffset"].getNumber(0.0).</para>
+/// <para>The parser rejects malformed documents and limits the nesting depth, it doesn't keep duplicate keys apart
+/// (the first one is found).</para>
+///
+/// </summary>
+class JsonValue
+{
+public:
+    JsonType type = JsonType::NONE;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    /*
+    * @return	returns the member or a NONE value if this isn't an object or has no such member
+    */
+    const JsonValue& operator[](std::string_view key) const
+    {
+        for (const std::pair<std::string, JsonValue>& member : object)
+        {
+            if (member.first == key)
+            {
+                return member.second;
+            }
+        }
+        return none();
+    }
+
+    /*
+    * @return	returns the element or a NONE value if this isn't an array or index is out of range
+    */
+    const JsonValue& operator[](size_t index) const
+    {
+        return index < array.size() ? array[index] : none();
+    }
+
+    bool isNone() const
+    {
+        return type == JsonType::NONE;
+    }
+
+    /*
+    * @return	returns the number of array elements or object members
+    */
+    size_t size() const
+    {
+        return type == JsonType::ARRAY ? array.size() : object.size();
+    }
+
+    double getNumber(double fallback) const
+    {
+        return type == JsonType::NUMBER ? number : fallback;
+    }
+
+    /*
+    * @return	returns the number as non negative integer or fallback if it isn't one (E.g.: an index or a byte offset)
+    */
+    uint64_t getIndex(uint64_t fallback) const
+    {
+        if (type != JsonType::NUMBER || number < 0.0 || number > 9007199254740992.0 || static_cast<double>(static_cast<uint64_t>(number)) != number)
+        {
+            return fallback;
+        }
+        return static_cast<uint64_t>(number);
+    }
+
+    const std::string& getString() const
+    {
+        return string;
+    }
+
+    /*
+    * @brief	parse a whole document, trailing characters other than whitespace are an error
+    *
+    * @return	returns false and prints the position of the error if text isn't valid JSON
+    */
+    static bool parse(std::string_view text, JsonValue& value)
+    {
+        Parser parser = { text.data(), text.data() + text.size(), text.data(), NULL };
+        value = JsonValue();
+        bool valid = parser.parseValue(value, 0);
+        if (valid)
+        {
+            parser.skipWhitespace();
+            valid = parser.position == parser.end;
+        }
+        if (!valid)
+        {
+            if (parser.error == NULL)
+            {
+                parser.error = "unexpected character";
+            }
+            std::cout << "ERROR Json: " << parser.error << " at offset " << (parser.position - parser.begin) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const unsigned int MAX_DEPTH = 256;
+
+    static const JsonValue& none()
+    {
+        static const JsonValue value;
+        return value;
+    }
+
+    struct Parser
+    {
+        const char* position;
+        const char* end;
+        const char* begin;
+        const char* error;
+
+        void skipWhitespace()
+        {
+            while (position < end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+            {
+                position++;
+            }
+        }
+
+        bool fail(const char* message)
+        {
+            error = message;
+            return false;
+        }
+
+        bool consume(std::string_view literal)
+        {
+            if (static_cast<size_t>(end - position) < literal.size() || std::string_view(position, literal.size()) != literal)
+            {
+                return fail("invalid literal");
+            }
+            position += literal.size();
+            return true;
+        }
+
+        bool parseValue(JsonValue& value, unsigned int depth)
+        {
+            if (depth > MAX_DEPTH)
+            {
+                return fail("nested too deep");
+            }
+            skipWhitespace();
+            if (position == end)
+            {
+                return fail("unexpected end");
+            }
+            switch (*position)
+            {
+            case '{':
+                return parseObject(value, depth);
+            case '[':
+                return parseArray(value, depth);
+            case '"':
+                value.type = JsonType::STRING;
+                return parseString(value.string);
+            case 't':
+                value.type = JsonType::BOOLEAN;
+                value.boolean = true;
+                return consume("true");
+            case 'f':
+                value.type = JsonType::BOOLEAN;
+                value.boolean = false;
+                return consume("false");
+            case 'n':
+                value.type = JsonType::NONE;
+                return consume("null");
+            default:
+                return parseNumber(value);
+            }
+        }
+
+        bool parseObject(JsonValue& value, unsigned int depth)
+        {
+            value.type = JsonType::OBJECT;
+            position++;
+            skipWhitespace();
+            if (position < end && *position == '}')
+            {
+                position++;
+                return true;
+            }
+            while (true)
+            {
+                skipWhitespace();
+                if (position == end || *position != '"')
+                {
+                    return fail("expected a member name");
+                }
+                value.object.emplace_back();
+                if (!parseString(value.object.back().first))
+                {
+                    return false;
+                }
+                skipWhitespace();
+                if (position == end || *position != ':')
+                {
+                    return fail("expected ':'");
+                }
+                position++;
+                if (!parseValue(value.object.back().second, depth + 1))
+                {
+                    return false;
+                }
+                skipWhitespace();
+                if (position < end && *position == ',')
+                {
+                    position++;
+                    continue;
+                }
+                if (position < end && *position == '}')
+                {
+                    position++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+
+        bool parseArray(JsonValue& value, unsigned int depth)
+        {
+            value.type = JsonType::ARRAY;
+            position++;
+            skipWhitespace();
+            if (position < end && *position == ']')
+            {
+                position++;
+                return true;
+            }
+            while (true)
+            {
+                value.array.emplace_back();
+                if (!parseValue(value.array.back(), depth + 1))
+                {
+                    return false;
+                }
+                skipWhitespace();
+                if (position < end && *position == ',')
+                {
+                    position++;
+                    continue;
+                }
+                if (position < end && *position == ']')
+                {
+                    position++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool parseNumber(JsonValue& value)
+        {
+            // from_chars accepts a few forms JSON doesn't ("inf", leading '+'), they are rejected by the first character
+            if (*position != '-' && (*position < '0' || *position > '9'))
+            {
+                return fail("unexpected character");
+            }
+            std::from_chars_result result = std::from_chars(position, end, value.number);
+            if (result.ec != std::errc())
+            {
+                return fail("invalid number");
+            }
+            value.type = JsonType::NUMBER;
+            position = result.ptr;
+            return true;
+        }
+
+        bool parseHex(unsigned int& code)
+        {
+            if (end - position < 4)
+            {
+                return fail("invalid escape");
+            }
+            code = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = *position++;
+                code <<= 4;
+                if (c >= '0' && c <= '9')
+                {
+                    code |= c - '0';
+                }
+                else if (c >= 'a' && c <= 'f')
+                {
+                    code |= c - 'a' + 10;
+                }
+                else if (c >= 'A' && c <= 'F')
+                {
+                    code |= c - 'A' + 10;
+                }
+                else
+                {
+                    return fail("invalid escape");
+                }
+            }
+            return true;
+        }
+
+        bool parseString(std::string& string)
+        {
+            position++;
+            while (position < end && *position != '"')
+            {
+                char c = *position++;
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    return fail("control character in string");
+                }
+                if (c != '\\')
+                {
+                    string += c;
+                    continue;
+                }
+                if (position == end)
+                {
+                    break;
+                }
+                switch (*position++)
+                {
+                case '"': string += '"'; break;
+                case '\\': string += '\\'; break;
+                case '/': string += '/'; break;
+                case 'b': string += '\b'; break;
+                case 'f': string += '\f'; break;
+                case 'n': string += '\n'; break;
+                case 'r': string += '\r'; break;
+                case 't': string += '\t'; break;
+                case 'u':
+                {
+                    unsigned int code;
+                    if (!parseHex(code))
+                    {
+                        return false;
+                    }
+                    // a surrogate pair encodes a code point above U+FFFF in two escapes
+                    if (code >= 0xD800 && code < 0xDC00 && end - position >= 2 && position[0] == '\\' && position[1] == 'u')
+                    {
+                        position += 2;
+                        unsigned int low;
+                        if (!parseHex(low) || low < 0xDC00 || low >= 0xE000)
+                        {
+                            return fail("invalid surrogate pair");
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(string, code);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+                }
+            }
+            if (position == end)
+            {
+                return fail("unterminated string");
+            }
+            position++;
+            return true;
+        }
+
+        static void appendUtf8(std::string& string, unsigned int code)
+        {
+            if (code < 0x80)
+            {
+                string += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                string += static_cast<char>(0xC0 | (code >> 6));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                string += static_cast<char>(0xE0 | (code >> 12));
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                string += static_cast<char>(0xF0 | (code >> 18));
+                string += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                string += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+    };
+};
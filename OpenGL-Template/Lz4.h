@@ -0,0 +1,223 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+/// <summary>
+///
+/// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) without the frame format around it.
+/// <para>The compressor is the greedy single hash table variant of the reference implementation, its output can be
+/// decompressed by any LZ4 decoder. decompress() validates every length and offset, so corrupted input is rejected
+/// instead of reading or writing out of bounds.</para>
+///
+/// </summary>
+class Lz4
+{
+public:
+    /*
+    * @return	returns the worst case size of compressing size bytes
+    */
+    static size_t getBound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    /*
+    * @brief	compress source into destination, destination is resized to the compressed size
+    */
+    static void compress(const unsigned char* source, size_t size, std::vector<unsigned char>& destination)
+    {
+        destination.resize(getBound(size));
+        unsigned char* out = destination.data();
+        const unsigned char* anchor = source;
+        const unsigned char* end = source + size;
+
+        if (size >= MIN_INPUT)
+        {
+            std::vector<uint32_t> table(static_cast<size_t>(1) << HASH_LOG, 0);
+            const unsigned char* matchLimit = end - LAST_LITERALS;
+            const unsigned char* inputLimit = end - MF_LIMIT;
+            const unsigned char* position = source + 1;
+            table[hash(read32(source))] = 0;
+            while (position < inputLimit)
+            {
+                uint32_t sequence = read32(position);
+                uint32_t& slot = table[hash(sequence)];
+                const unsigned char* match = source + slot;
+                slot = static_cast<uint32_t>(position - source);
+                if (position - match > MAX_OFFSET || match >= position || read32(match) != sequence)
+                {
+                    position++;
+                    continue;
+                }
+
+                // extend the match backwards over the pending literals and forwards up to the end limit
+                while (position > anchor && match > source && position[-1] == match[-1])
+                {
+                    position--;
+                    match--;
+                }
+                const unsigned char* matchEnd = position + MIN_MATCH;
+                const unsigned char* reference = match + MIN_MATCH;
+                while (matchEnd < matchLimit && *matchEnd == *reference)
+                {
+                    matchEnd++;
+                    reference++;
+                }
+
+                out = writeSequence(out, anchor, position - anchor, static_cast<uint16_t>(position - match), matchEnd - position - MIN_MATCH);
+                position = matchEnd;
+                anchor = position;
+                if (position < inputLimit)
+                {
+                    table[hash(read32(position - 2))] = static_cast<uint32_t>(position - 2 - source);
+                }
+            }
+        }
+
+        // the block always ends with literals
+        size_t literals = static_cast<size_t>(end - anchor);
+        unsigned char* token = out++;
+        out = writeLength(out, token, literals, 4);
+        if (literals > 0)
+        {
+            std::memcpy(out, anchor, literals);
+            out += literals;
+        }
+        destination.resize(static_cast<size_t>(out - destination.data()));
+    }
+
+    /*
+    * @brief	decompress a block into destination, the decompressed size has to be known (it's stored next to the block)
+    *
+    * @return	returns false if the block is corrupted or doesn't decompress to exactly destinationSize bytes
+    */
+    static bool decompress(const unsigned char* source, size_t size, unsigned char* destination, size_t destinationSize)
+    {
+        const unsigned char* in = source;
+        const unsigned char* inEnd = source + size;
+        unsigned char* out = destination;
+        unsigned char* outEnd = destination + destinationSize;
+        while (in < inEnd)
+        {
+            unsigned int token = *in++;
+            size_t literals = token >> 4;
+            if (!readLength(in, inEnd, literals) || literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out))
+            {
+                return false;
+            }
+            std::memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+            if (in == inEnd)
+            {
+                break; // last sequence, it has no match
+            }
+
+            if (inEnd - in < 2)
+            {
+                return false;
+            }
+            size_t offset = static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+            in += 2;
+            size_t length = token & 15;
+            if (offset == 0 || offset > static_cast<size_t>(out - destination) || !readLength(in, inEnd, length))
+            {
+                return false;
+            }
+            length += MIN_MATCH;
+            if (length > static_cast<size_t>(outEnd - out))
+            {
+                return false;
+            }
+            // byte by byte, the match may overlap the bytes it produces (offset < length repeats a pattern)
+            const unsigned char* match = out - offset;
+            if (offset >= length)
+            {
+                std::memcpy(out, match, length);
+                out += length;
+            }
+            else
+            {
+                for (size_t i = 0; i < length; i++)
+                {
+                    *out++ = *match++;
+                }
+            }
+        }
+        return out == outEnd;
+    }
+
+private:
+    static const unsigned int MIN_MATCH = 4;
+    static const unsigned int LAST_LITERALS = 5; // the last 5 bytes are always literals
+    static const unsigned int MF_LIMIT = 12; // the last match starts at least 12 bytes before the end
+    static const unsigned int MIN_INPUT = MF_LIMIT + 1;
+    static const unsigned int MAX_OFFSET = 65535;
+    static const unsigned int HASH_LOG = 16;
+
+    static uint32_t read32(const unsigned char* position)
+    {
+        uint32_t value;
+        std::memcpy(&value, position, sizeof(value));
+        return value;
+    }
+
+    static uint32_t hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761U) >> (32 - HASH_LOG);
+    }
+
+    /*
+    * @brief	store a length in the token nibble at shift and the following 255 extension bytes
+    */
+    static unsigned char* writeLength(unsigned char* out, unsigned char* token, size_t length, int shift)
+    {
+        if (length < 15)
+        {
+            *token = static_cast<unsigned char>(length << shift);
+            return out;
+        }
+        *token = static_cast<unsigned char>(15 << shift);
+        for (length -= 15; length >= 255; length -= 255)
+        {
+            *out++ = 255;
+        }
+        *out++ = static_cast<unsigned char>(length);
+        return out;
+    }
+
+    static unsigned char* writeSequence(unsigned char* out, const unsigned char* literals, size_t literalLength, uint16_t offset, size_t matchLength)
+    {
+        unsigned char* token = out++;
+        out = writeLength(out, token, literalLength, 4);
+        unsigned char literalToken = *token;
+        std::memcpy(out, literals, literalLength);
+        out += literalLength;
+        *out++ = static_cast<unsigned char>(offset & 0xFF);
+        *out++ = static_cast<unsigned char>(offset >> 8);
+        out = writeLength(out, token, matchLength, 0);
+        *token |= literalToken;
+        return out;
+    }
+
+    static bool readLength(const unsigned char*& in, const unsigned char* inEnd, size_t& length)
+    {
+        if (length != 15)
+        {
+            return true;
+        }
+        unsigned char extension;
+        do
+        {
+            if (in == inEnd)
+            {
+                return false;
+            }
+            extension = *in++;
+            length += extension;
+        } while (extension == 255);
+        return true;
+    }
+};
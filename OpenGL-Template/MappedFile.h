@@ -0,0 +1,158 @@
+#pragma once
+
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+///
+/// Read only memory mapping of a whole file (mmap on POSIX, CreateFileMapping on Windows).
+/// <para>The pages are read by the OS on first access and shared with the page cache, so nothing is copied
+/// until the data is actually used. Pointers into the mapping stay valid until close().</para>
+///
+/// </summary>
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /*
+    * @return	returns false and prints the reason if the file can't be mapped
+    */
+    bool open(const char* path)
+    {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+        {
+            std::cout << "ERROR couldn't open File (Path: " << path << " )" << std::endl;
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(fileSize.QuadPart);
+        if (length > 0)
+        {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            bytes = mapping != NULL ? static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+        }
+#else
+        file = ::open(path, O_RDONLY);
+        struct stat status;
+        if (file < 0 || fstat(file, &status) != 0)
+        {
+            std::cout << "ERROR couldn't open File (Path: " << path << " )" << std::endl;
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(status.st_size);
+        if (length > 0)
+        {
+            void* address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+            bytes = address != MAP_FAILED ? static_cast<const unsigned char*>(address) : NULL;
+        }
+#endif
+        if (length > 0 && bytes == NULL)
+        {
+            std::cout << "ERROR couldn't map File (Path: " << path << " )" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (bytes != NULL)
+        {
+            UnmapViewOfFile(bytes);
+        }
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+        }
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes != NULL)
+        {
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+        if (file >= 0)
+        {
+            ::close(file);
+        }
+        file = -1;
+#endif
+        bytes = NULL;
+        length = 0;
+    }
+
+    /*
+    * @brief	tell the OS that the whole file will be read soon, so it can start reading ahead
+    */
+    void prefetch() const
+    {
+#if !defined(_WIN32)
+        if (bytes != NULL)
+        {
+            madvise(const_cast<unsigned char*>(bytes), length, MADV_WILLNEED);
+        }
+#endif
+    }
+
+    const unsigned char* data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    bool isOpen() const
+    {
+#if defined(_WIN32)
+        return file != INVALID_HANDLE_VALUE;
+#else
+        return file >= 0;
+#endif
+    }
+
+private:
+    const unsigned char* bytes = NULL;
+    size_t length = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int file = -1;
+#endif
+};
@@ -0,0 +1,1260 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// triangle list in separate float streams, what the parsers produce and cook() consumes
+struct RawMesh
+{
+    std::vector<float> positions; // 3 floats per vertex
+    std::vector<float> normals; // 3 floats per vertex, empty if the file has none
+    std::vector<float> texCoords; // 2 floats per vertex, empty if the file has none
+    std::vector<unsigned int> indices; // empty for a non indexed triangle list
+
+    size_t getVertexCount() const
+    {
+        return positions.size() / 3;
+    }
+};
+
+/// cooked mesh: interleaved vertices in the layout of format and a vertex cache optimized triangle list.
+/// vertices and indices point into the storage vectors after cooking or into the mapped cache file,
+/// either way they can be passed to glBufferData as they are
+struct MeshData
+{
+    VertexFormat format;
+    VertexQuantization quantization;
+    glm::vec3 minimum = glm::vec3(0.0f); // bounds of the positions
+    glm::vec3 maximum = glm::vec3(0.0f);
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    const unsigned char* vertices = NULL;
+    const unsigned int* indices = NULL;
+    bool cached = false; // true if the mesh was read from the cooked cache
+
+    std::vector<unsigned char> vertexStorage;
+    std::vector<unsigned int> indexStorage;
+    MappedFile mapping;
+};
+
+/// seconds spent in the stages of MeshLoader::load
+struct MeshLoadStats
+{
+    double parse = 0.0;
+    double cook = 0.0;
+    double cache = 0.0; // reading or writing the cooked file
+};
+
+/// <summary>
+///
+/// Loads triangle meshes from Wavefront OBJ and glTF 2.0 (.gltf with external or embedded buffers, .glb) files.
+/// <para>The file is parsed in parallel on the ThreadPool (OBJ in chunks of lines, glTF in ranges of vertices), then
+/// cooked: the vertices are welded, the triangles ordered with MeshOptimizer, the vertices renumbered in the order of
+/// their first use and encoded in a compact VertexFormat. Missing normals are computed from the triangles.</para>
+/// <para>load() stores the cooked mesh in a cache directory. Later runs map the cache file and hand the pointers into
+/// the mapping to OpenGL, as long as the size and modification time of the source file didn't change.</para>
+///
+/// </summary>
+class MeshLoader
+{
+public:
+    /*
+    * @brief	layout of cooked meshes: 16 bit positions, octahedral normals and half float texture coordinates,
+    *			16 bytes per vertex
+    */
+    static VertexFormat getDefaultFormat()
+    {
+        VertexFormat format;
+        format.add(VertexSemantic::POSITION, VertexEncoding::UNORM16)
+            .add(VertexSemantic::NORMAL, VertexEncoding::OCTAHEDRAL)
+            .add(VertexSemantic::TEXCOORD, VertexEncoding::HALF);
+        return format;
+    }
+
+    /*
+    * @brief	load the cooked mesh from the cache or parse and cook the file and store the result in the cache
+    *
+    * @param	cacheDirectory	directory of the cooked files, an empty path disables the cache
+    */
+    static bool load(const char* path, MeshData& mesh, ThreadPool* pool = NULL, const char* cacheDirectory = "", MeshLoadStats* stats = NULL)
+    {
+        MeshLoadStats times;
+        SourceStamp stamp;
+        if (!getSourceStamp(path, stamp))
+        {
+            std::cout << "ERROR couldn't read File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        VertexFormat format = getDefaultFormat();
+        std::string cachePath = cacheDirectory[0] != '\0' ? getCachePath(cacheDirectory, path) : std::string();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!cachePath.empty() && readCache(cachePath.c_str(), format, stamp, mesh))
+        {
+            times.cache = elapsed(start);
+        }
+        else
+        {
+            RawMesh raw;
+            start = std::chrono::steady_clock::now();
+            if (!parse(path, raw, pool))
+            {
+                return false;
+            }
+            times.parse = elapsed(start);
+            start = std::chrono::steady_clock::now();
+            cook(raw, format, mesh);
+            times.cook = elapsed(start);
+            if (!cachePath.empty())
+            {
+                start = std::chrono::steady_clock::now();
+                std::error_code error;
+                std::filesystem::create_directories(cacheDirectory, error);
+                writeCache(cachePath.c_str(), mesh, stamp);
+                times.cache = elapsed(start);
+            }
+        }
+        if (stats != NULL)
+        {
+            *stats = times;
+        }
+        return true;
+    }
+
+    /*
+    * @brief	parse an .obj, .gltf or .glb file, chosen by the extension
+    */
+    static bool parse(const char* path, RawMesh& mesh, ThreadPool* pool = NULL)
+    {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".gltf" || extension == ".glb")
+        {
+            return parseGltf(path, mesh, pool);
+        }
+        if (extension != ".obj")
+        {
+            std::cout << "ERROR Mesh format isn't supported (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        MappedFile file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+        file.prefetch();
+        return parseObj(reinterpret_cast<const char*>(file.data()), file.size(), mesh, pool);
+    }
+
+    /*
+    * @brief	parse the v, vt, vn and f statements of an OBJ file, polygons are triangulated as fans and everything else
+    *			(groups, materials, lines) is ignored. The result is a non indexed triangle list
+    */
+    static bool parseObj(const char* text, size_t size, RawMesh& mesh, ThreadPool* pool = NULL)
+    {
+        mesh = RawMesh();
+        // the chunks start at line starts, every chunk is parsed on its own and they are joined afterwards
+        size_t chunkCount = std::max<size_t>(1, size / OBJ_CHUNK_SIZE);
+        std::vector<size_t> bounds(chunkCount + 1, size);
+        bounds[0] = 0;
+        for (size_t i = 1; i < chunkCount; i++)
+        {
+            size_t position = std::max(bounds[i - 1], size / chunkCount * i);
+            const void* lineEnd = position < size ? std::memchr(text + position, '\n', size - position) : NULL;
+            bounds[i] = lineEnd != NULL ? static_cast<size_t>(static_cast<const char*>(lineEnd) - text) + 1 : size;
+        }
+        std::vector<ObjChunk> chunks(chunkCount);
+        forEach(pool, chunkCount, [&](size_t i)
+        {
+            parseObjChunk(text + bounds[i], text + bounds[i + 1], chunks[i]);
+        });
+
+        // indices in the chunks are global, except the negative ones that count back from the end of their chunk
+        std::vector<size_t> positionBase(chunkCount + 1, 0), texCoordBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            if (!chunks[i].error.empty())
+            {
+                std::cout << "ERROR OBJ: " << chunks[i].error << std::endl;
+                return false;
+            }
+            positionBase[i + 1] = positionBase[i] + chunks[i].positions.size() / 3;
+            texCoordBase[i + 1] = texCoordBase[i] + chunks[i].texCoords.size() / 2;
+            normalBase[i + 1] = normalBase[i] + chunks[i].normals.size() / 3;
+            cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+        }
+        size_t cornerCount = cornerBase[chunkCount];
+        if (cornerCount == 0)
+        {
+            std::cout << "ERROR OBJ: the file has no faces" << std::endl;
+            return false;
+        }
+        std::vector<float> positions(positionBase[chunkCount] * 3), texCoords(texCoordBase[chunkCount] * 2), normals(normalBase[chunkCount] * 3);
+        forEach(pool, chunkCount, [&](size_t i)
+        {
+            std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + positionBase[i] * 3);
+            std::copy(chunks[i].texCoords.begin(), chunks[i].texCoords.end(), texCoords.begin() + texCoordBase[i] * 2);
+            std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + normalBase[i] * 3);
+        });
+
+        mesh.positions.resize(cornerCount * 3);
+        mesh.texCoords.resize(texCoords.empty() ? 0 : cornerCount * 2);
+        mesh.normals.resize(normals.empty() ? 0 : cornerCount * 3);
+        std::atomic<bool> valid(true);
+        forEach(pool, chunkCount, [&](size_t i)
+        {
+            const ObjChunk& chunk = chunks[i];
+            for (size_t c = 0; c < chunk.corners.size(); c++)
+            {
+                const ObjCorner& corner = chunk.corners[c];
+                size_t target = cornerBase[i] + c;
+                int64_t position = corner.position + ((corner.relative & 1) ? static_cast<int64_t>(positionBase[i]) : 0);
+                int64_t texCoord = corner.texCoord + ((corner.relative & 2) ? static_cast<int64_t>(texCoordBase[i]) : 0);
+                int64_t normal = corner.normal + ((corner.relative & 4) ? static_cast<int64_t>(normalBase[i]) : 0);
+                if (position < 0 || position >= static_cast<int64_t>(positions.size() / 3)
+                    || (corner.texCoord != NO_INDEX && (texCoord < 0 || texCoord >= static_cast<int64_t>(texCoords.size() / 2)))
+                    || (corner.normal != NO_INDEX && (normal < 0 || normal >= static_cast<int64_t>(normals.size() / 3))))
+                {
+                    valid = false;
+                    return;
+                }
+                std::copy_n(&positions[position * 3], 3, &mesh.positions[target * 3]);
+                if (!mesh.texCoords.empty())
+                {
+                    mesh.texCoords[target * 2] = corner.texCoord != NO_INDEX ? texCoords[texCoord * 2] : 0.0f;
+                    mesh.texCoords[target * 2 + 1] = corner.texCoord != NO_INDEX ? texCoords[texCoord * 2 + 1] : 0.0f;
+                }
+                if (!mesh.normals.empty())
+                {
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        mesh.normals[target * 3 + axis] = corner.normal != NO_INDEX ? normals[normal * 3 + axis] : 0.0f;
+                    }
+                }
+            }
+        });
+        if (!valid)
+        {
+            std::cout << "ERROR OBJ: a face references a vertex that doesn't exist" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    * @brief	parse the triangle primitives of the default scene (or of all meshes if there is no scene), the node
+    *			transforms are applied to the vertices. Buffers can be part of the .glb, data URIs or files next to the .gltf
+    */
+    static bool parseGltf(const char* path, RawMesh& mesh, ThreadPool* pool = NULL)
+    {
+        mesh = RawMesh();
+        MappedFile file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+        std::string_view json(reinterpret_cast<const char*>(file.data()), file.size());
+        std::string_view binary;
+        if (file.size() >= 12 && read32(file.data()) == GLB_MAGIC && !parseGlb(file.data(), file.size(), json, binary))
+        {
+            return false;
+        }
+        JsonValue document;
+        if (!JsonValue::parse(json, document))
+        {
+            return false;
+        }
+        if (document["asset"]["version"].getString().compare(0, 2, "2.") != 0)
+        {
+            std::cout << "ERROR glTF: only version 2 is supported (Path: " << path << " )" << std::endl;
+            return false;
+        }
+
+        GltfBuffers buffers;
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        const JsonValue& bufferList = document["buffers"];
+        for (size_t i = 0; i < bufferList.size(); i++)
+        {
+            if (!loadBuffer(bufferList[i], directory, i == 0 ? binary : std::string_view(), buffers))
+            {
+                return false;
+            }
+        }
+
+        std::vector<GltfPrimitive> primitives;
+        collectPrimitives(document, primitives);
+        // every primitive gets a range of the vertices and indices of the mesh
+        size_t vertexCount = 0, indexCount = 0;
+        bool hasNormals = false, hasTexCoords = false;
+        for (GltfPrimitive& primitive : primitives)
+        {
+            const JsonValue& attributes = (*primitive.primitive)["attributes"];
+            if (!getAccessor(document, buffers, attributes["POSITION"].getIndex(~0ULL), 3, primitive.positions))
+            {
+                return false;
+            }
+            if (!attributes["NORMAL"].isNone() && !getAccessor(document, buffers, attributes["NORMAL"].getIndex(~0ULL), 3, primitive.normals))
+            {
+                return false;
+            }
+            if (!attributes["TEXCOORD_0"].isNone() && !getAccessor(document, buffers, attributes["TEXCOORD_0"].getIndex(~0ULL), 2, primitive.texCoords))
+            {
+                return false;
+            }
+            const JsonValue& indices = (*primitive.primitive)["indices"];
+            if (!indices.isNone() && !getAccessor(document, buffers, indices.getIndex(~0ULL), 1, primitive.indices))
+            {
+                return false;
+            }
+            size_t count = primitive.positions.count;
+            if ((primitive.normals.data != NULL && primitive.normals.count != count) || (primitive.texCoords.data != NULL && primitive.texCoords.count != count))
+            {
+                std::cout << "ERROR glTF: the attributes of a primitive have different counts" << std::endl;
+                return false;
+            }
+            primitive.firstVertex = vertexCount;
+            primitive.firstIndex = indexCount;
+            vertexCount += count;
+            indexCount += primitive.indices.data != NULL ? primitive.indices.count : count;
+            hasNormals |= primitive.normals.data != NULL;
+            hasTexCoords |= primitive.texCoords.data != NULL;
+        }
+        if (indexCount == 0 || vertexCount > 0xFFFFFFFFULL)
+        {
+            std::cout << "ERROR glTF: the file has no triangles or too many vertices (Path: " << path << " )" << std::endl;
+            return false;
+        }
+
+        mesh.positions.resize(vertexCount * 3);
+        mesh.normals.resize(hasNormals ? vertexCount * 3 : 0);
+        mesh.texCoords.resize(hasTexCoords ? vertexCount * 2 : 0);
+        mesh.indices.resize(indexCount);
+        std::atomic<bool> valid(true);
+        for (const GltfPrimitive& primitive : primitives)
+        {
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(primitive.transform)));
+            size_t count = primitive.positions.count;
+            forRange(pool, count, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    size_t vertex = primitive.firstVertex + i;
+                    glm::vec3 position = glm::vec3(primitive.transform * glm::vec4(readVector(primitive.positions, i), 1.0f));
+                    std::memcpy(&mesh.positions[vertex * 3], &position[0], 3 * sizeof(float));
+                    if (hasNormals)
+                    {
+                        glm::vec3 normal = primitive.normals.data != NULL ? normalMatrix * readVector(primitive.normals, i) : glm::vec3(0.0f);
+                        std::memcpy(&mesh.normals[vertex * 3], &normal[0], 3 * sizeof(float));
+                    }
+                    if (hasTexCoords)
+                    {
+                        bool present = primitive.texCoords.data != NULL;
+                        mesh.texCoords[vertex * 2] = present ? readComponent(primitive.texCoords, i, 0) : 0.0f;
+                        mesh.texCoords[vertex * 2 + 1] = present ? readComponent(primitive.texCoords, i, 1) : 0.0f;
+                    }
+                }
+            });
+            size_t primitiveIndices = primitive.indices.data != NULL ? primitive.indices.count : count;
+            forRange(pool, primitiveIndices, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    size_t index = primitive.indices.data != NULL ? readIndex(primitive.indices, i) : i;
+                    if (index >= count)
+                    {
+                        valid = false;
+                        return;
+                    }
+                    mesh.indices[primitive.firstIndex + i] = static_cast<unsigned int>(primitive.firstVertex + index);
+                }
+            });
+        }
+        if (!valid)
+        {
+            std::cout << "ERROR glTF: an index is out of range (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    * @brief	weld, optimize and encode a parsed mesh, the vertices and indices of mesh point into its storage afterwards
+    */
+    static void cook(const RawMesh& raw, const VertexFormat& format, MeshData& mesh)
+    {
+        // interleave to position, normal, texture coordinates, so identical corners can be welded bitwise
+        size_t rawCount = raw.getVertexCount();
+        std::vector<float> interleaved(rawCount * FLOATS_PER_VERTEX, 0.0f);
+        for (size_t i = 0; i < rawCount; i++)
+        {
+            float* vertex = &interleaved[i * FLOATS_PER_VERTEX];
+            std::copy_n(&raw.positions[i * 3], 3, vertex);
+            if (!raw.normals.empty())
+            {
+                glm::vec3 normal(raw.normals[i * 3], raw.normals[i * 3 + 1], raw.normals[i * 3 + 2]);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+                std::memcpy(vertex + 3, &normal[0], 3 * sizeof(float));
+            }
+            if (!raw.texCoords.empty())
+            {
+                std::copy_n(&raw.texCoords[i * 2], 2, vertex + 6);
+            }
+        }
+        std::vector<unsigned int> remap;
+        size_t vertexCount = MeshOptimizer::weldVertices(interleaved.data(), rawCount, VERTEX_SIZE, remap);
+        std::vector<float> vertices(vertexCount * FLOATS_PER_VERTEX);
+        MeshOptimizer::remapVertexBuffer(vertices.data(), interleaved.data(), rawCount, VERTEX_SIZE, remap);
+        interleaved = std::vector<float>();
+
+        // the index buffer without degenerate triangles, they only cost vertex shading
+        std::vector<unsigned int> indices;
+        size_t rawIndexCount = raw.indices.empty() ? rawCount : raw.indices.size();
+        indices.reserve(rawIndexCount);
+        for (size_t i = 0; i + 2 < rawIndexCount; i += 3)
+        {
+            unsigned int a = remap[raw.indices.empty() ? i : raw.indices[i]];
+            unsigned int b = remap[raw.indices.empty() ? i + 1 : raw.indices[i + 1]];
+            unsigned int c = remap[raw.indices.empty() ? i + 2 : raw.indices[i + 2]];
+            if (a != b && b != c && c != a)
+            {
+                indices.push_back(a);
+                indices.push_back(b);
+                indices.push_back(c);
+            }
+        }
+        computeMissingNormals(vertices, vertexCount, indices);
+
+        std::vector<unsigned int> cacheOrder(indices.size());
+        MeshOptimizer::optimizeVertexCache(cacheOrder.data(), indices.data(), indices.size(), vertexCount);
+        MeshOptimizer::optimizeOverdraw(indices.data(), cacheOrder.data(), cacheOrder.size(), vertices.data(), vertexCount, VERTEX_SIZE);
+        size_t usedCount = MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+        std::vector<float> fetchOrder(usedCount * FLOATS_PER_VERTEX);
+        MeshOptimizer::remapVertexBuffer(fetchOrder.data(), vertices.data(), vertexCount, VERTEX_SIZE, remap);
+
+        VertexSource source;
+        source.count = usedCount;
+        source.position = { fetchOrder.data(), VERTEX_SIZE };
+        source.normal = { fetchOrder.data() + 3, VERTEX_SIZE };
+        source.texCoord = { fetchOrder.data() + 6, VERTEX_SIZE };
+        mesh.format = format;
+        mesh.quantization = format.encode(source, mesh.vertexStorage);
+        mesh.minimum = glm::vec3(usedCount > 0 ? fetchOrder[0] : 0.0f, usedCount > 0 ? fetchOrder[1] : 0.0f, usedCount > 0 ? fetchOrder[2] : 0.0f);
+        mesh.maximum = mesh.minimum;
+        for (size_t i = 0; i < usedCount; i++)
+        {
+            glm::vec3 position(fetchOrder[i * FLOATS_PER_VERTEX], fetchOrder[i * FLOATS_PER_VERTEX + 1], fetchOrder[i * FLOATS_PER_VERTEX + 2]);
+            mesh.minimum = glm::min(mesh.minimum, position);
+            mesh.maximum = glm::max(mesh.maximum, position);
+        }
+        mesh.indexStorage = std::move(indices);
+        mesh.mapping.close();
+        mesh.vertexCount = usedCount;
+        mesh.indexCount = mesh.indexStorage.size();
+        mesh.vertices = mesh.vertexStorage.data();
+        mesh.indices = mesh.indexStorage.data();
+        mesh.cached = false;
+    }
+
+private:
+    static const size_t OBJ_CHUNK_SIZE = 1 << 20;
+    static const size_t RANGE_SIZE = 1 << 16; // vertices per parallel range of a glTF primitive
+    static const size_t FLOATS_PER_VERTEX = 8;
+    static const size_t VERTEX_SIZE = FLOATS_PER_VERTEX * sizeof(float);
+    static const int64_t NO_INDEX = INT64_MIN;
+    static const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    static const uint32_t GLB_JSON = 0x4E4F534A;
+    static const uint32_t GLB_BIN = 0x004E4942;
+    static const uint32_t CACHE_MAGIC = 0x48534D47; // "GMSH"
+    static const uint32_t CACHE_VERSION = 1;
+    static const uint64_t CACHE_ALIGNMENT = 64;
+
+    /// corner of an OBJ face, relative has a bit for every index that counts from the start of the chunk
+    struct ObjCorner
+    {
+        int64_t position;
+        int64_t texCoord;
+        int64_t normal;
+        unsigned char relative;
+    };
+
+    struct ObjChunk
+    {
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners; // three per triangle
+        std::string error;
+    };
+
+    /// a typed view into a glTF buffer
+    struct GltfAccessor
+    {
+        const unsigned char* data = NULL;
+        size_t count = 0;
+        size_t stride = 0;
+        unsigned int componentType = 0;
+        unsigned int components = 0;
+        bool normalized = false;
+    };
+
+    struct GltfPrimitive
+    {
+        const JsonValue* primitive;
+        glm::mat4 transform;
+        GltfAccessor positions;
+        GltfAccessor normals;
+        GltfAccessor texCoords;
+        GltfAccessor indices;
+        size_t firstVertex = 0;
+        size_t firstIndex = 0;
+    };
+
+    struct GltfBuffers
+    {
+        std::vector<std::string_view> views;
+        std::vector<std::unique_ptr<MappedFile>> files;
+        std::vector<std::vector<unsigned char>> decoded;
+    };
+
+    struct SourceStamp
+    {
+        uint64_t size = 0;
+        int64_t time = 0;
+    };
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint32_t stride;
+        uint32_t elementCount;
+        uint8_t semantics[4];
+        uint8_t encodings[4];
+        float quantization[6]; // scale, offset
+        float bounds[6]; // minimum, maximum
+    };
+
+    static double elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template<class Function>
+    static void forEach(ThreadPool* pool, size_t count, const Function& function)
+    {
+        if (pool != NULL)
+        {
+            pool->parallelFor(0, count, function, 1);
+            return;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            function(i);
+        }
+    }
+
+    /*
+    * @brief	call function(begin, end) for ranges of RANGE_SIZE indices
+    */
+    template<class Function>
+    static void forRange(ThreadPool* pool, size_t count, const Function& function)
+    {
+        forEach(pool, (count + RANGE_SIZE - 1) / RANGE_SIZE, [&](size_t range)
+        {
+            function(range * RANGE_SIZE, std::min(count, (range + 1) * RANGE_SIZE));
+        });
+    }
+
+    static uint32_t read32(const unsigned char* bytes)
+    {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skipSpaces(const char* position, const char* end)
+    {
+        while (position < end && isSpace(*position))
+        {
+            position++;
+        }
+        return position;
+    }
+
+    static bool parseFloats(const char*& position, const char* end, float* values, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            position = skipSpaces(position, end);
+            if (position < end && *position == '+')
+            {
+                position++;
+            }
+            std::from_chars_result result = std::from_chars(position, end, values[i]);
+            if (result.ec != std::errc())
+            {
+                return false;
+            }
+            position = result.ptr;
+        }
+        return true;
+    }
+
+    /*
+    * @brief	resolve an OBJ index: positive ones count from 1 at the start of the file, negative ones back from the
+    *			last element before the face, they are stored relative to the chunk and the bit is set in relative
+    */
+    static bool parseObjIndex(const char*& position, const char* end, size_t localCount, int64_t& index, unsigned char& relative, unsigned char bit)
+    {
+        int64_t value = 0;
+        std::from_chars_result result = std::from_chars(position, end, value);
+        if (result.ec != std::errc() || value == 0)
+        {
+            return false;
+        }
+        position = result.ptr;
+        if (value > 0)
+        {
+            index = value - 1;
+        }
+        else
+        {
+            index = static_cast<int64_t>(localCount) + value;
+            relative |= bit;
+        }
+        return true;
+    }
+
+    static void parseObjChunk(const char* position, const char* end, ObjChunk& chunk)
+    {
+        std::vector<ObjCorner> polygon;
+        while (position < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(position, '\n', end - position));
+            lineEnd = lineEnd != NULL ? lineEnd : end;
+            const char* lineStart = skipSpaces(position, lineEnd);
+            position = lineEnd + 1;
+            const char* cursor = lineStart;
+            while (cursor < lineEnd && !isSpace(*cursor))
+            {
+                cursor++;
+            }
+            std::string_view keyword(lineStart, cursor - lineStart);
+
+            // comments, groups, materials, lines and everything else is skipped
+            bool valid = true;
+            if (keyword == "v" || keyword == "vn")
+            {
+                float values[3];
+                valid = parseFloats(cursor, lineEnd, values, 3);
+                std::vector<float>& target = keyword == "v" ? chunk.positions : chunk.normals;
+                target.insert(target.end(), values, values + 3);
+            }
+            else if (keyword == "vt")
+            {
+                // the v coordinate is optional
+                float values[2] = { 0.0f, 0.0f };
+                valid = parseFloats(cursor, lineEnd, values, 1);
+                if (valid && skipSpaces(cursor, lineEnd) < lineEnd)
+                {
+                    valid = parseFloats(cursor, lineEnd, values + 1, 1);
+                }
+                chunk.texCoords.insert(chunk.texCoords.end(), values, values + 2);
+            }
+            else if (keyword == "f")
+            {
+                polygon.clear();
+                cursor = skipSpaces(cursor, lineEnd);
+                while (valid && cursor < lineEnd)
+                {
+                    // p, p/t, p//n or p/t/n
+                    ObjCorner corner = { NO_INDEX, NO_INDEX, NO_INDEX, 0 };
+                    valid = parseObjIndex(cursor, lineEnd, chunk.positions.size() / 3, corner.position, corner.relative, 1);
+                    if (valid && cursor < lineEnd && *cursor == '/')
+                    {
+                        cursor++;
+                        if (cursor < lineEnd && *cursor != '/')
+                        {
+                            valid = parseObjIndex(cursor, lineEnd, chunk.texCoords.size() / 2, corner.texCoord, corner.relative, 2);
+                        }
+                        if (valid && cursor < lineEnd && *cursor == '/')
+                        {
+                            cursor++;
+                            valid = parseObjIndex(cursor, lineEnd, chunk.normals.size() / 3, corner.normal, corner.relative, 4);
+                        }
+                    }
+                    valid = valid && (cursor == lineEnd || isSpace(*cursor));
+                    polygon.push_back(corner);
+                    cursor = skipSpaces(cursor, lineEnd);
+                }
+                for (size_t i = 2; valid && i < polygon.size(); i++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            }
+            if (!valid)
+            {
+                chunk.error = "invalid statement \"" + std::string(lineStart, std::min<size_t>(64, lineEnd - lineStart)) + "\"";
+                return;
+            }
+        }
+    }
+
+    static bool parseGlb(const unsigned char* bytes, size_t size, std::string_view& json, std::string_view& binary)
+    {
+        uint32_t length = read32(bytes + 8);
+        if (read32(bytes + 4) != 2 || length > size || length < 20)
+        {
+            std::cout << "ERROR glTF: invalid .glb header" << std::endl;
+            return false;
+        }
+        json = std::string_view();
+        binary = std::string_view();
+        for (size_t offset = 12; offset + 8 <= length; )
+        {
+            uint32_t chunkLength = read32(bytes + offset);
+            uint32_t chunkType = read32(bytes + offset + 4);
+            if (chunkLength > length - offset - 8)
+            {
+                std::cout << "ERROR glTF: .glb chunk exceeds the file" << std::endl;
+                return false;
+            }
+            std::string_view data(reinterpret_cast<const char*>(bytes + offset + 8), chunkLength);
+            if (chunkType == GLB_JSON && json.data() == NULL)
+            {
+                json = data;
+            }
+            else if (chunkType == GLB_BIN && binary.data() == NULL)
+            {
+                binary = data;
+            }
+            offset += 8 + static_cast<size_t>(chunkLength);
+        }
+        if (json.data() == NULL)
+        {
+            std::cout << "ERROR glTF: .glb has no JSON chunk" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool decodeBase64(std::string_view text, std::vector<unsigned char>& output)
+    {
+        output.clear();
+        output.reserve(text.size() / 4 * 3);
+        uint32_t bits = 0;
+        int count = 0;
+        for (char c : text)
+        {
+            int value;
+            if (c >= 'A' && c <= 'Z')
+            {
+                value = c - 'A';
+            }
+            else if (c >= 'a' && c <= 'z')
+            {
+                value = c - 'a' + 26;
+            }
+            else if (c >= '0' && c <= '9')
+            {
+                value = c - '0' + 52;
+            }
+            else if (c == '+' || c == '-')
+            {
+                value = 62;
+            }
+            else if (c == '/' || c == '_')
+            {
+                value = 63;
+            }
+            else if (c == '=')
+            {
+                break;
+            }
+            else
+            {
+                return false;
+            }
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            count += 6;
+            if (count >= 8)
+            {
+                count -= 8;
+                output.push_back(static_cast<unsigned char>((bits >> count) & 0xFF));
+            }
+        }
+        return true;
+    }
+
+    /*
+    * @brief	URIs of external buffers are percent encoded (E.g.: spaces are %20)
+    */
+    static std::string decodeUri(const std::string& uri)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < uri.size(); i++)
+        {
+            unsigned int value = 0;
+            if (uri[i] == '%' && i + 2 < uri.size() && std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16).ptr == uri.data() + i + 3)
+            {
+                decoded += static_cast<char>(value);
+                i += 2;
+            }
+            else
+            {
+                decoded += uri[i];
+            }
+        }
+        return decoded;
+    }
+
+    static bool loadBuffer(const JsonValue& buffer, const std::string& directory, std::string_view binary, GltfBuffers& buffers)
+    {
+        uint64_t byteLength = buffer["byteLength"].getIndex(0);
+        const std::string& uri = buffer["uri"].getString();
+        std::string_view data;
+        if (uri.empty())
+        {
+            data = binary; // the first buffer of a .glb without uri is the BIN chunk
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            size_t comma = uri.find(";base64,");
+            buffers.decoded.emplace_back();
+            if (comma == std::string::npos || !decodeBase64(std::string_view(uri).substr(comma + 8), buffers.decoded.back()))
+            {
+                std::cout << "ERROR glTF: only base64 data URIs are supported" << std::endl;
+                return false;
+            }
+            data = std::string_view(reinterpret_cast<const char*>(buffers.decoded.back().data()), buffers.decoded.back().size());
+        }
+        else
+        {
+            std::string path = directory.empty() ? decodeUri(uri) : directory + "/" + decodeUri(uri);
+            buffers.files.push_back(std::make_unique<MappedFile>());
+            if (!buffers.files.back()->open(path.c_str()))
+            {
+                return false;
+            }
+            buffers.files.back()->prefetch();
+            data = std::string_view(reinterpret_cast<const char*>(buffers.files.back()->data()), buffers.files.back()->size());
+        }
+        if (data.size() < byteLength)
+        {
+            std::cout << "ERROR glTF: buffer is shorter than its byteLength (Uri: " << uri << " )" << std::endl;
+            return false;
+        }
+        buffers.views.push_back(data.substr(0, byteLength));
+        return true;
+    }
+
+    static unsigned int getComponentSize(unsigned int componentType)
+    {
+        switch (componentType)
+        {
+        case 5120: case 5121: return 1; // BYTE, UNSIGNED_BYTE
+        case 5122: case 5123: return 2; // SHORT, UNSIGNED_SHORT
+        case 5125: case 5126: return 4; // UNSIGNED_INT, FLOAT
+        default: return 0;
+        }
+    }
+
+    /*
+    * @brief	resolve an accessor to a view into its buffer and check that all its elements are inside the buffer view
+    *
+    * @param	components	1 for indices, 2 for texture coordinates and 3 for positions and normals
+    */
+    static bool getAccessor(const JsonValue& document, const GltfBuffers& buffers, uint64_t index, unsigned int components, GltfAccessor& accessor)
+    {
+        const JsonValue& description = document["accessors"][index];
+        static const char* TYPES[] = { "", "SCALAR", "VEC2", "VEC3" };
+        accessor.componentType = static_cast<unsigned int>(description["componentType"].getIndex(0));
+        accessor.components = components;
+        accessor.count = description["count"].getIndex(0);
+        accessor.normalized = description["normalized"].boolean;
+        unsigned int componentSize = getComponentSize(accessor.componentType);
+        bool floatData = accessor.componentType == 5126 || accessor.normalized;
+        bool supported = components == 1 ? accessor.componentType == 5121 || accessor.componentType == 5123 || accessor.componentType == 5125 : floatData;
+        if (description.isNone() || description["type"].getString() != TYPES[components] || componentSize == 0 || !supported)
+        {
+            std::cout << "ERROR glTF: accessor " << index << " is missing or has an unsupported type" << std::endl;
+            return false;
+        }
+        const JsonValue& view = document["bufferViews"][description["bufferView"].getIndex(~0ULL)];
+        uint64_t bufferIndex = view["buffer"].getIndex(~0ULL);
+        if (view.isNone() || !description["sparse"].isNone() || bufferIndex >= buffers.views.size())
+        {
+            std::cout << "ERROR glTF: accessor " << index << " has no buffer view (sparse accessors are not supported)" << std::endl;
+            return false;
+        }
+        uint64_t elementSize = static_cast<uint64_t>(componentSize) * components;
+        uint64_t viewOffset = view["byteOffset"].getIndex(0);
+        uint64_t viewLength = view["byteLength"].getIndex(0);
+        uint64_t accessorOffset = description["byteOffset"].getIndex(0);
+        accessor.stride = view["byteStride"].getIndex(elementSize);
+        std::string_view buffer = buffers.views[bufferIndex];
+        if (viewOffset > buffer.size() || viewLength > buffer.size() - viewOffset || accessor.stride < elementSize
+            || (accessor.count > 0 && (accessorOffset > viewLength || (accessor.count - 1) > (viewLength - accessorOffset - std::min(elementSize, viewLength - accessorOffset)) / accessor.stride
+                || accessorOffset + elementSize > viewLength)))
+        {
+            std::cout << "ERROR glTF: accessor " << index << " exceeds its buffer view" << std::endl;
+            return false;
+        }
+        accessor.data = reinterpret_cast<const unsigned char*>(buffer.data()) + viewOffset + accessorOffset;
+        return true;
+    }
+
+    static float readComponent(const GltfAccessor& accessor, size_t element, unsigned int component)
+    {
+        const unsigned char* data = accessor.data + element * accessor.stride;
+        switch (accessor.componentType)
+        {
+        case 5120: return std::max(static_cast<int8_t>(data[component]) / 127.0f, -1.0f);
+        case 5121: return data[component] / 255.0f;
+        case 5122:
+        {
+            int16_t value;
+            std::memcpy(&value, data + component * 2, sizeof(value));
+            return std::max(value / 32767.0f, -1.0f);
+        }
+        case 5123:
+        {
+            uint16_t value;
+            std::memcpy(&value, data + component * 2, sizeof(value));
+            return value / 65535.0f;
+        }
+        default:
+        {
+            float value;
+            std::memcpy(&value, data + component * 4, sizeof(value));
+            return value;
+        }
+        }
+    }
+
+    static glm::vec3 readVector(const GltfAccessor& accessor, size_t element)
+    {
+        return glm::vec3(readComponent(accessor, element, 0), readComponent(accessor, element, 1), readComponent(accessor, element, 2));
+    }
+
+    static size_t readIndex(const GltfAccessor& accessor, size_t element)
+    {
+        const unsigned char* data = accessor.data + element * accessor.stride;
+        if (accessor.componentType == 5121)
+        {
+            return data[0];
+        }
+        if (accessor.componentType == 5123)
+        {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static glm::mat4 getNodeTransform(const JsonValue& node)
+    {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.size() == 16)
+        {
+            glm::mat4 transform;
+            for (int i = 0; i < 16; i++)
+            {
+                transform[i / 4][i % 4] = static_cast<float>(matrix[i].getNumber(0.0)); // column major like glm
+            }
+            return transform;
+        }
+        const JsonValue& translation = node["translation"];
+        const JsonValue& rotation = node["rotation"];
+        const JsonValue& scale = node["scale"];
+        glm::mat4 transform(1.0f);
+        transform[3] = glm::vec4(translation[0].getNumber(0.0), translation[1].getNumber(0.0), translation[2].getNumber(0.0), 1.0f);
+        glm::quat orientation(static_cast<float>(rotation[3].getNumber(1.0)), static_cast<float>(rotation[0].getNumber(0.0)),
+            static_cast<float>(rotation[1].getNumber(0.0)), static_cast<float>(rotation[2].getNumber(0.0)));
+        glm::mat4 scaling(1.0f);
+        scaling[0][0] = static_cast<float>(scale[0].getNumber(1.0));
+        scaling[1][1] = static_cast<float>(scale[1].getNumber(1.0));
+        scaling[2][2] = static_cast<float>(scale[2].getNumber(1.0));
+        return transform * glm::mat4_cast(orientation) * scaling;
+    }
+
+    static void addMesh(const JsonValue& document, uint64_t meshIndex, const glm::mat4& transform, std::vector<GltfPrimitive>& primitives)
+    {
+        const JsonValue& primitiveList = document["meshes"][meshIndex]["primitives"];
+        for (size_t i = 0; i < primitiveList.size(); i++)
+        {
+            if (primitiveList[i]["mode"].getIndex(4) == 4) // TRIANGLES, strips and fans are skipped
+            {
+                GltfPrimitive primitive;
+                primitive.primitive = &primitiveList[i];
+                primitive.transform = transform;
+                primitives.push_back(primitive);
+            }
+        }
+    }
+
+    static void addNode(const JsonValue& document, uint64_t nodeIndex, const glm::mat4& parent, unsigned int depth, std::vector<GltfPrimitive>& primitives)
+    {
+        const JsonValue& node = document["nodes"][nodeIndex];
+        if (node.isNone() || depth > 64) // the node graph has to be a forest, the depth limit breaks cycles of broken files
+        {
+            return;
+        }
+        glm::mat4 transform = parent * getNodeTransform(node);
+        if (!node["mesh"].isNone())
+        {
+            addMesh(document, node["mesh"].getIndex(~0ULL), transform, primitives);
+        }
+        const JsonValue& children = node["children"];
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            addNode(document, children[i].getIndex(~0ULL), transform, depth + 1, primitives);
+        }
+    }
+
+    static void collectPrimitives(const JsonValue& document, std::vector<GltfPrimitive>& primitives)
+    {
+        const JsonValue& scene = document["scenes"][document["scene"].getIndex(0)];
+        if (!scene.isNone())
+        {
+            const JsonValue& roots = scene["nodes"];
+            for (size_t i = 0; i < roots.size(); i++)
+            {
+                addNode(document, roots[i].getIndex(~0ULL), glm::mat4(1.0f), 0, primitives);
+            }
+            return;
+        }
+        for (size_t i = 0; i < document["meshes"].size(); i++)
+        {
+            addMesh(document, i, glm::mat4(1.0f), primitives);
+        }
+    }
+
+    /*
+    * @brief	area weighted normals for the vertices without one, vertices at the same position share the normal so
+    *			texture seams stay smooth
+    */
+    static void computeMissingNormals(std::vector<float>& vertices, size_t vertexCount, const std::vector<unsigned int>& indices)
+    {
+        bool missing = false;
+        for (size_t i = 0; i < vertexCount && !missing; i++)
+        {
+            const float* normal = &vertices[i * FLOATS_PER_VERTEX + 3];
+            missing = normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f;
+        }
+        if (!missing)
+        {
+            return;
+        }
+        std::vector<float> positions(vertexCount * 3);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            std::copy_n(&vertices[i * FLOATS_PER_VERTEX], 3, &positions[i * 3]);
+        }
+        std::vector<unsigned int> positionRemap;
+        size_t positionCount = MeshOptimizer::weldVertices(positions.data(), vertexCount, 3 * sizeof(float), positionRemap);
+        std::vector<glm::vec3> normals(positionCount, glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            glm::vec3 a = glm::make_vec3(&positions[indices[i] * 3]);
+            glm::vec3 b = glm::make_vec3(&positions[indices[i + 1] * 3]);
+            glm::vec3 c = glm::make_vec3(&positions[indices[i + 2] * 3]);
+            glm::vec3 normal = glm::cross(b - a, c - a); // length is twice the area
+            for (int corner = 0; corner < 3; corner++)
+            {
+                normals[positionRemap[indices[i + corner]]] += normal;
+            }
+        }
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            float* normal = &vertices[i * FLOATS_PER_VERTEX + 3];
+            if (normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f)
+            {
+                glm::vec3 sum = normals[positionRemap[i]];
+                float length = glm::length(sum);
+                glm::vec3 unit = length > 0.0f ? sum / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                std::memcpy(normal, &unit[0], 3 * sizeof(float));
+            }
+        }
+    }
+
+    static bool getSourceStamp(const char* path, SourceStamp& stamp)
+    {
+        std::error_code error;
+        stamp.size = std::filesystem::file_size(path, error);
+        if (error)
+        {
+            return false;
+        }
+        stamp.time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+        return !error;
+    }
+
+    /*
+    * @brief	the cooked file is named after a hash of the absolute source path
+    */
+    static std::string getCachePath(const char* cacheDirectory, const char* path)
+    {
+        std::error_code error;
+        std::string absolute = std::filesystem::absolute(path, error).generic_string();
+        unsigned long long hash = 14695981039346656037ULL; // FNV-1a 64 bit
+        for (char c : absolute)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        std::ostringstream cachePath;
+        cachePath << cacheDirectory << "/" << std::hex << hash << ".mesh";
+        return cachePath.str();
+    }
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    /*
+    * @brief	write into a temporary file and rename it, a run that is killed while writing leaves no broken cache file
+    */
+    static bool writeCache(const char* path, const MeshData& mesh, const SourceStamp& stamp)
+    {
+        const std::vector<VertexElement>& elements = mesh.format.getElements();
+        CacheHeader header = {};
+        header.magic = CACHE_MAGIC;
+        header.version = CACHE_VERSION;
+        header.sourceSize = stamp.size;
+        header.sourceTime = stamp.time;
+        header.vertexCount = mesh.vertexCount;
+        header.indexCount = mesh.indexCount;
+        header.vertexOffset = alignUp(sizeof(CacheHeader), CACHE_ALIGNMENT);
+        header.indexOffset = alignUp(header.vertexOffset + mesh.vertexCount * mesh.format.getStride(), CACHE_ALIGNMENT);
+        header.stride = mesh.format.getStride();
+        header.elementCount = static_cast<uint32_t>(elements.size());
+        for (size_t i = 0; i < elements.size() && i < 4; i++)
+        {
+            header.semantics[i] = static_cast<uint8_t>(elements[i].semantic);
+            header.encodings[i] = static_cast<uint8_t>(elements[i].encoding);
+        }
+        std::memcpy(header.quantization, &mesh.quantization.scale[0], 3 * sizeof(float));
+        std::memcpy(header.quantization + 3, &mesh.quantization.offset[0], 3 * sizeof(float));
+        std::memcpy(header.bounds, &mesh.minimum[0], 3 * sizeof(float));
+        std::memcpy(header.bounds + 3, &mesh.maximum[0], 3 * sizeof(float));
+
+        std::string temporary = std::string(path) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            const char padding[CACHE_ALIGNMENT] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+            file.write(reinterpret_cast<const char*>(mesh.vertices), static_cast<std::streamsize>(mesh.vertexCount * header.stride));
+            file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - mesh.vertexCount * header.stride));
+            file.write(reinterpret_cast<const char*>(mesh.indices), static_cast<std::streamsize>(mesh.indexCount * sizeof(unsigned int)));
+            if (!file)
+            {
+                std::cout << "ERROR couldn't write File (Path: " << temporary << " )" << std::endl;
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    /*
+    * @return	returns false if there is no cooked file, it's outdated or it was cooked with another format
+    */
+    static bool readCache(const char* path, const VertexFormat& format, const SourceStamp& stamp, MeshData& mesh)
+    {
+        std::error_code error;
+        if (!std::filesystem::exists(path, error) || !mesh.mapping.open(path))
+        {
+            return false;
+        }
+        CacheHeader header;
+        const std::vector<VertexElement>& elements = format.getElements();
+        bool valid = mesh.mapping.size() >= sizeof(header);
+        if (valid)
+        {
+            std::memcpy(&header, mesh.mapping.data(), sizeof(header));
+            valid = header.magic == CACHE_MAGIC && header.version == CACHE_VERSION && header.sourceSize == stamp.size && header.sourceTime == stamp.time
+                && header.stride == format.getStride() && header.elementCount == elements.size()
+                && header.vertexOffset % CACHE_ALIGNMENT == 0 && header.indexOffset % CACHE_ALIGNMENT == 0
+                && header.vertexOffset <= mesh.mapping.size() && header.vertexCount <= (mesh.mapping.size() - header.vertexOffset) / header.stride
+                && header.indexOffset <= mesh.mapping.size() && header.indexCount <= (mesh.mapping.size() - header.indexOffset) / sizeof(unsigned int);
+        }
+        for (size_t i = 0; valid && i < elements.size(); i++)
+        {
+            valid = i < 4 && header.semantics[i] == static_cast<uint8_t>(elements[i].semantic) && header.encodings[i] == static_cast<uint8_t>(elements[i].encoding);
+        }
+        if (!valid)
+        {
+            mesh.mapping.close();
+            return false;
+        }
+        mesh.mapping.prefetch();
+        // the indices go to the GPU unchecked, a corrupt file must not let it fetch vertices out of bounds
+        const unsigned int* indices = reinterpret_cast<const unsigned int*>(mesh.mapping.data() + header.indexOffset);
+        unsigned int largestIndex = 0;
+        for (uint64_t i = 0; i < header.indexCount; i++)
+        {
+            largestIndex = std::max(largestIndex, indices[i]);
+        }
+        if (header.indexCount > 0 && largestIndex >= header.vertexCount)
+        {
+            std::cout << "ERROR cooked mesh has indices out of range, cooking it again (Path: " << path << " )" << std::endl;
+            mesh.mapping.close();
+            return false;
+        }
+        mesh.format = format;
+        std::memcpy(&mesh.quantization.scale[0], header.quantization, 3 * sizeof(float));
+        std::memcpy(&mesh.quantization.offset[0], header.quantization + 3, 3 * sizeof(float));
+        std::memcpy(&mesh.minimum[0], header.bounds, 3 * sizeof(float));
+        std::memcpy(&mesh.maximum[0], header.bounds + 3, 3 * sizeof(float));
+        mesh.vertexCount = header.vertexCount;
+        mesh.indexCount = header.indexCount;
+        mesh.vertices = mesh.mapping.data() + header.vertexOffset;
+        mesh.indices = indices;
+        mesh.vertexStorage.clear();
+        mesh.indexStorage.clear();
+        mesh.cached = true;
+        return true;
+    }
+};
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+/// vertex cache efficiency of an index buffer, see MeshOptimizer::analyzeVertexCache
+struct VertexCacheStats
+{
+    unsigned int transformedVertices = 0; // cache misses
+    float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle, 0.5 is the ideal for large grids, 3 means no reuse
+    float atvr = 0.0f; // average transformed vertex ratio: transformed vertices per referenced vertex, 1 is the ideal
+};
+
+/// <summary>
+///
+/// Index buffer generation and optimization for triangle lists.
+/// <para>weldVertices() merges bitwise identical vertices through a hash table, so a non indexed mesh becomes an
+/// indexed one. optimizeVertexCache() reorders the triangles with Tipsify (Sander et al. 2007) for the post
+/// transform vertex cache, optimizeOverdraw() then moves clusters of triangles that face outwards to the front
+/// so they occlude the rest, as long as the cache efficiency stays within a threshold.</para>
+/// <para>Usage: weldVertices() -> remapVertexBuffer() -> optimizeVertexCache() -> optimizeOverdraw() -> optimizeVertexFetch() -> remapVertexBuffer()</para>
+///
+/// </summary>
+class MeshOptimizer
+{
+public:
+    static const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+    /*
+    * @brief	find bitwise identical vertices, the unique vertices keep the order of their first occurrence
+    *
+    * @param	remap	receives the unique index of every input vertex, for a non indexed mesh it is the index buffer
+    *
+    * @return	returns the number of unique vertices
+    */
+    static size_t weldVertices(const void* vertices, size_t vertexCount, size_t vertexSize, std::vector<unsigned int>& remap)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(vertices);
+        remap.resize(vertexCount);
+
+        // open addressing with linear probing, the table stores the index of the first occurrence
+        size_t tableSize = 16;
+        while (tableSize < vertexCount * 2)
+        {
+            tableSize *= 2;
+        }
+        const unsigned int EMPTY = ~0U;
+        std::vector<unsigned int> table(tableSize, EMPTY);
+        size_t unique = 0;
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const unsigned char* vertex = bytes + i * vertexSize;
+            size_t slot = hashBytes(vertex, vertexSize) & (tableSize - 1);
+            while (table[slot] != EMPTY && std::memcmp(bytes + static_cast<size_t>(table[slot]) * vertexSize, vertex, vertexSize) != 0)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == EMPTY)
+            {
+                table[slot] = static_cast<unsigned int>(i);
+                remap[i] = static_cast<unsigned int>(unique++);
+            }
+            else
+            {
+                remap[i] = remap[table[slot]];
+            }
+        }
+        return unique;
+    }
+
+    /*
+    * @brief	copy every vertex to its unique index, destination holds as many vertices as weldVertices returned,
+    *			vertices remapped to ~0U are dropped
+    */
+    static void remapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const std::vector<unsigned int>& remap)
+    {
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            if (remap[i] == ~0U)
+            {
+                continue;
+            }
+            std::memcpy(static_cast<unsigned char*>(destination) + static_cast<size_t>(remap[i]) * vertexSize,
+                static_cast<const unsigned char*>(vertices) + i * vertexSize, vertexSize);
+        }
+    }
+
+    /*
+    * @brief	number the vertices in the order the triangles use them first, so the vertex fetch walks the vertex buffer
+    *			forward. The indices are rewritten in place, the vertices have to be moved with remapVertexBuffer
+    *
+    * @param	remap	receives the new index of every vertex, unused vertices get ~0U
+    *
+    * @return	returns the number of used vertices
+    */
+    static size_t optimizeVertexFetch(unsigned int* indices, size_t indexCount, size_t vertexCount, std::vector<unsigned int>& remap)
+    {
+        remap.assign(vertexCount, ~0U);
+        unsigned int next = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            unsigned int& target = remap[indices[i]];
+            if (target == ~0U)
+            {
+                target = next++;
+            }
+            indices[i] = target;
+        }
+        return next;
+    }
+
+    /*
+    * @brief	simulate a FIFO post transform cache
+    */
+    static VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        unsigned int time = cacheSize + 1;
+        size_t referencedCount = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            unsigned int vertex = indices[i];
+            if (time - timestamps[vertex] > cacheSize)
+            {
+                timestamps[vertex] = time++;
+                stats.transformedVertices++;
+            }
+            if (!referenced[vertex])
+            {
+                referenced[vertex] = true;
+                referencedCount++;
+            }
+        }
+        if (indexCount > 0)
+        {
+            stats.acmr = static_cast<float>(stats.transformedVertices) / (indexCount / 3);
+            stats.atvr = static_cast<float>(stats.transformedVertices) / referencedCount;
+        }
+        return stats;
+    }
+
+    /*
+    * @brief	reorder the triangles for the post transform vertex cache with Tipsify, runs in linear time
+    *
+    * @param	destination	indexCount indices, must not be the same array as indices
+    */
+    static void optimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+    {
+        size_t triangleCount = indexCount / 3;
+        Adjacency adjacency = buildAdjacency(indices, indexCount, vertexCount);
+        std::vector<unsigned int> liveTriangles(adjacency.counts);
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> deadEnds; // recently used vertices, candidates when the fan runs dry
+        std::vector<unsigned int> candidates;
+        unsigned int time = cacheSize + 1;
+        size_t cursor = 0, output = 0;
+
+        int fan = skipDeadEnd(liveTriangles, deadEnds, cursor);
+        while (fan >= 0)
+        {
+            // emit every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (unsigned int k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1]; k++)
+            {
+                unsigned int triangle = adjacency.triangles[k];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int vertex = indices[triangle * 3 + corner];
+                    destination[output++] = vertex;
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (time - timestamps[vertex] > cacheSize)
+                    {
+                        timestamps[vertex] = time++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            // next fan: the oldest candidate that is still in the cache after its remaining triangles are emitted
+            fan = -1;
+            unsigned int bestPriority = 0;
+            for (unsigned int vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0 || time - timestamps[vertex] + 2 * liveTriangles[vertex] > cacheSize)
+                {
+                    continue;
+                }
+                unsigned int priority = time - timestamps[vertex];
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fan = static_cast<int>(vertex);
+                }
+            }
+            if (fan < 0)
+            {
+                fan = skipDeadEnd(liveTriangles, deadEnds, cursor);
+            }
+        }
+    }
+
+    /*
+    * @brief	reorder clusters of a cache optimized index buffer so triangles that face away from the mesh center are drawn first
+    *
+    * @param	destination	indexCount indices, must not be the same array as indices
+    * @param	positions	first float of the xyz position of vertex 0
+    * @param	stride	bytes between two positions
+    * @param	threshold	the cluster order is only used if the ACMR grows by at most this factor
+    */
+    static void optimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t stride,
+        float threshold = 1.05f, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+    {
+        std::copy(indices, indices + indexCount, destination);
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+        {
+            return;
+        }
+        auto position = [positions, stride](unsigned int vertex)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + static_cast<size_t>(vertex) * stride);
+        };
+
+        // clusters start where the cache restarts: triangles whose three vertices all miss
+        std::vector<size_t> clusterStarts;
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        unsigned int time = cacheSize + 1;
+        for (size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            int misses = 0;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                if (time - timestamps[vertex] > cacheSize)
+                {
+                    timestamps[vertex] = time++;
+                    misses++;
+                }
+            }
+            if (misses == 3)
+            {
+                clusterStarts.push_back(triangle);
+            }
+        }
+        if (clusterStarts.empty() || clusterStarts[0] != 0)
+        {
+            clusterStarts.insert(clusterStarts.begin(), 0);
+        }
+        clusterStarts.push_back(triangleCount);
+        size_t clusterCount = clusterStarts.size() - 1;
+        if (clusterCount < 2)
+        {
+            return;
+        }
+
+        // occlusion potential: how far the cluster lies outwards along its own area weighted normal
+        float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                meshCenter[c] += position(indices[i])[c] / indexCount;
+            }
+        }
+        std::vector<float> potentials(clusterCount);
+        for (size_t cluster = 0; cluster < clusterCount; cluster++)
+        {
+            float center[3] = { 0.0f, 0.0f, 0.0f }, normal[3] = { 0.0f, 0.0f, 0.0f };
+            size_t corners = (clusterStarts[cluster + 1] - clusterStarts[cluster]) * 3;
+            for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+            {
+                const float* a = position(indices[triangle * 3]);
+                const float* b = position(indices[triangle * 3 + 1]);
+                const float* c = position(indices[triangle * 3 + 2]);
+                float edge0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                float edge1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                normal[0] += edge0[1] * edge1[2] - edge0[2] * edge1[1];
+                normal[1] += edge0[2] * edge1[0] - edge0[0] * edge1[2];
+                normal[2] += edge0[0] * edge1[1] - edge0[1] * edge1[0];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    center[axis] += (a[axis] + b[axis] + c[axis]) / corners;
+                }
+            }
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            float potential = 0.0f;
+            for (int axis = 0; axis < 3 && length > 0.0f; axis++)
+            {
+                potential += (center[axis] - meshCenter[axis]) * normal[axis] / length;
+            }
+            potentials[cluster] = potential;
+        }
+
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+        std::stable_sort(order.begin(), order.end(), [&potentials](size_t a, size_t b) { return potentials[a] > potentials[b]; });
+        size_t output = 0;
+        for (size_t cluster : order)
+        {
+            for (size_t i = clusterStarts[cluster] * 3; i < clusterStarts[cluster + 1] * 3; i++)
+            {
+                destination[output++] = indices[i];
+            }
+        }
+
+        float before = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+        float after = analyzeVertexCache(destination, indexCount, vertexCount, cacheSize).acmr;
+        if (after > before * threshold)
+        {
+            std::copy(indices, indices + indexCount, destination);
+        }
+    }
+
+private:
+    /// triangles around every vertex (compressed rows)
+    struct Adjacency
+    {
+        std::vector<unsigned int> counts;
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+    };
+
+    static Adjacency buildAdjacency(const unsigned int* indices, size_t indexCount, size_t vertexCount)
+    {
+        Adjacency adjacency;
+        adjacency.counts.assign(vertexCount, 0);
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        adjacency.triangles.resize(indexCount - indexCount % 3);
+        for (size_t i = 0; i < adjacency.triangles.size(); i++)
+        {
+            adjacency.counts[indices[i]]++;
+        }
+        for (size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            adjacency.offsets[vertex + 1] = adjacency.offsets[vertex] + adjacency.counts[vertex];
+        }
+        std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < adjacency.triangles.size(); i++)
+        {
+            adjacency.triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+        return adjacency;
+    }
+
+    /*
+    * @brief	the most recent dead end vertex that still has triangles, otherwise the next one in input order
+    */
+    static int skipDeadEnd(const std::vector<unsigned int>& liveTriangles, std::vector<unsigned int>& deadEnds, size_t& cursor)
+    {
+        while (!deadEnds.empty())
+        {
+            unsigned int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+            {
+                return static_cast<int>(vertex);
+            }
+        }
+        for (; cursor < liveTriangles.size(); cursor++)
+        {
+            if (liveTriangles[cursor] > 0)
+            {
+                return static_cast<int>(cursor);
+            }
+        }
+        return -1;
+    }
+
+    static size_t hashBytes(const unsigned char* bytes, size_t size)
+    {
+        // FNV-1a
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 16777619U;
+        }
+        return hash;
+    }
+};
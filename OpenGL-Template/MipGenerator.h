@@ -0,0 +1,463 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define MIP_GENERATOR_AVX2
+#include <immintrin.h>
+#endif
+
+#include "ThreadPool.h"
+
+/// BOX: 2x2 average, KAISER: 8x8 Kaiser windowed sinc, sharper and without the aliasing of the box filter
+enum class MipFilter {
+    BOX,
+    KAISER
+};
+
+struct MipSettings
+{
+    MipFilter filter = MipFilter::KAISER;
+    bool srgb = true; // the colors are sRGB encoded (photos, albedo), they are filtered in linear space
+    float alphaCutoff = 0.0f; // > 0: scale the alpha of every level so the same share of pixels passes this alpha test
+    bool simd = true; // false: scalar reference implementation
+};
+
+/// one level inside MipChain::data
+struct MipLevel
+{
+    size_t offset = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/// RGBA8 image with its mip chain, level 0 is the largest
+struct MipChain
+{
+    int width = 0;
+    int height = 0;
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> data;
+
+    size_t getByteSize() const
+    {
+        return data.size();
+    }
+};
+
+/// <summary>
+///
+/// CPU mipmap generator for RGBA8 images, replaces glGenerateMipmap so the quality doesn't depend on the driver
+/// and the chain can be generated on worker threads or offline.
+/// <para>Every level is filtered from the previous one in linear, premultiplied float RGBA with a separable 2:1
+/// filter: rows are filtered vertically, the result horizontally. The filter loops use AVX2 or SSE2 when the
+/// compiler targets them (OPENGL_TEMPLATE_NATIVE enables AVX2). The rows of a level are processed in bands
+/// on the ThreadPool, edges are clamped.</para>
+/// <para>Alpha coverage preservation (MipSettings::alphaCutoff) keeps cutout textures from thinning out in the
+/// distance: the alpha of each level is scaled so the same share of pixels passes the alpha test as in level 0.</para>
+///
+/// </summary>
+class MipGenerator
+{
+public:
+    /*
+    * @brief	build the full mip chain down to 1x1, level 0 is a copy of the input
+    *
+    * @param	pool	optional, filters on the calling thread if NULL
+    */
+    static void generate(const unsigned char* rgba, int width, int height, const MipSettings& settings, MipChain& chain, ThreadPool* pool = NULL)
+    {
+        chain.width = width;
+        chain.height = height;
+        chain.levels.clear();
+        size_t total = 0;
+        for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+        {
+            MipLevel level;
+            level.offset = total;
+            level.width = w;
+            level.height = h;
+            chain.levels.push_back(level);
+            total += static_cast<size_t>(w) * h * 4;
+            if (w == 1 && h == 1)
+            {
+                break;
+            }
+        }
+        chain.data.resize(total);
+        std::memcpy(chain.data.data(), rgba, static_cast<size_t>(width) * height * 4);
+        if (chain.levels.size() == 1)
+        {
+            return;
+        }
+
+        const Tables& tables = getTables();
+        Kernel kernel = getKernel(settings.filter);
+        float coverage = settings.alphaCutoff > 0.0f ? computeCoverage(rgba, static_cast<size_t>(width) * height, settings.alphaCutoff) : 0.0f;
+
+        // level 0 to linear premultiplied floats
+        std::vector<float> current(static_cast<size_t>(width) * height * 4), next;
+        forRows(pool, height, [&](int y)
+        {
+            const unsigned char* source = rgba + static_cast<size_t>(y) * width * 4;
+            float* target = current.data() + static_cast<size_t>(y) * width * 4;
+            for (int x = 0; x < width * 4; x += 4)
+            {
+                float alpha = source[x + 3] * (1.0f / 255.0f);
+                for (int c = 0; c < 3; c++)
+                {
+                    target[x + c] = (settings.srgb ? tables.toLinear[source[x + c]] : source[x + c] * (1.0f / 255.0f)) * alpha;
+                }
+                target[x + 3] = alpha;
+            }
+        });
+
+        for (size_t i = 1; i < chain.levels.size(); i++)
+        {
+            const MipLevel& source = chain.levels[i - 1];
+            const MipLevel& level = chain.levels[i];
+            next.resize(static_cast<size_t>(level.width) * level.height * 4);
+            downsample(current.data(), source.width, source.height, next.data(), level.width, level.height, kernel, settings.simd, pool);
+
+            float alphaScale = settings.alphaCutoff > 0.0f ? findAlphaScale(next, settings.alphaCutoff, coverage) : 1.0f;
+            unsigned char* target = chain.data.data() + level.offset;
+            forRows(pool, level.height, [&](int y)
+            {
+                size_t row = static_cast<size_t>(y) * level.width * 4;
+                encodeRow(next.data() + row, target + row, level.width, alphaScale, settings.srgb, tables);
+            });
+            current.swap(next);
+        }
+    }
+
+private:
+    static const int MAX_TAPS = 8;
+    static const int PADDING = 4; // pixels left and right of a filtered row, so the horizontal taps never need a clamp
+    static const int BAND_ROWS = 16; // output rows per parallelFor index
+    static const int ENCODE_TABLE_SIZE = 1 << 14;
+
+    /// 2:1 filter, output pixel x is centered between the source pixels 2x and 2x + 1 and reads 2x + first .. 2x + first + count - 1
+    struct Kernel
+    {
+        int first;
+        int count;
+        float weights[MAX_TAPS];
+    };
+
+    struct Tables
+    {
+        float toLinear[256];
+        unsigned char toSrgb[ENCODE_TABLE_SIZE + 1];
+    };
+
+    static const Tables& getTables()
+    {
+        static const Tables tables = []()
+        {
+            Tables result;
+            for (int i = 0; i < 256; i++)
+            {
+                float value = i / 255.0f;
+                result.toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i <= ENCODE_TABLE_SIZE; i++)
+            {
+                float value = static_cast<float>(i) / ENCODE_TABLE_SIZE;
+                float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                result.toSrgb[i] = static_cast<unsigned char>(encoded * 255.0f + 0.5f);
+            }
+            return result;
+        }();
+        return tables;
+    }
+
+    static Kernel getKernel(MipFilter filter)
+    {
+        Kernel kernel;
+        if (filter == MipFilter::BOX)
+        {
+            kernel.first = 0;
+            kernel.count = 2;
+            kernel.weights[0] = kernel.weights[1] = 0.5f;
+            return kernel;
+        }
+
+        // sinc with the cutoff of the halved resolution, windowed by a Kaiser window (alpha 4) over 4 source pixels on each side
+        const double alpha = 4.0, radius = 4.0;
+        auto besselI0 = [](double x)
+        {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 20; k++)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        };
+        kernel.first = -3;
+        kernel.count = 8;
+        double total = 0.0, weights[MAX_TAPS];
+        for (int i = 0; i < kernel.count; i++)
+        {
+            double t = kernel.first + i - 0.5; // distance of the tap from the output center in source pixels
+            double x = 3.14159265358979323846 * t * 0.5;
+            double sinc = std::sin(x) / x;
+            double window = besselI0(alpha * std::sqrt(1.0 - (t / radius) * (t / radius))) / besselI0(alpha);
+            weights[i] = sinc * window;
+            total += weights[i];
+        }
+        for (int i = 0; i < kernel.count; i++)
+        {
+            kernel.weights[i] = static_cast<float>(weights[i] / total);
+        }
+        return kernel;
+    }
+
+    template<class Function>
+    static void forRows(ThreadPool* pool, int rows, const Function& function)
+    {
+        auto band = [&](size_t index)
+        {
+            int last = std::min(rows, static_cast<int>(index + 1) * BAND_ROWS);
+            for (int y = static_cast<int>(index) * BAND_ROWS; y < last; y++)
+            {
+                function(y);
+            }
+        };
+        size_t bands = static_cast<size_t>((rows + BAND_ROWS - 1) / BAND_ROWS);
+        if (pool != NULL)
+        {
+            pool->parallelFor(0, bands, band, 1);
+        }
+        else
+        {
+            for (size_t i = 0; i < bands; i++)
+            {
+                band(i);
+            }
+        }
+    }
+
+    static void downsample(const float* source, int width, int height, float* target, int targetWidth, int targetHeight, const Kernel& kernel, bool simd, ThreadPool* pool)
+    {
+        forRows(pool, targetHeight, [&](int y)
+        {
+            // vertical pass into a padded row, a band reuses the row of its thread
+            thread_local std::vector<float> row;
+            row.resize(static_cast<size_t>(width + 2 * PADDING) * 4);
+            float* filtered = row.data() + PADDING * 4;
+            const float* rows[MAX_TAPS];
+            int taps = height > 1 ? kernel.count : 1;
+            float weights[MAX_TAPS];
+            for (int k = 0; k < taps; k++)
+            {
+                int sourceY = height > 1 ? std::min(std::max(2 * y + kernel.first + k, 0), height - 1) : 0;
+                rows[k] = source + static_cast<size_t>(sourceY) * width * 4;
+                weights[k] = height > 1 ? kernel.weights[k] : 1.0f;
+            }
+            if (simd)
+            {
+                filterVerticalSimd(rows, weights, taps, filtered, width * 4);
+            }
+            else
+            {
+                filterVertical(rows, weights, taps, filtered, width * 4);
+            }
+            for (int p = 0; p < PADDING; p++)
+            {
+                std::memcpy(row.data() + p * 4, filtered, 4 * sizeof(float));
+                std::memcpy(filtered + (width + p) * 4, filtered + (width - 1) * 4, 4 * sizeof(float));
+            }
+
+            float* output = target + static_cast<size_t>(y) * targetWidth * 4;
+            if (width == 1)
+            {
+                std::memcpy(output, filtered, 4 * sizeof(float));
+            }
+            else if (simd)
+            {
+                filterHorizontalSimd(filtered, kernel, output, targetWidth);
+            }
+            else
+            {
+                filterHorizontal(filtered, kernel, output, targetWidth);
+            }
+        });
+    }
+
+    static void filterVertical(const float* const* rows, const float* weights, int taps, float* output, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < taps; k++)
+            {
+                sum += weights[k] * rows[k][i];
+            }
+            output[i] = sum;
+        }
+    }
+
+    static void filterHorizontal(const float* row, const Kernel& kernel, float* output, int targetWidth)
+    {
+        for (int x = 0; x < targetWidth; x++)
+        {
+            const float* first = row + (2 * x + kernel.first) * 4;
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < kernel.count; k++)
+                {
+                    sum += kernel.weights[k] * first[k * 4 + c];
+                }
+                output[x * 4 + c] = sum;
+            }
+        }
+    }
+
+    static void filterVerticalSimd(const float* const* rows, const float* weights, int taps, float* output, int count)
+    {
+        int i = 0;
+#if defined(MIP_GENERATOR_AVX2)
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < taps; k++)
+            {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+            }
+            _mm256_storeu_ps(output + i, sum);
+        }
+#endif
+#if defined(MIP_GENERATOR_SSE2)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < taps; k++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+            }
+            _mm_storeu_ps(output + i, sum);
+        }
+#endif
+        if (i < count)
+        {
+            const float* rest[MAX_TAPS];
+            for (int k = 0; k < taps; k++)
+            {
+                rest[k] = rows[k] + i;
+            }
+            filterVertical(rest, weights, taps, output + i, count - i);
+        }
+    }
+
+    static void filterHorizontalSimd(const float* row, const Kernel& kernel, float* output, int targetWidth)
+    {
+        int x = 0;
+#if defined(MIP_GENERATOR_AVX2)
+        // two output pixels per register, their taps are two source pixels apart
+        for (; x + 2 <= targetWidth; x += 2)
+        {
+            const float* first = row + (2 * x + kernel.first) * 4;
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < kernel.count; k++)
+            {
+                __m256 pixels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(first + k * 4)), _mm_loadu_ps(first + (k + 2) * 4), 1);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel.weights[k]), pixels));
+            }
+            _mm256_storeu_ps(output + x * 4, sum);
+        }
+#endif
+#if defined(MIP_GENERATOR_SSE2)
+        // one RGBA pixel per register
+        for (; x < targetWidth; x++)
+        {
+            const float* first = row + (2 * x + kernel.first) * 4;
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < kernel.count; k++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[k]), _mm_loadu_ps(first + k * 4)));
+            }
+            _mm_storeu_ps(output + x * 4, sum);
+        }
+#endif
+        if (x < targetWidth)
+        {
+            filterHorizontal(row + 2 * x * 4, kernel, output + x * 4, targetWidth - x);
+        }
+    }
+
+    /*
+    * @brief	premultiplied linear floats back to straight RGBA8
+    */
+    static void encodeRow(const float* pixels, unsigned char* output, int width, float alphaScale, bool srgb, const Tables& tables)
+    {
+        for (int x = 0; x < width * 4; x += 4)
+        {
+            float alpha = std::min(std::max(pixels[x + 3], 0.0f), 1.0f);
+            float inverse = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+            for (int c = 0; c < 3; c++)
+            {
+                float value = std::min(std::max(pixels[x + c] * inverse, 0.0f), 1.0f);
+                output[x + c] = srgb ? tables.toSrgb[static_cast<int>(value * ENCODE_TABLE_SIZE + 0.5f)] : static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+            output[x + 3] = static_cast<unsigned char>(std::min(alpha * alphaScale, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    static float computeCoverage(const unsigned char* rgba, size_t pixels, float cutoff)
+    {
+        size_t covered = 0;
+        for (size_t i = 0; i < pixels; i++)
+        {
+            covered += rgba[i * 4 + 3] > cutoff * 255.0f ? 1 : 0;
+        }
+        return static_cast<float>(covered) / pixels;
+    }
+
+    /*
+    * @brief	binary search for the alpha scale closest to 1 with which the level covers the same share of pixels as level 0
+    */
+    static float findAlphaScale(const std::vector<float>& pixels, float cutoff, float coverage)
+    {
+        size_t count = pixels.size() / 4;
+        auto coverageAt = [&](float scale)
+        {
+            size_t covered = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                covered += pixels[i * 4 + 3] * scale > cutoff ? 1 : 0;
+            }
+            return static_cast<float>(covered) / count;
+        };
+        float current = coverageAt(1.0f);
+        if (current == coverage)
+        {
+            return 1.0f;
+        }
+        // too few pixels pass: the smallest scale above 1 that reaches the coverage, too many: the largest scale below 1
+        bool increase = current < coverage;
+        float low = increase ? 1.0f : 0.0f, high = increase ? 4.0f : 1.0f;
+        for (int iteration = 0; iteration < 12; iteration++)
+        {
+            float scale = 0.5f * (low + high);
+            float reached = coverageAt(scale);
+            if (increase ? reached < coverage : reached <= coverage)
+            {
+                low = scale;
+            }
+            else
+            {
+                high = scale;
+            }
+        }
+        return increase ? high : low;
+    }
+};
@@ -0,0 +1,559 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define OCCLUSION_CULLER_AVX2
+#include <immintrin.h>
+#endif
+
+/// counters of the current frame, reset by OcclusionCuller::clear()
+struct OcclusionStats
+{
+    size_t occluders = 0;
+    size_t triangles = 0; // occluder triangles that reached the rasterizer (front facing, in front of the camera)
+    size_t tested = 0;
+    size_t occluded = 0;
+};
+
+/// <summary>
+///
+/// Low resolution software depth rasterizer for occlusion culling in the style of Masked Occlusion Culling: the
+/// occluders are rasterized on the CPU, the bounds of the other objects are tested against the result before they
+/// are submitted.
+/// <para>The depth buffer is split into tiles of 32x8 pixels. Instead of a depth per pixel a tile keeps a coverage
+/// bit per pixel and two depths: zMax0 bounds the whole tile, zMax1 the pixels covered by the working layer. A full
+/// working layer replaces zMax0, so the buffer is hierarchical by construction and the tests read one value per tile.
+/// The coverage of a triangle is computed for the 8 rows of a tile at once (AVX2, SSE2 or the scalar reference),
+/// every row is a 32 bit mask built from the edge intercepts.</para>
+/// <para>The occluders are rasterized inner conservative, a pixel counts only if it's completely covered, so nothing
+/// visible is ever culled. Triangles are binned by tile rows and the rows are rasterized in parallel.</para>
+/// <para>Usage per frame: clear() -> addOccluder()/addBoxOccluder() -> rasterize() -> cull()/testBox()</para>
+///
+/// </summary>
+class OcclusionCuller
+{
+public:
+    static const unsigned int TILE_WIDTH = 32; // one bit per pixel in a row mask
+    static const unsigned int TILE_HEIGHT = 8;
+
+    /*
+    * @brief	the size is rounded up to whole tiles, the aspect ratio should match the viewport
+    */
+    OcclusionCuller(unsigned int width = 256, unsigned int height = 192)
+        : tilesX((std::max(width, 1U) + TILE_WIDTH - 1) / TILE_WIDTH), tilesY((std::max(height, 1U) + TILE_HEIGHT - 1) / TILE_HEIGHT),
+        width(tilesX * TILE_WIDTH), height(tilesY * TILE_HEIGHT)
+    {
+        masks.resize(static_cast<size_t>(tilesX) * tilesY * TILE_HEIGHT);
+        zMax0.resize(static_cast<size_t>(tilesX) * tilesY);
+        zMax1.resize(static_cast<size_t>(tilesX) * tilesY);
+        bins.resize(tilesY);
+        clear();
+    }
+
+    /*
+    * @brief	start a frame: empty depth buffer, no occluders
+    */
+    void clear()
+    {
+        std::fill(masks.begin(), masks.end(), 0U);
+        std::fill(zMax0.begin(), zMax0.end(), 1.0f);
+        std::fill(zMax1.begin(), zMax1.end(), 0.0f);
+        triangles.clear();
+        for (std::vector<unsigned int>& bin : bins)
+        {
+            bin.clear();
+        }
+        stats = OcclusionStats();
+    }
+
+    /*
+    * @brief	queue the triangles of an occluder for rasterize(), counter clockwise triangles are front facing.
+    *			The occluder has to lie inside the object it belongs to
+    */
+    void addOccluder(const glm::mat4& modelViewProjection, const glm::vec3* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+    {
+        clipVertices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            clipVertices[i] = modelViewProjection * glm::vec4(vertices[i], 1.0f);
+        }
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            setupTriangle(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]);
+        }
+        stats.occluders++;
+    }
+
+    /*
+    * @brief	queue the box [minimum, maximum] in model space as occluder
+    */
+    void addBoxOccluder(const glm::mat4& modelViewProjection, const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        // corner c has bit 0 = x, bit 1 = y, bit 2 = z at the maximum
+        static const unsigned int BOX_INDICES[36] = {
+            0, 2, 3, 0, 3, 1, // -z
+            4, 5, 7, 4, 7, 6, // +z
+            0, 4, 6, 0, 6, 2, // -x
+            1, 3, 7, 1, 7, 5, // +x
+            0, 1, 5, 0, 5, 4, // -y
+            2, 6, 7, 2, 7, 3  // +y
+        };
+        glm::vec3 corners[8];
+        for (unsigned int c = 0; c < 8; c++)
+        {
+            corners[c] = glm::vec3(c & 1 ? maximum.x : minimum.x, c & 2 ? maximum.y : minimum.y, c & 4 ? maximum.z : minimum.z);
+        }
+        addOccluder(modelViewProjection, corners, 8, BOX_INDICES, 36);
+    }
+
+    /*
+    * @brief	rasterize the queued occluders, one task per row of tiles
+    *
+    * @param	simd	false: scalar reference implementation
+    */
+    void rasterize(ThreadPool* pool = NULL, bool simd = true)
+    {
+        if (pool != NULL)
+        {
+            pool->parallelFor(0, tilesY, [&](size_t row) { rasterizeRow(static_cast<unsigned int>(row), simd); }, 1);
+            return;
+        }
+        for (unsigned int row = 0; row < tilesY; row++)
+        {
+            rasterizeRow(row, simd);
+        }
+    }
+
+    /*
+    * @brief	test the world space box against the rasterized occluders
+    *
+    * @return	returns false if the box is hidden for sure
+    */
+    bool testBox(const glm::mat4& viewProjection, const glm::vec3& minimum, const glm::vec3& maximum) const
+    {
+        glm::vec2 screenMinimum(std::numeric_limits<float>::max()), screenMaximum(-std::numeric_limits<float>::max());
+        float depth = std::numeric_limits<float>::max();
+        // the corners are sums of one column term per axis
+        glm::vec4 xTerms[2] = { viewProjection[0] * minimum.x, viewProjection[0] * maximum.x };
+        glm::vec4 yTerms[2] = { viewProjection[1] * minimum.y + viewProjection[3], viewProjection[1] * maximum.y + viewProjection[3] };
+        glm::vec4 zTerms[2] = { viewProjection[2] * minimum.z, viewProjection[2] * maximum.z };
+        for (unsigned int c = 0; c < 8; c++)
+        {
+            glm::vec4 clip = xTerms[c & 1] + yTerms[(c >> 1) & 1] + zTerms[c >> 2];
+            if (clip.w <= NEAR_W)
+            {
+                return true; // reaches behind the camera
+            }
+            glm::vec3 screen = toScreen(clip);
+            screenMinimum = glm::min(screenMinimum, glm::vec2(screen));
+            screenMaximum = glm::max(screenMaximum, glm::vec2(screen));
+            depth = std::min(depth, screen.z);
+        }
+        // every pixel the box touches
+        int x0 = std::max(static_cast<int>(std::floor(screenMinimum.x)), 0);
+        int y0 = std::max(static_cast<int>(std::floor(screenMinimum.y)), 0);
+        int x1 = std::min(static_cast<int>(std::ceil(screenMaximum.x)) - 1, static_cast<int>(width) - 1);
+        int y1 = std::min(static_cast<int>(std::ceil(screenMaximum.y)) - 1, static_cast<int>(height) - 1);
+        if (x0 > x1 || y0 > y1)
+        {
+            return true;
+        }
+        for (int tileY = y0 / static_cast<int>(TILE_HEIGHT); tileY <= y1 / static_cast<int>(TILE_HEIGHT); tileY++)
+        {
+            for (int tileX = x0 / static_cast<int>(TILE_WIDTH); tileX <= x1 / static_cast<int>(TILE_WIDTH); tileX++)
+            {
+                size_t tile = static_cast<size_t>(tileY) * tilesX + tileX;
+                if (depth >= zMax0[tile])
+                {
+                    continue;
+                }
+                // the working layer hides the box if it covers every pixel of the box inside the tile
+                if (depth < zMax1[tile])
+                {
+                    return true;
+                }
+                uint32_t columns = getSpanMask(x0 - tileX * static_cast<int>(TILE_WIDTH), x1 - tileX * static_cast<int>(TILE_WIDTH));
+                for (int row = std::max(y0 - tileY * static_cast<int>(TILE_HEIGHT), 0); row <= std::min(y1 - tileY * static_cast<int>(TILE_HEIGHT), static_cast<int>(TILE_HEIGHT) - 1); row++)
+                {
+                    if ((masks[tile * TILE_HEIGHT + row] & columns) != columns)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /*
+    * @brief	remove the hidden objects from the first count entries of visible, the order is kept
+    *
+    * @return	returns the number of objects that stay visible
+    */
+    size_t cull(const glm::mat4& viewProjection, const BoundingBoxes& boxes, std::vector<unsigned int>& visible, size_t count, ThreadPool* pool = NULL)
+    {
+        hidden.resize(count);
+        auto test = [&](size_t i)
+        {
+            unsigned int object = visible[i];
+            glm::vec3 center(boxes.centerX[object], boxes.centerY[object], boxes.centerZ[object]);
+            glm::vec3 extent(boxes.extentX[object], boxes.extentY[object], boxes.extentZ[object]);
+            hidden[i] = testBox(viewProjection, center - extent, center + extent) ? 0 : 1;
+        };
+        if (pool != NULL && count >= PARALLEL_TESTS)
+        {
+            pool->parallelFor(0, count, test, PARALLEL_TESTS / 4);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                test(i);
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            visible[kept] = visible[i];
+            kept += 1 - hidden[i];
+        }
+        stats.tested += count;
+        stats.occluded += count - kept;
+        return kept;
+    }
+
+    const OcclusionStats& getStats() const
+    {
+        return stats;
+    }
+
+    unsigned int getWidth() const
+    {
+        return width;
+    }
+
+    unsigned int getHeight() const
+    {
+        return height;
+    }
+
+    /*
+    * @brief	depth bound of every pixel (zMax1 where the working layer covers it, else zMax0), row 0 is the bottom.
+    *			For debugging and tests
+    */
+    void getDepth(std::vector<float>& depth) const
+    {
+        depth.resize(static_cast<size_t>(width) * height);
+        for (unsigned int y = 0; y < height; y++)
+        {
+            for (unsigned int x = 0; x < width; x++)
+            {
+                size_t tile = static_cast<size_t>(y / TILE_HEIGHT) * tilesX + x / TILE_WIDTH;
+                bool covered = (masks[tile * TILE_HEIGHT + y % TILE_HEIGHT] >> (x % TILE_WIDTH)) & 1;
+                depth[static_cast<size_t>(y) * width + x] = covered ? zMax1[tile] : zMax0[tile];
+            }
+        }
+    }
+
+private:
+    static constexpr float NEAR_W = 1e-4f; // triangles with a vertex closer than this to the camera plane are skipped
+    static const size_t PARALLEL_TESTS = 4096; // object tests are split over the pool above this count
+
+    /// screen space setup of an occluder triangle
+    struct Triangle
+    {
+        // row coverage of edge e: pixel x is covered if side * (x - (slope * (y + 0.5) + offset)) >= 0
+        float slope[3];
+        float offset[3];
+        int side[3]; // 1: left edge, covers x >= intercept, -1: right edge, covers x <= intercept
+        float depthX, depthY, depthZ; // depth plane: depth = depthX * x + depthY * y + depthZ
+        float depthMinimum, depthMaximum;
+        int x0, y0, x1, y1; // pixels that may be covered, inclusive
+    };
+
+    unsigned int tilesX, tilesY;
+    unsigned int width, height;
+    std::vector<uint32_t> masks; // TILE_HEIGHT row masks per tile, bit x = column x
+    std::vector<float> zMax0; // depth bound of the whole tile
+    std::vector<float> zMax1; // depth bound of the pixels in the working layer (masks)
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<unsigned int>> bins; // triangles per row of tiles
+    std::vector<glm::vec4> clipVertices;
+    std::vector<unsigned char> hidden;
+    OcclusionStats stats;
+
+    /*
+    * @brief	window coordinates in pixels and depth in [0, 1], like the OpenGL viewport transform
+    */
+    glm::vec3 toScreen(const glm::vec4& clip) const
+    {
+        float inverseW = 1.0f / clip.w;
+        return glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height, clip.z * inverseW * 0.5f + 0.5f);
+    }
+
+    /*
+    * @brief	bits first to last of a row mask, clamped to the tile
+    */
+    static uint32_t getSpanMask(int first, int last)
+    {
+        first = std::max(first, 0);
+        last = std::min(last, static_cast<int>(TILE_WIDTH) - 1);
+        if (first > last)
+        {
+            return 0;
+        }
+        return static_cast<uint32_t>((0xFFFFFFFFULL << first) & ((2ULL << last) - 1));
+    }
+
+    void setupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+    {
+        // clipping at the near plane is skipped, leaving out an occluder triangle is always safe
+        if (clip0.w <= NEAR_W || clip1.w <= NEAR_W || clip2.w <= NEAR_W)
+        {
+            return;
+        }
+        glm::vec3 v[3] = { toScreen(clip0), toScreen(clip1), toScreen(clip2) };
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (!(area > 0.0f))
+        {
+            return; // back facing or degenerate
+        }
+
+        // only pixels completely inside the triangle are covered, so the bounding box shrinks to whole pixels
+        Triangle triangle;
+        triangle.x0 = std::max(static_cast<int>(std::ceil(std::min(std::min(v[0].x, v[1].x), v[2].x))), 0);
+        triangle.y0 = std::max(static_cast<int>(std::ceil(std::min(std::min(v[0].y, v[1].y), v[2].y))), 0);
+        triangle.x1 = std::min(static_cast<int>(std::floor(std::max(std::max(v[0].x, v[1].x), v[2].x))) - 1, static_cast<int>(width) - 1);
+        triangle.y1 = std::min(static_cast<int>(std::floor(std::max(std::max(v[0].y, v[1].y), v[2].y))) - 1, static_cast<int>(height) - 1);
+        if (triangle.x0 > triangle.x1 || triangle.y0 > triangle.y1)
+        {
+            return;
+        }
+
+        for (int e = 0; e < 3; e++)
+        {
+            const glm::vec3& from = v[e];
+            const glm::vec3& to = v[(e + 1) % 3];
+            // edge function a * x + b * y + c >= 0 inside, shifted by half a pixel in both axes for full coverage
+            float a = from.y - to.y;
+            float b = to.x - from.x;
+            float c = -(a * from.x + b * from.y) - 0.5f * (std::fabs(a) + std::fabs(b));
+            if (a != 0.0f)
+            {
+                // solved for the column of the pixel center x + 0.5
+                triangle.slope[e] = -b / a;
+                triangle.offset[e] = -c / a - 0.5f;
+                triangle.side[e] = a > 0.0f ? 1 : -1;
+            }
+            else
+            {
+                // horizontal edges only limit the rows
+                float row = -c / b - 0.5f;
+                if (b > 0.0f)
+                {
+                    triangle.y0 = std::max(triangle.y0, static_cast<int>(std::ceil(row)));
+                }
+                else
+                {
+                    triangle.y1 = std::min(triangle.y1, static_cast<int>(std::floor(row)));
+                }
+                triangle.slope[e] = 0.0f;
+                triangle.offset[e] = -1.0f;
+                triangle.side[e] = 1;
+            }
+        }
+        if (triangle.y0 > triangle.y1)
+        {
+            return;
+        }
+
+        triangle.depthX = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+        triangle.depthY = ((v[1].x - v[0].x) * (v[2].z - v[0].z) - (v[2].x - v[0].x) * (v[1].z - v[0].z)) / area;
+        triangle.depthZ = v[0].z - triangle.depthX * v[0].x - triangle.depthY * v[0].y;
+        triangle.depthMinimum = std::min(std::min(v[0].z, v[1].z), v[2].z);
+        triangle.depthMaximum = std::max(std::max(v[0].z, v[1].z), v[2].z);
+
+        unsigned int index = static_cast<unsigned int>(triangles.size());
+        triangles.push_back(triangle);
+        for (int row = triangle.y0 / static_cast<int>(TILE_HEIGHT); row <= triangle.y1 / static_cast<int>(TILE_HEIGHT); row++)
+        {
+            bins[row].push_back(index);
+        }
+        stats.triangles++;
+    }
+
+    void rasterizeRow(unsigned int tileY, bool simd)
+    {
+        for (unsigned int index : bins[tileY])
+        {
+            const Triangle& triangle = triangles[index];
+            for (int tileX = triangle.x0 / static_cast<int>(TILE_WIDTH); tileX <= triangle.x1 / static_cast<int>(TILE_WIDTH); tileX++)
+            {
+                uint32_t coverage[TILE_HEIGHT];
+                if (!computeCoverage(triangle, tileX, tileY, coverage, simd))
+                {
+                    continue;
+                }
+                // the depth plane is largest at a corner of the part of the tile the triangle can cover
+                float left = static_cast<float>(std::max(triangle.x0, tileX * static_cast<int>(TILE_WIDTH)));
+                float right = static_cast<float>(std::min(triangle.x1 + 1, (tileX + 1) * static_cast<int>(TILE_WIDTH)));
+                float bottom = static_cast<float>(std::max(triangle.y0, static_cast<int>(tileY * TILE_HEIGHT)));
+                float top = static_cast<float>(std::min(triangle.y1 + 1, static_cast<int>((tileY + 1) * TILE_HEIGHT)));
+                float depth = std::max(std::max(triangle.depthX * left, triangle.depthX * right) + std::max(triangle.depthY * bottom, triangle.depthY * top) + triangle.depthZ, triangle.depthMinimum);
+                updateTile(static_cast<size_t>(tileY) * tilesX + tileX, coverage, std::min(depth, triangle.depthMaximum));
+            }
+        }
+    }
+
+    /*
+    * @brief	coverage masks of the TILE_HEIGHT rows of a tile
+    *
+    * @return	returns false if no pixel is covered
+    */
+    static bool computeCoverage(const Triangle& triangle, int tileX, unsigned int tileY, uint32_t* coverage, bool simd)
+    {
+        float column = static_cast<float>(tileX * static_cast<int>(TILE_WIDTH));
+        int firstRow = static_cast<int>(tileY * TILE_HEIGHT);
+#if defined(OCCLUSION_CULLER_AVX2)
+        if (simd)
+        {
+            __m256i rows = _mm256_add_epi32(_mm256_set1_epi32(firstRow), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            __m256 centers = _mm256_add_ps(_mm256_cvtepi32_ps(rows), _mm256_set1_ps(0.5f));
+            __m256i mask = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(triangle.y0), rows), _mm256_cmpgt_epi32(rows, _mm256_set1_epi32(triangle.y1))),
+                _mm256_set1_epi32(-1));
+            for (int e = 0; e < 3; e++)
+            {
+                __m256 intercept = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.slope[e]), centers), _mm256_set1_ps(triangle.offset[e])), _mm256_set1_ps(column));
+                intercept = _mm256_min_ps(_mm256_max_ps(intercept, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(static_cast<float>(TILE_WIDTH + 1)));
+                if (triangle.side[e] > 0)
+                {
+                    // shifts by 32 or more give 0
+                    __m256i first = _mm256_max_epi32(_mm256_cvtps_epi32(_mm256_ceil_ps(intercept)), _mm256_setzero_si256());
+                    mask = _mm256_and_si256(mask, _mm256_sllv_epi32(_mm256_set1_epi32(-1), first));
+                }
+                else
+                {
+                    __m256i count = _mm256_add_epi32(_mm256_cvtps_epi32(_mm256_floor_ps(intercept)), _mm256_set1_epi32(1));
+                    __m256i shift = _mm256_max_epi32(_mm256_sub_epi32(_mm256_set1_epi32(TILE_WIDTH), count), _mm256_setzero_si256());
+                    mask = _mm256_and_si256(mask, _mm256_srlv_epi32(_mm256_set1_epi32(-1), shift));
+                }
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(coverage), mask);
+            return !_mm256_testz_si256(mask, mask);
+        }
+#elif defined(OCCLUSION_CULLER_SSE2)
+        if (simd)
+        {
+            // SSE2 has no variable shifts, the intercepts are computed 4 rows at a time and shifted per row
+            uint32_t any = 0;
+            for (unsigned int half = 0; half < TILE_HEIGHT; half += 4)
+            {
+                __m128 centers = _mm_add_ps(_mm_set1_ps(firstRow + half + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+                alignas(16) int bounds[3][4];
+                for (int e = 0; e < 3; e++)
+                {
+                    __m128 intercept = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.slope[e]), centers), _mm_set1_ps(triangle.offset[e])), _mm_set1_ps(column));
+                    intercept = _mm_min_ps(_mm_max_ps(intercept, _mm_set1_ps(-1.0f)), _mm_set1_ps(static_cast<float>(TILE_WIDTH + 1)));
+                    // floor and ceil from the truncation, the values are >= -1
+                    __m128i truncated = _mm_cvttps_epi32(intercept);
+                    __m128 back = _mm_cvtepi32_ps(truncated);
+                    __m128i rounded = triangle.side[e] > 0 ? _mm_sub_epi32(truncated, _mm_castps_si128(_mm_cmplt_ps(back, intercept)))
+                        : _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmpgt_ps(back, intercept)));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(bounds[e]), rounded);
+                }
+                for (unsigned int r = 0; r < 4; r++)
+                {
+                    coverage[half + r] = getRowMask(triangle, firstRow + static_cast<int>(half + r), bounds[0][r], bounds[1][r], bounds[2][r]);
+                    any |= coverage[half + r];
+                }
+            }
+            return any != 0;
+        }
+#endif
+        uint32_t any = 0;
+        for (unsigned int r = 0; r < TILE_HEIGHT; r++)
+        {
+            float center = firstRow + r + 0.5f;
+            int rounded[3];
+            for (int e = 0; e < 3; e++)
+            {
+                float intercept = triangle.slope[e] * center + triangle.offset[e] - column;
+                intercept = std::min(std::max(intercept, -1.0f), static_cast<float>(TILE_WIDTH + 1));
+                rounded[e] = static_cast<int>(triangle.side[e] > 0 ? std::ceil(intercept) : std::floor(intercept));
+            }
+            coverage[r] = getRowMask(triangle, firstRow + static_cast<int>(r), rounded[0], rounded[1], rounded[2]);
+            any |= coverage[r];
+        }
+        return any != 0;
+    }
+
+    /*
+    * @param	bounds	first covered column of left edges, last covered column of right edges
+    */
+    static uint32_t getRowMask(const Triangle& triangle, int row, int bound0, int bound1, int bound2)
+    {
+        if (row < triangle.y0 || row > triangle.y1)
+        {
+            return 0;
+        }
+        const int bounds[3] = { bound0, bound1, bound2 };
+        int first = 0, last = TILE_WIDTH - 1;
+        for (int e = 0; e < 3; e++)
+        {
+            if (triangle.side[e] > 0)
+            {
+                first = std::max(first, bounds[e]);
+            }
+            else
+            {
+                last = std::min(last, bounds[e]);
+            }
+        }
+        return getSpanMask(first, last);
+    }
+
+    /*
+    * @brief	merge a triangle into a tile with the heuristic of Masked Occlusion Culling
+    */
+    void updateTile(size_t tile, const uint32_t* coverage, float depth)
+    {
+        uint32_t* mask = &masks[tile * TILE_HEIGHT];
+        float& reference = zMax0[tile];
+        float& working = zMax1[tile];
+        // behind the reference layer the triangle still hides everything behind zMax0
+        depth = std::min(depth, reference);
+        // a triangle much closer than the working layer starts a new one
+        if (working - depth > reference - working)
+        {
+            working = 0.0f;
+            std::fill(mask, mask + TILE_HEIGHT, 0U);
+        }
+        working = std::max(working, depth);
+        uint32_t full = ~0U;
+        for (unsigned int r = 0; r < TILE_HEIGHT; r++)
+        {
+            mask[r] |= coverage[r];
+            full &= mask[r];
+        }
+        if (full == ~0U)
+        {
+            reference = working;
+            working = 0.0f;
+            std::fill(mask, mask + TILE_HEIGHT, 0U);
+        }
+    }
+};
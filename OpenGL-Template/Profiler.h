@@ -0,0 +1,473 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+/// rolling statistics of one scope in milliseconds, per frame the time of all calls of the scope is summed up
+struct ProfileStats
+{
+    double min = 0.0;
+    double avg = 0.0;
+    double p99 = 0.0;
+    unsigned int samples = 0;
+};
+
+/// <summary>
+///
+/// Frame profiler for named CPU and GPU scopes.
+/// <para>CPU scopes are measured with the steady clock. GPU scopes write a GL_TIMESTAMP query (glQueryCounter) at their
+/// start and end, so they can be nested. The queries of a frame are read back framesInFlight frames later and only if
+/// the GPU already finished them, the profiler never waits for the GPU. Results that are still not available are
+/// dropped and counted.</para>
+/// <para>Every scope keeps a rolling history of the last frames for min/avg/p99. With tracing enabled every scope is
+/// also recorded for writeChromeTrace, the file can be opened in chrome://tracing or https://ui.perfetto.dev.</para>
+/// <para>Usage per frame: beginFrame() -> CpuScope / GpuScope / ProfileScope -> endFrame(). Not thread safe, only
+/// profile the thread that owns the OpenGL context. Without a context (the software backend) construct it with
+/// gpuTimers = false, the GPU scopes are ignored then.</para>
+///
+/// </summary>
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /*
+    * @param	historySize	frames the rolling statistics are computed over
+    * @param	framesInFlight	frames between issuing and reading back the GPU queries
+    * @param	gpuTimers	false: only CPU scopes, no OpenGL calls at all
+    */
+    Profiler(unsigned int historySize = 240, unsigned int framesInFlight = 3, bool gpuTimers = true)
+        : historySize(std::max(1U, historySize)), gpuTimers(gpuTimers), frames(std::max(2U, framesInFlight))
+    {
+        cpuBase = Clock::now();
+        if (gpuTimers)
+        {
+            glGetInteger64v(GL_TIMESTAMP, &gpuBase);
+        }
+        frameScope = getScope("frame");
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /*
+    * @brief	record every scope for writeChromeTrace, at most MAX_TRACE_EVENTS are kept
+    */
+    void setTracing(bool enabled)
+    {
+        tracing = enabled;
+    }
+
+    /*
+    * @brief	read back the GPU queries of an old frame and start the frame scopes
+    */
+    void beginFrame()
+    {
+        FrameQueries& slot = frames[current];
+        if (slot.pending)
+        {
+            resolve(slot);
+        }
+        frameStart = Clock::now();
+        frameGpuSample = gpuTimers ? beginGpuScope(frameScope) : 0;
+    }
+
+    /*
+    * @brief	close the frame scopes and push the CPU times of this frame into the history
+    */
+    void endFrame()
+    {
+        FrameQueries& slot = frames[current];
+        if (gpuTimers)
+        {
+            endGpuScope(frameGpuSample);
+            slot.frameEnd = slot.samples[frameGpuSample].query + 1;
+            slot.pending = true;
+        }
+        addCpuTime(frameScope, frameStart, Clock::now());
+
+        for (Scope& scope : scopes)
+        {
+            if (scope.cpuTouched)
+            {
+                push(scope.cpuHistory, scope.cpuCount, scope.cpuFrameTime);
+                scope.cpuFrameTime = 0.0;
+                scope.cpuTouched = false;
+            }
+        }
+        current = (current + 1) % frames.size();
+        FrameCount++;
+    }
+
+    /*
+    * @return	returns the index of the scope, the scope is created on first use
+    */
+    unsigned int getScope(const char* name)
+    {
+        for (unsigned int i = 0; i < scopes.size(); i++)
+        {
+            // scope names are usually string literals, compare the pointer before the string
+            if (scopes[i].literal == name || scopes[i].name == name)
+            {
+                scopes[i].literal = name;
+                return i;
+            }
+        }
+        Scope scope;
+        scope.name = name;
+        scope.literal = name;
+        scope.cpuHistory.resize(historySize);
+        scope.gpuHistory.resize(historySize);
+        scopes.push_back(scope);
+        return static_cast<unsigned int>(scopes.size() - 1);
+    }
+
+    void addCpuTime(unsigned int scope, Clock::time_point start, Clock::time_point end)
+    {
+        double duration = std::chrono::duration<double, std::milli>(end - start).count();
+        scopes[scope].cpuFrameTime += duration;
+        scopes[scope].cpuTouched = true;
+        if (tracing)
+        {
+            addTraceEvent(scope, CPU_THREAD, std::chrono::duration<double, std::micro>(start - cpuBase).count(), 1000.0 * duration);
+        }
+    }
+
+    /*
+    * @brief	write the start timestamp of a GPU scope
+    *
+    * @return	returns the sample that has to be passed to endGpuScope
+    */
+    unsigned int beginGpuScope(unsigned int scope)
+    {
+        if (!gpuTimers)
+        {
+            return 0;
+        }
+        FrameQueries& slot = frames[current];
+        if (slot.queries.size() < slot.used + 2)
+        {
+            size_t oldSize = slot.queries.size();
+            slot.queries.resize(std::max<size_t>(16, oldSize * 2));
+            glGenQueries(static_cast<GLsizei>(slot.queries.size() - oldSize), &slot.queries[oldSize]);
+        }
+        GpuSample sample = { scope, slot.used };
+        glQueryCounter(slot.queries[slot.used], GL_TIMESTAMP);
+        slot.used += 2;
+        slot.samples.push_back(sample);
+        return static_cast<unsigned int>(slot.samples.size() - 1);
+    }
+
+    void endGpuScope(unsigned int sample)
+    {
+        if (!gpuTimers)
+        {
+            return;
+        }
+        FrameQueries& slot = frames[current];
+        glQueryCounter(slot.queries[slot.samples[sample].query + 1], GL_TIMESTAMP);
+    }
+
+    /*
+    * @return	returns the CPU statistics of the scope in milliseconds
+    */
+    ProfileStats getCpuStats(const char* name)
+    {
+        const Scope& scope = scopes[getScope(name)];
+        return computeStats(scope.cpuHistory, scope.cpuCount);
+    }
+
+    /*
+    * @return	returns the GPU statistics of the scope in milliseconds, lags framesInFlight frames behind
+    */
+    ProfileStats getGpuStats(const char* name)
+    {
+        const Scope& scope = scopes[getScope(name)];
+        return computeStats(scope.gpuHistory, scope.gpuCount);
+    }
+
+    /*
+    * @brief	print min/avg/p99 of all scopes
+    */
+    void printStats() const
+    {
+        std::cout << std::fixed << std::setprecision(3) << "Profile over the last " << std::min<unsigned long long>(FrameCount, historySize)
+            << " frames (ms, min / avg / p99):" << std::endl;
+        for (const Scope& scope : scopes)
+        {
+            ProfileStats cpu = computeStats(scope.cpuHistory, scope.cpuCount);
+            ProfileStats gpu = computeStats(scope.gpuHistory, scope.gpuCount);
+            std::cout << "  " << std::left << std::setw(16) << scope.name << std::right;
+            if (cpu.samples > 0)
+            {
+                std::cout << " CPU " << cpu.min << " / " << cpu.avg << " / " << cpu.p99;
+            }
+            if (gpu.samples > 0)
+            {
+                std::cout << " GPU " << gpu.min << " / " << gpu.avg << " / " << gpu.p99;
+            }
+            std::cout << std::endl;
+        }
+        if (DroppedFrames > 0)
+        {
+            std::cout << "  GPU results of " << DroppedFrames << " frames were not ready in time and dropped" << std::endl;
+        }
+    }
+
+    /*
+    * @brief	write all recorded scopes as Chrome trace event JSON, CPU and GPU scopes are shown as two threads
+    */
+    bool writeChromeTrace(const char* path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR couldn't write File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << CPU_THREAD << ",\"args\":{\"name\":\"CPU\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+        for (const TraceEvent& event : traceEvents)
+        {
+            file << ",\n{\"name\":\"" << scopes[event.scope].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        }
+        file << "\n]}\n";
+        if (TruncatedEvents > 0)
+        {
+            std::cout << "Trace is truncated, " << TruncatedEvents << " events were not recorded" << std::endl;
+        }
+        return true;
+    }
+
+    unsigned long long getFrameCount() const
+    {
+        return FrameCount;
+    }
+
+    /*
+    * @brief	number of frames whose GPU results were dropped because they were not available in time
+    */
+    unsigned long long getDroppedFrames() const
+    {
+        return DroppedFrames;
+    }
+
+    void remove()
+    {
+        for (FrameQueries& slot : frames)
+        {
+            if (!slot.queries.empty())
+            {
+                glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+            }
+            slot = FrameQueries();
+        }
+    }
+
+private:
+    static const unsigned int CPU_THREAD = 0;
+    static const unsigned int GPU_THREAD = 1;
+    static const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    struct Scope
+    {
+        std::string name;
+        const char* literal = NULL;
+        std::vector<float> cpuHistory; // ring buffer of the per frame times
+        std::vector<float> gpuHistory;
+        unsigned long long cpuCount = 0; // samples written so far
+        unsigned long long gpuCount = 0;
+        double cpuFrameTime = 0.0;
+        bool cpuTouched = false;
+    };
+
+    struct GpuSample
+    {
+        unsigned int scope;
+        unsigned int query; // start query, the end query follows it
+    };
+
+    struct FrameQueries
+    {
+        std::vector<unsigned int> queries;
+        std::vector<GpuSample> samples;
+        unsigned int used = 0;
+        unsigned int frameEnd = 0; // end query of the frame scope, issued after all other queries of the frame
+        bool pending = false;
+    };
+
+    struct TraceEvent
+    {
+        unsigned int scope;
+        unsigned int thread;
+        double start; // microseconds since the profiler was created
+        double duration;
+    };
+
+    unsigned int historySize;
+    bool gpuTimers;
+    std::vector<Scope> scopes;
+    std::vector<FrameQueries> frames;
+    size_t current = 0;
+    unsigned int frameScope = 0;
+    unsigned int frameGpuSample = 0;
+    Clock::time_point frameStart;
+
+    // the GPU clock is mapped onto the CPU clock with the timestamps taken at construction
+    Clock::time_point cpuBase;
+    GLint64 gpuBase = 0;
+
+    bool tracing = false;
+    std::vector<TraceEvent> traceEvents;
+
+    unsigned long long FrameCount = 0;
+    unsigned long long DroppedFrames = 0;
+    unsigned long long TruncatedEvents = 0;
+
+    void resolve(FrameQueries& slot)
+    {
+        // once the last query of the frame is available all earlier ones are too
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(slot.queries[slot.frameEnd], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            DroppedFrames++;
+        }
+        else
+        {
+            std::vector<double> frameTimes(scopes.size(), -1.0);
+            for (const GpuSample& sample : slot.samples)
+            {
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(slot.queries[sample.query], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(slot.queries[sample.query + 1], GL_QUERY_RESULT, &end);
+                double duration = end > start ? (end - start) * 1e-6 : 0.0;
+                frameTimes[sample.scope] = std::max(frameTimes[sample.scope], 0.0) + duration;
+                if (tracing)
+                {
+                    addTraceEvent(sample.scope, GPU_THREAD, (static_cast<GLint64>(start) - gpuBase) * 1e-3, 1000.0 * duration);
+                }
+            }
+            for (size_t i = 0; i < scopes.size(); i++)
+            {
+                if (frameTimes[i] >= 0.0)
+                {
+                    push(scopes[i].gpuHistory, scopes[i].gpuCount, frameTimes[i]);
+                }
+            }
+        }
+        slot.samples.clear();
+        slot.used = 0;
+        slot.pending = false;
+    }
+
+    void push(std::vector<float>& history, unsigned long long& count, double value)
+    {
+        history[count % history.size()] = static_cast<float>(value);
+        count++;
+    }
+
+    void addTraceEvent(unsigned int scope, unsigned int thread, double start, double duration)
+    {
+        if (traceEvents.size() >= MAX_TRACE_EVENTS)
+        {
+            TruncatedEvents++;
+            return;
+        }
+        TraceEvent event = { scope, thread, start, duration };
+        traceEvents.push_back(event);
+    }
+
+    static ProfileStats computeStats(const std::vector<float>& history, unsigned long long count)
+    {
+        ProfileStats stats;
+        size_t samples = static_cast<size_t>(std::min<unsigned long long>(count, history.size()));
+        if (samples == 0)
+        {
+            return stats;
+        }
+        std::vector<float> sorted(history.begin(), history.begin() + samples);
+        double sum = 0.0;
+        for (float value : sorted)
+        {
+            sum += value;
+        }
+        size_t p99 = (samples * 99 + 99) / 100 - 1;
+        std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+        stats.p99 = sorted[p99];
+        stats.min = *std::min_element(sorted.begin(), sorted.end());
+        stats.avg = sum / samples;
+        stats.samples = static_cast<unsigned int>(samples);
+        return stats;
+    }
+};
+
+/// measures the CPU time until the end of the C++ scope
+class CpuScope
+{
+public:
+    CpuScope(Profiler& profiler, const char* name)
+        : profiler(profiler), scope(profiler.getScope(name)), start(Profiler::Clock::now())
+    {
+    }
+
+    ~CpuScope()
+    {
+        profiler.addCpuTime(scope, start, Profiler::Clock::now());
+    }
+
+    CpuScope(const CpuScope&) = delete;
+    CpuScope& operator=(const CpuScope&) = delete;
+
+private:
+    Profiler& profiler;
+    unsigned int scope;
+    Profiler::Clock::time_point start;
+};
+
+/// measures the GPU time of the commands issued until the end of the C++ scope
+class GpuScope
+{
+public:
+    GpuScope(Profiler& profiler, const char* name)
+        : profiler(profiler), sample(profiler.beginGpuScope(profiler.getScope(name)))
+    {
+    }
+
+    ~GpuScope()
+    {
+        profiler.endGpuScope(sample);
+    }
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+    Profiler& profiler;
+    unsigned int sample;
+};
+
+/// measures the CPU and the GPU time of the C++ scope under the same name
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const char* name)
+        : cpu(profiler, name), gpu(profiler, name)
+    {
+    }
+
+private:
+    CpuScope cpu;
+    GpuScope gpu;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+struct RingAllocation
+{
+    void* data = NULL; // CPU pointer into the persistently mapped buffer, NULL if the frame section is full
+    GLintptr offset = 0; // offset inside the buffer object, used to bind the allocation
+    GLsizeiptr size = 0;
+};
+
+/// <summary>
+///
+/// Persistently mapped buffer for data that changes every frame.
+/// <para>The buffer is split into one section per frame in flight (triple buffered by default). Data is written
+/// straight into GPU visible memory and bound by offset, so there are no driver copies and no per call overhead.
+/// A fence guards every section, before a section is reused the CPU waits until the GPU finished reading it.</para>
+/// <para>Usage per frame: beginFrame() -> allocate() -> bind ID at the allocation offset -> draw -> endFrame()</para>
+///
+/// </summary>
+class RingBuffer
+{
+public:
+    static const GLsizeiptr MAX_ALIGNMENT = 256; // largest GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT the spec allows
+
+    unsigned int ID = 0;
+
+    /*
+    * @param	frameSize	bytes available per frame, rounded up to a multiple of MAX_ALIGNMENT so every section starts
+    *						aligned, at least one alignment since glBufferStorage rejects empty buffers
+    * @param	frameCount	frames in flight, 3 = triple buffering
+    */
+    RingBuffer(GLsizeiptr frameSize, unsigned int frameCount = 3)
+        : frameSize(std::max<GLsizeiptr>((frameSize + MAX_ALIGNMENT - 1) / MAX_ALIGNMENT * MAX_ALIGNMENT, MAX_ALIGNMENT)), fences(frameCount, (GLsync)0)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = this->frameSize * frameCount;
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (mapped == NULL)
+        {
+            std::cout << "ERROR RingBuffer: couldn't map " << size << " bytes persistently" << std::endl;
+        }
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /*
+    * @brief	start writing the next section, waits if the GPU still reads from it
+    */
+    void beginFrame()
+    {
+        GLsync& fence = fences[section];
+        if (fence != 0)
+        {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                // the CPU is frames ahead of the GPU
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                do
+                {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+                } while (result == GL_TIMEOUT_EXPIRED);
+                StallCount++;
+                StallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            glDeleteSync(fence);
+            fence = 0;
+        }
+        head = 0;
+    }
+
+    /*
+    * @brief	reserve bytes in the current section
+    *
+    * @param	alignment	alignment of the offset in the buffer object (not only inside the section), e.g.
+    *						GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform buffers
+    *
+    * @return	returns an allocation with data == NULL if the section has no space left
+    */
+    RingAllocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        RingAllocation allocation;
+        GLsizeiptr sectionStart = static_cast<GLsizeiptr>(section) * frameSize;
+        GLsizeiptr start = (sectionStart + head + alignment - 1) / alignment * alignment - sectionStart;
+        if (mapped == NULL || start + size > frameSize)
+        {
+            return allocation;
+        }
+        head = start + size;
+        allocation.offset = static_cast<GLintptr>(sectionStart + start);
+        allocation.data = mapped + allocation.offset;
+        allocation.size = size;
+        return allocation;
+    }
+
+    /*
+    * @brief	fence the commands that read the current section and move on to the next one
+    */
+    void endFrame()
+    {
+        fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        section = (section + 1) % fences.size();
+    }
+
+    GLsizeiptr getFrameSize() const
+    {
+        return frameSize;
+    }
+
+    /*
+    * @brief	number of frames the CPU had to wait for the GPU
+    */
+    unsigned long long getStallCount() const
+    {
+        return StallCount;
+    }
+
+    /*
+    * @brief	seconds the CPU waited for the GPU in total
+    */
+    double getStallTime() const
+    {
+        return StallTime;
+    }
+
+    void remove()
+    {
+        for (GLsync& fence : fences)
+        {
+            if (fence != 0)
+            {
+                glDeleteSync(fence);
+                fence = 0;
+            }
+        }
+        if (ID != 0)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &ID);
+            ID = 0;
+            mapped = NULL;
+        }
+    }
+
+private:
+    GLsizeiptr frameSize;
+    std::vector<GLsync> fences;
+    unsigned char* mapped = NULL;
+    size_t section = 0;
+    GLsizeiptr head = 0;
+
+    unsigned long long StallCount = 0;
+    double StallTime = 0.0;
+};
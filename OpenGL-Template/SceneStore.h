@@ -0,0 +1,507 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "ThreadPool.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_STORE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define SCENE_STORE_AVX
+#include <immintrin.h>
+#endif
+
+/// <summary>
+///
+/// Transforms of the scene objects in structure of arrays layout: position, rotation (unit quaternion) and scale are
+/// stored component by component, the local matrices translate * rotate * scale are derived from them.
+/// <para>Objects are grouped in blocks of BLOCK_SIZE, every setter flags the block of its object. update() only
+/// recomputes the flagged blocks, BLOCK_SIZE objects at a time with AVX or 4 at a time with SSE2 from contiguous
+/// loads (or the scalar reference), so the cost per frame follows the number of changed objects instead of the scene size. The blocks
+/// are spread over the ThreadPool if one is given.</para>
+/// <para>An object can have a parent, its world matrix is then world(parent) * local. The objects are stored in
+/// breadth first order, parents before their children, so update() propagates the world matrices in one linear
+/// pass per level of the hierarchy. The objects of a level are independent and processed in parallel, only the
+/// ones whose local matrix or parent changed are recomputed. Objects without a parent use their local matrix.</para>
+/// <para>The setters are not thread safe. The world matrices are valid after update(), write() gathers them
+/// contiguously into an upload buffer.</para>
+///
+/// </summary>
+class SceneStore
+{
+public:
+    static const size_t BLOCK_SIZE = 8;
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    /*
+    * @brief	breadth first order of a hierarchy given in any order: the roots in their order, then their children
+    *			level by level. Add the objects in this order, with the parents mapped to their new indices
+    *
+    * @param	parents		parent of every object, negative for roots
+    * @param	order		receives the objects in breadth first order
+    */
+    static void sortBreadthFirst(const std::vector<int>& parents, std::vector<unsigned int>& order)
+    {
+        size_t objects = parents.size();
+        // children of every object as one array with offsets
+        std::vector<unsigned int> offsets(objects + 1, 0), children(objects);
+        for (int parent : parents)
+        {
+            if (parent >= 0)
+            {
+                offsets[parent + 1]++;
+            }
+        }
+        for (size_t i = 0; i < objects; i++)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+        std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+        order.clear();
+        order.reserve(objects);
+        for (size_t i = 0; i < objects; i++)
+        {
+            if (parents[i] >= 0)
+            {
+                children[next[parents[i]]++] = static_cast<unsigned int>(i);
+            }
+            else
+            {
+                order.push_back(static_cast<unsigned int>(i));
+            }
+        }
+        // the order is its own queue
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            order.insert(order.end(), children.begin() + offsets[order[k]], children.begin() + offsets[order[k] + 1]);
+        }
+    }
+
+    /*
+    * @param	parent	index of an object added before, negative for a root. A parent in the level of the last
+    *					object starts a new level, keep the breadth first order (sortBreadthFirst()) for few levels
+    *
+    * @return	returns the index of the new object, its world matrix is computed by the next update()
+    */
+    size_t add(const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f),
+        int parent = -1)
+    {
+        if (parent >= static_cast<int>(count))
+        {
+            std::cout << "ERROR SceneStore parent " << parent << " of object " << count << " wasn't added yet, the object becomes a root" << std::endl;
+            parent = -1;
+        }
+        if (levels.empty() || (parent >= 0 && static_cast<size_t>(parent) >= levels.back()))
+        {
+            levels.push_back(count);
+        }
+        parents.push_back(parent);
+        changed.push_back(0);
+        if (count % BLOCK_SIZE == 0)
+        {
+            // a new block, padded with identity transforms so update() can always load whole blocks
+            size_t padded = count + BLOCK_SIZE;
+            for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ })
+            {
+                component->resize(padded, 0.0f);
+            }
+            for (std::vector<float>* component : { &rotationW, &scaleX, &scaleY, &scaleZ })
+            {
+                component->resize(padded, 1.0f);
+            }
+            local.resize(padded, glm::mat4(1.0f));
+            world.resize(padded, glm::mat4(1.0f));
+            blockDirty.push_back(0);
+        }
+        count++;
+        setPosition(count - 1, position);
+        setRotation(count - 1, rotation);
+        setScale(count - 1, scale);
+        return count - 1;
+    }
+
+    void setPosition(size_t index, const glm::vec3& position)
+    {
+        positionX[index] = position.x;
+        positionY[index] = position.y;
+        positionZ[index] = position.z;
+        markDirty(index);
+    }
+
+    void setRotation(size_t index, const glm::quat& rotation)
+    {
+        rotationX[index] = rotation.x;
+        rotationY[index] = rotation.y;
+        rotationZ[index] = rotation.z;
+        rotationW[index] = rotation.w;
+        markDirty(index);
+    }
+
+    void setScale(size_t index, const glm::vec3& scale)
+    {
+        scaleX[index] = scale.x;
+        scaleY[index] = scale.y;
+        scaleZ[index] = scale.z;
+        markDirty(index);
+    }
+
+    glm::vec3 getPosition(size_t index) const
+    {
+        return glm::vec3(positionX[index], positionY[index], positionZ[index]);
+    }
+
+    glm::quat getRotation(size_t index) const
+    {
+        return glm::quat(rotationW[index], rotationX[index], rotationY[index], rotationZ[index]);
+    }
+
+    glm::vec3 getScale(size_t index) const
+    {
+        return glm::vec3(scaleX[index], scaleY[index], scaleZ[index]);
+    }
+
+    int getParent(size_t index) const
+    {
+        return parents[index];
+    }
+
+    /*
+    * @return	returns the number of levels of the hierarchy, 1 without parents
+    */
+    size_t getLevelCount() const
+    {
+        return levels.size();
+    }
+
+    /*
+    * @brief	recompute the local matrices of the flagged blocks, clear the flags and propagate the world matrices
+    *
+    * @param	simd	false runs the scalar reference
+    *
+    * @return	returns the number of recomputed local matrices, including the unchanged objects of flagged blocks
+    */
+    size_t update(ThreadPool* pool = NULL, bool simd = true)
+    {
+        size_t blocks = dirtyBlocks.size();
+        if (blocks == 0)
+        {
+            return 0;
+        }
+        // objects are marked with the number of the update that changed them, nothing has to be cleared
+        stamp++;
+        auto updateBlocks = [&](size_t first, size_t last)
+            {
+                for (size_t b = first; b < last; b++)
+                {
+                    size_t block = dirtyBlocks[b];
+#if defined(SCENE_STORE_AVX)
+                    if (simd)
+                    {
+                        updateBlockSimd(block * BLOCK_SIZE);
+                    }
+                    else
+#elif defined(SCENE_STORE_SSE2)
+                    if (simd)
+                    {
+                        updateBlockSse2(block * BLOCK_SIZE);
+                    }
+                    else
+#else
+                    (void)simd;
+#endif
+                    {
+                        updateBlock(block * BLOCK_SIZE);
+                    }
+                    blockDirty[block] = 0;
+                    std::fill(changed.begin() + block * BLOCK_SIZE, changed.begin() + std::min((block + 1) * BLOCK_SIZE, count), stamp);
+                }
+            };
+        if (pool != NULL && blocks > 2 * GRAIN_BLOCKS)
+        {
+            pool->parallelFor(0, (blocks + GRAIN_BLOCKS - 1) / GRAIN_BLOCKS, [&](size_t chunk)
+                {
+                    updateBlocks(chunk * GRAIN_BLOCKS, std::min(blocks, (chunk + 1) * GRAIN_BLOCKS));
+                }, 1);
+        }
+        else
+        {
+            updateBlocks(0, blocks);
+        }
+        dirtyBlocks.clear();
+
+        // every level only reads the world matrices of the levels before
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            size_t first = levels[level], last = level + 1 < levels.size() ? levels[level + 1] : count;
+            if (pool != NULL && last - first > 2 * GRAIN_OBJECTS)
+            {
+                pool->parallelFor(0, (last - first + GRAIN_OBJECTS - 1) / GRAIN_OBJECTS, [&](size_t chunk)
+                    {
+                        propagate(first + chunk * GRAIN_OBJECTS, std::min(last, first + (chunk + 1) * GRAIN_OBJECTS));
+                    }, 1);
+            }
+            else
+            {
+                propagate(first, last);
+            }
+        }
+        return std::min(blocks * BLOCK_SIZE, count);
+    }
+
+    /*
+    * @return	returns the number of objects update() would recompute
+    */
+    size_t getDirtyCount() const
+    {
+        return dirtyBlocks.size() * BLOCK_SIZE;
+    }
+
+    const glm::mat4& getWorld(size_t index) const
+    {
+        return world[index];
+    }
+
+    /*
+    * @brief	size() consecutive world matrices
+    */
+    const glm::mat4* getWorldMatrices() const
+    {
+        return world.data();
+    }
+
+    /*
+    * @brief	gather the world matrices of the given objects contiguously, e.g. into the mapped instance buffer
+    *
+    * @param	indices		objects to write, NULL writes the first count objects
+    */
+    void write(const unsigned int* indices, size_t objects, glm::mat4* destination) const
+    {
+        if (indices == NULL)
+        {
+            memcpy(destination, world.data(), objects * sizeof(glm::mat4));
+            return;
+        }
+        for (size_t k = 0; k < objects; k++)
+        {
+            destination[k] = world[indices[k]];
+        }
+    }
+
+private:
+    static const size_t GRAIN_BLOCKS = 256; // blocks per ThreadPool task
+    static const size_t GRAIN_OBJECTS = 4096; // objects of a level per ThreadPool task
+
+    size_t count = 0;
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+    std::vector<glm::mat4> local;
+    std::vector<glm::mat4> world;
+    std::vector<int> parents;
+    std::vector<size_t> levels; // index of the first object of every level
+    std::vector<unsigned int> changed; // stamp of the last update() that changed the world matrix
+    unsigned int stamp = 0;
+    std::vector<unsigned char> blockDirty;
+    std::vector<unsigned int> dirtyBlocks;
+
+    void markDirty(size_t index)
+    {
+        size_t block = index / BLOCK_SIZE;
+        if (!blockDirty[block])
+        {
+            blockDirty[block] = 1;
+            dirtyBlocks.push_back(static_cast<unsigned int>(block));
+        }
+    }
+
+    /*
+    * @brief	world matrices of the objects whose local matrix or parent changed in this update()
+    */
+    void propagate(size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            int parent = parents[i];
+            if (parent < 0)
+            {
+                if (changed[i] == stamp)
+                {
+                    world[i] = local[i];
+                }
+            }
+            else if (changed[i] == stamp || changed[parent] == stamp)
+            {
+                multiply(world[parent], local[i], world[i]);
+                changed[i] = stamp;
+            }
+        }
+    }
+
+    /*
+    * @brief	result = a * b, every column of the result is a combination of the columns of a
+    */
+    static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+    {
+#if defined(SCENE_STORE_SSE2)
+        const float* left = &a[0][0];
+        __m128 column0 = _mm_loadu_ps(left), column1 = _mm_loadu_ps(left + 4), column2 = _mm_loadu_ps(left + 8), column3 = _mm_loadu_ps(left + 12);
+        for (int c = 0; c < 4; c++)
+        {
+            __m128 sum = _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(b[c][0])), _mm_mul_ps(column1, _mm_set1_ps(b[c][1])));
+            sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(b[c][2])), _mm_mul_ps(column3, _mm_set1_ps(b[c][3]))));
+            _mm_storeu_ps(&result[c][0], sum);
+        }
+#else
+        result = a * b;
+#endif
+    }
+
+    /*
+    * @brief	the rotation columns of the quaternion (glm::mat3_cast) scaled per axis, and the translation
+    */
+    void updateBlock(size_t first)
+    {
+        for (size_t i = first; i < first + BLOCK_SIZE; i++)
+        {
+            float x = rotationX[i], y = rotationY[i], z = rotationZ[i], w = rotationW[i];
+            float xx = x * x, yy = y * y, zz = z * z, xy = x * y, xz = x * z, yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+            glm::mat4& matrix = local[i];
+            matrix[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * scaleX[i];
+            matrix[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * scaleY[i];
+            matrix[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * scaleZ[i];
+            matrix[3] = glm::vec4(positionX[i], positionY[i], positionZ[i], 1.0f);
+        }
+    }
+
+#if defined(SCENE_STORE_SSE2)
+    /*
+    * @brief	updateBlock() for 4 objects at a time, every group of 4 elements is transposed into the 4 matrices
+    */
+    void updateBlockSse2(size_t first)
+    {
+        __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+        for (size_t group = first; group < first + BLOCK_SIZE; group += 4)
+        {
+            __m128 x = _mm_loadu_ps(&rotationX[group]), y = _mm_loadu_ps(&rotationY[group]);
+            __m128 z = _mm_loadu_ps(&rotationZ[group]), w = _mm_loadu_ps(&rotationW[group]);
+            __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+            __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+            __m128 sx = _mm_loadu_ps(&scaleX[group]), sy = _mm_loadu_ps(&scaleY[group]), sz = _mm_loadu_ps(&scaleZ[group]);
+
+            __m128 elements[16];
+            elements[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+            elements[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+            elements[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+            elements[3] = zero;
+            elements[4] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+            elements[5] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+            elements[6] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+            elements[7] = zero;
+            elements[8] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+            elements[9] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+            elements[10] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+            elements[11] = zero;
+            elements[12] = _mm_loadu_ps(&positionX[group]);
+            elements[13] = _mm_loadu_ps(&positionY[group]);
+            elements[14] = _mm_loadu_ps(&positionZ[group]);
+            elements[15] = one;
+
+            // after the transpose register i of a column holds that column of object i
+            float* destination = &local[group][0][0];
+            for (int column = 0; column < 4; column++)
+            {
+                __m128* rows = elements + 4 * column;
+                _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+                for (int i = 0; i < 4; i++)
+                {
+                    _mm_storeu_ps(destination + 16 * i + 4 * column, rows[i]);
+                }
+            }
+        }
+    }
+#endif
+
+#if defined(SCENE_STORE_AVX)
+    /*
+    * @brief	updateBlock() for all 8 objects of the block at once, the 16 matrix elements are transposed on the way out
+    */
+    void updateBlockSimd(size_t first)
+    {
+        __m256 x = _mm256_loadu_ps(&rotationX[first]), y = _mm256_loadu_ps(&rotationY[first]);
+        __m256 z = _mm256_loadu_ps(&rotationZ[first]), w = _mm256_loadu_ps(&rotationW[first]);
+        __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+        __m256 sx = _mm256_loadu_ps(&scaleX[first]), sy = _mm256_loadu_ps(&scaleY[first]), sz = _mm256_loadu_ps(&scaleZ[first]);
+
+        __m256 elements[16];
+        elements[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        elements[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        elements[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        elements[3] = zero;
+        elements[4] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        elements[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        elements[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        elements[7] = zero;
+        elements[8] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        elements[9] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        elements[10] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+        elements[11] = zero;
+        elements[12] = _mm256_loadu_ps(&positionX[first]);
+        elements[13] = _mm256_loadu_ps(&positionY[first]);
+        elements[14] = _mm256_loadu_ps(&positionZ[first]);
+        elements[15] = one;
+
+        // two 8x8 transposes: elements 0..7 are the first half of every matrix, 8..15 the second
+        float* destination = &local[first][0][0];
+        for (int half = 0; half < 2; half++)
+        {
+            __m256* rows = elements + 8 * half;
+            __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]), t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+            __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]), t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+            __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]), t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+            __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]), t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+            __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+            // lane i of the block gets element 8 * half .. 8 * half + 7 of its matrix
+            __m256 objects[8];
+            objects[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+            objects[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+            objects[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+            objects[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+            objects[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+            objects[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+            objects[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+            objects[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+            for (int i = 0; i < 8; i++)
+            {
+                _mm256_storeu_ps(destination + 16 * i + 8 * half, objects[i]);
+            }
+        }
+    }
+#endif
+};
@@ -9,61 +9,143 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#include "AssetArchive.h"
+
+/// active uniform or vertex attribute of a linked program
+struct ShaderVariable
+{
+	std::string name;
+	unsigned int hash;
+	int location; // -1 for uniforms that live in a uniform block
+	GLenum type;
+	int arraySize;
+};
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile, not part of the preinstalled glad
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+/// BLOCKING: the constructor returns a linked program
+/// ASYNC: the constructor only submits the compile and link, poll isReady() before using the program
+enum class ShaderBuild {
+	BLOCKING,
+	ASYNC
+};
+
+/// startup statistics of all Shaders, see Shader::setBinaryCacheDirectory
+struct ShaderCacheStats
+{
+	unsigned int compiled = 0; // programs compiled from source
+	unsigned int loaded = 0; // programs loaded from the binary cache
+	unsigned int rejected = 0; // cached binaries the driver didn't accept
+	double compileTime = 0.0; // seconds
+	double loadTime = 0.0; // seconds
+};
 
 class Shader {
 public:
 	unsigned int ID;
 
-	Shader(const char* vertexPath, const char* fragmentPath)
+	Shader(const char* vertexPath, const char* fragmentPath, ShaderBuild mode = ShaderBuild::BLOCKING)
 	{
-		std::string vertexShaderCode = getShaderCode(vertexPath);
-		std::string fragmentShaderCode = getShaderCode(fragmentPath);
+		build({
+			{ GL_VERTEX_SHADER, getShaderCode(vertexPath), "Vertex Shader" },
+			{ GL_FRAGMENT_SHADER, getShaderCode(fragmentPath), "Fragment Shader" }
+		}, mode);
+	}
 
-		unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode.c_str(), "Vertex Shader");
-		unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode.c_str(), "Fragment Shader");
+	Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, ShaderBuild mode = ShaderBuild::BLOCKING)
+	{
+		build({
+			{ GL_VERTEX_SHADER, getShaderCode(vertexPath), "Vertex Shader" },
+			{ GL_GEOMETRY_SHADER, getShaderCode(geometryPath), "Geometry Shader" },
+			{ GL_FRAGMENT_SHADER, getShaderCode(fragmentPath), "Fragment Shader" }
+		}, mode);
+	}
 
-		int succes;
-		char infoLog[1024];
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		glGetProgramiv(ID, GL_COMPILE_STATUS, &succes);
-		if (!succes)
+	/*
+	* @brief	compute program
+	*/
+	explicit Shader(const char* computePath, ShaderBuild mode = ShaderBuild::BLOCKING)
+	{
+		build({
+			{ GL_COMPUTE_SHADER, getShaderCode(computePath), "Compute Shader" }
+		}, mode);
+	}
+
+	/*
+	* @brief	enable parallel shader compilation if the driver supports GL_KHR_parallel_shader_compile,
+	*			call once after glad was loaded with the same loader
+	*
+	* @return	returns true if the driver compiles in parallel and completion can be polled without blocking
+	*/
+	static bool loadExtensions(GLADloadproc load)
+	{
+		int count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = NULL;
+		for (int i = 0; i < count && maxShaderCompilerThreads == NULL; i++)
 		{
-			glGetProgramInfoLog(ID, 1024, NULL, infoLog);
-			std::cout << "ERROR Linking Program:\n" << infoLog << std::endl;
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+			{
+				maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+			}
+			else if (strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+			{
+				maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+			}
 		}
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+		parallelCompile() = maxShaderCompilerThreads != NULL;
+		if (parallelCompile())
+		{
+			// 0xFFFFFFFF lets the driver choose the number of compiler threads
+			maxShaderCompilerThreads(0xFFFFFFFFU);
+		}
+		return parallelCompile();
 	}
 
-	Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
+	/*
+	* @brief	checks if an ASYNC build finished and finalizes it, a BLOCKING Shader is always ready. Only non blocking
+	*			with KHR_parallel_shader_compile, without it the call waits until the driver finished the build
+	*/
+	bool isReady()
 	{
-		std::string vertexShaderCode = getShaderCode(vertexPath);
-		std::string geometryShaderCode = getShaderCode(geometryPath);
-		std::string fragmentShaderCode = getShaderCode(fragmentPath);
-
-		unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode.c_str(), "Vertex Shader");
-		unsigned int geometryShader = compileShader(GL_GEOMETRY_SHADER, geometryShaderCode.c_str(), "Geometry Shader");
-		unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode.c_str(), "Fragment Shader");
+		if (pendingShaders.empty())
+		{
+			return true;
+		}
+		if (parallelCompile())
+		{
+			int complete = GL_FALSE;
+			glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+			if (!complete)
+			{
+				return false;
+			}
+		}
+		finishBuild();
+		return true;
+	}
 
-		int succes;
-		char infoLog[1024];
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, geometryShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		glGetProgramiv(ID, GL_COMPILE_STATUS, &succes);
-		if (!succes)
+	/*
+	* @brief	blocks until an ASYNC build finished
+	*/
+	void wait()
+	{
+		if (!pendingShaders.empty())
 		{
-			glGetProgramInfoLog(ID, 1024, NULL, infoLog);
-			std::cout << "ERROR Linking Program:\n" << infoLog << std::endl;
+			finishBuild();
 		}
-		glDeleteShader(vertexShader);
-		glDeleteShader(geometryShader);
-		glDeleteShader(fragmentShader);
 	}
 
 	void use()
@@ -72,116 +154,116 @@ public:
 	}
 
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, int value)
 	{
-		glUniform1i(glGetUniformLocation(ID, name), value);
+		set(findUniformLocation(name), value);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, unsigned int value)
 	{
-		glUniform1ui(glGetUniformLocation(ID, name), value);
+		set(findUniformLocation(name), value);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, float value)
 	{
-		glUniform1f(glGetUniformLocation(ID, name), value);
+		set(findUniformLocation(name), value);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, double value)
 	{
-		glUniform1d(glGetUniformLocation(ID, name), value);
+		set(findUniformLocation(name), value);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, int value1, int value2)
 	{
-		glUniform2i(glGetUniformLocation(ID, name), value1, value2);
+		set(findUniformLocation(name), value1, value2);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, unsigned int value1, unsigned int value2)
 	{
-		glUniform2ui(glGetUniformLocation(ID, name), value1, value2);
+		set(findUniformLocation(name), value1, value2);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, float value1, float value2)
 	{
-		glUniform2f(glGetUniformLocation(ID, name), value1, value2);
+		set(findUniformLocation(name), value1, value2);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, double value1, double value2)
 	{
-		glUniform2d(glGetUniformLocation(ID, name), value1, value2);
+		set(findUniformLocation(name), value1, value2);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, int value1, int value2, int value3)
 	{
-		glUniform3i(glGetUniformLocation(ID, name), value1, value2, value3);
+		set(findUniformLocation(name), value1, value2, value3);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, unsigned int value1, unsigned int value2, unsigned int value3)
 	{
-		glUniform3ui(glGetUniformLocation(ID, name), value1, value2, value3);
+		set(findUniformLocation(name), value1, value2, value3);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, float value1, float value2, float value3)
 	{
-		glUniform3f(glGetUniformLocation(ID, name), value1, value2, value3);
+		set(findUniformLocation(name), value1, value2, value3);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, double value1, double value2, double value3)
 	{
-		glUniform3d(glGetUniformLocation(ID, name), value1, value2, value3);
+		set(findUniformLocation(name), value1, value2, value3);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, int value1, int value2, int value3, int value4)
 	{
-		glUniform4i(glGetUniformLocation(ID, name), value1, value2, value3, value4);
+		set(findUniformLocation(name), value1, value2, value3, value4);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, unsigned int value1, unsigned int value2, unsigned int value3, unsigned int value4)
 	{
-		glUniform4ui(glGetUniformLocation(ID, name), value1, value2, value3, value4);
+		set(findUniformLocation(name), value1, value2, value3, value4);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, float value1, float value2, float value3, float value4)
 	{
-		glUniform4f(glGetUniformLocation(ID, name), value1, value2, value3, value4);
+		set(findUniformLocation(name), value1, value2, value3, value4);
 	}
 	/*
-	* @brief	suitable for single use
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
 	*/
 	void set(const char* name, double value1, double value2, double value3, double value4)
 	{
-		glUniform4d(glGetUniformLocation(ID, name), value1, value2, value3, value4);
+		set(findUniformLocation(name), value1, value2, value3, value4);
 	}
 
 
@@ -190,120 +272,194 @@ public:
 	*/
 	void set(unsigned int location, int value)
 	{
-		glUniform1i(location, value);
+		const int values[] = { value };
+		if (changed(location, values))
+		{
+			glProgramUniform1i(ID, location, value);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, unsigned int value)
 	{
-		glUniform1ui(location, value);
+		const unsigned int values[] = { value };
+		if (changed(location, values))
+		{
+			glProgramUniform1ui(ID, location, value);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, float value)
 	{
-		glUniform1f(location, value);
+		const float values[] = { value };
+		if (changed(location, values))
+		{
+			glProgramUniform1f(ID, location, value);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, double value)
 	{
-		glUniform1d(location, value);
+		const double values[] = { value };
+		if (changed(location, values))
+		{
+			glProgramUniform1d(ID, location, value);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, int value1, int value2)
 	{
-		glUniform2i(location, value1, value2);
+		const int values[] = { value1, value2 };
+		if (changed(location, values))
+		{
+			glProgramUniform2i(ID, location, value1, value2);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, unsigned int value1, unsigned int value2)
 	{
-		glUniform2ui(location, value1, value2);
+		const unsigned int values[] = { value1, value2 };
+		if (changed(location, values))
+		{
+			glProgramUniform2ui(ID, location, value1, value2);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, float value1, float value2)
 	{
-		glUniform2f(location, value1, value2);
+		const float values[] = { value1, value2 };
+		if (changed(location, values))
+		{
+			glProgramUniform2f(ID, location, value1, value2);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, double value1, double value2)
 	{
-		glUniform2d(location, value1, value2);
+		const double values[] = { value1, value2 };
+		if (changed(location, values))
+		{
+			glProgramUniform2d(ID, location, value1, value2);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, int value1, int value2, int value3)
 	{
-		glUniform3i(location, value1, value2, value3);
+		const int values[] = { value1, value2, value3 };
+		if (changed(location, values))
+		{
+			glProgramUniform3i(ID, location, value1, value2, value3);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, unsigned int value1, unsigned int value2, unsigned int value3)
 	{
-		glUniform3ui(location, value1, value2, value3);
+		const unsigned int values[] = { value1, value2, value3 };
+		if (changed(location, values))
+		{
+			glProgramUniform3ui(ID, location, value1, value2, value3);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, float value1, float value2, float value3)
 	{
-		glUniform3f(location, value1, value2, value3);
+		const float values[] = { value1, value2, value3 };
+		if (changed(location, values))
+		{
+			glProgramUniform3f(ID, location, value1, value2, value3);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, double value1, double value2, double value3)
 	{
-		glUniform3d(location, value1, value2, value3);
+		const double values[] = { value1, value2, value3 };
+		if (changed(location, values))
+		{
+			glProgramUniform3d(ID, location, value1, value2, value3);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, int value1, int value2, int value3, int value4)
 	{
-		glUniform4i(location, value1, value2, value3, value4);
+		const int values[] = { value1, value2, value3, value4 };
+		if (changed(location, values))
+		{
+			glProgramUniform4i(ID, location, value1, value2, value3, value4);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, unsigned int value1, unsigned int value2, unsigned int value3, unsigned int value4)
 	{
-		glUniform4ui(location, value1, value2, value3, value4);
+		const unsigned int values[] = { value1, value2, value3, value4 };
+		if (changed(location, values))
+		{
+			glProgramUniform4ui(ID, location, value1, value2, value3, value4);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, float value1, float value2, float value3, float value4)
 	{
-		glUniform4f(location, value1, value2, value3, value4);
+		const float values[] = { value1, value2, value3, value4 };
+		if (changed(location, values))
+		{
+			glProgramUniform4f(ID, location, value1, value2, value3, value4);
+		}
 	}
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
 	void set(unsigned int location, double value1, double value2, double value3, double value4)
 	{
-		glUniform4d(location, value1, value2, value3, value4);
+		const double values[] = { value1, value2, value3, value4 };
+		if (changed(location, values))
+		{
+			glProgramUniform4d(ID, location, value1, value2, value3, value4);
+		}
 	}
 
 	/*
 	* @brief	suitable for multiple use, use getSetLocation to get the location of the uniform
 	*/
-	void setMat4(unsigned int location, glm::mat4& value)
+	void setMat4(unsigned int location, const glm::mat4& value)
+	{
+		if (changed(location, value))
+		{
+			glProgramUniformMatrix4fv(ID, location, 1, GL_FALSE, glm::value_ptr(value));
+		}
+	}
+	/*
+	* @brief	suitable for single use, costs one lookup in the reflected uniform table
+	*/
+	void setMat4(const char* name, const glm::mat4& value)
 	{
-		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+		setMat4(findUniformLocation(name), value);
 	}
 
 	/*
@@ -311,15 +467,123 @@ public:
 	*/
 	unsigned int getSetLocation(const char* name)
 	{
-		int id = glGetUniformLocation(ID, name);
-		if (id > -1)
+		const ShaderVariable* uniform = find(uniforms, uniformTable, name);
+		if (uniform != NULL && uniform->location > -1)
 		{
-			return id;
+			return uniform->location;
 		}
 		std::cout << "ERROR Uniform <" << name << "> doesn't exists" << std::endl;
 		return -1;
 	}
 
+	/*
+	* @brief	all active uniforms of the program, including the members of uniform blocks
+	*/
+	const std::vector<ShaderVariable>& getUniforms() const
+	{
+		return uniforms;
+	}
+
+	/*
+	* @brief	all active vertex attributes of the program
+	*/
+	const std::vector<ShaderVariable>& getAttributes() const
+	{
+		return attributes;
+	}
+
+	/*
+	* @return	returns the location of the vertex attribute or -1 if it doesn't exists
+	*/
+	int getAttributeLocation(const char* name) const
+	{
+		const ShaderVariable* attribute = find(attributes, attributeTable, name);
+		return attribute != NULL ? attribute->location : -1;
+	}
+
+	/*
+	* @brief	store linked programs with glGetProgramBinary in this directory and load them on the next start,
+	*			an empty path disables the cache
+	*/
+	static void setBinaryCacheDirectory(const char* path)
+	{
+		binaryCacheDirectory() = path;
+		if (!binaryCacheDirectory().empty())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(binaryCacheDirectory(), error);
+		}
+	}
+
+	/*
+	* @brief	read the shader sources from this archive, paths that are not in the archive are read from the files,
+	*			NULL reads every source from the files. The archive has to stay open while Shaders are created
+	*/
+	static void setAssetArchive(AssetArchive* archive)
+	{
+		assetArchive() = archive;
+	}
+
+	/*
+	* @brief	register the code of an #include "name" directive, Shaders created afterwards use it instead of the file
+	*			next to the shader (E.g.: the attribute decode generated by VertexFormat::getShaderDecode)
+	*/
+	static void setInclude(const char* name, const std::string& code)
+	{
+		includes()[name] = code;
+	}
+
+	static const ShaderCacheStats& getCacheStats()
+	{
+		return cacheStats();
+	}
+
+	/*
+	* @brief	assign a binding point to a uniform block name, every Shader created afterwards binds its block automatically
+	*/
+	static void registerUniformBlock(const char* name, unsigned int binding)
+	{
+		uniformBlockBindings()[name] = binding;
+	}
+
+	/*
+	* @brief	bind a uniform block of this program to a binding point
+	*
+	* @return	returns false if the program has no active block with this name
+	*/
+	bool bindUniformBlock(const char* name, unsigned int binding)
+	{
+		unsigned int index = glGetUniformBlockIndex(ID, name);
+		if (index == GL_INVALID_INDEX)
+		{
+			return false;
+		}
+		glUniformBlockBinding(ID, index, binding);
+		return true;
+	}
+
+	/*
+	* @brief	check that the linked uniform block has the same size as the C++ struct that feeds it (see UniformBuffer.h)
+	*/
+	template<class T>
+	bool checkUniformBlock(const char* name)
+	{
+		unsigned int index = glGetUniformBlockIndex(ID, name);
+		if (index == GL_INVALID_INDEX)
+		{
+			std::cout << "ERROR Uniform block <" << name << "> doesn't exists" << std::endl;
+			return false;
+		}
+		int size;
+		glGetActiveUniformBlockiv(ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		if (size != static_cast<int>(sizeof(T)))
+		{
+			std::cout << "ERROR Uniform block <" << name << "> has " << size << " bytes, but the C++ struct has " << sizeof(T) << " bytes" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
 	void remove()
 	{
 		glDeleteProgram(ID);
@@ -327,57 +591,498 @@ public:
 
 
 private:
+	/// source code of a stage, either a view into the AssetArchive or the text read from the file
+	struct ShaderSource
+	{
+		std::string_view archived;
+		std::string loaded;
+
+		std::string_view get() const
+		{
+			return archived.data() != NULL ? archived : std::string_view(loaded);
+		}
+	};
+
+	struct ShaderStage
+	{
+		GLenum type;
+		ShaderSource source;
+		const char* name;
+	};
+
+	/// shaders of an ASYNC build that are still compiling
+	struct PendingShader
+	{
+		unsigned int shader;
+		const char* name;
+	};
+	std::vector<PendingShader> pendingShaders;
+	unsigned long long pendingKey = 0;
+	std::chrono::steady_clock::time_point buildStart;
+
+	/*
+	* @brief	load the program from the binary cache or submit the compile and link from source
+	*/
+	void build(const std::vector<ShaderStage>& stages, ShaderBuild mode)
+	{
+		buildStart = std::chrono::steady_clock::now();
+		ID = glCreateProgram();
+
+		pendingKey = getBinaryKey(stages);
+		if (loadBinary(pendingKey))
+		{
+			cacheStats().loaded++;
+			cacheStats().loadTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+			bindRegisteredUniformBlocks();
+			reflect();
+			return;
+		}
+
+		// the status is only checked in finishBuild, so the driver can compile in the background
+		for (const ShaderStage& stage : stages)
+		{
+			PendingShader pending = { compileShader(stage.type, stage.source.get()), stage.name };
+			pendingShaders.push_back(pending);
+			glAttachShader(ID, pending.shader);
+		}
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(ID);
+
+		if (mode == ShaderBuild::BLOCKING)
+		{
+			finishBuild();
+		}
+	}
+
+	/*
+	* @brief	check the compile and link status, store the binary and reflect the program
+	*/
+	void finishBuild()
+	{
+		int succes;
+		char infoLog[1024];
+		glGetProgramiv(ID, GL_LINK_STATUS, &succes);
+		if (!succes)
+		{
+			for (const PendingShader& pending : pendingShaders)
+			{
+				int compiled;
+				glGetShaderiv(pending.shader, GL_COMPILE_STATUS, &compiled);
+				if (!compiled)
+				{
+					glGetShaderInfoLog(pending.shader, 1024, NULL, infoLog);
+					std::cout << "ERROR Shader <" << pending.name << "> Compilation Failed:\n" << infoLog << std::endl;
+				}
+			}
+			glGetProgramInfoLog(ID, 1024, NULL, infoLog);
+			std::cout << "ERROR Linking Program:\n" << infoLog << std::endl;
+		}
+		for (const PendingShader& pending : pendingShaders)
+		{
+			glDetachShader(ID, pending.shader);
+			glDeleteShader(pending.shader);
+		}
+		pendingShaders.clear();
+		if (succes)
+		{
+			storeBinary(pendingKey);
+		}
+		cacheStats().compiled++;
+		cacheStats().compileTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+		bindRegisteredUniformBlocks();
+		reflect();
+	}
+
+	static bool& parallelCompile()
+	{
+		static bool parallel = false;
+		return parallel;
+	}
+
+	static AssetArchive*& assetArchive()
+	{
+		static AssetArchive* archive = NULL;
+		return archive;
+	}
+
+	static std::map<std::string, std::string>& includes()
+	{
+		static std::map<std::string, std::string> code;
+		return code;
+	}
+
+	static std::string& binaryCacheDirectory()
+	{
+		static std::string directory;
+		return directory;
+	}
+
+	static ShaderCacheStats& cacheStats()
+	{
+		static ShaderCacheStats stats;
+		return stats;
+	}
+
+	/*
+	* @brief	hash of the stage sources (including their #defines) and the driver, a driver update invalidates the cache
+	*/
+	static unsigned long long getBinaryKey(const std::vector<ShaderStage>& stages)
+	{
+		// FNV-1a 64 bit
+		unsigned long long hash = 14695981039346656037ULL;
+		auto add = [&hash](const void* data, size_t size)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++)
+			{
+				hash = (hash ^ bytes[i]) * 1099511628211ULL;
+			}
+		};
+		const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+		for (GLenum name : driverStrings)
+		{
+			const char* value = reinterpret_cast<const char*>(glGetString(name));
+			if (value != NULL)
+			{
+				add(value, strlen(value) + 1);
+			}
+		}
+		for (const ShaderStage& stage : stages)
+		{
+			add(&stage.type, sizeof(stage.type));
+			std::string_view code = stage.source.get();
+			add(code.data(), code.size());
+		}
+		return hash;
+	}
+
+	static std::string getBinaryPath(unsigned long long key)
+	{
+		std::ostringstream path;
+		path << binaryCacheDirectory() << "/" << std::hex << key << ".bin";
+		return path.str();
+	}
+
+	bool loadBinary(unsigned long long key)
+	{
+		if (binaryCacheDirectory().empty())
+		{
+			return false;
+		}
+		std::string path = getBinaryPath(key);
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		std::streamoff fileSize = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+		unsigned int header[3]; // magic, format, length
+		if (!file || !file.seekg(0) || !file.read(reinterpret_cast<char*>(header), sizeof(header))
+			|| header[0] != BINARY_MAGIC || header[2] != fileSize - static_cast<std::streamoff>(sizeof(header)))
+		{
+			return false;
+		}
+		std::vector<char> binary(header[2]);
+		if (!file.read(binary.data(), binary.size()))
+		{
+			return false;
+		}
+
+		glProgramBinary(ID, header[1], binary.data(), static_cast<int>(binary.size()));
+		int succes;
+		glGetProgramiv(ID, GL_LINK_STATUS, &succes);
+		if (!succes)
+		{
+			// the driver rejected the binary, compile from source and replace the file
+			cacheStats().rejected++;
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(path, error);
+			glDeleteProgram(ID);
+			ID = glCreateProgram();
+			return false;
+		}
+		return true;
+	}
+
+	void storeBinary(unsigned long long key)
+	{
+		int formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (binaryCacheDirectory().empty() || formats == 0)
+		{
+			return;
+		}
+		int length = 0;
+		glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+		std::vector<char> binary(length);
+		GLenum format;
+		glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+		std::ofstream file(getBinaryPath(key), std::ios::binary);
+		unsigned int header[3] = { BINARY_MAGIC, format, static_cast<unsigned int>(length) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(binary.data(), length);
+	}
+
+	static const unsigned int BINARY_MAGIC = 0x42505347; // "GSPB"
+
+	/// last value of every uniform location, setters skip the GL call if the value didn't change
+	struct CachedValue
+	{
+		unsigned char data[sizeof(glm::mat4)];
+		unsigned char size = 0;
+	};
+
+	std::vector<ShaderVariable> uniforms;
+	std::vector<ShaderVariable> attributes;
+	std::vector<int> uniformTable; // open addressing hash table of indices into uniforms, -1 = empty slot
+	std::vector<int> attributeTable;
+	std::vector<CachedValue> valueCache; // indexed by location
+
+	static unsigned int hashName(const char* name)
+	{
+		// FNV-1a
+		unsigned int hash = 2166136261U;
+		for (; *name != '\0'; name++)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619U;
+		}
+		return hash;
+	}
+
+	static const ShaderVariable* find(const std::vector<ShaderVariable>& variables, const std::vector<int>& table, const char* name)
+	{
+		if (table.empty())
+		{
+			return NULL;
+		}
+		unsigned int hash = hashName(name);
+		size_t mask = table.size() - 1;
+		for (size_t slot = hash & mask; table[slot] != -1; slot = (slot + 1) & mask)
+		{
+			const ShaderVariable& variable = variables[table[slot]];
+			if (variable.hash == hash && variable.name == name)
+			{
+				return &variable;
+			}
+		}
+		return NULL;
+	}
+
+	static std::vector<int> buildTable(const std::vector<ShaderVariable>& variables)
+	{
+		size_t size = 8;
+		while (size < variables.size() * 2)
+		{
+			size *= 2;
+		}
+		std::vector<int> table(size, -1);
+		for (size_t i = 0; i < variables.size(); i++)
+		{
+			size_t slot = variables[i].hash & (size - 1);
+			while (table[slot] != -1)
+			{
+				slot = (slot + 1) & (size - 1);
+			}
+			table[slot] = static_cast<int>(i);
+		}
+		return table;
+	}
+
+	static std::vector<ShaderVariable> queryResources(unsigned int program, GLenum interface)
+	{
+		int count = 0;
+		glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+		std::vector<ShaderVariable> variables;
+		variables.reserve(count);
+		const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE };
+		for (int i = 0; i < count; i++)
+		{
+			int values[4];
+			glGetProgramResourceiv(program, interface, i, 4, properties, 4, NULL, values);
+			ShaderVariable variable;
+			variable.name.resize(values[0]);
+			glGetProgramResourceName(program, interface, i, values[0], NULL, &variable.name[0]);
+			variable.name.resize(values[0] > 0 ? values[0] - 1 : 0); // drop the null terminator
+			variable.type = values[1];
+			variable.location = values[2];
+			variable.arraySize = values[3];
+			variable.hash = hashName(variable.name.c_str());
+			variables.push_back(variable);
+
+			// arrays are reported as "name[0]", make them available as "name" too
+			size_t bracket = variable.name.size() > 3 ? variable.name.rfind("[0]") : std::string::npos;
+			if (bracket != std::string::npos && bracket + 3 == variable.name.size())
+			{
+				variable.name.resize(bracket);
+				variable.hash = hashName(variable.name.c_str());
+				variables.push_back(variable);
+			}
+		}
+		return variables;
+	}
+
 	/*
-	* @brief	get the Shader source code from a file
+	* @brief	query all active uniforms and attributes of the linked program and build the lookup tables
+	*/
+	void reflect()
+	{
+		uniforms = queryResources(ID, GL_UNIFORM);
+		attributes = queryResources(ID, GL_PROGRAM_INPUT);
+		uniformTable = buildTable(uniforms);
+		attributeTable = buildTable(attributes);
+
+		int locations = 0;
+		for (const ShaderVariable& uniform : uniforms)
+		{
+			locations = std::max(locations, uniform.location + std::max(uniform.arraySize, 1));
+		}
+		valueCache.assign(locations, CachedValue());
+	}
+
+	unsigned int findUniformLocation(const char* name) const
+	{
+		const ShaderVariable* uniform = find(uniforms, uniformTable, name);
+		return uniform != NULL ? uniform->location : -1;
+	}
+
+	/*
+	* @brief	compare the value with the cached value of the location and store it
+	*
+	* @return	returns true if the value differs and has to be sent to OpenGL
+	*/
+	template<class T>
+	bool changed(unsigned int location, const T& value)
+	{
+		static_assert(sizeof(T) <= sizeof(CachedValue::data), "value is too large for the uniform cache");
+		if (location >= valueCache.size())
+		{
+			return true;
+		}
+		CachedValue& cached = valueCache[location];
+		if (cached.size == sizeof(T) && std::memcmp(cached.data, &value, sizeof(T)) == 0)
+		{
+			return false;
+		}
+		std::memcpy(cached.data, &value, sizeof(T));
+		cached.size = sizeof(T);
+		return true;
+	}
+
+	static std::map<std::string, unsigned int>& uniformBlockBindings()
+	{
+		static std::map<std::string, unsigned int> bindings;
+		return bindings;
+	}
+
+	void bindRegisteredUniformBlocks()
+	{
+		for (const std::pair<const std::string, unsigned int>& block : uniformBlockBindings())
+		{
+			bindUniformBlock(block.first.c_str(), block.second);
+		}
+	}
+
+	/*
+	* @brief	get the Shader source code from the asset archive or a file
 	*
 	* @param	path	Path to the Shader file (E.g.: ../Shaders/MyShader.vert)
 	*
-	* @return	returns the source code
+	* @return	returns the source code, archived sources are not copied
 	*/
-	std::string getShaderCode(const char* path)
+	ShaderSource getShaderCode(const char* path)
 	{
-		std::ifstream shaderFile;
+		ShaderSource source = readSource(path);
+		if (source.get().find("#include") != std::string_view::npos)
+		{
+			source.loaded = resolveIncludes(path, source.get());
+			source.archived = std::string_view();
+		}
+		return source;
+	}
 
-		shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	static ShaderSource readSource(const std::string& path)
+	{
+		ShaderSource source;
+		if (assetArchive() != NULL)
+		{
+			source.archived = assetArchive()->view(path);
+			if (source.archived.data() != NULL)
+			{
+				return source;
+			}
+		}
 
-		try
+		std::ifstream shaderFile(path, std::ios::binary | std::ios::ate);
+		if (!shaderFile)
 		{
-			shaderFile.open(path);
-			std::stringstream shaderStream;
-			shaderStream << shaderFile.rdbuf();
-			shaderFile.close();
-			return shaderStream.str();
+			std::cout << "Error couldn't read File (Path: " << path << " )" << std::endl;
+			return source;
 		}
-		catch (std::ifstream::failure e)
+		source.loaded.resize(static_cast<size_t>(shaderFile.tellg()));
+		shaderFile.seekg(0);
+		shaderFile.read(&source.loaded[0], static_cast<std::streamsize>(source.loaded.size()));
+		return source;
+	}
+
+	/*
+	* @brief	replace the #include "name" lines with the code registered by setInclude or else with the file next to the
+	*			shader, includes are not nested. A #line directive after the inserted code keeps the line numbers of
+	*			compile errors pointing into the shader file
+	*/
+	static std::string resolveIncludes(const char* path, std::string_view code)
+	{
+		std::string directory = std::filesystem::path(path).parent_path().generic_string();
+		std::string expanded;
+		expanded.reserve(code.size());
+		unsigned int lineNumber = 1;
+		for (size_t position = 0; position < code.size(); lineNumber++)
 		{
-			std::cout << "Error couldn't read File (Path: " << path << " )\n" << "Errorcode: " << e.code() << "\n" << e.what() << std::endl;
+			size_t end = std::min(code.find('\n', position), code.size());
+			std::string_view line = code.substr(position, end - position);
+			position = end + 1;
+
+			size_t start = line.find_first_not_of(" \t");
+			size_t open = line.find('"');
+			size_t close = line.rfind('"');
+			if (start == std::string_view::npos || line.compare(start, 8, "#include") != 0 || open == std::string_view::npos || close == open)
+			{
+				expanded.append(line);
+				expanded += '\n';
+				continue;
+			}
+			std::string name(line.substr(open + 1, close - open - 1));
+			std::map<std::string, std::string>::const_iterator registered = includes().find(name);
+			if (registered != includes().end())
+			{
+				expanded += registered->second;
+			}
+			else
+			{
+				ShaderSource file = readSource(directory.empty() ? name : directory + "/" + name);
+				expanded.append(file.get());
+			}
+			expanded += "\n#line " + std::to_string(lineNumber + 1) + "\n";
 		}
-		return "";
+		return expanded;
 	}
 
 	/*
-	* @brief	create and compile a OpenGl-shader
+	* @brief	create a OpenGl-shader and submit the compilation, the status is checked in finishBuild
 	*
 	* @param	type	Shader type (E.g.: GL_VERTEX_SHADER)
 	* @param	code	sourcecode of the shader
-	* @param	shaderName	name to show in errormessage
 	*
 	* @return	returns a Shader ID
 	*/
-	unsigned int compileShader(GLenum type, const char* code, std::string shaderName)
+	unsigned int compileShader(GLenum type, std::string_view code)
 	{
-
-		int succes;
 		unsigned int shader = glCreateShader(type);
-		glShaderSource(shader, 1, &code, NULL);
+		const char* data = code.data();
+		int length = static_cast<int>(code.size());
+		glShaderSource(shader, 1, &data, &length);
 		glCompileShader(shader);
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &succes);
-		if (!succes)
-		{
-			char infoLog[1024];
-			glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-			std::cout << "ERROR Shader <" << shaderName << "> Compilation Failed:\n" << infoLog << std::endl;
-		}
 		return shader;
 	}
 };
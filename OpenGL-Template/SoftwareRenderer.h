@@ -0,0 +1,1048 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_RENDERER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SOFTWARE_RENDERER_AVX2
+#include <immintrin.h>
+#endif
+
+/// indexed triangle mesh with the attributes simple.vert reads
+struct SoftwareMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
+};
+
+/// counters of the current frame, reset by SoftwareRenderer::beginFrame()
+struct SoftwareRenderStats
+{
+    size_t instances = 0;
+    size_t triangles = 0; // set up for rasterization, after clipping
+    size_t clipped = 0; // input triangles that crossed the near or far plane or the guard band
+    size_t binned = 0; // triangle and tile pairs
+};
+
+/// <summary>
+///
+/// CPU rendering backend for the template scene: the simple.vert transform (viewProjection * model * position) and
+/// the textureMix.frag shading (mix of two textures) without OpenGL, for machines without a GPU and as a reference
+/// that can be profiled like any other code.
+/// <para>draw() runs the vertex stage in batches of instances on the ThreadPool: the triangles are clipped in
+/// homogeneous space against the near and far plane and a guard band, snapped to 1/16 pixel and binned into tiles of
+/// TILE_SIZE pixels. render() then shades every tile on its own thread, walking the batches in submission order, so
+/// the result doesn't depend on the thread count.</para>
+/// <para>The edge functions are evaluated 8 pixels at a time with AVX2 (OPENGL_TEMPLATE_NATIVE), 4 pixels at a time
+/// with SSE2 (any x86-64 build, the covered pixels are shaded one by one since SSE2 can't gather texels) or by the
+/// scalar reference. They are computed exactly per tile in double, so neighboring triangles never overlap or leave gaps,
+/// shared edges follow the top left rule. Depth (GL_LESS, cleared to 1) and the texture coordinates are interpolated
+/// perspective correct, the textures are sampled like GL_LINEAR_MIPMAP_LINEAR with GL_REPEAT from their MipChain.
+/// Both sides of a triangle are drawn, like OpenGL without GL_CULL_FACE. Row 0 of the color buffer is the bottom.</para>
+/// <para>Usage per frame: beginFrame() -> setTextures() -> draw() ... -> render() -> getColor()/saveFramebuffer()</para>
+///
+/// </summary>
+class SoftwareRenderer
+{
+public:
+    static const int TILE_SIZE = 64;
+
+    SoftwareRenderer(unsigned int width, unsigned int height)
+        : width(static_cast<int>(std::max(width, 1U))), height(static_cast<int>(std::max(height, 1U))),
+        tilesX((this->width + TILE_SIZE - 1) / TILE_SIZE), tilesY((this->height + TILE_SIZE - 1) / TILE_SIZE)
+    {
+        color.resize(static_cast<size_t>(this->width) * this->height);
+        depth.resize(static_cast<size_t>(this->width) * this->height);
+        placeholder.width = placeholder.height = 1;
+        placeholder.levels.push_back(MipLevel{ 0, 1, 1 });
+        placeholder.data = { 128, 128, 128, 255 };
+        setTextures(NULL, NULL, 0.0f);
+        beginFrame(glm::vec4(0.0f));
+    }
+
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    /*
+    * @brief	drop the draws of the last frame, the buffers are cleared to clearColor and 1.0 in render()
+    */
+    void beginFrame(const glm::vec4& clearColor)
+    {
+        clearValue = packColor(clearColor * 255.0f);
+        draws.clear();
+        usedBatches = 0;
+        stats = SoftwareRenderStats();
+    }
+
+    /*
+    * @brief	textures of the next draws, like texture1, texture2 and visible of textureMix.frag.
+    *			The chains have to stay alive until render() returned, NULL samples a gray placeholder
+    */
+    void setTextures(const MipChain* texture1, const MipChain* texture2, float visible)
+    {
+        setSampler(texture1, state.samplers[0]);
+        setSampler(texture2, state.samplers[1]);
+        state.visible = visible;
+    }
+
+    /*
+    * @brief	queue instanceCount instances of the mesh, instance i is transformed by models[i]
+    */
+    void draw(const glm::mat4& viewProjection, const glm::mat4* models, size_t instanceCount, const SoftwareMesh& mesh, ThreadPool* pool = NULL)
+    {
+        size_t triangleCount = mesh.indices.size() / 3;
+        if (instanceCount == 0 || triangleCount == 0)
+        {
+            return;
+        }
+        unsigned int drawIndex = static_cast<unsigned int>(draws.size());
+        draws.push_back(state);
+
+        // the batches only depend on the draw, never on the thread count
+        size_t instancesPerBatch = std::max<size_t>(1, BATCH_TRIANGLES / triangleCount);
+        size_t batchCount = (instanceCount + instancesPerBatch - 1) / instancesPerBatch;
+        size_t firstBatch = usedBatches;
+        usedBatches += batchCount;
+        while (batches.size() < usedBatches)
+        {
+            batches.emplace_back();
+            batches.back().bins.resize(static_cast<size_t>(tilesX) * tilesY);
+        }
+        auto processBatch = [&](size_t b)
+        {
+            size_t first = b * instancesPerBatch;
+            processInstances(batches[firstBatch + b], viewProjection, models, first, std::min(instanceCount, first + instancesPerBatch), mesh, drawIndex);
+        };
+        if (pool != NULL)
+        {
+            pool->parallelFor(0, batchCount, processBatch, 1);
+        }
+        else
+        {
+            for (size_t b = 0; b < batchCount; b++)
+            {
+                processBatch(b);
+            }
+        }
+
+        stats.instances += instanceCount;
+        for (size_t b = firstBatch; b < usedBatches; b++)
+        {
+            stats.triangles += batches[b].triangles.size();
+            stats.clipped += batches[b].clipped;
+            stats.binned += batches[b].binned;
+        }
+    }
+
+    /*
+    * @brief	clear and shade every tile, one task per tile
+    *
+    * @param	simd	false: scalar reference implementation
+    */
+    void render(ThreadPool* pool = NULL, bool simd = true)
+    {
+        size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+        if (pool != NULL)
+        {
+            pool->parallelFor(0, tileCount, [&](size_t tile) { renderTile(tile, simd); }, 1);
+            return;
+        }
+        for (size_t tile = 0; tile < tileCount; tile++)
+        {
+            renderTile(tile, simd);
+        }
+    }
+
+    /*
+    * @brief	RGBA8 pixels packed as R | G << 8 | B << 16 | A << 24, bottom row first like glReadPixels
+    */
+    const std::vector<uint32_t>& getColor() const
+    {
+        return color;
+    }
+
+    const std::vector<float>& getDepth() const
+    {
+        return depth;
+    }
+
+    unsigned int getWidth() const
+    {
+        return static_cast<unsigned int>(width);
+    }
+
+    unsigned int getHeight() const
+    {
+        return static_cast<unsigned int>(height);
+    }
+
+    const SoftwareRenderStats& getStats() const
+    {
+        return stats;
+    }
+
+    /*
+    * @brief	write the color buffer as binary PPM (P6)
+    *
+    * @param	path	Path of the image file (E.g.: frame.ppm)
+    */
+    bool saveFramebuffer(const char* path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR couldn't write File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+        for (int y = height - 1; y >= 0; y--)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                uint32_t pixel = color[static_cast<size_t>(y) * width + x];
+                row[3 * x] = static_cast<unsigned char>(pixel);
+                row[3 * x + 1] = static_cast<unsigned char>(pixel >> 8);
+                row[3 * x + 2] = static_cast<unsigned char>(pixel >> 16);
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+        }
+        return true;
+    }
+
+private:
+    static constexpr float GUARD_BAND = 16.0f; // triangles are clipped at GUARD_BAND times the viewport, the snapped coordinates stay exact
+    static constexpr float SUBPIXEL_STEPS = 16.0f;
+    static const size_t BATCH_TRIANGLES = 4096; // input triangles per vertex stage task
+    static const int MAX_LEVELS = 16;
+
+    /// mip chain of a texture in the layout the gathers need
+    struct Sampler
+    {
+        const uint32_t* texels;
+        int levels;
+        float baseWidth, baseHeight;
+        int widths[MAX_LEVELS];
+        int heights[MAX_LEVELS];
+        int offsets[MAX_LEVELS]; // in texels
+    };
+
+    /// textures and uniforms of a draw
+    struct DrawState
+    {
+        Sampler samplers[2];
+        float visible;
+    };
+
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        glm::vec2 texCoord;
+    };
+
+    /// screen space plane of an interpolated value: value at the first vertex plus the gradient
+    struct Plane
+    {
+        float dx, dy, value;
+    };
+
+    struct Triangle
+    {
+        // edge function of edge e: edgeA * (x - edgeX) + edgeB * (y - edgeY), >= 0 inside
+        float edgeA[3], edgeB[3], edgeX[3], edgeY[3];
+        int topLeft[3]; // -1: pixel centers exactly on the edge belong to this triangle
+        float originX, originY; // first vertex, origin of the planes
+        Plane depth, inverseW, u, v; // u and v divided by w
+        int x0, y0, x1, y1; // pixel bounds, inclusive
+        unsigned int draw;
+    };
+
+    /// output of one vertex stage task, bins hold triangle indices per tile
+    struct Batch
+    {
+        std::vector<glm::vec4> clip;
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<unsigned int>> bins;
+        size_t clipped = 0;
+        size_t binned = 0;
+    };
+
+    int width, height;
+    int tilesX, tilesY;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+    uint32_t clearValue;
+    MipChain placeholder;
+    DrawState state;
+    std::vector<DrawState> draws;
+    std::vector<Batch> batches;
+    size_t usedBatches = 0;
+    SoftwareRenderStats stats;
+
+    void setSampler(const MipChain* chain, Sampler& sampler)
+    {
+        if (chain == NULL || chain->levels.empty())
+        {
+            chain = &placeholder;
+        }
+        sampler.texels = reinterpret_cast<const uint32_t*>(chain->data.data());
+        sampler.levels = std::min(static_cast<int>(chain->levels.size()), MAX_LEVELS);
+        sampler.baseWidth = static_cast<float>(chain->levels[0].width);
+        sampler.baseHeight = static_cast<float>(chain->levels[0].height);
+        for (int l = 0; l < MAX_LEVELS; l++)
+        {
+            const MipLevel& level = chain->levels[std::min(l, sampler.levels - 1)];
+            sampler.widths[l] = level.width;
+            sampler.heights[l] = level.height;
+            sampler.offsets[l] = static_cast<int>(level.offset / 4);
+        }
+    }
+
+    static uint32_t packColor(const glm::vec4& value)
+    {
+        uint32_t packed = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            int channel = static_cast<int>(std::nearbyint(value[c]));
+            packed |= static_cast<uint32_t>(std::min(std::max(channel, 0), 255)) << (8 * c);
+        }
+        return packed;
+    }
+
+    /*
+    * @brief	vertex stage, clipping, triangle setup and binning of the instances [first, last)
+    */
+    void processInstances(Batch& batch, const glm::mat4& viewProjection, const glm::mat4* models, size_t first, size_t last, const SoftwareMesh& mesh,
+        unsigned int drawIndex)
+    {
+        batch.triangles.clear();
+        for (std::vector<unsigned int>& bin : batch.bins)
+        {
+            bin.clear();
+        }
+        batch.clipped = 0;
+        batch.binned = 0;
+        batch.clip.resize(mesh.positions.size());
+        for (size_t instance = first; instance < last; instance++)
+        {
+            glm::mat4 modelViewProjection = viewProjection * models[instance];
+            for (size_t i = 0; i < mesh.positions.size(); i++)
+            {
+                batch.clip[i] = modelViewProjection * glm::vec4(mesh.positions[i], 1.0f);
+            }
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            {
+                ClipVertex triangle[3];
+                unsigned int outside = ~0U, crossing = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int index = mesh.indices[i + k];
+                    triangle[k].position = batch.clip[index];
+                    triangle[k].texCoord = index < mesh.texCoords.size() ? mesh.texCoords[index] : glm::vec2(0.0f);
+                    unsigned int code = getOutcode(triangle[k].position);
+                    outside &= code;
+                    crossing |= code;
+                }
+                if ((outside & VIEW_PLANES) != 0)
+                {
+                    continue; // completely outside one plane of the view frustum
+                }
+                if ((crossing & CLIP_PLANES) == 0)
+                {
+                    setupTriangle(batch, triangle[0], triangle[1], triangle[2], drawIndex);
+                    continue;
+                }
+                batch.clipped++;
+                ClipVertex polygon[MAX_POLYGON];
+                int count = clipTriangle(triangle, crossing, polygon);
+                for (int k = 1; k + 1 < count; k++)
+                {
+                    setupTriangle(batch, polygon[0], polygon[k], polygon[k + 1], drawIndex);
+                }
+            }
+        }
+    }
+
+    static const unsigned int VIEW_PLANES = 63; // -x, +x, -y, +y, near, far
+    static const unsigned int GUARD_BAND_BIT = 64;
+    static const unsigned int CLIP_PLANES = 16 | 32 | GUARD_BAND_BIT;
+    static const int MAX_POLYGON = 16;
+
+    static unsigned int getOutcode(const glm::vec4& p)
+    {
+        unsigned int code = (p.x < -p.w ? 1 : 0) | (p.x > p.w ? 2 : 0) | (p.y < -p.w ? 4 : 0) | (p.y > p.w ? 8 : 0)
+            | (p.z < -p.w ? 16 : 0) | (p.z > p.w ? 32 : 0);
+        float guard = GUARD_BAND * p.w;
+        if (p.x < -guard || p.x > guard || p.y < -guard || p.y > guard)
+        {
+            code |= GUARD_BAND_BIT;
+        }
+        return code;
+    }
+
+    /*
+    * @brief	Sutherland-Hodgman clipping in homogeneous space against the planes in crossing
+    *
+    * @return	returns the vertex count of the convex polygon
+    */
+    static int clipTriangle(const ClipVertex* triangle, unsigned int crossing, ClipVertex* polygon)
+    {
+        // distance functions, >= 0 inside: near, far, then the guard band
+        static const glm::vec4 PLANES[6] = {
+            glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+            glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND), glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+            glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND), glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND)
+        };
+        ClipVertex buffer[MAX_POLYGON];
+        ClipVertex* input = polygon;
+        ClipVertex* output = buffer;
+        int count = 3;
+        std::copy(triangle, triangle + 3, input);
+        for (int p = 0; p < 6 && count > 0; p++)
+        {
+            if ((p == 0 && !(crossing & 16)) || (p == 1 && !(crossing & 32)) || (p >= 2 && !(crossing & GUARD_BAND_BIT)))
+            {
+                continue;
+            }
+            int outputCount = 0;
+            for (int k = 0; k < count; k++)
+            {
+                const ClipVertex& from = input[k];
+                const ClipVertex& to = input[(k + 1) % count];
+                float fromDistance = glm::dot(PLANES[p], from.position);
+                float toDistance = glm::dot(PLANES[p], to.position);
+                if (fromDistance >= 0.0f)
+                {
+                    output[outputCount++] = from;
+                }
+                if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+                {
+                    float t = fromDistance / (fromDistance - toDistance);
+                    output[outputCount].position = from.position + (to.position - from.position) * t;
+                    output[outputCount].texCoord = from.texCoord + (to.texCoord - from.texCoord) * t;
+                    outputCount++;
+                }
+            }
+            std::swap(input, output);
+            count = outputCount;
+        }
+        if (input != polygon)
+        {
+            std::copy(input, input + count, polygon);
+        }
+        return count;
+    }
+
+    void setupTriangle(Batch& batch, const ClipVertex& vertex0, const ClipVertex& vertex1, const ClipVertex& vertex2, unsigned int drawIndex)
+    {
+        const ClipVertex* vertices[3] = { &vertex0, &vertex1, &vertex2 };
+        float x[3], y[3], z[3], inverseW[3], u[3], v[3];
+        for (int k = 0; k < 3; k++)
+        {
+            const glm::vec4& position = vertices[k]->position;
+            inverseW[k] = 1.0f / position.w;
+            // viewport transform like OpenGL, snapped to the subpixel grid
+            x[k] = std::floor((position.x * inverseW[k] * 0.5f + 0.5f) * width * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+            y[k] = std::floor((position.y * inverseW[k] * 0.5f + 0.5f) * height * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+            z[k] = position.z * inverseW[k] * 0.5f + 0.5f;
+            u[k] = vertices[k]->texCoord.x * inverseW[k];
+            v[k] = vertices[k]->texCoord.y * inverseW[k];
+        }
+        double area = (static_cast<double>(x[1]) - x[0]) * (static_cast<double>(y[2]) - y[0]) - (static_cast<double>(x[2]) - x[0]) * (static_cast<double>(y[1]) - y[0]);
+        if (area == 0.0)
+        {
+            return;
+        }
+        if (area < 0.0)
+        {
+            // clockwise, both sides are drawn: reorder to counter clockwise
+            for (float* values : { x, y, z, inverseW, u, v })
+            {
+                std::swap(values[1], values[2]);
+            }
+            area = -area;
+        }
+
+        Triangle triangle;
+        triangle.x0 = std::max(static_cast<int>(std::ceil(std::min(std::min(x[0], x[1]), x[2]) - 0.5f)), 0);
+        triangle.y0 = std::max(static_cast<int>(std::ceil(std::min(std::min(y[0], y[1]), y[2]) - 0.5f)), 0);
+        triangle.x1 = std::min(static_cast<int>(std::floor(std::max(std::max(x[0], x[1]), x[2]) - 0.5f)), width - 1);
+        triangle.y1 = std::min(static_cast<int>(std::floor(std::max(std::max(y[0], y[1]), y[2]) - 0.5f)), height - 1);
+        if (triangle.x0 > triangle.x1 || triangle.y0 > triangle.y1)
+        {
+            return;
+        }
+        for (int e = 0; e < 3; e++)
+        {
+            int next = (e + 1) % 3;
+            // the interior is on the left of the counter clockwise edges
+            triangle.edgeA[e] = y[e] - y[next];
+            triangle.edgeB[e] = x[next] - x[e];
+            triangle.edgeX[e] = x[e];
+            triangle.edgeY[e] = y[e];
+            bool topLeft = triangle.edgeA[e] > 0.0f || (triangle.edgeA[e] == 0.0f && triangle.edgeB[e] < 0.0f);
+            triangle.topLeft[e] = topLeft ? -1 : 0;
+        }
+        triangle.originX = x[0];
+        triangle.originY = y[0];
+        auto setPlane = [&](const float* values, Plane& plane)
+        {
+            double d1 = static_cast<double>(values[1]) - values[0], d2 = static_cast<double>(values[2]) - values[0];
+            plane.dx = static_cast<float>((d1 * (static_cast<double>(y[2]) - y[0]) - d2 * (static_cast<double>(y[1]) - y[0])) / area);
+            plane.dy = static_cast<float>(((static_cast<double>(x[1]) - x[0]) * d2 - (static_cast<double>(x[2]) - x[0]) * d1) / area);
+            plane.value = values[0];
+        };
+        setPlane(z, triangle.depth);
+        setPlane(inverseW, triangle.inverseW);
+        setPlane(u, triangle.u);
+        setPlane(v, triangle.v);
+        triangle.draw = drawIndex;
+
+        unsigned int index = static_cast<unsigned int>(batch.triangles.size());
+        batch.triangles.push_back(triangle);
+        for (int tileY = triangle.y0 / TILE_SIZE; tileY <= triangle.y1 / TILE_SIZE; tileY++)
+        {
+            for (int tileX = triangle.x0 / TILE_SIZE; tileX <= triangle.x1 / TILE_SIZE; tileX++)
+            {
+                batch.bins[static_cast<size_t>(tileY) * tilesX + tileX].push_back(index);
+                batch.binned++;
+            }
+        }
+    }
+
+    void renderTile(size_t tile, bool simd)
+    {
+        int left = static_cast<int>(tile % tilesX) * TILE_SIZE;
+        int bottom = static_cast<int>(tile / tilesX) * TILE_SIZE;
+        int right = std::min(left + TILE_SIZE, width) - 1;
+        int top = std::min(bottom + TILE_SIZE, height) - 1;
+        for (int y = bottom; y <= top; y++)
+        {
+            std::fill_n(&color[static_cast<size_t>(y) * width + left], right - left + 1, clearValue);
+            std::fill_n(&depth[static_cast<size_t>(y) * width + left], right - left + 1, 1.0f);
+        }
+        for (size_t b = 0; b < usedBatches; b++)
+        {
+            const Batch& batch = batches[b];
+            for (unsigned int index : batch.bins[tile])
+            {
+                const Triangle& triangle = batch.triangles[index];
+#if defined(SOFTWARE_RENDERER_AVX2)
+                if (simd)
+                {
+                    rasterizeSimd(triangle, left, bottom, right, top);
+                    continue;
+                }
+#elif defined(SOFTWARE_RENDERER_SSE2)
+                if (simd)
+                {
+                    rasterizeSse2(triangle, left, bottom, right, top);
+                    continue;
+                }
+#else
+                (void)simd;
+#endif
+                rasterize(triangle, left, bottom, right, top);
+            }
+        }
+    }
+
+    /*
+    * @brief	edge function at the pixel center (left, bottom) of a tile, exact in double and rounded once,
+    *			so the two triangles of a shared edge get exactly opposite values
+    */
+    static float getTileEdge(const Triangle& triangle, int e, int left, int bottom)
+    {
+        return static_cast<float>(static_cast<double>(triangle.edgeA[e]) * (left + 0.5 - triangle.edgeX[e])
+            + static_cast<double>(triangle.edgeB[e]) * (bottom + 0.5 - triangle.edgeY[e]));
+    }
+
+    /*
+    * @brief	value of the plane at the pixel center (x, y)
+    */
+    static float getPlaneValue(const Plane& plane, const Triangle& triangle, int x, int y)
+    {
+        return plane.value + plane.dx * (x + 0.5f - triangle.originX) + plane.dy * (y + 0.5f - triangle.originY);
+    }
+
+    static float fastLog2(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        float exponent = static_cast<float>(static_cast<int>((bits >> 23) & 255) - 127);
+        bits = (bits & 0x007FFFFF) | 0x3F800000;
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+        // polynomial fit of log2 on [1, 2)
+        return exponent + (-1.7417939f + (2.8212026f + (-1.4699568f + (0.44717955f - 0.056570851f * mantissa) * mantissa) * mantissa) * mantissa);
+    }
+
+    /// the 4 texels and the weights of a bilinear sample
+    struct Taps
+    {
+        uint32_t t00, t10, t01, t11;
+        float fx, fy;
+    };
+
+    /*
+    * @brief	texels of a bilinear sample of a mip level with GL_REPEAT
+    */
+    static Taps getTaps(const Sampler& sampler, int level, float u, float v)
+    {
+        int levelWidth = sampler.widths[level], levelHeight = sampler.heights[level];
+        float x = u * levelWidth - 0.5f, y = v * levelHeight - 0.5f;
+        float x0 = std::floor(x), y0 = std::floor(y);
+        float fx = x - x0, fy = y - y0;
+        int column0 = std::min(std::max(static_cast<int>(x0 - std::floor(x0 / levelWidth) * levelWidth), 0), levelWidth - 1);
+        int row0 = std::min(std::max(static_cast<int>(y0 - std::floor(y0 / levelHeight) * levelHeight), 0), levelHeight - 1);
+        int column1 = column0 + 1 == levelWidth ? 0 : column0 + 1;
+        int row1 = row0 + 1 == levelHeight ? 0 : row0 + 1;
+        const uint32_t* texels = sampler.texels + sampler.offsets[level];
+        Taps taps;
+        taps.t00 = texels[row0 * levelWidth + column0];
+        taps.t10 = texels[row0 * levelWidth + column1];
+        taps.t01 = texels[row1 * levelWidth + column0];
+        taps.t11 = texels[row1 * levelWidth + column1];
+        taps.fx = fx;
+        taps.fy = fy;
+        return taps;
+    }
+
+    /*
+    * @brief	bilinear sample of a mip level with GL_REPEAT, channels in [0, 255]
+    */
+    static void sampleLevel(const Sampler& sampler, int level, float u, float v, float* result)
+    {
+        Taps taps = getTaps(sampler, level, u, v);
+        for (int c = 0; c < 4; c++)
+        {
+            float c00 = static_cast<float>((taps.t00 >> (8 * c)) & 255), c10 = static_cast<float>((taps.t10 >> (8 * c)) & 255);
+            float c01 = static_cast<float>((taps.t01 >> (8 * c)) & 255), c11 = static_cast<float>((taps.t11 >> (8 * c)) & 255);
+            float bottom = c00 + (c10 - c00) * taps.fx;
+            float top = c01 + (c11 - c01) * taps.fx;
+            result[c] = bottom + (top - bottom) * taps.fy;
+        }
+    }
+
+    /*
+    * @brief	mip level (level0) and the weight of the next level (blend) for the screen space derivatives of the
+    *			texture coordinates
+    */
+    static void getLevel(const Sampler& sampler, float dudx, float dvdx, float dudy, float dvdy, int& level0, float& blend)
+    {
+        float dx = dudx * dudx * sampler.baseWidth * sampler.baseWidth + dvdx * dvdx * sampler.baseHeight * sampler.baseHeight;
+        float dy = dudy * dudy * sampler.baseWidth * sampler.baseWidth + dvdy * dvdy * sampler.baseHeight * sampler.baseHeight;
+        float lod = 0.5f * fastLog2(std::max(dx, dy));
+        float level = std::min(std::max(lod, 0.0f), static_cast<float>(sampler.levels - 1));
+        level0 = static_cast<int>(level);
+        blend = level - static_cast<float>(level0);
+    }
+
+    /*
+    * @brief	trilinear sample, the level of detail comes from the screen space derivatives of the texture coordinates
+    */
+    static void sample(const Sampler& sampler, float u, float v, float dudx, float dvdx, float dudy, float dvdy, float* result)
+    {
+        int level0;
+        float blend;
+        getLevel(sampler, dudx, dvdx, dudy, dvdy, level0, blend);
+        sampleLevel(sampler, level0, u, v, result);
+        if (blend > 0.0f)
+        {
+            float next[4];
+            sampleLevel(sampler, std::min(level0 + 1, sampler.levels - 1), u, v, next);
+            for (int c = 0; c < 4; c++)
+            {
+                result[c] += (next[c] - result[c]) * blend;
+            }
+        }
+    }
+
+    /*
+    * @brief	scalar reference of rasterizeSimd()
+    */
+    void rasterize(const Triangle& triangle, int left, int bottom, int right, int top)
+    {
+        int x0 = std::max(triangle.x0, left), x1 = std::min(triangle.x1, right);
+        int y0 = std::max(triangle.y0, bottom), y1 = std::min(triangle.y1, top);
+        float tileEdges[3];
+        for (int e = 0; e < 3; e++)
+        {
+            tileEdges[e] = getTileEdge(triangle, e, left, bottom);
+        }
+        const DrawState& draw = draws[triangle.draw];
+        for (int y = y0; y <= y1; y++)
+        {
+            float rowEdges[3];
+            for (int e = 0; e < 3; e++)
+            {
+                rowEdges[e] = tileEdges[e] + triangle.edgeB[e] * static_cast<float>(y - bottom);
+            }
+            float rowDepth = getPlaneValue(triangle.depth, triangle, left, y);
+            float rowInverseW = getPlaneValue(triangle.inverseW, triangle, left, y);
+            float rowU = getPlaneValue(triangle.u, triangle, left, y);
+            float rowV = getPlaneValue(triangle.v, triangle, left, y);
+            for (int x = x0; x <= x1; x++)
+            {
+                float dx = static_cast<float>(x - left);
+                bool inside = true;
+                for (int e = 0; e < 3; e++)
+                {
+                    float edge = rowEdges[e] + triangle.edgeA[e] * dx;
+                    inside = inside && (edge > 0.0f || (edge == 0.0f && triangle.topLeft[e] != 0));
+                }
+                if (!inside)
+                {
+                    continue;
+                }
+                size_t pixel = static_cast<size_t>(y) * width + x;
+                float z = rowDepth + triangle.depth.dx * dx;
+                if (!(z < depth[pixel]))
+                {
+                    continue;
+                }
+                depth[pixel] = z;
+                color[pixel] = shade(triangle, draw, rowInverseW, rowU, rowV, dx);
+            }
+        }
+    }
+
+    /*
+    * @brief	textureMix.frag at the pixel dx to the right of the tile's left edge, rowInverseW, rowU and rowV are
+    *			the planes at the tile's left edge
+    */
+    static uint32_t shade(const Triangle& triangle, const DrawState& draw, float rowInverseW, float rowU, float rowV, float dx)
+    {
+        float inverseW = rowInverseW + triangle.inverseW.dx * dx;
+        float w = 1.0f / inverseW;
+        float u = (rowU + triangle.u.dx * dx) * w;
+        float v = (rowV + triangle.v.dx * dx) * w;
+        // derivatives of u = (u / w) / (1 / w)
+        float dudx = (triangle.u.dx - u * triangle.inverseW.dx) * w;
+        float dvdx = (triangle.v.dx - v * triangle.inverseW.dx) * w;
+        float dudy = (triangle.u.dy - u * triangle.inverseW.dy) * w;
+        float dvdy = (triangle.v.dy - v * triangle.inverseW.dy) * w;
+        float texel1[4], texel2[4];
+        sample(draw.samplers[0], u, v, dudx, dvdx, dudy, dvdy, texel1);
+        sample(draw.samplers[1], u, v, dudx, dvdx, dudy, dvdy, texel2);
+        glm::vec4 mixed;
+        for (int c = 0; c < 4; c++)
+        {
+            mixed[c] = texel1[c] + (texel2[c] - texel1[c]) * draw.visible;
+        }
+        return packColor(mixed);
+    }
+
+#if defined(SOFTWARE_RENDERER_SSE2)
+    static __m128 unpackTexel(uint32_t texel)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(texel));
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+    }
+
+    /*
+    * @brief	sampleLevel() with the 4 channels in one register
+    */
+    static __m128 sampleLevelSse2(const Sampler& sampler, int level, float u, float v)
+    {
+        Taps taps = getTaps(sampler, level, u, v);
+        __m128 c00 = unpackTexel(taps.t00), c10 = unpackTexel(taps.t10);
+        __m128 c01 = unpackTexel(taps.t01), c11 = unpackTexel(taps.t11);
+        __m128 fx = _mm_set1_ps(taps.fx);
+        __m128 bottom = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fx));
+        __m128 top = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fx));
+        return _mm_add_ps(bottom, _mm_mul_ps(_mm_sub_ps(top, bottom), _mm_set1_ps(taps.fy)));
+    }
+
+    static __m128 sampleSse2(const Sampler& sampler, float u, float v, float dudx, float dvdx, float dudy, float dvdy)
+    {
+        int level0;
+        float blend;
+        getLevel(sampler, dudx, dvdx, dudy, dvdy, level0, blend);
+        __m128 result = sampleLevelSse2(sampler, level0, u, v);
+        if (blend > 0.0f)
+        {
+            __m128 next = sampleLevelSse2(sampler, std::min(level0 + 1, sampler.levels - 1), u, v);
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_sub_ps(next, result), _mm_set1_ps(blend)));
+        }
+        return result;
+    }
+
+    /*
+    * @brief	shade() with the channels of a texel in one register, rounds and clamps like packColor()
+    */
+    static uint32_t shadeSse2(const Triangle& triangle, const DrawState& draw, float rowInverseW, float rowU, float rowV, float dx)
+    {
+        float inverseW = rowInverseW + triangle.inverseW.dx * dx;
+        float w = 1.0f / inverseW;
+        float u = (rowU + triangle.u.dx * dx) * w;
+        float v = (rowV + triangle.v.dx * dx) * w;
+        float dudx = (triangle.u.dx - u * triangle.inverseW.dx) * w;
+        float dvdx = (triangle.v.dx - v * triangle.inverseW.dx) * w;
+        float dudy = (triangle.u.dy - u * triangle.inverseW.dy) * w;
+        float dvdy = (triangle.v.dy - v * triangle.inverseW.dy) * w;
+        __m128 texel1 = sampleSse2(draw.samplers[0], u, v, dudx, dvdx, dudy, dvdy);
+        __m128 texel2 = sampleSse2(draw.samplers[1], u, v, dudx, dvdx, dudy, dvdy);
+        __m128 mixed = _mm_add_ps(texel1, _mm_mul_ps(_mm_sub_ps(texel2, texel1), _mm_set1_ps(draw.visible)));
+        // round to nearest even like std::nearbyint, the saturating packs clamp to [0, 255]
+        __m128i channels = _mm_cvtps_epi32(mixed);
+        channels = _mm_packs_epi32(channels, channels);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(channels, channels)));
+    }
+
+    /*
+    * @brief	rasterize the part of the triangle inside the tile with the edge functions and the depth test 4 pixels
+    *			of a row at a time, the covered pixels are shaded one by one with shadeSse2()
+    */
+    void rasterizeSse2(const Triangle& triangle, int left, int bottom, int right, int top)
+    {
+        int x0 = std::max(triangle.x0, left), x1 = std::min(triangle.x1, right);
+        int y0 = std::max(triangle.y0, bottom), y1 = std::min(triangle.y1, top);
+        const DrawState& draw = draws[triangle.draw];
+        const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+        __m128 edgeA[3];
+        __m128i topLeft[3];
+        float tileEdges[3];
+        for (int e = 0; e < 3; e++)
+        {
+            edgeA[e] = _mm_set1_ps(triangle.edgeA[e]);
+            topLeft[e] = _mm_set1_epi32(triangle.topLeft[e]);
+            tileEdges[e] = getTileEdge(triangle, e, left, bottom);
+        }
+        __m128 depthDx = _mm_set1_ps(triangle.depth.dx);
+        for (int y = y0; y <= y1; y++)
+        {
+            __m128 rowEdges[3];
+            for (int e = 0; e < 3; e++)
+            {
+                rowEdges[e] = _mm_set1_ps(tileEdges[e] + triangle.edgeB[e] * static_cast<float>(y - bottom));
+            }
+            __m128 rowDepth = _mm_set1_ps(getPlaneValue(triangle.depth, triangle, left, y));
+            float rowInverseW = getPlaneValue(triangle.inverseW, triangle, left, y);
+            float rowU = getPlaneValue(triangle.u, triangle, left, y);
+            float rowV = getPlaneValue(triangle.v, triangle, left, y);
+            for (int x = x0; x <= x1; x += 4)
+            {
+                __m128 dx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - left)), lanes);
+                __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(x1 - x + 1), laneIndices);
+                for (int e = 0; e < 3; e++)
+                {
+                    __m128 edge = _mm_add_ps(rowEdges[e], _mm_mul_ps(edgeA[e], dx));
+                    __m128i inside = _mm_castps_si128(_mm_cmpgt_ps(edge, _mm_setzero_ps()));
+                    __m128i onEdge = _mm_and_si128(_mm_castps_si128(_mm_cmpeq_ps(edge, _mm_setzero_ps())), topLeft[e]);
+                    mask = _mm_and_si128(mask, _mm_or_si128(inside, onEdge));
+                }
+                if (_mm_movemask_ps(_mm_castsi128_ps(mask)) == 0)
+                {
+                    continue;
+                }
+                size_t pixel = static_cast<size_t>(y) * width + x;
+                __m128 z = _mm_add_ps(rowDepth, _mm_mul_ps(depthDx, dx));
+                // at the right edge of the tile the lanes past it are masked, don't read them past the end of the buffer
+                __m128 stored;
+                if (x + 3 <= right)
+                {
+                    stored = _mm_loadu_ps(&depth[pixel]);
+                }
+                else
+                {
+                    float row[4] = {};
+                    std::copy(&depth[pixel], &depth[pixel] + (right - x + 1), row);
+                    stored = _mm_loadu_ps(row);
+                }
+                int covered = _mm_movemask_ps(_mm_and_ps(_mm_castsi128_ps(mask), _mm_cmplt_ps(z, stored)));
+                if (covered == 0)
+                {
+                    continue;
+                }
+                float depths[4];
+                _mm_storeu_ps(depths, z);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if ((covered >> lane) & 1)
+                    {
+                        depth[pixel + lane] = depths[lane];
+                        color[pixel + lane] = shadeSse2(triangle, draw, rowInverseW, rowU, rowV, static_cast<float>(x - left + lane));
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+#if defined(SOFTWARE_RENDERER_AVX2)
+    static __m256 fastLog2(__m256 value)
+    {
+        __m256i bits = _mm256_castps_si256(value);
+        __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(255)), _mm256_set1_epi32(127)));
+        __m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+        __m256 polynomial = _mm256_sub_ps(_mm256_set1_ps(0.44717955f), _mm256_mul_ps(_mm256_set1_ps(0.056570851f), mantissa));
+        polynomial = _mm256_add_ps(_mm256_set1_ps(-1.4699568f), _mm256_mul_ps(polynomial, mantissa));
+        polynomial = _mm256_add_ps(_mm256_set1_ps(2.8212026f), _mm256_mul_ps(polynomial, mantissa));
+        polynomial = _mm256_add_ps(_mm256_set1_ps(-1.7417939f), _mm256_mul_ps(polynomial, mantissa));
+        return _mm256_add_ps(exponent, polynomial);
+    }
+
+    /*
+    * @brief	8 bilinear samples with GL_REPEAT, every lane may read another level. Out of range inputs are clamped,
+    *			so the gathers of inactive lanes stay inside the texture
+    */
+    static void sampleLevel(const Sampler& sampler, __m256i level, __m256 u, __m256 v, __m256* result)
+    {
+        __m256i levelWidth = _mm256_i32gather_epi32(sampler.widths, level, 4);
+        __m256i levelHeight = _mm256_i32gather_epi32(sampler.heights, level, 4);
+        __m256i offset = _mm256_i32gather_epi32(sampler.offsets, level, 4);
+        __m256 widthFloat = _mm256_cvtepi32_ps(levelWidth), heightFloat = _mm256_cvtepi32_ps(levelHeight);
+        __m256 x = _mm256_sub_ps(_mm256_mul_ps(u, widthFloat), _mm256_set1_ps(0.5f));
+        __m256 y = _mm256_sub_ps(_mm256_mul_ps(v, heightFloat), _mm256_set1_ps(0.5f));
+        __m256 x0 = _mm256_floor_ps(x), y0 = _mm256_floor_ps(y);
+        __m256 fx = _mm256_sub_ps(x, x0), fy = _mm256_sub_ps(y, y0);
+        __m256i one = _mm256_set1_epi32(1);
+        __m256i column0 = _mm256_cvttps_epi32(_mm256_sub_ps(x0, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(x0, widthFloat)), widthFloat)));
+        __m256i row0 = _mm256_cvttps_epi32(_mm256_sub_ps(y0, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(y0, heightFloat)), heightFloat)));
+        column0 = _mm256_min_epi32(_mm256_max_epi32(column0, _mm256_setzero_si256()), _mm256_sub_epi32(levelWidth, one));
+        row0 = _mm256_min_epi32(_mm256_max_epi32(row0, _mm256_setzero_si256()), _mm256_sub_epi32(levelHeight, one));
+        __m256i column1 = _mm256_add_epi32(column0, one);
+        column1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(column1, levelWidth), column1);
+        __m256i row1 = _mm256_add_epi32(row0, one);
+        row1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(row1, levelHeight), row1);
+        __m256i start0 = _mm256_add_epi32(offset, _mm256_mullo_epi32(row0, levelWidth));
+        __m256i start1 = _mm256_add_epi32(offset, _mm256_mullo_epi32(row1, levelWidth));
+        const int* texels = reinterpret_cast<const int*>(sampler.texels);
+        __m256i t00 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(start0, column0), 4);
+        __m256i t10 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(start0, column1), 4);
+        __m256i t01 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(start1, column0), 4);
+        __m256i t11 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(start1, column1), 4);
+        __m256i byte = _mm256_set1_epi32(255);
+        for (int c = 0; c < 4; c++)
+        {
+            __m128i shift = _mm_cvtsi32_si128(8 * c);
+            __m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(t00, shift), byte));
+            __m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(t10, shift), byte));
+            __m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(t01, shift), byte));
+            __m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(t11, shift), byte));
+            __m256 bottom = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), fx));
+            __m256 top = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), fx));
+            result[c] = _mm256_add_ps(bottom, _mm256_mul_ps(_mm256_sub_ps(top, bottom), fy));
+        }
+    }
+
+    static void sample(const Sampler& sampler, __m256 u, __m256 v, __m256 dudx, __m256 dvdx, __m256 dudy, __m256 dvdy, __m256* result)
+    {
+        __m256 width2 = _mm256_set1_ps(sampler.baseWidth * sampler.baseWidth), height2 = _mm256_set1_ps(sampler.baseHeight * sampler.baseHeight);
+        __m256 dx = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(dudx, dudx), width2), _mm256_mul_ps(_mm256_mul_ps(dvdx, dvdx), height2));
+        __m256 dy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(dudy, dudy), width2), _mm256_mul_ps(_mm256_mul_ps(dvdy, dvdy), height2));
+        __m256 lod = _mm256_mul_ps(_mm256_set1_ps(0.5f), fastLog2(_mm256_max_ps(dx, dy)));
+        // NaN in inactive lanes ends up as level 0
+        __m256 level = _mm256_min_ps(_mm256_max_ps(lod, _mm256_setzero_ps()), _mm256_set1_ps(static_cast<float>(sampler.levels - 1)));
+        __m256i level0 = _mm256_cvttps_epi32(level);
+        __m256 blend = _mm256_sub_ps(level, _mm256_cvtepi32_ps(level0));
+        sampleLevel(sampler, level0, u, v, result);
+        if (_mm256_movemask_ps(_mm256_cmp_ps(blend, _mm256_setzero_ps(), _CMP_GT_OQ)) != 0)
+        {
+            __m256 next[4];
+            __m256i level1 = _mm256_min_epi32(_mm256_add_epi32(level0, _mm256_set1_epi32(1)), _mm256_set1_epi32(sampler.levels - 1));
+            sampleLevel(sampler, level1, u, v, next);
+            for (int c = 0; c < 4; c++)
+            {
+                result[c] = _mm256_add_ps(result[c], _mm256_mul_ps(_mm256_sub_ps(next[c], result[c]), blend));
+            }
+        }
+    }
+
+    /*
+    * @brief	rasterize and shade the part of the triangle inside the tile, 8 pixels of a row at a time
+    */
+    void rasterizeSimd(const Triangle& triangle, int left, int bottom, int right, int top)
+    {
+        int x0 = std::max(triangle.x0, left), x1 = std::min(triangle.x1, right);
+        int y0 = std::max(triangle.y0, bottom), y1 = std::min(triangle.y1, top);
+        const DrawState& draw = draws[triangle.draw];
+        const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256 edgeA[3];
+        __m256i topLeft[3];
+        float tileEdges[3];
+        for (int e = 0; e < 3; e++)
+        {
+            edgeA[e] = _mm256_set1_ps(triangle.edgeA[e]);
+            topLeft[e] = _mm256_set1_epi32(triangle.topLeft[e]);
+            tileEdges[e] = getTileEdge(triangle, e, left, bottom);
+        }
+        __m256 visible = _mm256_set1_ps(draw.visible);
+        for (int y = y0; y <= y1; y++)
+        {
+            __m256 rowEdges[3];
+            for (int e = 0; e < 3; e++)
+            {
+                rowEdges[e] = _mm256_set1_ps(tileEdges[e] + triangle.edgeB[e] * static_cast<float>(y - bottom));
+            }
+            __m256 rowDepth = _mm256_set1_ps(getPlaneValue(triangle.depth, triangle, left, y));
+            __m256 rowInverseW = _mm256_set1_ps(getPlaneValue(triangle.inverseW, triangle, left, y));
+            __m256 rowU = _mm256_set1_ps(getPlaneValue(triangle.u, triangle, left, y));
+            __m256 rowV = _mm256_set1_ps(getPlaneValue(triangle.v, triangle, left, y));
+            for (int x = x0; x <= x1; x += 8)
+            {
+                __m256 dx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - left)), lanes);
+                __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(x1 - x + 1), laneIndices);
+                for (int e = 0; e < 3; e++)
+                {
+                    __m256 edge = _mm256_add_ps(rowEdges[e], _mm256_mul_ps(edgeA[e], dx));
+                    __m256i inside = _mm256_castps_si256(_mm256_cmp_ps(edge, _mm256_setzero_ps(), _CMP_GT_OQ));
+                    __m256i onEdge = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(edge, _mm256_setzero_ps(), _CMP_EQ_OQ)), topLeft[e]);
+                    mask = _mm256_and_si256(mask, _mm256_or_si256(inside, onEdge));
+                }
+                if (_mm256_testz_si256(mask, mask))
+                {
+                    continue;
+                }
+                size_t pixel = static_cast<size_t>(y) * width + x;
+                __m256 z = _mm256_add_ps(rowDepth, _mm256_mul_ps(_mm256_set1_ps(triangle.depth.dx), dx));
+                __m256 stored = _mm256_maskload_ps(&depth[pixel], mask);
+                mask = _mm256_and_si256(mask, _mm256_castps_si256(_mm256_cmp_ps(z, stored, _CMP_LT_OQ)));
+                if (_mm256_testz_si256(mask, mask))
+                {
+                    continue;
+                }
+                __m256 inverseW = _mm256_add_ps(rowInverseW, _mm256_mul_ps(_mm256_set1_ps(triangle.inverseW.dx), dx));
+                __m256 w = _mm256_div_ps(_mm256_set1_ps(1.0f), inverseW);
+                __m256 u = _mm256_mul_ps(_mm256_add_ps(rowU, _mm256_mul_ps(_mm256_set1_ps(triangle.u.dx), dx)), w);
+                __m256 v = _mm256_mul_ps(_mm256_add_ps(rowV, _mm256_mul_ps(_mm256_set1_ps(triangle.v.dx), dx)), w);
+                __m256 dudx = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(triangle.u.dx), _mm256_mul_ps(u, _mm256_set1_ps(triangle.inverseW.dx))), w);
+                __m256 dvdx = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(triangle.v.dx), _mm256_mul_ps(v, _mm256_set1_ps(triangle.inverseW.dx))), w);
+                __m256 dudy = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(triangle.u.dy), _mm256_mul_ps(u, _mm256_set1_ps(triangle.inverseW.dy))), w);
+                __m256 dvdy = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(triangle.v.dy), _mm256_mul_ps(v, _mm256_set1_ps(triangle.inverseW.dy))), w);
+                __m256 texel1[4], texel2[4];
+                sample(draw.samplers[0], u, v, dudx, dvdx, dudy, dvdy, texel1);
+                sample(draw.samplers[1], u, v, dudx, dvdx, dudy, dvdy, texel2);
+                __m256i packed = _mm256_setzero_si256();
+                for (int c = 0; c < 4; c++)
+                {
+                    __m256 mixed = _mm256_add_ps(texel1[c], _mm256_mul_ps(_mm256_sub_ps(texel2[c], texel1[c]), visible));
+                    __m256i channel = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvtps_epi32(mixed), _mm256_setzero_si256()), _mm256_set1_epi32(255));
+                    packed = _mm256_or_si256(packed, _mm256_sll_epi32(channel, _mm_cvtsi32_si128(8 * c)));
+                }
+                _mm256_maskstore_ps(&depth[pixel], mask, z);
+                _mm256_maskstore_epi32(reinterpret_cast<int*>(&color[pixel]), mask, packed);
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// GL_EXT_texture_compression_s3tc / GL_EXT_texture_sRGB, not part of the preinstalled glad
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+/// one mip level inside CompressedImage::data
+struct CompressedLevel
+{
+    size_t offset = 0;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/// block compressed texture with its mip chain, level 0 is the largest
+struct CompressedImage
+{
+    GLenum internalFormat = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<CompressedLevel> levels;
+    std::vector<unsigned char> data;
+
+    size_t getByteSize() const
+    {
+        return data.size();
+    }
+};
+
+/// <summary>
+///
+/// Reads KTX2 and DDS containers with block compressed (BCn, ETC2) 2D textures and writes DDS.
+/// <para>Only single layer, single face textures without supercompression are supported. Rows are taken as they are
+/// stored, the textures of this project are stored bottom row first like OpenGL expects (see tools/textureCompressor.cpp).</para>
+///
+/// </summary>
+class TextureContainer
+{
+public:
+    /*
+    * @brief	bytes of one 4x4 block of a compressed format, 0 if the format is not supported
+    */
+    static unsigned int getBlockSize(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+        case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    /*
+    * @brief	bytes of a mip level, every dimension is rounded up to whole 4x4 blocks
+    */
+    static size_t getLevelSize(GLenum internalFormat, int width, int height)
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(internalFormat);
+    }
+
+    /*
+    * @brief	true if the path ends with .ktx2 or .dds
+    */
+    static bool isContainer(const std::string& path)
+    {
+        return endsWith(path, ".ktx2") || endsWith(path, ".dds") || endsWith(path, ".KTX2") || endsWith(path, ".DDS");
+    }
+
+    /*
+    * @brief	parse a KTX2 or DDS file that is already in memory
+    *
+    * @return	returns false and prints the reason if the file is invalid or uses an unsupported format
+    */
+    static bool parse(const unsigned char* file, size_t size, CompressedImage& image, const char* path = "")
+    {
+        if (size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(file, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+        {
+            return parseKTX2(file, size, image, path);
+        }
+        if (size >= 4 && std::memcmp(file, "DDS ", 4) == 0)
+        {
+            return parseDDS(file, size, image, path);
+        }
+        std::cout << "ERROR Texture container: unknown file format (Path: " << path << " )" << std::endl;
+        return false;
+    }
+
+    static bool load(const char* path, CompressedImage& image)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            std::cout << "ERROR couldn't read File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return parse(bytes.data(), bytes.size(), image, path);
+    }
+
+    /*
+    * @brief	write the image as DDS, BC7 and sRGB formats use the DX10 extension header
+    */
+    static bool saveDDS(const char* path, const CompressedImage& image)
+    {
+        uint32_t fourCC = 0, dxgiFormat = 0;
+        if (!getDDSFormat(image.internalFormat, fourCC, dxgiFormat))
+        {
+            std::cout << "ERROR Texture container: the format 0x" << std::hex << image.internalFormat << std::dec << " can't be stored as DDS" << std::endl;
+            return false;
+        }
+        uint32_t header[31] = {};
+        header[0] = 124; // dwSize
+        header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | (image.levels.size() > 1 ? DDSD_MIPMAPCOUNT : 0);
+        header[2] = image.height;
+        header[3] = image.width;
+        header[4] = static_cast<uint32_t>(image.levels.empty() ? 0 : image.levels[0].size);
+        header[6] = static_cast<uint32_t>(image.levels.size());
+        header[18] = 32; // DDS_PIXELFORMAT::dwSize
+        header[19] = DDPF_FOURCC;
+        header[20] = fourCC;
+        header[26] = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR couldn't write File (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        file.write("DDS ", 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        if (fourCC == makeFourCC("DX10"))
+        {
+            const uint32_t dx10[5] = { dxgiFormat, DDS_DIMENSION_TEXTURE2D, 0, 1, 0 };
+            file.write(reinterpret_cast<const char*>(dx10), sizeof(dx10));
+        }
+        file.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+        return static_cast<bool>(file);
+    }
+
+private:
+    static constexpr unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    static const uint32_t DDSD_CAPS = 0x1;
+    static const uint32_t DDSD_HEIGHT = 0x2;
+    static const uint32_t DDSD_WIDTH = 0x4;
+    static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+    static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    static const uint32_t DDSD_LINEARSIZE = 0x80000;
+    static const uint32_t DDPF_FOURCC = 0x4;
+    static const uint32_t DDSCAPS_COMPLEX = 0x8;
+    static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+    static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+    static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+    static bool endsWith(const std::string& text, const char* suffix)
+    {
+        size_t length = std::strlen(suffix);
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+
+    static uint32_t makeFourCC(const char* code)
+    {
+        return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 | static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+    }
+
+    template<class T>
+    static T read(const unsigned char* data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    /*
+    * @return	returns the number of levels of a full mip chain down to 1x1, 0 if the size is empty or too large
+    */
+    static unsigned int getFullLevelCount(uint32_t width, uint32_t height)
+    {
+        const uint32_t MAX_SIZE = 1U << 16; // larger than any GL_MAX_TEXTURE_SIZE, keeps the level sizes in range
+        if (width == 0 || height == 0 || width > MAX_SIZE || height > MAX_SIZE)
+        {
+            return 0;
+        }
+        unsigned int count = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    /*
+    * @brief	fill image.levels with a tightly packed mip chain and check that it fits into the file
+    */
+    static bool addLevels(CompressedImage& image, unsigned int levelCount, size_t dataSize, const char* path)
+    {
+        size_t offset = 0;
+        int width = image.width, height = image.height;
+        for (unsigned int i = 0; i < levelCount; i++)
+        {
+            CompressedLevel level;
+            level.offset = offset;
+            level.size = getLevelSize(image.internalFormat, width, height);
+            level.width = width;
+            level.height = height;
+            offset += level.size;
+            if (offset > dataSize)
+            {
+                std::cout << "ERROR Texture container: file is truncated (Path: " << path << " )" << std::endl;
+                return false;
+            }
+            image.levels.push_back(level);
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        return true;
+    }
+
+    static GLenum getVkFormat(uint32_t vkFormat)
+    {
+        switch (vkFormat)
+        {
+        case 131: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;              // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case 132: return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;             // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        case 133: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;             // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+        case 134: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;       // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+        case 135: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;             // VK_FORMAT_BC2_UNORM_BLOCK
+        case 136: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;       // VK_FORMAT_BC2_SRGB_BLOCK
+        case 137: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;             // VK_FORMAT_BC3_UNORM_BLOCK
+        case 138: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;       // VK_FORMAT_BC3_SRGB_BLOCK
+        case 139: return GL_COMPRESSED_RED_RGTC1;                      // VK_FORMAT_BC4_UNORM_BLOCK
+        case 140: return GL_COMPRESSED_SIGNED_RED_RGTC1;               // VK_FORMAT_BC4_SNORM_BLOCK
+        case 141: return GL_COMPRESSED_RG_RGTC2;                       // VK_FORMAT_BC5_UNORM_BLOCK
+        case 142: return GL_COMPRESSED_SIGNED_RG_RGTC2;                // VK_FORMAT_BC5_SNORM_BLOCK
+        case 145: return GL_COMPRESSED_RGBA_BPTC_UNORM;                // VK_FORMAT_BC7_UNORM_BLOCK
+        case 146: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;          // VK_FORMAT_BC7_SRGB_BLOCK
+        case 147: return GL_COMPRESSED_RGB8_ETC2;                      // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+        case 148: return GL_COMPRESSED_SRGB8_ETC2;                     // VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK
+        case 149: return GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2;  // VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK
+        case 150: return GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2; // VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK
+        case 151: return GL_COMPRESSED_RGBA8_ETC2_EAC;                 // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+        case 152: return GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;          // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+        default: return 0;
+        }
+    }
+
+    static bool parseKTX2(const unsigned char* file, size_t size, CompressedImage& image, const char* path)
+    {
+        const size_t headerSize = 80; // identifier, header and index without the level index
+        if (size < headerSize)
+        {
+            std::cout << "ERROR Texture container: file is truncated (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        uint32_t vkFormat = read<uint32_t>(file + 12);
+        uint32_t pixelWidth = read<uint32_t>(file + 20);
+        uint32_t pixelHeight = read<uint32_t>(file + 24);
+        uint32_t pixelDepth = read<uint32_t>(file + 28);
+        uint32_t layerCount = read<uint32_t>(file + 32);
+        uint32_t faceCount = read<uint32_t>(file + 36);
+        uint32_t levelCount = std::max(1U, read<uint32_t>(file + 40));
+        uint32_t supercompression = read<uint32_t>(file + 44);
+        if (pixelDepth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0)
+        {
+            std::cout << "ERROR Texture container: only plain 2D KTX2 textures without supercompression are supported (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        image.internalFormat = getVkFormat(vkFormat);
+        if (image.internalFormat == 0)
+        {
+            std::cout << "ERROR Texture container: unsupported KTX2 vkFormat " << vkFormat << " (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        if (size < headerSize + levelCount * 24ULL)
+        {
+            std::cout << "ERROR Texture container: file is truncated (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        unsigned int fullLevels = getFullLevelCount(pixelWidth, std::max(1U, pixelHeight));
+        if (fullLevels == 0 || levelCount > fullLevels)
+        {
+            std::cout << "ERROR Texture container: invalid size or level count (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        image.width = static_cast<int>(pixelWidth);
+        image.height = static_cast<int>(std::max(1U, pixelHeight));
+
+        // KTX2 may store the levels in any order (usually smallest first), repack them largest first
+        size_t total = 0;
+        image.levels.clear();
+        int width = image.width, height = image.height;
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            const unsigned char* entry = file + headerSize + i * 24;
+            uint64_t byteOffset = read<uint64_t>(entry);
+            uint64_t byteLength = read<uint64_t>(entry + 8);
+            CompressedLevel level;
+            level.offset = total;
+            level.size = getLevelSize(image.internalFormat, width, height);
+            level.width = width;
+            level.height = height;
+            if (byteLength < level.size || byteOffset > size || byteOffset + level.size > size)
+            {
+                std::cout << "ERROR Texture container: level " << i << " is out of bounds (Path: " << path << " )" << std::endl;
+                return false;
+            }
+            total += level.size;
+            image.levels.push_back(level);
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        image.data.resize(total);
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            uint64_t byteOffset = read<uint64_t>(file + headerSize + i * 24);
+            std::memcpy(image.data.data() + image.levels[i].offset, file + byteOffset, image.levels[i].size);
+        }
+        return true;
+    }
+
+    static bool getDDSFormat(GLenum internalFormat, uint32_t& fourCC, uint32_t& dxgiFormat)
+    {
+        fourCC = makeFourCC("DX10");
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: fourCC = makeFourCC("DXT1"); dxgiFormat = 71; return true;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: fourCC = makeFourCC("DXT3"); dxgiFormat = 74; return true;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: fourCC = makeFourCC("DXT5"); dxgiFormat = 77; return true;
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: dxgiFormat = 72; return true;
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: dxgiFormat = 75; return true;
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: dxgiFormat = 78; return true;
+        case GL_COMPRESSED_RED_RGTC1: dxgiFormat = 80; return true;
+        case GL_COMPRESSED_SIGNED_RED_RGTC1: dxgiFormat = 81; return true;
+        case GL_COMPRESSED_RG_RGTC2: dxgiFormat = 83; return true;
+        case GL_COMPRESSED_SIGNED_RG_RGTC2: dxgiFormat = 84; return true;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM: dxgiFormat = 98; return true;
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM: dxgiFormat = 99; return true;
+        default: return false;
+        }
+    }
+
+    static GLenum getDXGIFormat(uint32_t dxgiFormat)
+    {
+        switch (dxgiFormat)
+        {
+        case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;        // DXGI_FORMAT_BC1_UNORM
+        case 72: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;  // DXGI_FORMAT_BC1_UNORM_SRGB
+        case 74: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;        // DXGI_FORMAT_BC2_UNORM
+        case 75: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;  // DXGI_FORMAT_BC2_UNORM_SRGB
+        case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;        // DXGI_FORMAT_BC3_UNORM
+        case 78: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;  // DXGI_FORMAT_BC3_UNORM_SRGB
+        case 80: return GL_COMPRESSED_RED_RGTC1;                 // DXGI_FORMAT_BC4_UNORM
+        case 81: return GL_COMPRESSED_SIGNED_RED_RGTC1;          // DXGI_FORMAT_BC4_SNORM
+        case 83: return GL_COMPRESSED_RG_RGTC2;                  // DXGI_FORMAT_BC5_UNORM
+        case 84: return GL_COMPRESSED_SIGNED_RG_RGTC2;           // DXGI_FORMAT_BC5_SNORM
+        case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;           // DXGI_FORMAT_BC7_UNORM
+        case 99: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;     // DXGI_FORMAT_BC7_UNORM_SRGB
+        default: return 0;
+        }
+    }
+
+    static bool parseDDS(const unsigned char* file, size_t size, CompressedImage& image, const char* path)
+    {
+        size_t dataOffset = 4 + 124;
+        if (size < dataOffset)
+        {
+            std::cout << "ERROR Texture container: file is truncated (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        const unsigned char* header = file + 4;
+        uint32_t height = read<uint32_t>(header + 8);
+        uint32_t width = read<uint32_t>(header + 12);
+        unsigned int fullLevels = getFullLevelCount(width, height);
+        if (fullLevels == 0)
+        {
+            std::cout << "ERROR Texture container: invalid size " << width << "x" << height << " (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        image.height = static_cast<int>(height);
+        image.width = static_cast<int>(width);
+        // the header count is untrusted, more levels than the full chain can't exist
+        uint32_t mipCount = std::min(std::max(1U, read<uint32_t>(header + 24)), fullLevels);
+        uint32_t pixelFlags = read<uint32_t>(header + 76);
+        uint32_t fourCC = read<uint32_t>(header + 80);
+        if (!(pixelFlags & DDPF_FOURCC))
+        {
+            std::cout << "ERROR Texture container: only block compressed DDS files are supported (Path: " << path << " )" << std::endl;
+            return false;
+        }
+
+        if (fourCC == makeFourCC("DXT1")) image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        else if (fourCC == makeFourCC("DXT3")) image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        else if (fourCC == makeFourCC("DXT5")) image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        else if (fourCC == makeFourCC("ATI1") || fourCC == makeFourCC("BC4U")) image.internalFormat = GL_COMPRESSED_RED_RGTC1;
+        else if (fourCC == makeFourCC("ATI2") || fourCC == makeFourCC("BC5U")) image.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        else if (fourCC == makeFourCC("DX10"))
+        {
+            if (size < dataOffset + 20)
+            {
+                std::cout << "ERROR Texture container: file is truncated (Path: " << path << " )" << std::endl;
+                return false;
+            }
+            uint32_t dxgiFormat = read<uint32_t>(file + dataOffset);
+            uint32_t arraySize = read<uint32_t>(file + dataOffset + 12);
+            image.internalFormat = getDXGIFormat(dxgiFormat);
+            if (arraySize > 1)
+            {
+                std::cout << "ERROR Texture container: DDS texture arrays are not supported (Path: " << path << " )" << std::endl;
+                return false;
+            }
+            dataOffset += 20;
+        }
+        if (image.internalFormat == 0)
+        {
+            std::cout << "ERROR Texture container: unsupported DDS format (Path: " << path << " )" << std::endl;
+            return false;
+        }
+        image.levels.clear();
+        if (!addLevels(image, mipCount, size - dataOffset, path))
+        {
+            return false;
+        }
+        image.data.assign(file + dataOffset, file + dataOffset + image.levels.back().offset + image.levels.back().size);
+        return true;
+    }
+};
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "stb_image.h"
+#include "AssetArchive.h"
+#include "MipGenerator.h"
+#include "RingBuffer.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+/// index of a texture inside its TextureLoader
+typedef unsigned int TextureHandle;
+
+/// <summary>
+///
+/// Loads textures without blocking the render thread.
+/// <para>load() returns a handle right away, the image is decoded by stb_image on the ThreadPool (always as RGBA8)
+/// and its mip chain is generated there by MipGenerator. update() streams the levels row by row through a persistently
+/// mapped pixel unpack buffer (PBO) into the texture, at most uploadBudget bytes per frame. Until the last row of the
+/// last level is uploaded the handle resolves to a shared 1x1 placeholder texture, afterwards to the real texture.</para>
+/// <para>KTX2 and DDS files are read on the ThreadPool as well and uploaded level by level with
+/// glCompressedTexImage2D, their precomputed mip chain is used as it is.</para>
+/// <para>With setArchive() the files are decoded straight from the memory mapped AssetArchive.</para>
+/// <para>Usage: load() -> once per frame update() -> bind() or getID()</para>
+///
+/// </summary>
+class TextureLoader
+{
+public:
+    /*
+    * @param	uploadBudget	bytes that are uploaded per frame at most
+    */
+    TextureLoader(ThreadPool& pool, GLsizeiptr uploadBudget = 1 << 20)
+        : pool(pool), uploadRing(uploadBudget)
+    {
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; i++)
+        {
+            if (strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), "GL_EXT_texture_compression_s3tc") == 0)
+            {
+                s3tcSupported = true;
+            }
+        }
+
+        const unsigned char gray[] = { 128, 128, 128, 255 };
+        glGenTextures(1, &placeholder);
+        glBindTexture(GL_TEXTURE_2D, placeholder);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    /*
+    * @brief	decode the images of this archive instead of the files, paths that are not in the archive are read from the files.
+    *			The archive has to stay open until the loader is idle
+    */
+    void setArchive(AssetArchive* assetArchive)
+    {
+        archive = assetArchive;
+    }
+
+    /*
+    * @brief	queue the image for decoding, stbi_set_flip_vertically_on_load has to be set before
+    *
+    * @param	path	Path of the image file (E.g.: textures/container.jpg)
+    * @param	mipSettings	filter of the generated mip chain, KTX2 and DDS files bring their own chain
+    */
+    TextureHandle load(const char* path, const MipSettings& mipSettings = MipSettings())
+    {
+        TextureHandle handle = static_cast<TextureHandle>(textures.size());
+        Texture texture;
+        texture.path = path;
+        textures.push_back(texture);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendingDecodes++;
+        }
+        std::string file = path;
+        AssetArchive* assetArchive = archive;
+        pool.submit([this, handle, file, assetArchive, mipSettings]()
+        {
+            DecodedImage image;
+            image.handle = handle;
+            std::string_view archived = assetArchive != NULL ? assetArchive->view(file) : std::string_view();
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(archived.data());
+            if (TextureContainer::isContainer(file))
+            {
+                std::shared_ptr<CompressedImage> compressed = std::make_shared<CompressedImage>();
+                bool parsed = bytes != NULL ? TextureContainer::parse(bytes, archived.size(), *compressed, file.c_str())
+                    : TextureContainer::load(file.c_str(), *compressed);
+                if (parsed)
+                {
+                    image.compressed = compressed;
+                }
+            }
+            else
+            {
+                int width, height, channels;
+                unsigned char* pixels = bytes != NULL ? stbi_load_from_memory(bytes, static_cast<int>(archived.size()), &width, &height, &channels, 4)
+                    : stbi_load(file.c_str(), &width, &height, &channels, 4);
+                if (pixels != NULL)
+                {
+                    image.mips = std::make_shared<MipChain>();
+                    MipGenerator::generate(pixels, width, height, mipSettings, *image.mips, &pool);
+                    stbi_image_free(pixels);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(image);
+            pendingDecodes--;
+            decodeFinished.notify_all();
+        });
+        return handle;
+    }
+
+    /*
+    * @brief	upload the next rows of the decoded images, has to be called once per frame on the render thread
+    */
+    void update()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const DecodedImage& image : decoded)
+            {
+                Texture& texture = textures[image.handle];
+                if (image.mips == NULL && image.compressed == NULL)
+                {
+                    std::cout << "Failed to load texture (Path: " << texture.path << " )" << std::endl;
+                    texture.state = FAILED;
+                    continue;
+                }
+                if (image.compressed != NULL && !isSupported(image.compressed->internalFormat))
+                {
+                    std::cout << "Failed to load texture, the driver doesn't support the compressed format 0x" << std::hex << image.compressed->internalFormat
+                        << std::dec << " (Path: " << texture.path << " )" << std::endl;
+                    texture.state = FAILED;
+                    continue;
+                }
+                texture.mips = image.mips;
+                texture.compressed = image.compressed;
+                texture.state = UPLOADING;
+                uploads.push_back(image.handle);
+            }
+            decoded.clear();
+        }
+        if (uploads.empty())
+        {
+            return;
+        }
+
+        uploadRing.beginFrame();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadRing.ID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        while (!uploads.empty())
+        {
+            Texture& texture = textures[uploads.front()];
+            if (!(texture.compressed != NULL ? uploadLevels(texture) : uploadRows(texture)))
+            {
+                break;
+            }
+            uploads.pop_front();
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        uploadRing.endFrame();
+    }
+
+    /*
+    * @return	returns the OpenGL texture, the placeholder until the upload finished
+    */
+    unsigned int getID(TextureHandle handle) const
+    {
+        const Texture& texture = textures[handle];
+        return texture.state == READY ? texture.ID : placeholder;
+    }
+
+    bool isReady(TextureHandle handle) const
+    {
+        return textures[handle].state == READY;
+    }
+
+    /*
+    * @brief	true if every texture is uploaded or failed
+    */
+    bool isIdle()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pendingDecodes == 0 && decoded.empty() && uploads.empty();
+    }
+
+    void bind(TextureHandle handle, unsigned int unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, getID(handle));
+    }
+
+    /*
+    * @brief	waits for the running decodes and deletes all textures
+    */
+    void remove()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        decodeFinished.wait(lock, [this]() { return pendingDecodes == 0; });
+        decoded.clear();
+        for (Texture& texture : textures)
+        {
+            texture.mips.reset();
+            texture.compressed.reset();
+            if (texture.ID != 0)
+            {
+                glDeleteTextures(1, &texture.ID);
+                texture.ID = 0;
+            }
+        }
+        uploads.clear();
+        glDeleteTextures(1, &placeholder);
+        placeholder = 0;
+        uploadRing.remove();
+    }
+
+private:
+    enum TextureState {
+        DECODING,
+        UPLOADING,
+        READY,
+        FAILED
+    };
+
+    struct Texture
+    {
+        std::string path;
+        TextureState state = DECODING;
+        unsigned int ID = 0;
+        std::shared_ptr<MipChain> mips; // decoded RGBA8 mip chain, freed after the upload
+        std::shared_ptr<CompressedImage> compressed; // or the block compressed mip chain
+        size_t uploadedLevels = 0;
+        int uploadedRows = 0; // of the level that is uploaded next
+    };
+
+    /// result of a decode job, handed from the worker to the render thread
+    struct DecodedImage
+    {
+        TextureHandle handle = 0;
+        std::shared_ptr<MipChain> mips;
+        std::shared_ptr<CompressedImage> compressed;
+    };
+
+    ThreadPool& pool;
+    AssetArchive* archive = NULL;
+    RingBuffer uploadRing;
+    unsigned int placeholder = 0;
+    bool s3tcSupported = false;
+    std::vector<Texture> textures;
+    std::deque<TextureHandle> uploads;
+
+    // shared with the decode jobs
+    std::mutex mutex;
+    std::condition_variable decodeFinished;
+    std::vector<DecodedImage> decoded;
+    unsigned int pendingDecodes = 0;
+
+    /*
+    * @brief	copy as many rows of the mip levels as the budget allows into the PBO and from there into the texture
+    *
+    * @return	returns true if the texture is complete
+    */
+    bool uploadRows(Texture& texture)
+    {
+        const MipChain& mips = *texture.mips;
+        if (texture.uploadedLevels == 0 && texture.uploadedRows == 0)
+        {
+            glGenTextures(1, &texture.ID);
+            glBindTexture(GL_TEXTURE_2D, texture.ID);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.levels.size() - 1));
+            for (size_t i = 0; i < mips.levels.size(); i++)
+            {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA8, mips.levels[i].width, mips.levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            }
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, texture.ID);
+        }
+
+        for (; texture.uploadedLevels < mips.levels.size(); texture.uploadedLevels++, texture.uploadedRows = 0)
+        {
+            const MipLevel& level = mips.levels[texture.uploadedLevels];
+            GLint index = static_cast<GLint>(texture.uploadedLevels);
+            const unsigned char* pixels = mips.data.data() + level.offset;
+            GLsizeiptr rowSize = static_cast<GLsizeiptr>(level.width) * 4;
+            if (rowSize > uploadRing.getFrameSize())
+            {
+                // a single row doesn't fit into the budget, upload the whole level from client memory
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glTexSubImage2D(GL_TEXTURE_2D, index, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadRing.ID);
+                continue;
+            }
+            while (texture.uploadedRows < level.height)
+            {
+                GLsizeiptr rows = std::min<GLsizeiptr>(level.height - texture.uploadedRows, uploadRing.getFrameSize() / rowSize);
+                RingAllocation allocation = uploadRing.allocate(rows * rowSize, 4);
+                while (allocation.data == NULL && rows > 1)
+                {
+                    // the budget of this frame is partially used by the previous texture or level
+                    rows /= 2;
+                    allocation = uploadRing.allocate(rows * rowSize, 4);
+                }
+                if (allocation.data == NULL)
+                {
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    return false;
+                }
+                std::memcpy(allocation.data, pixels + texture.uploadedRows * rowSize, static_cast<size_t>(rows * rowSize));
+                glTexSubImage2D(GL_TEXTURE_2D, index, 0, texture.uploadedRows, level.width, static_cast<GLsizei>(rows), GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(allocation.offset));
+                texture.uploadedRows += static_cast<int>(rows);
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        texture.mips.reset();
+        texture.state = READY;
+        return true;
+    }
+
+    bool isSupported(GLenum internalFormat) const
+    {
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return s3tcSupported;
+        default:
+            // RGTC, BPTC and ETC2 are core since OpenGL 3.0, 4.2 and 4.3
+            return TextureContainer::getBlockSize(internalFormat) != 0;
+        }
+    }
+
+    /*
+    * @brief	copy as many mip levels as the budget allows into the PBO and from there into the texture
+    *
+    * @return	returns true if the texture is complete
+    */
+    bool uploadLevels(Texture& texture)
+    {
+        const CompressedImage& image = *texture.compressed;
+        if (texture.uploadedLevels == 0)
+        {
+            glGenTextures(1, &texture.ID);
+            glBindTexture(GL_TEXTURE_2D, texture.ID);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, texture.ID);
+        }
+
+        for (; texture.uploadedLevels < image.levels.size(); texture.uploadedLevels++)
+        {
+            const CompressedLevel& level = image.levels[texture.uploadedLevels];
+            GLint index = static_cast<GLint>(texture.uploadedLevels);
+            GLsizei size = static_cast<GLsizei>(level.size);
+            if (static_cast<GLsizeiptr>(level.size) > uploadRing.getFrameSize())
+            {
+                // the level doesn't fit into the budget, upload it from client memory
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glCompressedTexImage2D(GL_TEXTURE_2D, index, image.internalFormat, level.width, level.height, 0, size, image.data.data() + level.offset);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadRing.ID);
+                continue;
+            }
+            RingAllocation allocation = uploadRing.allocate(size, 4);
+            if (allocation.data == NULL)
+            {
+                glBindTexture(GL_TEXTURE_2D, 0);
+                return false;
+            }
+            std::memcpy(allocation.data, image.data.data() + level.offset, level.size);
+            glCompressedTexImage2D(GL_TEXTURE_2D, index, image.internalFormat, level.width, level.height, 0, size, reinterpret_cast<void*>(allocation.offset));
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        texture.compressed.reset();
+        texture.state = READY;
+        return true;
+    }
+};
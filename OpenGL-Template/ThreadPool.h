@@ -0,0 +1,24 @@
+#pragma once
+
+#include "JobSystem.h"
+
+/// <summary>
+///
+/// Fixed set of worker threads shared by all subsystems that load or process data in the background.
+/// <para>submit() queues a task and returns immediately, parallelFor() splits an index range into jobs that
+/// the workers and the calling thread process together and returns once every index was processed.</para>
+/// <para>The pool is a work stealing JobSystem, so nested parallelFor() calls and tasks that wait for other
+/// tasks keep every thread busy. Work with dependencies uses its jobs and continuations directly.</para>
+///
+/// </summary>
+class ThreadPool : public JobSystem
+{
+public:
+    /*
+    * @param	threadCount	number of worker threads, 0 = one less than the hardware threads so the render thread keeps its core
+    */
+    ThreadPool(unsigned int threadCount = 0)
+        : JobSystem(threadCount)
+    {
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#include "RingBuffer.h"
+
+/// std140 rules for the C++ mirror of a uniform block:
+// scalars are 4 byte aligned, vec2 8 byte, vec3/vec4 16 byte (a vec3 is followed by a float or padding),
+// mat4 is four vec4 columns, arrays and nested structs round every element up to 16 bytes,
+// the block size is a multiple of 16 bytes.
+// Check every member with STD140_OFFSET next to the struct, a mismatch fails to compile.
+#define STD140_OFFSET(Block, member, offset) \
+    static_assert(offsetof(Block, member) == (offset), "std140: " #Block "::" #member " has to be at offset " #offset)
+
+/// Binding points of the uniform blocks shared between all programs
+enum UniformBinding : unsigned int {
+    CAMERA_BINDING = 0
+};
+
+/// uniform block "Camera", updated once per frame
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+};
+STD140_OFFSET(CameraBlock, view, 0);
+STD140_OFFSET(CameraBlock, projection, 64);
+STD140_OFFSET(CameraBlock, viewProjection, 128);
+
+/// <summary>
+///
+/// Typed uniform block that is written once per frame into the RingBuffer and bound by offset to its binding point.
+/// <para>Every program that declares the block reads the same data, see Shader::registerUniformBlock.</para>
+///
+/// </summary>
+template<class T>
+class UniformBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "uniform blocks are copied with memcpy");
+    static_assert(sizeof(T) % 16 == 0, "std140: the size of a uniform block is a multiple of 16 bytes");
+
+public:
+    unsigned int Binding;
+
+    UniformBuffer(unsigned int binding)
+        : Binding(binding)
+    {
+        // queried once, the ring aligns the offset in the whole buffer so every frame section binds at a valid offset
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment > RingBuffer::MAX_ALIGNMENT)
+        {
+            std::cout << "ERROR UniformBuffer: offset alignment " << alignment << " is larger than the ring buffer sections reserve" << std::endl;
+        }
+    }
+
+    /*
+    * @brief	bytes this block needs per frame in the ring buffer, including the worst case offset alignment
+    */
+    static GLsizeiptr getFrameSize()
+    {
+        return sizeof(T) + RingBuffer::MAX_ALIGNMENT;
+    }
+
+    /*
+    * @brief	write the block into the current ring buffer section and bind it
+    */
+    bool update(RingBuffer& ring, const T& data)
+    {
+        RingAllocation allocation = ring.allocate(sizeof(T), alignment);
+        if (allocation.data == NULL)
+        {
+            return false;
+        }
+        std::memcpy(allocation.data, &data, sizeof(T));
+        glBindBufferRange(GL_UNIFORM_BUFFER, Binding, ring.ID, allocation.offset, sizeof(T));
+        return true;
+    }
+
+private:
+    GLint alignment = 256;
+};
@@ -0,0 +1,559 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// meaning of a vertex attribute, it fixes the attribute location (see VertexFormat::getLocation)
+enum class VertexSemantic
+{
+    POSITION,
+    COLOR,
+    TEXCOORD,
+    NORMAL
+};
+
+/// FLOAT:          32 bit floats, every semantic
+/// UNORM16:        positions, 16 bit per axis relative to the bounds of the mesh, dequantized with VertexQuantization
+/// HALF:           texture coordinates, 16 bit floats
+/// UNORM8:         colors, 8 bit per channel
+/// INT_2_10_10_10: normals, GL_INT_2_10_10_10_REV with 10 bit per axis
+/// OCTAHEDRAL:     normals, octahedral mapping of the unit sphere to two 16 bit snorm values
+enum class VertexEncoding
+{
+    FLOAT,
+    UNORM16,
+    HALF,
+    UNORM8,
+    INT_2_10_10_10,
+    OCTAHEDRAL
+};
+
+struct VertexElement
+{
+    VertexSemantic semantic;
+    VertexEncoding encoding;
+    unsigned int offset; // bytes from the start of the vertex
+};
+
+/// position = stored position * scale + offset, set as the uniforms positionScale and positionOffset of the programs
+/// that draw the mesh. Identity for float positions
+struct VertexQuantization
+{
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+/// float data of one attribute, stride is the distance between two vertices in bytes
+struct VertexStream
+{
+    const float* data = NULL;
+    size_t stride = 0;
+};
+
+/// float data of a mesh, the streams of attributes that are not part of the format are ignored
+struct VertexSource
+{
+    size_t count = 0;
+    VertexStream position; // 3 floats
+    VertexStream color; // 3 floats
+    VertexStream texCoord; // 2 floats
+    VertexStream normal; // 3 floats of unit length
+};
+
+/// <summary>
+///
+/// Description of an interleaved vertex layout with compact encodings of the attributes.
+/// <para>The format sets up the attributes of the bound vertex array (setup), converts float vertices into its layout
+/// (encode) and generates the matching GLSL declarations and decode functions (getShaderDecode). The vertex shaders
+/// include the generated code with #include "vertexFormat.glsl" (see Shader::setInclude) and read the attributes
+/// with decodePosition(), decodeColor(), decodeTexCoord() and decodeNormal().</para>
+/// <para>UNORM16 positions, HALF texture coordinates and OCTAHEDRAL normals store a vertex in 16 instead of 32 bytes,
+/// the vertex fetch reads half the memory.</para>
+///
+/// </summary>
+class VertexFormat
+{
+public:
+    /*
+    * @brief	append an attribute to the layout, every semantic can be added once
+    */
+    VertexFormat& add(VertexSemantic semantic, VertexEncoding encoding)
+    {
+        if (find(semantic) != NULL)
+        {
+            std::cout << "ERROR Vertex format already has a " << getName(semantic) << " attribute" << std::endl;
+            return *this;
+        }
+        unsigned int size = getSize(semantic, encoding);
+        if (size == 0)
+        {
+            std::cout << "ERROR Vertex encoding isn't supported for the " << getName(semantic) << " attribute" << std::endl;
+            return *this;
+        }
+        elements.push_back({ semantic, encoding, stride });
+        stride += size; // every encoding is a multiple of 4 bytes, the attributes stay aligned
+        return *this;
+    }
+
+    unsigned int getStride() const
+    {
+        return stride;
+    }
+
+    const std::vector<VertexElement>& getElements() const
+    {
+        return elements;
+    }
+
+    /*
+    * @return	returns the element of the semantic or NULL if the format doesn't have it
+    */
+    const VertexElement* find(VertexSemantic semantic) const
+    {
+        for (const VertexElement& element : elements)
+        {
+            if (element.semantic == semantic)
+            {
+                return &element;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+    * @return	returns the attribute location of a semantic, 3 to 6 are left to the per instance model matrix
+    */
+    static unsigned int getLocation(VertexSemantic semantic)
+    {
+        switch (semantic)
+        {
+        case VertexSemantic::POSITION: return 0;
+        case VertexSemantic::COLOR: return 1;
+        case VertexSemantic::TEXCOORD: return 2;
+        default: return 7;
+        }
+    }
+
+    /*
+    * @brief	set the format of the attributes in the bound vertex array and source them from a vertex buffer binding,
+    *			bind the buffer with glBindVertexBuffer(binding, buffer, offset, getStride())
+    */
+    void setup(unsigned int binding = 0) const
+    {
+        for (const VertexElement& element : elements)
+        {
+            unsigned int location = getLocation(element.semantic);
+            switch (element.encoding)
+            {
+            case VertexEncoding::FLOAT:
+                glVertexAttribFormat(location, getComponents(element.semantic), GL_FLOAT, GL_FALSE, element.offset);
+                break;
+            case VertexEncoding::UNORM16:
+                glVertexAttribFormat(location, 3, GL_UNSIGNED_SHORT, GL_TRUE, element.offset);
+                break;
+            case VertexEncoding::HALF:
+                glVertexAttribFormat(location, 2, GL_HALF_FLOAT, GL_FALSE, element.offset);
+                break;
+            case VertexEncoding::UNORM8:
+                glVertexAttribFormat(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, element.offset);
+                break;
+            case VertexEncoding::INT_2_10_10_10:
+                glVertexAttribFormat(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, element.offset);
+                break;
+            case VertexEncoding::OCTAHEDRAL:
+                glVertexAttribFormat(location, 2, GL_SHORT, GL_TRUE, element.offset);
+                break;
+            }
+            glVertexAttribBinding(location, binding);
+            glEnableVertexAttribArray(location);
+        }
+    }
+
+    /*
+    * @brief	GLSL attribute declarations and decode functions of the format, register them with
+    *			Shader::setInclude("vertexFormat.glsl", format.getShaderDecode()) before the Shaders are created
+    */
+    std::string getShaderDecode() const
+    {
+        std::ostringstream code;
+        code << "// generated by VertexFormat, " << stride << " bytes per vertex\n";
+        for (const VertexElement& element : elements)
+        {
+            code << "layout (location = " << getLocation(element.semantic) << ") in " << getAttributeType(element) << " "
+                << getAttributeName(element.semantic) << ";\n";
+        }
+        for (const VertexElement& element : elements)
+        {
+            switch (element.semantic)
+            {
+            case VertexSemantic::POSITION:
+                if (element.encoding == VertexEncoding::UNORM16)
+                {
+                    code << "uniform vec3 positionScale;\n"
+                        "uniform vec3 positionOffset;\n"
+                        "vec3 decodePosition() { return aPos * positionScale + positionOffset; }\n";
+                }
+                else
+                {
+                    code << "vec3 decodePosition() { return aPos; }\n";
+                }
+                break;
+            case VertexSemantic::COLOR:
+                code << (element.encoding == VertexEncoding::UNORM8 ? "vec3 decodeColor() { return aColor.rgb; }\n" : "vec3 decodeColor() { return aColor; }\n");
+                break;
+            case VertexSemantic::TEXCOORD:
+                code << "vec2 decodeTexCoord() { return aTexCoord; }\n";
+                break;
+            case VertexSemantic::NORMAL:
+                if (element.encoding == VertexEncoding::OCTAHEDRAL)
+                {
+                    // the lower hemisphere is folded over the diagonals of the octahedron, unfold it
+                    code << "vec3 decodeNormal()\n"
+                        "{\n"
+                        "   vec3 n = vec3(aNormal, 1.0 - abs(aNormal.x) - abs(aNormal.y));\n"
+                        "   float fold = max(-n.z, 0.0);\n"
+                        "   n.x += n.x >= 0.0 ? -fold : fold;\n"
+                        "   n.y += n.y >= 0.0 ? -fold : fold;\n"
+                        "   return normalize(n);\n"
+                        "}\n";
+                }
+                else
+                {
+                    code << (element.encoding == VertexEncoding::INT_2_10_10_10 ? "vec3 decodeNormal() { return normalize(aNormal.xyz); }\n"
+                        : "vec3 decodeNormal() { return aNormal; }\n");
+                }
+                break;
+            }
+        }
+        return code.str();
+    }
+
+    /*
+    * @brief	convert float vertices into the layout of the format, output is resized to source.count * getStride()
+    *
+    * @return	returns the dequantization of the positions
+    */
+    VertexQuantization encode(const VertexSource& source, std::vector<unsigned char>& output) const
+    {
+        output.assign(source.count * stride, 0);
+        VertexQuantization quantization;
+        const VertexElement* position = find(VertexSemantic::POSITION);
+        if (position != NULL && position->encoding == VertexEncoding::UNORM16 && source.count > 0)
+        {
+            glm::vec3 minimum(read(source.position, 0, 0), read(source.position, 0, 1), read(source.position, 0, 2));
+            glm::vec3 maximum = minimum;
+            for (size_t i = 1; i < source.count; i++)
+            {
+                glm::vec3 value(read(source.position, i, 0), read(source.position, i, 1), read(source.position, i, 2));
+                minimum = glm::min(minimum, value);
+                maximum = glm::max(maximum, value);
+            }
+            quantization.scale = maximum - minimum;
+            quantization.offset = minimum;
+        }
+
+        for (const VertexElement& element : elements)
+        {
+            const VertexStream& stream = getStream(source, element.semantic);
+            if (stream.data == NULL)
+            {
+                std::cout << "ERROR Vertex source has no " << getName(element.semantic) << " data" << std::endl;
+                continue;
+            }
+            unsigned int components = getComponents(element.semantic);
+            for (size_t i = 0; i < source.count; i++)
+            {
+                unsigned char* vertex = output.data() + i * stride + element.offset;
+                float value[3];
+                for (unsigned int c = 0; c < components; c++)
+                {
+                    value[c] = read(stream, i, c);
+                }
+                switch (element.encoding)
+                {
+                case VertexEncoding::FLOAT:
+                    std::memcpy(vertex, value, components * sizeof(float));
+                    break;
+                case VertexEncoding::UNORM16:
+                {
+                    uint16_t quantized[4] = { 0, 0, 0, 0 };
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        float extent = quantization.scale[c];
+                        float normalized = extent > 0.0f ? (value[c] - quantization.offset[c]) / extent : 0.0f;
+                        quantized[c] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+                    }
+                    std::memcpy(vertex, quantized, sizeof(quantized));
+                    break;
+                }
+                case VertexEncoding::HALF:
+                {
+                    uint16_t half[2] = { toHalf(value[0]), toHalf(value[1]) };
+                    std::memcpy(vertex, half, sizeof(half));
+                    break;
+                }
+                case VertexEncoding::UNORM8:
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        vertex[c] = static_cast<unsigned char>(std::lround(std::clamp(value[c], 0.0f, 1.0f) * 255.0f));
+                    }
+                    vertex[3] = 255;
+                    break;
+                case VertexEncoding::INT_2_10_10_10:
+                {
+                    uint32_t packed = 0;
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        int32_t component = static_cast<int32_t>(std::lround(std::clamp(value[c], -1.0f, 1.0f) * 511.0f));
+                        packed |= (static_cast<uint32_t>(component) & 1023U) << (10 * c);
+                    }
+                    std::memcpy(vertex, &packed, sizeof(packed));
+                    break;
+                }
+                case VertexEncoding::OCTAHEDRAL:
+                {
+                    int16_t octahedral[2];
+                    encodeOctahedral(value, octahedral);
+                    std::memcpy(vertex, octahedral, sizeof(octahedral));
+                    break;
+                }
+                }
+            }
+        }
+        return quantization;
+    }
+
+    /*
+    * @brief	decode an attribute of an encoded vertex to floats like the vertex shader does, for measuring the precision
+    *
+    * @param	values	getComponents(semantic) floats
+    */
+    void decode(const unsigned char* vertex, const VertexQuantization& quantization, VertexSemantic semantic, float* values) const
+    {
+        const VertexElement* element = find(semantic);
+        if (element == NULL)
+        {
+            return;
+        }
+        const unsigned char* data = vertex + element->offset;
+        switch (element->encoding)
+        {
+        case VertexEncoding::FLOAT:
+            std::memcpy(values, data, getComponents(semantic) * sizeof(float));
+            break;
+        case VertexEncoding::UNORM16:
+        {
+            uint16_t quantized[3];
+            std::memcpy(quantized, data, sizeof(quantized));
+            for (int c = 0; c < 3; c++)
+            {
+                values[c] = quantized[c] / 65535.0f * quantization.scale[c] + quantization.offset[c];
+            }
+            break;
+        }
+        case VertexEncoding::HALF:
+        {
+            uint16_t half[2];
+            std::memcpy(half, data, sizeof(half));
+            values[0] = fromHalf(half[0]);
+            values[1] = fromHalf(half[1]);
+            break;
+        }
+        case VertexEncoding::UNORM8:
+            for (int c = 0; c < 3; c++)
+            {
+                values[c] = data[c] / 255.0f;
+            }
+            break;
+        case VertexEncoding::INT_2_10_10_10:
+        {
+            uint32_t packed;
+            std::memcpy(&packed, data, sizeof(packed));
+            glm::vec3 normal;
+            for (int c = 0; c < 3; c++)
+            {
+                int32_t component = static_cast<int32_t>((packed >> (10 * c)) & 1023U);
+                component -= component >= 512 ? 1024 : 0; // sign extend
+                normal[c] = std::max(component / 511.0f, -1.0f);
+            }
+            store(glm::normalize(normal), values);
+            break;
+        }
+        case VertexEncoding::OCTAHEDRAL:
+        {
+            int16_t octahedral[2];
+            std::memcpy(octahedral, data, sizeof(octahedral));
+            glm::vec3 normal(std::max(octahedral[0] / 32767.0f, -1.0f), std::max(octahedral[1] / 32767.0f, -1.0f), 0.0f);
+            normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+            float fold = std::max(-normal.z, 0.0f);
+            normal.x += normal.x >= 0.0f ? -fold : fold;
+            normal.y += normal.y >= 0.0f ? -fold : fold;
+            store(glm::normalize(normal), values);
+            break;
+        }
+        }
+    }
+
+    /*
+    * @return	returns the number of floats of a semantic in a VertexSource
+    */
+    static unsigned int getComponents(VertexSemantic semantic)
+    {
+        return semantic == VertexSemantic::TEXCOORD ? 2 : 3;
+    }
+
+    /*
+    * @brief	IEEE 754 half precision with round to nearest even, values above 65504 become infinity
+    */
+    static uint16_t toHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000U);
+        uint32_t magnitude = bits & 0x7FFFFFFFU;
+        if (magnitude >= 0x7F800000U) // infinity and NaN
+        {
+            return static_cast<uint16_t>(sign | 0x7C00U | (magnitude > 0x7F800000U ? 0x200U : 0U));
+        }
+        if (magnitude >= 0x477FF000U) // rounds to infinity
+        {
+            return static_cast<uint16_t>(sign | 0x7C00U);
+        }
+        if (magnitude < 0x38800000U) // subnormal half, the multiplication by 2^24 is exact
+        {
+            float absolute;
+            std::memcpy(&absolute, &magnitude, sizeof(absolute));
+            return static_cast<uint16_t>(sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.0f)));
+        }
+        uint32_t half = (magnitude - 0x38000000U) >> 13; // rebias the exponent from 127 to 15
+        uint32_t remainder = magnitude & 0x1FFFU;
+        if (remainder > 0x1000U || (remainder == 0x1000U && (half & 1U)))
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    static float fromHalf(uint16_t half)
+    {
+        uint32_t sign = static_cast<uint32_t>(half & 0x8000U) << 16;
+        uint32_t exponent = (half >> 10) & 0x1FU;
+        uint32_t mantissa = half & 0x3FFU;
+        if (exponent == 0)
+        {
+            float value = std::ldexp(static_cast<float>(mantissa), -24);
+            return sign != 0 ? -value : value;
+        }
+        uint32_t bits = sign | (exponent == 31 ? 0x7F800000U : (exponent + 112) << 23) | (mantissa << 13);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+private:
+    std::vector<VertexElement> elements;
+    unsigned int stride = 0;
+
+    /*
+    * @return	returns the bytes of an encoded attribute or 0 if the encoding doesn't fit the semantic
+    */
+    static unsigned int getSize(VertexSemantic semantic, VertexEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case VertexEncoding::FLOAT: return getComponents(semantic) * sizeof(float);
+        case VertexEncoding::UNORM16: return semantic == VertexSemantic::POSITION ? 8 : 0; // padded to 4 shorts
+        case VertexEncoding::HALF: return semantic == VertexSemantic::TEXCOORD ? 4 : 0;
+        case VertexEncoding::UNORM8: return semantic == VertexSemantic::COLOR ? 4 : 0;
+        case VertexEncoding::INT_2_10_10_10: return semantic == VertexSemantic::NORMAL ? 4 : 0;
+        case VertexEncoding::OCTAHEDRAL: return semantic == VertexSemantic::NORMAL ? 4 : 0;
+        default: return 0;
+        }
+    }
+
+    static const char* getName(VertexSemantic semantic)
+    {
+        switch (semantic)
+        {
+        case VertexSemantic::POSITION: return "position";
+        case VertexSemantic::COLOR: return "color";
+        case VertexSemantic::TEXCOORD: return "texture coordinate";
+        default: return "normal";
+        }
+    }
+
+    static const char* getAttributeName(VertexSemantic semantic)
+    {
+        switch (semantic)
+        {
+        case VertexSemantic::POSITION: return "aPos";
+        case VertexSemantic::COLOR: return "aColor";
+        case VertexSemantic::TEXCOORD: return "aTexCoord";
+        default: return "aNormal";
+        }
+    }
+
+    static const char* getAttributeType(const VertexElement& element)
+    {
+        switch (element.encoding)
+        {
+        case VertexEncoding::UNORM8: return "vec4";
+        case VertexEncoding::INT_2_10_10_10: return "vec4";
+        case VertexEncoding::HALF: return "vec2";
+        case VertexEncoding::OCTAHEDRAL: return "vec2";
+        default: return getComponents(element.semantic) == 2 ? "vec2" : "vec3";
+        }
+    }
+
+    static const VertexStream& getStream(const VertexSource& source, VertexSemantic semantic)
+    {
+        switch (semantic)
+        {
+        case VertexSemantic::POSITION: return source.position;
+        case VertexSemantic::COLOR: return source.color;
+        case VertexSemantic::TEXCOORD: return source.texCoord;
+        default: return source.normal;
+        }
+    }
+
+    static float read(const VertexStream& stream, size_t vertex, unsigned int component)
+    {
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(stream.data) + vertex * stream.stride;
+        return reinterpret_cast<const float*>(data)[component];
+    }
+
+    static void store(const glm::vec3& value, float* values)
+    {
+        values[0] = value.x;
+        values[1] = value.y;
+        values[2] = value.z;
+    }
+
+    /*
+    * @brief	project the normal on the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+    */
+    static void encodeOctahedral(const float* normal, int16_t* encoded)
+    {
+        float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+        float x = length > 0.0f ? normal[0] / length : 0.0f;
+        float y = length > 0.0f ? normal[1] / length : 0.0f;
+        if (length > 0.0f && normal[2] < 0.0f)
+        {
+            float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        encoded[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+        encoded[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+    }
+};
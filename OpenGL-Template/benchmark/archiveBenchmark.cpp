@@ -0,0 +1,189 @@
+// Compares loading the loose asset files with loading them from an AssetArchive, with a cold and a warm page cache.
+// loose:   std::ifstream + std::stringstream per file, like Shader::getShaderCode did before the archive
+// archive: open the mapping, view() every entry and read every byte of it
+// "decode" additionally decodes the images (stb_image, KTX2/DDS parsing), the part TextureLoader does on its workers.
+// Cold runs drop the files from the page cache with posix_fadvise before every iteration, that is only reliable on Linux.
+// Usage: archive-benchmark <archive.pak> [--iterations <count>]
+// Run it from the directory the archive was packed in, so the entry names resolve to the loose files.
+#include "stb_image.h"
+
+#include "AssetArchive.h"
+#include "TextureContainer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+* @brief	drop the clean pages of a file from the page cache
+*/
+void evict(const std::string& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file >= 0)
+    {
+        fdatasync(file);
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+}
+
+/*
+* @brief	sum of the bytes, so the reads can't be optimized away and every page of a mapping is touched
+*/
+unsigned long long checksum(std::string_view bytes)
+{
+    unsigned long long sum = 0;
+    for (char byte : bytes)
+    {
+        sum += static_cast<unsigned char>(byte);
+    }
+    return sum;
+}
+
+unsigned long long decode(const std::string& name, std::string_view bytes)
+{
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    if (TextureContainer::isContainer(name))
+    {
+        CompressedImage image;
+        return TextureContainer::parse(data, bytes.size(), image, name.c_str()) ? image.getByteSize() : 0;
+    }
+    int width, height, channels;
+    if (stbi_info_from_memory(data, static_cast<int>(bytes.size()), &width, &height, &channels))
+    {
+        unsigned char* pixels = stbi_load_from_memory(data, static_cast<int>(bytes.size()), &width, &height, &channels, 4);
+        stbi_image_free(pixels);
+        return static_cast<unsigned long long>(width) * height;
+    }
+    return 0;
+}
+
+unsigned long long loadLoose(const std::vector<std::string>& names, bool decodeImages)
+{
+    unsigned long long sum = 0;
+    for (const std::string& name : names)
+    {
+        std::ifstream file(name, std::ios::binary);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string bytes = stream.str();
+        sum += decodeImages ? decode(name, bytes) : checksum(bytes);
+    }
+    return sum;
+}
+
+unsigned long long loadArchive(const char* path, const std::vector<std::string>& names, bool decodeImages)
+{
+    AssetArchive archive;
+    if (!archive.open(path))
+    {
+        return 0;
+    }
+    unsigned long long sum = 0;
+    for (const std::string& name : names)
+    {
+        std::string_view bytes = archive.view(name);
+        sum += decodeImages ? decode(name, bytes) : checksum(bytes);
+    }
+    return sum;
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: archive-benchmark <archive.pak> [--iterations <count>]" << std::endl;
+        return 1;
+    }
+    const char* path = argv[1];
+    unsigned int iterations = 20;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    std::vector<std::string> names;
+    uint64_t bytes = 0;
+    {
+        AssetArchive archive;
+        if (!archive.open(path))
+        {
+            return 1;
+        }
+        for (const ArchiveEntry& entry : archive.getEntries())
+        {
+            names.push_back(std::string(archive.getName(entry)));
+            bytes += entry.originalSize;
+        }
+    }
+    for (const std::string& name : names)
+    {
+        if (!std::ifstream(name))
+        {
+            std::cout << "ERROR couldn't read File (Path: " << name << " ), run the benchmark from the directory the archive was packed in" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << std::fixed << std::setprecision(2) << path << ": " << names.size() << " entries, " << bytes / 1024.0 << " KiB, "
+        << iterations << " iterations, median ms" << std::endl;
+
+    std::cout << std::left << std::setw(16) << "" << std::right << std::setw(12) << "loose" << std::setw(12) << "archive" << std::endl;
+    const char* rows[] = { "read cold", "read warm", "decode cold", "decode warm" };
+    for (int row = 0; row < 4; row++)
+    {
+        bool cold = row % 2 == 0;
+        bool decodeImages = row >= 2;
+        double results[2];
+        for (int variant = 0; variant < 2; variant++)
+        {
+            std::vector<double> times;
+            unsigned long long sum = 0;
+            for (unsigned int i = 0; i <= iterations; i++)
+            {
+                if (cold)
+                {
+                    evict(path);
+                    for (const std::string& name : names)
+                    {
+                        evict(name);
+                    }
+                }
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                sum += variant == 0 ? loadLoose(names, decodeImages) : loadArchive(path, names, decodeImages);
+                double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (i > 0) // the first iteration only warms up the code and, for warm runs, the page cache
+                {
+                    times.push_back(time);
+                }
+            }
+            results[variant] = median(times);
+            if (sum == 0)
+            {
+                std::cout << "ERROR nothing was loaded" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << std::left << std::setw(16) << rows[row] << std::right << std::setw(12) << results[0] << std::setw(12) << results[1] << std::endl;
+    }
+    return 0;
+}
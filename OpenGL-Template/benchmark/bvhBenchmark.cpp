@@ -0,0 +1,214 @@
+// Scene queries through Bvh against the linear scans they replace, for growing scene sizes: frustum culling, ray
+// picking and nearest object. The linear times grow with the object count, the hierarchy times far slower. Also
+// measures the build on one thread and on the ThreadPool, and a refit after every object moved against a rebuild.
+// Every query is compared with the brute force result.
+// Usage: bvh-benchmark [--objects <largest count>] [--iterations <count>]
+#include "Bvh.h"
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const unsigned int QUERIES = 256; // rays and points per measurement
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/*
+* @brief	boxes with the density of the cube field in main.cpp, roughly 8 units^3 per object
+*/
+void createBoxes(size_t count, std::mt19937& random, BoundingBoxes& boxes)
+{
+    float worldSize = 2.0f * std::cbrt(static_cast<float>(count));
+    std::uniform_real_distribution<float> position(-0.5f * worldSize, 0.5f * worldSize);
+    std::uniform_real_distribution<float> size(0.2f, 0.9f);
+    boxes = BoundingBoxes();
+    boxes.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+        boxes.set(i, center - extent, center + extent);
+    }
+}
+
+float getDistanceSquared(const BoundingBoxes& boxes, size_t i, const glm::vec3& point)
+{
+    glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+    glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+    glm::vec3 offset = glm::max(glm::abs(point - center) - extent, glm::vec3(0.0f));
+    return glm::dot(offset, offset);
+}
+
+/*
+* @brief	brute force ray cast with the same slab arithmetic as Bvh
+*/
+float raycastLinear(const BoundingBoxes& boxes, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, unsigned int& index)
+{
+    glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float closest = maxDistance;
+    index = ~0U;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+        glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+        glm::vec3 minimum = center - extent, maximum = center + extent;
+        float entry = 0.0f, exit = closest;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float near = (minimum[axis] - origin[axis]) * inverse[axis];
+            float far = (maximum[axis] - origin[axis]) * inverse[axis];
+            entry = std::max(entry, std::min(near, far));
+            exit = std::min(exit, std::max(near, far));
+        }
+        if (entry <= exit)
+        {
+            closest = entry;
+            index = static_cast<unsigned int>(i);
+        }
+    }
+    return closest;
+}
+
+int main(int argc, char** argv)
+{
+    size_t largest = 1 << 20;
+    unsigned int iterations = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            largest = std::max<size_t>(1024, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    ThreadPool pool;
+    std::mt19937 random(42);
+    bool match = true;
+    std::cout << "BVH benchmark, best of " << iterations << " runs, " << pool.getThreadCount() + 1 << " threads, "
+        << QUERIES << " rays and points per query measurement" << std::endl;
+    std::cout << std::setw(9) << "objects" << std::setw(9) << "nodes" << std::setw(11) << "build 1T" << std::setw(11) << "build MT"
+        << std::setw(9) << "refit" << std::setw(11) << "cull flat" << std::setw(10) << "cull BVH" << std::setw(11) << "rays flat"
+        << std::setw(10) << "rays BVH" << std::setw(13) << "nearest flat" << std::setw(13) << "nearest BVH" << "   (ms)" << std::endl;
+    for (size_t count = 1024; count <= largest; count *= 4)
+    {
+        BoundingBoxes boxes;
+        createBoxes(count, random, boxes);
+        float worldSize = 2.0f * std::cbrt(static_cast<float>(count));
+
+        Bvh bvh;
+        double serialBuild = measure(iterations, [&]() { bvh.build(boxes, NULL); });
+        double parallelBuild = measure(iterations, [&]() { bvh.build(boxes, &pool); });
+
+        // every object moves a bit, the refit keeps the tree structure
+        BoundingBoxes moved = boxes;
+        std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+        for (size_t i = 0; i < count; i++)
+        {
+            moved.centerX[i] += offset(random);
+            moved.centerY[i] += offset(random);
+            moved.centerZ[i] += offset(random);
+        }
+        double refit = measure(iterations, [&]() { bvh.refit(moved); });
+
+        // camera in the middle of the scene like in main.cpp, the far plane bounds the visible part
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.3f, 0.1f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+        std::vector<unsigned int> reference, visible;
+        size_t referenceCount = 0, visibleCount = 0;
+        double flatCull = measure(iterations, [&]() { referenceCount = FrustumCuller::cull(frustum, moved, reference); });
+        double bvhCull = measure(iterations, [&]() { visibleCount = bvh.cull(frustum, visible); });
+        std::sort(visible.begin(), visible.begin() + visibleCount);
+        // the hierarchy may only keep more objects where a node was accepted as a whole, never lose one
+        match &= visibleCount >= referenceCount && std::includes(visible.begin(), visible.begin() + visibleCount, reference.begin(), reference.begin() + referenceCount);
+
+        std::uniform_real_distribution<float> position(-0.5f * worldSize, 0.5f * worldSize);
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        std::vector<glm::vec3> origins(QUERIES), directions(QUERIES), points(QUERIES);
+        for (unsigned int q = 0; q < QUERIES; q++)
+        {
+            origins[q] = glm::vec3(position(random), position(random), position(random));
+            directions[q] = glm::normalize(glm::vec3(direction(random), direction(random), direction(random)));
+            points[q] = glm::vec3(position(random), position(random), position(random));
+        }
+        std::vector<float> referenceDistances(QUERIES), distances(QUERIES);
+        double flatRays = measure(iterations, [&]() {
+            for (unsigned int q = 0; q < QUERIES; q++)
+            {
+                unsigned int index;
+                referenceDistances[q] = raycastLinear(moved, origins[q], directions[q], worldSize, index);
+            }
+        });
+        double bvhRays = measure(iterations, [&]() {
+            for (unsigned int q = 0; q < QUERIES; q++)
+            {
+                BvhRayHit hit;
+                distances[q] = bvh.raycast(origins[q], directions[q], worldSize, hit) ? hit.distance : worldSize;
+            }
+        });
+        match &= referenceDistances == distances;
+
+        double flatNearest = measure(iterations, [&]() {
+            for (unsigned int q = 0; q < QUERIES; q++)
+            {
+                float closest = std::numeric_limits<float>::infinity();
+                for (size_t i = 0; i < count; i++)
+                {
+                    closest = std::min(closest, getDistanceSquared(moved, i, points[q]));
+                }
+                referenceDistances[q] = std::sqrt(closest);
+            }
+        });
+        double bvhNearest = measure(iterations, [&]() {
+            for (unsigned int q = 0; q < QUERIES; q++)
+            {
+                unsigned int index;
+                bvh.nearest(points[q], std::numeric_limits<float>::infinity(), index, distances[q]);
+            }
+        });
+        for (unsigned int q = 0; q < QUERIES; q++)
+        {
+            match &= std::fabs(referenceDistances[q] - distances[q]) <= 1e-4f * (1.0f + referenceDistances[q]);
+        }
+
+        std::cout << std::fixed << std::setprecision(3) << std::setw(9) << count << std::setw(9) << bvh.getNodes().size()
+            << std::setw(11) << serialBuild << std::setw(11) << parallelBuild << std::setw(9) << refit
+            << std::setw(11) << flatCull << std::setw(10) << bvhCull << std::setw(11) << flatRays << std::setw(10) << bvhRays
+            << std::setw(13) << flatNearest << std::setw(13) << bvhNearest << std::endl;
+    }
+
+    if (!match)
+    {
+        std::cout << "ERROR the hierarchy and the linear scans found different objects" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Frustum culling of a large object list with FrustumCuller: scalar reference against the SIMD loops, for bounding
+// spheres and boxes, on one core. The objects are spread over a cube around the camera, so a part of them is inside
+// the view frustum. Build with OPENGL_TEMPLATE_NATIVE for the AVX path, otherwise SSE2 is used on x86-64.
+// Usage: culling-benchmark [--objects <count>] [--iterations <count>]
+#include "FrustumCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const float WORLD_SIZE = 200.0f;
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void printResult(const char* name, size_t objects, size_t visible, double time, double reference)
+{
+    std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setw(10) << visible
+        << std::setprecision(3) << std::setw(12) << time << std::setprecision(1) << std::setw(14) << objects / time / 1000.0
+        << std::setprecision(2) << std::setw(10) << reference / time << "x" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 1 << 20;
+    unsigned int iterations = 50;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            count = std::max<size_t>(1, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-0.5f * WORLD_SIZE, 0.5f * WORLD_SIZE);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    BoundingSpheres spheres;
+    BoundingBoxes boxes;
+    spheres.resize(count);
+    boxes.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+        spheres.set(i, center, glm::length(extent));
+        boxes.set(i, center - extent, center + extent);
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.3f, 0.1f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+#if defined(FRUSTUM_CULLER_AVX)
+    const char* simdName = "AVX, 8 per op";
+#elif defined(FRUSTUM_CULLER_SSE2)
+    const char* simdName = "SSE2, 4 per op";
+#else
+    const char* simdName = "none, scalar";
+#endif
+    std::cout << "Frustum culling benchmark, " << count << " objects, best of " << iterations << " runs, SIMD: " << simdName << std::endl;
+    std::cout << std::left << std::setw(18) << "volumes" << std::right << std::setw(10) << "visible" << std::setw(12) << "ms"
+        << std::setw(14) << "Mobjects/s" << std::setw(11) << "speedup" << std::endl;
+
+    std::vector<unsigned int> reference, visible;
+    size_t referenceCount = 0, visibleCount = 0;
+    double scalarTime = measure(iterations, [&]() { referenceCount = FrustumCuller::cull(frustum, spheres, reference, false); });
+    double simdTime = measure(iterations, [&]() { visibleCount = FrustumCuller::cull(frustum, spheres, visible, true); });
+    bool match = referenceCount == visibleCount && std::equal(reference.begin(), reference.begin() + referenceCount, visible.begin());
+    printResult("spheres scalar", count, referenceCount, scalarTime, scalarTime);
+    printResult("spheres SIMD", count, visibleCount, simdTime, scalarTime);
+
+    scalarTime = measure(iterations, [&]() { referenceCount = FrustumCuller::cull(frustum, boxes, reference, false); });
+    simdTime = measure(iterations, [&]() { visibleCount = FrustumCuller::cull(frustum, boxes, visible, true); });
+    match &= referenceCount == visibleCount && std::equal(reference.begin(), reference.begin() + referenceCount, visible.begin());
+    printResult("boxes scalar", count, referenceCount, scalarTime, scalarTime);
+    printResult("boxes SIMD", count, visibleCount, simdTime, scalarTime);
+
+    if (!match)
+    {
+        std::cout << "ERROR the SIMD and the scalar visible lists differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,309 @@
+// Microbenchmarks of the JobSystem. The first table measures the scheduling cost per job: empty child jobs
+// spawned from one thread, parallelFor() with one index per job, a chain of continuations, and for comparison a
+// pool with one mutex protected queue like the ThreadPool before the work stealing. The second table measures the
+// scaling of a compute bound parallelFor() and of a recursive fork join tree from 1 thread (no JobSystem, the loop
+// on the calling thread) up to --threads, the speedup is relative to that single thread.
+// Usage: job-benchmark [--jobs <count>] [--threads <largest count>] [--iterations <count>]
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/// the reference: workers take std::function tasks from one queue behind one mutex
+class CentralQueuePool
+{
+public:
+    CentralQueuePool(unsigned int threadCount)
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this]()
+                {
+                    for (;;)
+                    {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                            if (tasks.empty())
+                            {
+                                return;
+                            }
+                            task = std::move(tasks.front());
+                            tasks.pop_front();
+                        }
+                        task();
+                    }
+                });
+        }
+    }
+
+    ~CentralQueuePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+/*
+* @brief	64 dependent multiply adds, the work of one index of the scaling runs
+*/
+float compute(size_t index)
+{
+    float value = static_cast<float>(index & 1023) * 1e-3f;
+    for (int i = 0; i < 64; i++)
+    {
+        value = value * 0.999f + 0.5f;
+    }
+    return value;
+}
+
+/*
+* @brief	fork join tree: every job splits its range into two child jobs until the range is small, the leaves
+*			add their sums to total
+*/
+void forkJoin(JobSystem& jobs, Job* parent, size_t begin, size_t end, std::atomic<double>& total)
+{
+    if (end - begin <= 1024)
+    {
+        double sum = 0.0;
+        for (size_t i = begin; i < end; i++)
+        {
+            sum += compute(i);
+        }
+        double expected = total.load(std::memory_order_relaxed);
+        while (!total.compare_exchange_weak(expected, expected + sum, std::memory_order_relaxed))
+        {
+        }
+        return;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    for (std::pair<size_t, size_t> range : { std::make_pair(begin, middle), std::make_pair(middle, end) })
+    {
+        Job* child = jobs.create([&jobs, range, &total]()
+            {
+                Job* self = jobs.create([]() {});
+                forkJoin(jobs, self, range.first, range.second, total);
+                jobs.run(self);
+                jobs.wait(self);
+            }, parent);
+        jobs.run(child);
+        jobs.detach(child);
+    }
+}
+
+/*
+* @brief	the scheduling table for one thread count, every job is empty
+*/
+void benchmarkOverhead(unsigned int threadCount, size_t jobCount, unsigned int iterations)
+{
+    // jobs are spawned in batches, so the deque of the calling thread never overflows
+    const size_t BATCH = 1024;
+    size_t batches = std::max<size_t>(1, jobCount / BATCH);
+    jobCount = batches * BATCH;
+    double spawn, loop, chain, central;
+    {
+        JobSystem jobs(threadCount - 1);
+        spawn = measure(iterations, [&]()
+            {
+                for (size_t b = 0; b < batches; b++)
+                {
+                    Job* root = jobs.create([]() {});
+                    for (size_t i = 0; i < BATCH; i++)
+                    {
+                        Job* child = jobs.create([]() {}, root);
+                        jobs.run(child);
+                        jobs.detach(child);
+                    }
+                    jobs.run(root);
+                    jobs.wait(root);
+                }
+            });
+        std::atomic<size_t> calls{ 0 };
+        loop = measure(iterations, [&]() { jobs.parallelFor(0, jobCount, [&calls](size_t) { calls.fetch_add(1, std::memory_order_relaxed); }, 1); });
+        // every job is a continuation of the one before, so they run one after another
+        std::vector<Job*> links(BATCH);
+        chain = measure(iterations, [&]()
+            {
+                for (size_t b = 0; b < batches; b++)
+                {
+                    for (size_t i = 0; i < BATCH; i++)
+                    {
+                        links[i] = jobs.create([]() {});
+                        if (i > 0)
+                        {
+                            jobs.addContinuation(links[i - 1], links[i]);
+                        }
+                    }
+                    jobs.run(links[0]);
+                    for (size_t i = 0; i + 1 < BATCH; i++)
+                    {
+                        jobs.detach(links[i]);
+                    }
+                    jobs.wait(links[BATCH - 1]);
+                }
+            });
+    }
+    {
+        CentralQueuePool pool(threadCount - 1);
+        std::atomic<size_t> done{ 0 };
+        central = measure(iterations, [&]()
+            {
+                done.store(0);
+                for (size_t i = 0; i < jobCount; i++)
+                {
+                    pool.submit([&done]() { done.fetch_add(1, std::memory_order_release); });
+                }
+                while (done.load(std::memory_order_acquire) < jobCount)
+                {
+                    std::this_thread::yield();
+                }
+            });
+    }
+    double toNanoseconds = 1e6 / static_cast<double>(jobCount);
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << threadCount << std::setw(12) << spawn * toNanoseconds
+        << std::setw(15) << loop * toNanoseconds << std::setw(14) << chain * toNanoseconds << std::setw(15) << central * toNanoseconds << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t jobCount = 1 << 18;
+    unsigned int largest = std::max(2U, std::thread::hardware_concurrency());
+    unsigned int iterations = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            jobCount = std::max<size_t>(1024, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            largest = std::max(2U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    std::cout << "Job system benchmark, best of " << iterations << " runs, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::endl << "Scheduling cost per empty job" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "children" << std::setw(15) << "parallelFor 1" << std::setw(14) << "continuation"
+        << std::setw(15) << "central queue" << "   (ns)" << std::endl;
+    for (unsigned int threadCount = 2; threadCount <= largest; threadCount *= 2)
+    {
+        benchmarkOverhead(threadCount, jobCount, iterations);
+    }
+
+    // the workload of the scaling table, 16 times as many indices as jobs in the first table
+    size_t count = jobCount * 16;
+    double reference = 0.0;
+    double serial = measure(iterations, [&]()
+        {
+            reference = 0.0;
+            for (size_t i = 0; i < count; i++)
+            {
+                reference += compute(i);
+            }
+        });
+    std::cout << std::endl << "Scaling of " << count << " indices" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(13) << "parallelFor" << std::setw(9) << "speedup" << std::setw(11) << "fork join"
+        << std::setw(9) << "speedup" << "   (ms)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3) << std::setw(8) << 1 << std::setw(13) << serial << std::setw(9) << 1.0
+        << std::setw(11) << serial << std::setw(9) << 1.0 << std::endl;
+    double largestDifference = 0.0;
+    for (unsigned int threadCount = 2; threadCount <= largest; threadCount++)
+    {
+        JobSystem jobs(threadCount - 1);
+        // one partial sum per thread and block, so the threads don't write to the same cache line
+        const size_t BLOCK = 4096;
+        std::vector<double> sums((count + BLOCK - 1) / BLOCK);
+        double loop = measure(iterations, [&]()
+            {
+                jobs.parallelFor(0, sums.size(), [&](size_t block)
+                    {
+                        double sum = 0.0;
+                        for (size_t i = block * BLOCK; i < std::min(count, (block + 1) * BLOCK); i++)
+                        {
+                            sum += compute(i);
+                        }
+                        sums[block] = sum;
+                    });
+            });
+        double loopTotal = 0.0;
+        for (double sum : sums)
+        {
+            loopTotal += sum;
+        }
+        std::atomic<double> total{ 0.0 };
+        double tree = measure(iterations, [&]()
+            {
+                total.store(0.0);
+                Job* root = jobs.create([]() {});
+                forkJoin(jobs, root, 0, count, total);
+                jobs.run(root);
+                jobs.wait(root);
+            });
+        largestDifference = std::max({ largestDifference, std::abs(loopTotal - reference) / reference, std::abs(total.load() - reference) / reference });
+        std::cout << std::setw(8) << threadCount << std::setw(13) << loop << std::setw(9) << serial / loop
+            << std::setw(11) << tree << std::setw(9) << serial / tree << std::endl;
+    }
+
+    if (largestDifference > 1e-9)
+    {
+        std::cout << "ERROR the parallel sums differ from the serial one" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+// Measures the stages of MeshLoader on a large mesh: parsing single threaded and on the ThreadPool, cooking (weld,
+// vertex cache and overdraw order, encoding) and the load from the cooked cache that replaces both on later runs.
+// Without a file it writes a bumpy sphere of about one million triangles as .obj and .glb into the temp directory
+// and measures both formats.
+// Usage: mesh-benchmark [mesh file] [--triangles <count>] [--iterations <count>]
+#include "MeshLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+* @brief	grid over a sphere, one vertex per grid point and two triangles per cell
+*/
+void createSphere(size_t triangles, RawMesh& mesh)
+{
+    size_t columns = std::max<size_t>(4, static_cast<size_t>(std::sqrt(static_cast<double>(triangles))));
+    size_t rows = std::max<size_t>(2, triangles / (2 * columns));
+    mesh = RawMesh();
+    for (size_t row = 0; row <= rows; row++)
+    {
+        for (size_t column = 0; column <= columns; column++)
+        {
+            float u = static_cast<float>(column) / columns;
+            float v = static_cast<float>(row) / rows;
+            float phi = u * 6.2831853f;
+            float theta = v * 3.1415927f;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            glm::vec3 position = normal * (1.0f + 0.05f * std::sin(17.0f * phi) * std::sin(13.0f * theta));
+            mesh.positions.insert(mesh.positions.end(), { position.x, position.y, position.z });
+            mesh.normals.insert(mesh.normals.end(), { normal.x, normal.y, normal.z });
+            mesh.texCoords.insert(mesh.texCoords.end(), { u, v });
+        }
+    }
+    for (size_t row = 0; row < rows; row++)
+    {
+        for (size_t column = 0; column < columns; column++)
+        {
+            unsigned int a = static_cast<unsigned int>(row * (columns + 1) + column);
+            unsigned int b = a + static_cast<unsigned int>(columns + 1);
+            mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+}
+
+void writeObj(const std::string& path, const RawMesh& mesh)
+{
+    std::ofstream file(path);
+    file << std::setprecision(7);
+    for (size_t i = 0; i < mesh.getVertexCount(); i++)
+    {
+        file << "v " << mesh.positions[i * 3] << ' ' << mesh.positions[i * 3 + 1] << ' ' << mesh.positions[i * 3 + 2] << '\n';
+        file << "vt " << mesh.texCoords[i * 2] << ' ' << mesh.texCoords[i * 2 + 1] << '\n';
+        file << "vn " << mesh.normals[i * 3] << ' ' << mesh.normals[i * 3 + 1] << ' ' << mesh.normals[i * 3 + 2] << '\n';
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        file << 'f';
+        for (int corner = 0; corner < 3; corner++)
+        {
+            unsigned int index = mesh.indices[i + corner] + 1;
+            file << ' ' << index << '/' << index << '/' << index;
+        }
+        file << '\n';
+    }
+}
+
+void writeGlb(const std::string& path, const RawMesh& mesh)
+{
+    size_t vertexCount = mesh.getVertexCount();
+    size_t positionSize = mesh.positions.size() * sizeof(float);
+    size_t normalSize = mesh.normals.size() * sizeof(float);
+    size_t texCoordSize = mesh.texCoords.size() * sizeof(float);
+    size_t indexSize = mesh.indices.size() * sizeof(unsigned int);
+    size_t binarySize = positionSize + normalSize + texCoordSize + indexSize;
+
+    std::ostringstream json;
+    json << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+        << "\"buffers\":[{\"byteLength\":" << binarySize << "}],\"bufferViews\":["
+        << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << positionSize << "},"
+        << "{\"buffer\":0,\"byteOffset\":" << positionSize << ",\"byteLength\":" << normalSize << "},"
+        << "{\"buffer\":0,\"byteOffset\":" << positionSize + normalSize << ",\"byteLength\":" << texCoordSize << "},"
+        << "{\"buffer\":0,\"byteOffset\":" << positionSize + normalSize + texCoordSize << ",\"byteLength\":" << indexSize << "}],\"accessors\":["
+        << "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+        << "{\"bufferView\":1,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+        << "{\"bufferView\":2,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC2\"},"
+        << "{\"bufferView\":3,\"componentType\":5125,\"count\":" << mesh.indices.size() << ",\"type\":\"SCALAR\"}]}";
+    std::string text = json.str();
+    text.append((4 - text.size() % 4) % 4, ' '); // chunks are 4 byte aligned
+
+    uint32_t header[5] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + text.size() + 8 + binarySize), static_cast<uint32_t>(text.size()), 0x4E4F534A };
+    uint32_t binaryHeader[2] = { static_cast<uint32_t>(binarySize), 0x004E4942 };
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(text.data(), text.size());
+    file.write(reinterpret_cast<const char*>(binaryHeader), sizeof(binaryHeader));
+    file.write(reinterpret_cast<const char*>(mesh.positions.data()), positionSize);
+    file.write(reinterpret_cast<const char*>(mesh.normals.data()), normalSize);
+    file.write(reinterpret_cast<const char*>(mesh.texCoords.data()), texCoordSize);
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), indexSize);
+}
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void benchmark(const std::string& path, ThreadPool& pool, unsigned int iterations)
+{
+    std::error_code error;
+    std::string cacheDirectory = (std::filesystem::temp_directory_path() / "mesh-benchmark-cache").string();
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    RawMesh raw;
+    double serialParse = measure(iterations, [&]() { MeshLoader::parse(path.c_str(), raw, NULL); });
+    double parallelParse = measure(iterations, [&]() { MeshLoader::parse(path.c_str(), raw, &pool); });
+    MeshData cooked;
+    double cook = measure(iterations, [&]() { MeshLoader::cook(raw, MeshLoader::getDefaultFormat(), cooked); });
+
+    // the first load parses, cooks and writes the cache, the following ones only map it
+    MeshData mesh;
+    MeshLoadStats stats;
+    if (!MeshLoader::load(path.c_str(), mesh, &pool, cacheDirectory.c_str(), &stats))
+    {
+        return;
+    }
+    double firstLoad = (stats.parse + stats.cook + stats.cache) * 1000.0;
+    double cacheWrite = stats.cache * 1000.0;
+    // the mapping is only read on access, every page is touched like the upload would do
+    bool cached = true;
+    unsigned int checksum = 0;
+    double cacheLoad = measure(iterations, [&]() {
+        MeshData loaded;
+        MeshLoader::load(path.c_str(), loaded, &pool, cacheDirectory.c_str());
+        size_t vertexBytes = loaded.vertexCount * loaded.format.getStride();
+        for (size_t offset = 0; offset < vertexBytes; offset += 4096)
+        {
+            checksum += loaded.vertices[offset];
+        }
+        for (size_t offset = 0; offset < loaded.indexCount; offset += 1024)
+        {
+            checksum += loaded.indices[offset];
+        }
+        cached &= loaded.cached;
+    });
+    MeshData loaded;
+    MeshLoader::load(path.c_str(), loaded, &pool, cacheDirectory.c_str());
+    cached &= loaded.vertexCount == cooked.vertexCount && loaded.indexCount == cooked.indexCount
+        && std::memcmp(loaded.vertices, cooked.vertices, loaded.vertexCount * loaded.format.getStride()) == 0
+        && std::memcmp(loaded.indices, cooked.indices, loaded.indexCount * sizeof(unsigned int)) == 0;
+
+    size_t triangles = mesh.indexCount / 3;
+    std::cout << path << ": " << std::filesystem::file_size(path, error) / 1048576.0 << " MiB, " << triangles << " triangles, "
+        << mesh.vertexCount << " vertices after welding (" << mesh.format.getStride() << " bytes per vertex)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+        << "  parse, 1 thread        " << std::setw(10) << serialParse << " ms" << std::endl
+        << "  parse, " << std::setw(2) << pool.getThreadCount() + 1 << " threads     " << std::setw(10) << parallelParse << " ms  ("
+        << serialParse / parallelParse << "x)" << std::endl
+        << "  cook                   " << std::setw(10) << cook << " ms" << std::endl
+        << "  write cache            " << std::setw(10) << cacheWrite << " ms" << std::endl
+        << "  first load             " << std::setw(10) << firstLoad << " ms" << std::endl
+        << "  load from cache        " << std::setw(10) << cacheLoad << " ms  (" << firstLoad / cacheLoad << "x)" << std::endl;
+    if (!cached)
+    {
+        std::cout << "ERROR the cooked file wasn't used or differs from the cooked mesh (" << checksum << ")" << std::endl;
+    }
+    std::filesystem::remove_all(cacheDirectory, error);
+}
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    size_t triangles = 1 << 20;
+    unsigned int iterations = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc)
+        {
+            triangles = std::max<size_t>(16, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    ThreadPool pool;
+    if (!path.empty())
+    {
+        benchmark(path, pool, iterations);
+        return 0;
+    }
+    RawMesh sphere;
+    createSphere(triangles, sphere);
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string objPath = (directory / "mesh-benchmark.obj").string();
+    std::string glbPath = (directory / "mesh-benchmark.glb").string();
+    writeObj(objPath, sphere);
+    writeGlb(glbPath, sphere);
+    benchmark(objPath, pool, iterations);
+    benchmark(glbPath, pool, iterations);
+    std::error_code error;
+    std::filesystem::remove(objPath, error);
+    std::filesystem::remove(glbPath, error);
+    return 0;
+}
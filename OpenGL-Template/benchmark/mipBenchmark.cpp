@@ -0,0 +1,127 @@
+// Compares the SIMD mip chain generation of MipGenerator with its scalar reference, single threaded and on the ThreadPool.
+// The image is tiled up to --size so the chain is large enough to measure, "max diff" is the largest difference of
+// an output byte to the scalar reference (rounding of the different summation order).
+// Usage: mip-benchmark [image] [--size <pixels>] [--iterations <count>]
+#include "stb_image.h"
+
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Variant
+{
+    const char* name;
+    bool simd;
+    bool threaded;
+};
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = "textures/container.jpg";
+    int size = 2048;
+    unsigned int iterations = 10;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            size = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(path, &width, &height, &channels, 4);
+    if (pixels == NULL)
+    {
+        std::cout << "Failed to load texture (Path: " << path << " )" << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> image(static_cast<size_t>(size) * size * 4);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            std::memcpy(&image[(static_cast<size_t>(y) * size + x) * 4], pixels + (static_cast<size_t>(y % height) * width + x % width) * 4, 4);
+        }
+    }
+    stbi_image_free(pixels);
+
+#if defined(MIP_GENERATOR_AVX2)
+    const char* instructionSet = "AVX2";
+#elif defined(MIP_GENERATOR_SSE2)
+    const char* instructionSet = "SSE2";
+#else
+    const char* instructionSet = "none (scalar only)";
+#endif
+    ThreadPool pool;
+    std::cout << path << " tiled to " << size << "x" << size << ", SIMD: " << instructionSet << ", " << iterations << " iterations, median" << std::endl;
+    std::cout << std::left << std::setw(8) << "filter" << std::setw(20) << "variant" << std::right << std::setw(12) << "ms" << std::setw(12)
+        << "Mpixel/s" << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+
+    const Variant variants[] = {
+        { "scalar", false, false },
+        { "SIMD", true, false },
+        { "scalar threaded", false, true },
+        { "SIMD threaded", true, true }
+    };
+    const MipFilter filters[] = { MipFilter::BOX, MipFilter::KAISER };
+    for (MipFilter filter : filters)
+    {
+        MipChain reference;
+        double referenceTime = 0.0;
+        for (const Variant& variant : variants)
+        {
+            MipSettings settings;
+            settings.filter = filter;
+            settings.simd = variant.simd;
+            MipChain chain;
+            std::vector<double> times;
+            for (unsigned int i = 0; i <= iterations; i++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                MipGenerator::generate(image.data(), size, size, settings, chain, variant.threaded ? &pool : NULL);
+                double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (i > 0) // the first iteration warms up the allocations and the threads
+                {
+                    times.push_back(time);
+                }
+            }
+            double time = median(times);
+            if (reference.data.empty())
+            {
+                reference = chain;
+                referenceTime = time;
+            }
+            int maxDifference = 0;
+            for (size_t i = 0; i < chain.data.size(); i++)
+            {
+                maxDifference = std::max(maxDifference, std::abs(static_cast<int>(chain.data[i]) - reference.data[i]));
+            }
+            std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(8) << (filter == MipFilter::BOX ? "box" : "kaiser")
+                << std::setw(20) << variant.name << std::right << std::setw(12) << time << std::setw(12) << static_cast<double>(size) * size / time / 1000.0
+                << std::setw(9) << referenceTime / time << "x" << std::setw(10) << maxDifference << std::endl;
+        }
+    }
+    return 0;
+}
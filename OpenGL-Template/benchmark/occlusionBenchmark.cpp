@@ -0,0 +1,179 @@
+// Software occlusion culling with OcclusionCuller in a dense scene: a city grid of buildings seen from street level,
+// so the nearest blocks hide most of the rest. For growing scene sizes it measures the occluder rasterization with the
+// scalar reference and with SIMD, on one thread and on the ThreadPool, and the box tests of the frustum culled
+// objects, and prints the share of them that would not be drawn. The scalar and SIMD results are compared.
+// Usage: occlusion-benchmark [--objects <largest count>] [--occluders <count>] [--iterations <count>]
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/*
+* @brief	square grid of buildings with streets in between, 4 units per block, the camera stands at the origin
+*/
+void createCity(size_t count, std::mt19937& random, BoundingBoxes& boxes)
+{
+    unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    std::uniform_real_distribution<float> height(1.0f, 12.0f);
+    std::uniform_real_distribution<float> width(1.0f, 1.6f);
+    boxes = BoundingBoxes();
+    boxes.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = 4.0f * (static_cast<float>(i % side) - 0.5f * side) + 2.0f;
+        float z = -4.0f * static_cast<float>(i / side) - 4.0f;
+        glm::vec3 extent(width(random), 0.5f * height(random), width(random));
+        glm::vec3 center(x, extent.y - 2.0f, z);
+        boxes.set(i, center - extent, center + extent);
+    }
+}
+
+/*
+* @brief	start a frame and rasterize the occluders
+*/
+void rasterizeOccluders(OcclusionCuller& culler, const glm::mat4& viewProjection, const BoundingBoxes& boxes, const std::vector<unsigned int>& occluders,
+    ThreadPool* pool, bool simd)
+{
+    culler.clear();
+    for (unsigned int i : occluders)
+    {
+        glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+        glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+        culler.addBoxOccluder(viewProjection, center - extent, center + extent);
+    }
+    culler.rasterize(pool, simd);
+}
+
+int main(int argc, char** argv)
+{
+    size_t largest = 1 << 18;
+    unsigned int occluderCount = 32;
+    unsigned int iterations = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            largest = std::max<size_t>(1024, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--occluders") == 0 && i + 1 < argc)
+        {
+            occluderCount = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    ThreadPool pool;
+    std::mt19937 random(42);
+    bool match = true;
+    OcclusionCuller culler;
+    std::cout << "Occlusion benchmark, best of " << iterations << " runs, " << pool.getThreadCount() + 1 << " threads, "
+        << occluderCount << " occluders, " << culler.getWidth() << "x" << culler.getHeight() << " depth buffer, "
+#if defined(OCCLUSION_CULLER_AVX2)
+        << "AVX2" << std::endl;
+#elif defined(OCCLUSION_CULLER_SSE2)
+        << "SSE2" << std::endl;
+#else
+        << "no SIMD" << std::endl;
+#endif
+    std::cout << std::setw(9) << "objects" << std::setw(9) << "frustum" << std::setw(10) << "occluded" << std::setw(11) << "triangles"
+        << std::setw(12) << "raster 1T" << std::setw(14) << "raster SIMD" << std::setw(17) << "raster SIMD MT" << std::setw(9) << "test 1T"
+        << std::setw(9) << "test MT" << std::setw(9) << "total" << "   (ms)" << std::endl;
+    for (size_t count = 1024; count <= largest; count *= 4)
+    {
+        BoundingBoxes boxes;
+        createCity(count, random, boxes);
+
+        // eye height, looking down the street into the city
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+        glm::vec3 eye(0.0f, 0.0f, 0.0f);
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.4f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 viewProjection = projection * view;
+        std::vector<unsigned int> frustumVisible;
+        size_t frustumCount = FrustumCuller::cull(Frustum::fromMatrix(viewProjection), boxes, frustumVisible);
+
+        // the nearest objects in the frustum are the occluders, like in main.cpp
+        std::vector<unsigned int> occluders(frustumVisible.begin(), frustumVisible.begin() + frustumCount);
+        if (occluders.size() > occluderCount)
+        {
+            std::nth_element(occluders.begin(), occluders.begin() + occluderCount, occluders.end(), [&](unsigned int a, unsigned int b)
+                {
+                    glm::vec3 toA = glm::vec3(boxes.centerX[a], boxes.centerY[a], boxes.centerZ[a]) - eye;
+                    glm::vec3 toB = glm::vec3(boxes.centerX[b], boxes.centerY[b], boxes.centerZ[b]) - eye;
+                    return glm::dot(toA, toA) < glm::dot(toB, toB);
+                });
+            occluders.resize(occluderCount);
+        }
+
+        std::vector<unsigned int> visible, reference;
+        std::vector<float> referenceDepth, depth;
+        double scalarRaster = measure(iterations, [&]() { rasterizeOccluders(culler, viewProjection, boxes, occluders, NULL, false); });
+        culler.getDepth(referenceDepth);
+        reference = frustumVisible;
+        size_t referenceCount = culler.cull(viewProjection, boxes, reference, frustumCount, NULL);
+        double simdRaster = measure(iterations, [&]() { rasterizeOccluders(culler, viewProjection, boxes, occluders, NULL, true); });
+        culler.getDepth(depth);
+        match &= depth == referenceDepth;
+        double parallelRaster = measure(iterations, [&]() { rasterizeOccluders(culler, viewProjection, boxes, occluders, &pool, true); });
+        culler.getDepth(depth);
+        match &= depth == referenceDepth;
+        size_t triangles = culler.getStats().triangles;
+
+        // the tests of the frustum culled objects against the last depth buffer
+        size_t visibleCount = 0;
+        double serialTest = measure(iterations, [&]()
+            {
+                visible = frustumVisible;
+                visibleCount = culler.cull(viewProjection, boxes, visible, frustumCount, NULL);
+            });
+        match &= visibleCount == referenceCount && std::equal(visible.begin(), visible.begin() + visibleCount, reference.begin());
+        double parallelTest = measure(iterations, [&]()
+            {
+                visible = frustumVisible;
+                visibleCount = culler.cull(viewProjection, boxes, visible, frustumCount, &pool);
+            });
+        match &= visibleCount == referenceCount && std::equal(visible.begin(), visible.begin() + visibleCount, reference.begin());
+
+        std::cout << std::fixed << std::setprecision(3) << std::setw(9) << count << std::setw(9) << frustumCount
+            << std::setw(9) << std::setprecision(1) << 100.0 * (frustumCount - referenceCount) / std::max<size_t>(frustumCount, 1) << "%"
+            << std::setw(11) << triangles << std::setprecision(3) << std::setw(12) << scalarRaster << std::setw(14) << simdRaster
+            << std::setw(17) << parallelRaster << std::setw(9) << serialTest << std::setw(9) << parallelTest
+            << std::setw(9) << parallelRaster + parallelTest << std::endl;
+    }
+
+    if (!match)
+    {
+        std::cout << "ERROR the scalar and the SIMD rasterizer disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
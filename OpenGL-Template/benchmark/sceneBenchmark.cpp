@@ -0,0 +1,260 @@
+// Per frame transform cost of SceneStore against rebuilding every model matrix with glm::translate and
+// glm::toMat4 like the render loop did. For a growing scene and a growing share of changed objects it measures the
+// setters plus update() with the scalar reference and with SIMD, on one thread and on the ThreadPool, and the
+// gather of all world matrices into an upload buffer. The SIMD matrices are compared with the scalar ones.
+// The second table builds a random tree with --children children per object and compares the level by level
+// propagation of update() with walking up to the root for every object, after moving the roots and after moving
+// 1% of the leaves.
+// Usage: scene-benchmark [--objects <largest count>] [--children <count>] [--iterations <count>]
+#include "SceneStore.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/*
+* @return	returns the largest difference of two matrix elements
+*/
+float compare(const glm::mat4* a, const glm::mat4* b, size_t count)
+{
+    float difference = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            for (int r = 0; r < 4; r++)
+            {
+                difference = std::max(difference, std::abs(a[i][c][r] - b[i][c][r]));
+            }
+        }
+    }
+    return difference;
+}
+
+/*
+* @brief	world matrix of an object by multiplying the local matrices up to the root, no reuse between objects
+*/
+glm::mat4 walkToRoot(const SceneStore& scene, const std::vector<glm::mat4>& locals, size_t index)
+{
+    glm::mat4 world = locals[index];
+    for (int parent = scene.getParent(index); parent >= 0; parent = scene.getParent(parent))
+    {
+        world = locals[parent] * world;
+    }
+    return world;
+}
+
+/*
+* @brief	the hierarchy table: a tree whose objects are created in random order and added breadth first
+*
+* @return	returns the largest difference between the propagated and the walked world matrices
+*/
+float benchmarkHierarchy(size_t count, unsigned int childCount, unsigned int iterations, ThreadPool& pool, std::mt19937& random)
+{
+    // a complete tree with the objects shuffled, so the creation order is not the breadth first one
+    std::vector<unsigned int> labels(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        labels[i] = static_cast<unsigned int>(i);
+    }
+    std::shuffle(labels.begin(), labels.end(), random);
+    std::vector<int> parents(count, -1);
+    for (size_t i = 1; i < count; i++)
+    {
+        parents[labels[i]] = static_cast<int>(labels[(i - 1) / childCount]);
+    }
+    std::vector<unsigned int> order, slots(count);
+    SceneStore::sortBreadthFirst(parents, order);
+    for (size_t k = 0; k < count; k++)
+    {
+        slots[order[k]] = static_cast<unsigned int>(k);
+    }
+
+    SceneStore scene;
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<glm::mat4> locals(count);
+    for (size_t k = 0; k < count; k++)
+    {
+        int parent = parents[order[k]];
+        glm::vec3 position(distribution(random), distribution(random), distribution(random));
+        glm::quat rotation = glm::angleAxis(distribution(random), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)));
+        scene.add(position, rotation, glm::vec3(1.0f), parent < 0 ? -1 : static_cast<int>(slots[parent]));
+        locals[k] = glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation);
+    }
+    scene.update(&pool);
+    float difference = 0.0f;
+    for (size_t k = 0; k < count; k++)
+    {
+        glm::mat4 walked = walkToRoot(scene, locals, k);
+        difference = std::max(difference, compare(&scene.getWorld(k), &walked, 1));
+    }
+
+    std::vector<glm::mat4> worlds(count);
+    double walk = measure(iterations, [&]()
+        {
+            for (size_t k = 0; k < count; k++)
+            {
+                worlds[k] = walkToRoot(scene, locals, k);
+            }
+        });
+    // moving the root changes every world matrix, moving leaves only their own
+    unsigned int frame = 0;
+    auto moveRoot = [&]() { scene.setPosition(0, glm::vec3(0.001f * ++frame, 0.0f, 0.0f)); };
+    double rootSerial = measure(iterations, [&]() { moveRoot(); scene.update(NULL); });
+    double rootParallel = measure(iterations, [&]() { moveRoot(); scene.update(&pool); });
+    size_t leaves = std::max<size_t>(1, count / 100);
+    auto moveLeaves = [&]()
+        {
+            frame++;
+            for (size_t k = count - leaves; k < count; k++)
+            {
+                scene.setPosition(k, glm::vec3(0.001f * frame, 0.0f, 0.0f));
+            }
+        };
+    double leafSerial = measure(iterations, [&]() { moveLeaves(); scene.update(NULL); });
+    double leafParallel = measure(iterations, [&]() { moveLeaves(); scene.update(&pool); });
+
+    std::cout << std::fixed << std::setprecision(3) << std::setw(9) << count << std::setw(8) << scene.getLevelCount() << std::setw(10) << walk
+        << std::setw(9) << rootSerial << std::setw(9) << rootParallel << std::setw(9) << leafSerial << std::setw(9) << leafParallel << std::endl;
+    return difference;
+}
+
+int main(int argc, char** argv)
+{
+    size_t largest = 1 << 20;
+    unsigned int childCount = 4;
+    unsigned int iterations = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            largest = std::max<size_t>(1024, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--children") == 0 && i + 1 < argc)
+        {
+            childCount = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    ThreadPool pool;
+    std::mt19937 random(42);
+    float maximumDifference = 0.0f;
+    std::cout << "Scene store benchmark, best of " << iterations << " runs, " << pool.getThreadCount() + 1 << " threads, "
+#if defined(SCENE_STORE_AVX)
+        << "AVX" << std::endl;
+#elif defined(SCENE_STORE_SSE2)
+        << "SSE2" << std::endl;
+#else
+        << "no SIMD" << std::endl;
+#endif
+    std::cout << std::setw(9) << "objects" << std::setw(9) << "changed" << std::setw(10) << "rebuild" << std::setw(11) << "update 1T"
+        << std::setw(13) << "update SIMD" << std::setw(16) << "update SIMD MT" << std::setw(8) << "write" << "   (ms)" << std::endl;
+    for (size_t count = 1024; count <= largest; count *= 8)
+    {
+        std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+        std::vector<glm::vec3> positions(count);
+        std::vector<glm::quat> rotations(count);
+        SceneStore scene;
+        for (size_t i = 0; i < count; i++)
+        {
+            positions[i] = glm::vec3(distribution(random), distribution(random), distribution(random));
+            rotations[i] = glm::angleAxis(glm::radians(distribution(random)), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)));
+            scene.add(positions[i], rotations[i], glm::vec3(0.5f + 0.01f * (i % 64)));
+        }
+        scene.update(&pool);
+        std::vector<glm::mat4> reference(count), models(count);
+
+        // the old render loop: every matrix from scratch, whether it changed or not
+        unsigned int frame = 0;
+        double rebuild = measure(iterations, [&]()
+            {
+                glm::mat4 rotation = glm::toMat4(glm::angleAxis(0.01f * ++frame, glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f))));
+                for (size_t i = 0; i < count; i++)
+                {
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]) * glm::toMat4(rotations[i]);
+                    models[i] = 0 == i % 3U ? model * rotation : model;
+                }
+            });
+
+        // the changed objects are one contiguous range, like a group of animated objects added together
+        for (double share : { 0.001, 0.01, 0.1, 1.0 })
+        {
+            size_t changed = std::max<size_t>(1, static_cast<size_t>(share * count));
+            auto change = [&]()
+                {
+                    glm::quat spin = glm::angleAxis(0.01f * ++frame, glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f)));
+                    for (size_t i = 0; i < changed; i++)
+                    {
+                        scene.setRotation(i, rotations[i] * spin);
+                    }
+                };
+            double scalarUpdate = measure(iterations, [&]() { change(); scene.update(NULL, false); });
+            scene.write(NULL, count, reference.data());
+            // the same rotations again, so the SIMD results can be compared
+            frame--;
+            double simdUpdate = measure(1, [&]() { change(); scene.update(NULL, true); });
+            scene.write(NULL, count, models.data());
+            maximumDifference = std::max(maximumDifference, compare(models.data(), reference.data(), count));
+            simdUpdate = std::min(simdUpdate, measure(iterations, [&]() { change(); scene.update(NULL, true); }));
+            double parallelUpdate = measure(iterations, [&]() { change(); scene.update(&pool, true); });
+            double write = measure(iterations, [&]() { scene.write(NULL, count, models.data()); });
+
+            std::cout << std::fixed << std::setprecision(3) << std::setw(9) << count << std::setw(9) << changed << std::setw(10) << rebuild
+                << std::setw(11) << scalarUpdate << std::setw(13) << simdUpdate << std::setw(16) << parallelUpdate << std::setw(8) << write << std::endl;
+        }
+    }
+
+    std::cout << "Largest difference between the scalar and the SIMD matrices: " << std::scientific << maximumDifference << std::endl;
+
+    std::cout << std::endl << "Hierarchy with " << childCount << " children per object" << std::endl;
+    std::cout << std::setw(9) << "objects" << std::setw(8) << "levels" << std::setw(10) << "walk 1T" << std::setw(9) << "root 1T" << std::setw(9) << "root MT"
+        << std::setw(9) << "1% 1T" << std::setw(9) << "1% MT" << "   (ms)" << std::endl;
+    float hierarchyDifference = 0.0f;
+    for (size_t count = 1024; count <= largest; count *= 8)
+    {
+        hierarchyDifference = std::max(hierarchyDifference, benchmarkHierarchy(count, childCount, iterations, pool, random));
+    }
+    std::cout << "Largest difference between the propagated and the walked matrices: " << std::scientific << hierarchyDifference << std::endl;
+
+    if (maximumDifference > 1e-4f)
+    {
+        std::cout << "ERROR the scalar and the SIMD update disagree" << std::endl;
+        return 1;
+    }
+    if (hierarchyDifference > 1e-3f)
+    {
+        std::cout << "ERROR the propagated world matrices are wrong" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+// The software rendering backend on the template scene: a field of textured cubes seen by the default camera, for
+// growing cube counts. It measures the vertex stage (transform, clip, bin) and the tile rasterization with the scalar
+// reference and with SIMD, on one thread and on the ThreadPool, and checks that all of them produce the same image.
+// Usage: software-renderer-benchmark [--cubes <largest count>] [--iterations <count>] [--output <image.ppm>]
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+* @brief	best of iterations runs in milliseconds
+*/
+template<class Function>
+double measure(unsigned int iterations, const Function& function)
+{
+    double best = 1e30;
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/*
+* @brief	the unit cube of main.cpp with 24 vertices, every face mapped to the whole texture
+*/
+void createCube(SoftwareMesh& mesh)
+{
+    const glm::vec3 normals[6] = { glm::vec3(0, 0, -1), glm::vec3(0, 0, 1), glm::vec3(-1, 0, 0), glm::vec3(1, 0, 0), glm::vec3(0, -1, 0), glm::vec3(0, 1, 0) };
+    const glm::vec2 corners[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+    for (unsigned int face = 0; face < 6; face++)
+    {
+        glm::vec3 normal = normals[face];
+        glm::vec3 tangent = normal.x != 0.0f ? glm::vec3(0, 0, normal.x) : glm::vec3(normal.y + normal.z, 0, 0);
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+        unsigned int base = static_cast<unsigned int>(mesh.positions.size());
+        for (const glm::vec2& corner : corners)
+        {
+            mesh.positions.push_back(0.5f * normal + (corner.x - 0.5f) * tangent + (corner.y - 0.5f) * bitangent);
+            mesh.texCoords.push_back(corner);
+        }
+        const unsigned int quad[6] = { 0, 1, 2, 2, 3, 0 };
+        for (unsigned int index : quad)
+        {
+            mesh.indices.push_back(base + index);
+        }
+    }
+}
+
+/*
+* @brief	checkerboard with a gradient, so every mip level looks different
+*/
+void createTexture(int size, int cells, bool cutout, MipChain& chain)
+{
+    std::vector<unsigned char> rgba(static_cast<size_t>(size) * size * 4);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            bool odd = ((x * cells / size) + (y * cells / size)) % 2 != 0;
+            unsigned char* pixel = &rgba[(static_cast<size_t>(y) * size + x) * 4];
+            pixel[0] = static_cast<unsigned char>(odd ? 255 * x / size : 40);
+            pixel[1] = static_cast<unsigned char>(odd ? 200 : 255 * y / size);
+            pixel[2] = static_cast<unsigned char>(odd ? 60 : 180);
+            pixel[3] = static_cast<unsigned char>(cutout && odd ? 0 : 255);
+        }
+    }
+    MipSettings settings;
+    if (cutout)
+    {
+        settings.alphaCutoff = 0.5f;
+    }
+    MipGenerator::generate(rgba.data(), size, size, settings, chain);
+}
+
+int main(int argc, char** argv)
+{
+    size_t largest = 16384;
+    unsigned int iterations = 5;
+    const char* output = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cubes") == 0 && i + 1 < argc)
+        {
+            largest = std::max<size_t>(16, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+    }
+
+    ThreadPool pool;
+    SoftwareMesh cube;
+    createCube(cube);
+    MipChain texture1, texture2;
+    createTexture(512, 8, false, texture1);
+    createTexture(512, 4, true, texture2);
+    SoftwareRenderer renderer(800, 600);
+    std::mt19937 random(42);
+    bool match = true;
+
+    std::cout << "Software renderer benchmark, best of " << iterations << " runs, " << pool.getThreadCount() + 1 << " threads, "
+        << renderer.getWidth() << "x" << renderer.getHeight() << ", "
+#if defined(SOFTWARE_RENDERER_AVX2)
+        << "AVX2" << std::endl;
+#elif defined(SOFTWARE_RENDERER_SSE2)
+        << "SSE2" << std::endl;
+#else
+        << "no SIMD" << std::endl;
+#endif
+    std::cout << std::setw(7) << "cubes" << std::setw(11) << "triangles" << std::setw(9) << "binned" << std::setw(11) << "vertex 1T"
+        << std::setw(11) << "vertex MT" << std::setw(12) << "raster 1T" << std::setw(14) << "raster SIMD" << std::setw(17) << "raster SIMD MT"
+        << std::setw(11) << "Mpixel/s" << "   (ms)" << std::endl;
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f)
+        * glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    for (size_t count = 16; count <= largest; count *= 4)
+    {
+        // random rotations in a box in front of the camera that grows with the count, like --cubes in main.cpp
+        float range = 2.0f * std::cbrt(static_cast<float>(count));
+        std::uniform_real_distribution<float> spread(-range, range);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        std::vector<glm::mat4> models(count);
+        for (glm::mat4& model : models)
+        {
+            model = glm::translate(glm::mat4(1.0f), glm::vec3(spread(random), spread(random), -std::abs(spread(random)) - 2.0f));
+            model = glm::rotate(model, angle(random), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)));
+        }
+
+        ThreadPool* vertexPool = NULL;
+        auto submit = [&]()
+            {
+                renderer.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+                renderer.setTextures(&texture1, &texture2, 0.2f);
+                renderer.draw(viewProjection, models.data(), count, cube, vertexPool);
+            };
+        double serialVertex = measure(iterations, submit);
+        vertexPool = &pool;
+        double parallelVertex = measure(iterations, submit);
+        SoftwareRenderStats stats = renderer.getStats();
+
+        // beginFrame() drops the bins, so every raster run submits again and the vertex time is subtracted
+        std::vector<uint32_t> reference;
+        double scalarRaster = measure(iterations, [&]() { submit(); renderer.render(NULL, false); }) - parallelVertex;
+        reference = renderer.getColor();
+        double simdRaster = measure(iterations, [&]() { submit(); renderer.render(NULL, true); }) - parallelVertex;
+        match &= renderer.getColor() == reference;
+        double parallelRaster = measure(iterations, [&]() { submit(); renderer.render(&pool, true); }) - parallelVertex;
+        match &= renderer.getColor() == reference;
+
+        std::cout << std::fixed << std::setprecision(3) << std::setw(7) << count << std::setw(11) << stats.triangles << std::setw(9) << stats.binned
+            << std::setw(11) << serialVertex << std::setw(11) << parallelVertex << std::setw(12) << scalarRaster << std::setw(14) << simdRaster
+            << std::setw(17) << parallelRaster << std::setw(11) << std::setprecision(1)
+            << renderer.getWidth() * renderer.getHeight() / (1000.0 * std::max(parallelRaster, 1e-3)) << std::endl;
+    }
+
+    if (output != NULL)
+    {
+        renderer.saveFramebuffer(output);
+    }
+    if (!match)
+    {
+        std::cout << "ERROR the scalar and the SIMD rasterizer disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Compares uncompressed RGBA8 textures with BC1, BC3 and BC7 encoded by BlockCompressor:
+// memory footprint, encoding time, quality (PSNR of the level the driver decodes) and sampling throughput.
+// Runs offscreen through HeadlessContext, so it needs EGL (Linux).
+// Usage: texture-benchmark [image] [--passes <count>]
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include "BlockCompressor.h"
+#include "HeadlessContext.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const unsigned int TARGET_SIZE = 1024;
+const float TEXTURE_REPEAT = 4.0f; // the quad repeats the texture, so sampling is minified and reads the mip chain
+
+const char* VERTEX_SHADER = R"(#version 330 core
+out vec2 texCoord;
+uniform float repeat;
+void main()
+{
+    // fullscreen triangle
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    texCoord = position * repeat;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char* FRAGMENT_SHADER = R"(#version 330 core
+in vec2 texCoord;
+out vec4 FragColor;
+uniform sampler2D image;
+void main()
+{
+    FragColor = texture(image, texCoord);
+}
+)";
+
+struct Candidate
+{
+    const char* name;
+    GLenum internalFormat; // 0 = uncompressed RGBA8
+};
+
+unsigned int compileProgram()
+{
+    unsigned int program = glCreateProgram();
+    const char* sources[2] = { VERTEX_SHADER, FRAGMENT_SHADER };
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    for (int i = 0; i < 2; i++)
+    {
+        unsigned int shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program);
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, 1024, NULL, infoLog);
+        std::cout << "ERROR Linking Program:\n" << infoLog << std::endl;
+    }
+    return program;
+}
+
+double computePSNR(const unsigned char* reference, const unsigned char* decoded, size_t pixels, bool alpha)
+{
+    double squaredError = 0.0;
+    int channels = alpha ? 4 : 3;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            double difference = static_cast<double>(reference[i * 4 + c]) - decoded[i * 4 + c];
+            squaredError += difference * difference;
+        }
+    }
+    double mse = squaredError / (pixels * channels);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = "textures/container.jpg";
+    unsigned int passes = 50;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+        {
+            passes = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    HeadlessContext context;
+    if (!context.create(TARGET_SIZE, TARGET_SIZE) || !gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress) || !context.attachFramebuffer())
+    {
+        return 1;
+    }
+    std::cout << "Texture benchmark on " << glGetString(GL_RENDERER) << std::endl;
+
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(path, &width, &height, &channels, 4);
+    if (pixels == NULL)
+    {
+        std::cout << "Failed to load texture (Path: " << path << " )" << std::endl;
+        return 1;
+    }
+    bool hasAlpha = channels == 4;
+    std::cout << path << ": " << width << "x" << height << (hasAlpha ? " RGBA" : " RGB") << ", " << passes << " fullscreen passes of "
+        << TARGET_SIZE << "x" << TARGET_SIZE << " per format" << std::endl;
+
+    unsigned int program = compileProgram();
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "image"), 0);
+    glUniform1f(glGetUniformLocation(program, "repeat"), TEXTURE_REPEAT);
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    ThreadPool pool;
+    const Candidate candidates[] = {
+        { "RGBA8", 0 },
+        { "BC1", GL_COMPRESSED_RGBA_S3TC_DXT1_EXT },
+        { "BC3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT },
+        { "BC7", GL_COMPRESSED_RGBA_BPTC_UNORM }
+    };
+    std::vector<unsigned char> decoded(static_cast<size_t>(width) * height * 4);
+    std::cout << std::left << std::setw(8) << "format" << std::right << std::setw(12) << "VRAM KiB" << std::setw(12) << "encode ms"
+        << std::setw(12) << "PSNR dB" << std::setw(14) << "Gtexel/s" << std::endl;
+    for (const Candidate& candidate : candidates)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        double encodeTime = 0.0;
+        size_t footprint = 0;
+        if (candidate.internalFormat == 0)
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+            {
+                footprint += static_cast<size_t>(w) * h * 4;
+                if (w == 1 && h == 1)
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            CompressedImage image;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            BlockCompressor::compress(candidate.internalFormat, pixels, width, height, true, image, &pool);
+            encodeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            for (size_t i = 0; i < image.levels.size(); i++)
+            {
+                const CompressedLevel& level = image.levels[i];
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), image.internalFormat, level.width, level.height, 0,
+                    static_cast<GLsizei>(level.size), image.data.data() + level.offset);
+            }
+            footprint = image.getByteSize();
+        }
+        if (glGetError() != GL_NO_ERROR)
+        {
+            std::cout << std::left << std::setw(8) << candidate.name << std::right << " is not supported by the driver" << std::endl;
+            glDeleteTextures(1, &texture);
+            continue;
+        }
+
+        // the driver decodes the compressed level, compare it with the source pixels
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+        double psnr = computePSNR(pixels, decoded.data(), static_cast<size_t>(width) * height, hasAlpha);
+
+        glDrawArrays(GL_TRIANGLES, 0, 3); // warm up
+        glFinish();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned int pass = 0; pass < passes; pass++)
+        {
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double texels = static_cast<double>(TARGET_SIZE) * TARGET_SIZE * passes;
+
+        std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(8) << candidate.name << std::right
+            << std::setw(12) << footprint / 1024.0 << std::setw(12) << encodeTime << std::setw(12) << psnr
+            << std::setw(14) << std::setprecision(3) << texels / seconds / 1e9 << std::endl;
+        glDeleteTextures(1, &texture);
+    }
+
+    stbi_image_free(pixels);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    context.destroy();
+    return 0;
+}
@@ -0,0 +1,232 @@
+// Compares the vertex fetch of a large mesh in 32 bit float attributes with the compact encodings of VertexFormat:
+// bytes per vertex, encoding time, precision (decoded like the vertex shader does) and vertex throughput.
+// Every vertex is drawn once as point into a small viewport, so the draws are bound by the vertex fetch and shading
+// and not by the rasterization. The shader reads every attribute, they all contribute to gl_Position.
+// Runs offscreen through HeadlessContext, so it needs EGL (Linux).
+// Usage: vertex-format-benchmark [--vertices <count>] [--passes <count>]
+#include <glad/glad.h>
+
+#include "HeadlessContext.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const unsigned int TARGET_SIZE = 64;
+const float MESH_RADIUS = 25.0f;
+
+const char* VERTEX_SHADER_MAIN = R"(
+uniform float weight;
+void main()
+{
+    // a uniform weight instead of a constant, the compiler can't drop any attribute
+    vec3 position = decodePosition() + weight * (decodeNormal() + vec3(decodeTexCoord(), 0.0));
+    gl_Position = vec4(position / 32.0, 1.0);
+    gl_PointSize = 1.0;
+}
+)";
+
+const char* FRAGMENT_SHADER = R"(#version 330 core
+out vec4 FragColor;
+void main()
+{
+    FragColor = vec4(1.0);
+}
+)";
+
+struct Candidate
+{
+    const char* name;
+    VertexEncoding position;
+    VertexEncoding texCoord;
+    VertexEncoding normal;
+};
+
+/// float vertex of the source mesh, the reference of the precision measurements
+struct Vertex
+{
+    float position[3];
+    float normal[3];
+    float texCoord[2];
+};
+
+unsigned int compileProgram(const std::string& vertexCode)
+{
+    unsigned int program = glCreateProgram();
+    const char* sources[2] = { vertexCode.c_str(), FRAGMENT_SHADER };
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    for (int i = 0; i < 2; i++)
+    {
+        unsigned int shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program);
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, 1024, NULL, infoLog);
+        std::cout << "ERROR Linking Program:\n" << infoLog << std::endl;
+    }
+    return program;
+}
+
+/*
+* @brief	bumpy sphere with a texture wrapped around it, the vertices are in scan order like a parsed mesh
+*/
+std::vector<Vertex> createMesh(size_t count)
+{
+    size_t columns = static_cast<size_t>(std::sqrt(static_cast<double>(count) * 2.0));
+    size_t rows = (count + columns - 1) / columns;
+    std::vector<Vertex> vertices(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        float u = static_cast<float>(i % columns) / (columns - 1);
+        float v = static_cast<float>(i / columns) / std::max<size_t>(rows - 1, 1);
+        float phi = u * 6.2831853f;
+        float theta = v * 3.1415927f;
+        glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        float radius = MESH_RADIUS * (1.0f + 0.05f * std::sin(17.0f * phi) * std::sin(13.0f * theta));
+        glm::vec3 position = normal * radius;
+        Vertex& vertex = vertices[i];
+        std::memcpy(vertex.position, &position[0], sizeof(vertex.position));
+        std::memcpy(vertex.normal, &normal[0], sizeof(vertex.normal));
+        vertex.texCoord[0] = u * 4.0f;
+        vertex.texCoord[1] = v * 2.0f;
+    }
+    return vertices;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 4 << 20;
+    unsigned int passes = 20;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--vertices") == 0 && i + 1 < argc)
+        {
+            count = std::max<size_t>(16, strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+        {
+            passes = std::max(1U, static_cast<unsigned int>(strtoul(argv[++i], NULL, 10)));
+        }
+    }
+
+    HeadlessContext context;
+    if (!context.create(TARGET_SIZE, TARGET_SIZE) || !gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress) || !context.attachFramebuffer())
+    {
+        return 1;
+    }
+    std::cout << "Vertex format benchmark on " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << count << " vertices (position, normal, texture coordinates), " << passes << " passes per format" << std::endl;
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    std::vector<Vertex> vertices = createMesh(count);
+    VertexSource source;
+    source.count = count;
+    source.position = { vertices[0].position, sizeof(Vertex) };
+    source.normal = { vertices[0].normal, sizeof(Vertex) };
+    source.texCoord = { vertices[0].texCoord, sizeof(Vertex) };
+
+    const Candidate candidates[] = {
+        { "float", VertexEncoding::FLOAT, VertexEncoding::FLOAT, VertexEncoding::FLOAT },
+        { "2_10_10_10", VertexEncoding::UNORM16, VertexEncoding::HALF, VertexEncoding::INT_2_10_10_10 },
+        { "octahedral", VertexEncoding::UNORM16, VertexEncoding::HALF, VertexEncoding::OCTAHEDRAL }
+    };
+    std::cout << std::left << std::setw(12) << "format" << std::right << std::setw(8) << "bytes" << std::setw(10) << "MiB"
+        << std::setw(12) << "encode ms" << std::setw(12) << "pos error" << std::setw(12) << "normal deg" << std::setw(12) << "uv error"
+        << std::setw(12) << "ms/pass" << std::setw(12) << "Mvertex/s" << std::setw(10) << "GB/s" << std::setw(10) << "speedup" << std::endl;
+    double floatTime = 0.0;
+    for (const Candidate& candidate : candidates)
+    {
+        VertexFormat format;
+        format.add(VertexSemantic::POSITION, candidate.position).add(VertexSemantic::NORMAL, candidate.normal).add(VertexSemantic::TEXCOORD, candidate.texCoord);
+        std::vector<unsigned char> data;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        VertexQuantization quantization = format.encode(source, data);
+        double encodeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // position error relative to the radius, normal error as angle
+        float positionError = 0.0f, normalError = 0.0f, texCoordError = 0.0f;
+        for (size_t i = 0; i < count; i++)
+        {
+            const unsigned char* vertex = data.data() + i * format.getStride();
+            float position[3], normal[3], texCoord[2];
+            format.decode(vertex, quantization, VertexSemantic::POSITION, position);
+            format.decode(vertex, quantization, VertexSemantic::NORMAL, normal);
+            format.decode(vertex, quantization, VertexSemantic::TEXCOORD, texCoord);
+            for (int c = 0; c < 3; c++)
+            {
+                positionError = std::max(positionError, std::abs(position[c] - vertices[i].position[c]) / MESH_RADIUS);
+            }
+            // atan2 stays precise for small angles, acos of the dot product doesn't
+            glm::vec3 decoded(normal[0], normal[1], normal[2]);
+            glm::vec3 reference(vertices[i].normal[0], vertices[i].normal[1], vertices[i].normal[2]);
+            float angle = std::atan2(glm::length(glm::cross(decoded, reference)), glm::dot(decoded, reference));
+            normalError = std::max(normalError, glm::degrees(angle));
+            for (int c = 0; c < 2; c++)
+            {
+                texCoordError = std::max(texCoordError, std::abs(texCoord[c] - vertices[i].texCoord[c]));
+            }
+        }
+
+        unsigned int program = compileProgram("#version 330 core\n" + format.getShaderDecode() + VERTEX_SHADER_MAIN);
+        glUseProgram(program);
+        glUniform1f(glGetUniformLocation(program, "weight"), 1e-3f);
+        glUniform3f(glGetUniformLocation(program, "positionScale"), quantization.scale.x, quantization.scale.y, quantization.scale.z);
+        glUniform3f(glGetUniformLocation(program, "positionOffset"), quantization.offset.x, quantization.offset.y, quantization.offset.z);
+
+        unsigned int vbo, vao;
+        glGenBuffers(1, &vbo);
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+        glBindVertexBuffer(0, vbo, 0, format.getStride());
+        format.setup(0);
+
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count)); // warm up, the driver uploads the buffer
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        for (unsigned int pass = 0; pass < passes; pass++)
+        {
+            glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+        }
+        glFinish();
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / passes;
+        if (floatTime == 0.0)
+        {
+            floatTime = time;
+        }
+
+        std::cout << std::fixed << std::left << std::setw(12) << candidate.name << std::right << std::setw(8) << format.getStride()
+            << std::setprecision(2) << std::setw(10) << data.size() / 1048576.0 << std::setw(12) << encodeTime
+            << std::scientific << std::setprecision(1) << std::setw(12) << positionError << std::fixed << std::setprecision(3)
+            << std::setw(12) << normalError << std::scientific << std::setprecision(1) << std::setw(12) << texCoordError
+            << std::fixed << std::setprecision(2) << std::setw(12) << time << std::setw(12) << count / time / 1000.0
+            << std::setw(10) << data.size() / time / 1e6 << std::setw(9) << floatTime / time << "x" << std::endl;
+
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteProgram(program);
+    }
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "ERROR OpenGL reported an error during the benchmark" << std::endl;
+    }
+
+    context.destroy();
+    return 0;
+}
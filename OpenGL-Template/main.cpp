@@ -7,8 +7,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-// From https://github.com/nothings/stb/blob/master/stb_image.h
-#define STB_IMAGE_IMPLEMENTATION
+// From https://github.com/nothings/stb/blob/master/stb_image.h, implemented in src/stb_image.cpp
 #include "stb_image.h"
 
 #include <glm/glm.hpp>
@@ -24,6 +23,79 @@
 // #define CAMERA_FPS
 #include "Camera.h"
 
+#include "AssetArchive.h"
+#include "Bvh.h"
+#include "FramePacer.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "HeadlessContext.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "OcclusionCuller.h"
+#include "RingBuffer.h"
+#include "SceneStore.h"
+#include "SoftwareRenderer.h"
+#include "UniformBuffer.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "TextureLoader.h"
+#include "VertexFormat.h"
+
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+/// Command line options
+// --headless           render offscreen through EGL (llvmpipe on machines without a GPU), no window is created
+// --frames <count>     stop after <count> frames, headless runs default to HEADLESS_FRAMES
+// --output <file.ppm>  save the last headless frame as PPM
+// --cubes <count>      number of cubes in the scene, the first 10 are the classic cube positions
+// --no-instancing      draw every cube with its own glDrawElements call
+// --no-shader-cache    always compile the shaders from source
+// --trace <file.json>  record every profiler scope and write it as Chrome trace
+// --archive <file.pak> read shaders and textures from an archive created by tools/assetPacker.cpp
+// --float-vertices     store the cube with 32 bit float attributes instead of the compact vertex format
+// --mesh <file>        draw an .obj, .gltf or .glb mesh instead of the cube, cooked into MESH_CACHE_DIRECTORY on the first run
+// --no-culling         draw every cube, also the ones outside the view frustum
+// --flat-culling       test every cube against the view frustum instead of walking the bounding volume hierarchy
+// --gpu-culling        cull in a compute shader and draw the visible cubes with indirect draw commands
+// --no-occlusion-culling  skip the software depth test of the cubes behind the OCCLUDER_COUNT nearest cubes
+// --backend <name>     opengl (default) or software: render the cubes on the CPU with SoftwareRenderer, headless runs need no OpenGL
+struct Options
+{
+    bool headless = false;
+    unsigned int frames = 0; // 0 = until the window is closed
+    std::string output;
+    unsigned int cubes = 10;
+    bool instancing = true;
+    bool shaderCache = true;
+    std::string trace;
+    std::string archive;
+    bool compactVertices = true;
+    std::string mesh;
+    bool culling = true;
+    bool hierarchicalCulling = true;
+    bool gpuCulling = false;
+    bool occlusionCulling = true;
+    bool softwareBackend = false;
+};
+Options parseOptions(int argc, char** argv);
+std::vector<glm::vec3> createCubePositions(unsigned int count);
+void createCubeScene(const std::vector<glm::vec3>& positions, SceneStore& scene, std::vector<unsigned int>& cubeNodes);
+void animateCubes(SceneStore& scene, const std::vector<unsigned int>& cubeNodes, const glm::quat& spin, ThreadPool* pool);
+int runSoftwareBackend(Options& options, std::chrono::steady_clock::time_point startTime);
+void setVertexQuantization(Shader& shader, const VertexQuantization& quantization);
+std::string describeCubeQueries(const Bvh& bvh, const Camera& camera);
+
 void resize(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window, float* value);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
@@ -32,7 +104,63 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 const unsigned int FRAME_RATE = 60;
-const double FRAME_TIME = 1.0 / FRAME_RATE;
+const FramePacingMode FRAME_PACING = FramePacingMode::CAPPED; // VSYNC, CAPPED (to FRAME_RATE) or UNCAPPED
+const double FRAME_STATS_INTERVAL = 1.0; // seconds between frame statistics updates in the window title
+const unsigned int HEADLESS_FRAMES = 600;
+const double HEADLESS_FRAME_TIME = 1.0 / FRAME_RATE; // headless runs advance a fixed time step for deterministic output
+const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+const char* MESH_CACHE_DIRECTORY = "mesh_cache";
+const GLsizeiptr TEXTURE_UPLOAD_BUDGET = 1 << 20; // bytes of texture data uploaded per frame at most
+const float CUBE_RADIUS = 0.8660254f; // bounding sphere of the unit cube, a loaded mesh is scaled into it
+const float PICK_DISTANCE = 100.0f; // range of the cube picking along the camera front
+const unsigned int OCCLUDER_COUNT = 32; // nearest visible cubes rasterized as occluders each frame
+const unsigned int OCCLUSION_WIDTH = 256; // software depth buffer, same aspect ratio as the window
+const unsigned int OCCLUSION_HEIGHT = 192;
+
+// the unit cube as 36 vertices: position, texture coordinate
+const float vertices3D[] = {
+    -0.5f, -0.5f, -0.5f,    0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,    1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
+     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, 0.0f,
+
+    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,    1.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
+
+    -0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+
+     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
+     0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+     0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+     0.5f, -0.5f, -0.5f,    1.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+
+    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
+     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f, 0.0f,
+};
 
 double lastFrame = 0.0; // Time of last frame
 double lastX = 0.0;
@@ -41,77 +169,132 @@ bool firstMouse = true;
 
 Camera camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
-int main()
+int main(int argc, char** argv)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    Options options = parseOptions(argc, argv);
+    if (options.softwareBackend)
+    {
+        return runSoftwareBackend(options, startTime);
+    }
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "MyFirstWindow", NULL, NULL);
-    if (window == NULL)
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+    if (options.headless)
     {
-        std::cout << "Failed to initalized a Window :(" << std::endl;
-        glfwTerminate();
-        return 1;
+        if (!headless.create(SCR_WIDTH, SCR_HEIGHT))
+        {
+            std::cout << "Failed to initalized a headless Context :(" << std::endl;
+            return 1;
+        }
+        if (options.frames == 0)
+        {
+            options.frames = HEADLESS_FRAMES;
+        }
+    }
+    else
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "MyFirstWindow", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to initalized a Window :(" << std::endl;
+            glfwTerminate();
+            return 1;
+        }
+        glfwMakeContextCurrent(window);
     }
-    glfwMakeContextCurrent(window);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (!gladLoadGLLoader(options.headless ? (GLADloadproc)HeadlessContext::getProcAddress : (GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to intalized GLAD" << std::endl;
         return 2;
     }
 
-    // resize Viewport with Window
-    glfwSetFramebufferSizeCallback(window, resize);
+    bool parallelShaderCompile = Shader::loadExtensions(options.headless ? (GLADloadproc)HeadlessContext::getProcAddress : (GLADloadproc)glfwGetProcAddress);
+    bool computeShaders = GpuCuller::loadExtensions(options.headless ? (GLADloadproc)HeadlessContext::getProcAddress : (GLADloadproc)glfwGetProcAddress);
 
-    // Create Shaderprogram
-    Shader shader("shader/simple.vert", "shader/textureMix.frag");
-
-    unsigned int texture1, texture2;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("textures/container.jpg", &width, &height, &nrChannels, 0);
-    if (data)
+    if (options.headless)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (!headless.attachFramebuffer())
+        {
+            return 1;
+        }
+        std::cout << "Headless rendering on " << glGetString(GL_RENDERER) << " (OpenGL " << glGetString(GL_VERSION) << ")" << std::endl;
     }
     else
     {
-        std::cout << "Failed to load texture" << std::endl;
+        // resize Viewport with Window
+        glfwSetFramebufferSizeCallback(window, resize);
     }
-    stbi_image_free(data);
 
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
+    // assets that are not in the archive are still read from the loose files
+    AssetArchive archive;
+    if (!options.archive.empty() && archive.open(options.archive.c_str()))
+    {
+        archive.prefetch();
+        Shader::setAssetArchive(&archive);
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // the worker threads parse the mesh file and decode the textures
+    ThreadPool threadPool;
 
-    data = stbi_load("textures/awesomeface.png", &width, &height, &nrChannels, 0);
-    if (data)
+    // a mesh file replaces the cube, it's parsed and cooked once and mapped from the cache on later runs
+    MeshData mesh;
+    bool meshLoaded = false;
+    if (!options.mesh.empty())
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        MeshLoadStats meshStats;
+        meshLoaded = MeshLoader::load(options.mesh.c_str(), mesh, &threadPool, MESH_CACHE_DIRECTORY, &meshStats);
+        if (meshLoaded)
+        {
+            std::cout << std::fixed << std::setprecision(2) << "Mesh " << options.mesh << ": " << mesh.indexCount / 3 << " triangles, "
+                << mesh.vertexCount << " vertices, " << (mesh.cached ? "cache " : "parse ") << (meshStats.parse + meshStats.cook + meshStats.cache) * 1000.0
+                << " ms (parse " << meshStats.parse * 1000.0 << " ms, cook " << meshStats.cook * 1000.0 << " ms, cache " << meshStats.cache * 1000.0 << " ms)" << std::endl;
+        }
     }
-    else
+    if (!meshLoaded && options.compactVertices)
     {
-        std::cout << "Failed to load texture" << std::endl;
+        mesh.format.add(VertexSemantic::POSITION, VertexEncoding::UNORM16).add(VertexSemantic::TEXCOORD, VertexEncoding::HALF);
     }
-    stbi_image_free(data);
+    else if (!meshLoaded)
+    {
+        mesh.format.add(VertexSemantic::POSITION, VertexEncoding::FLOAT).add(VertexSemantic::TEXCOORD, VertexEncoding::FLOAT);
+    }
+    // the vertex shaders decode the attributes with the code generated for the vertex format of the mesh
+    Shader::setInclude("vertexFormat.glsl", mesh.format.getShaderDecode());
+
+    // Create Shaderprogram, the camera block is shared by all programs
+    Shader::setBinaryCacheDirectory(options.shaderCache ? SHADER_CACHE_DIRECTORY : "");
+    Shader::registerUniformBlock("Camera", CAMERA_BINDING);
+    // the textured programs are compiled in the background, until they are linked the cubes are drawn
+    // with the small one color programs
+    Shader shader("shader/simple.vert", "shader/textureMix.frag", ShaderBuild::ASYNC);
+    Shader instancedShader("shader/instanced.vert", "shader/textureMix.frag", ShaderBuild::ASYNC);
+    Shader fallbackShader("shader/simple.vert", "shader/oneColor.frag");
+    Shader fallbackInstancedShader("shader/instanced.vert", "shader/oneColor.frag");
+    fallbackShader.set("outColor", 0.8f, 0.8f, 0.8f, 1.0f);
+    fallbackInstancedShader.set("outColor", 0.8f, 0.8f, 0.8f, 1.0f);
+    Shader* cubeShader = &fallbackShader;
+    Shader* instancedCubeShader = &fallbackInstancedShader;
+
+    Profiler profiler;
+    profiler.setTracing(!options.trace.empty());
+
+    // the images are decoded on the worker threads and uploaded over the next frames, until then the
+    // handles resolve to a placeholder texture
+    TextureLoader textureLoader(threadPool, TEXTURE_UPLOAD_BUDGET);
+    textureLoader.setArchive(archive.isOpen() ? &archive : NULL);
+    stbi_set_flip_vertically_on_load(true);
+    TextureHandle texture1 = textureLoader.load("textures/container.jpg");
+    // the face is a cutout, its mip levels keep the share of pixels that pass an alpha test at 0.5
+    MipSettings cutoutMips;
+    cutoutMips.alphaCutoff = 0.5f;
+    TextureHandle texture2 = textureLoader.load("textures/awesomeface.png", cutoutMips);
 
 
     float vertices[] = {
@@ -153,181 +336,954 @@ int main()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 
-    float vertices3D[] = {
-    -0.5f, -0.5f, -0.5f,    0.0f, 0.0f,
-     0.5f, -0.5f, -0.5f,    1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,    0.0f, 0.0f,
-
-    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,    1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,    1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,    0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
-
-    -0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-
-     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-
-    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,    1.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,    1.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,    0.0f, 0.0f,
-    -0.5f, -0.5f, -0.5f,    0.0f, 1.0f,
+    if (!meshLoaded)
+    {
+        // the cube is written as 36 separate vertices, weld the duplicates and order the triangles for the vertex cache
+        const size_t cubeVertexSize = 5 * sizeof(float);
+        const size_t cubeInputVertices = sizeof(vertices3D) / cubeVertexSize;
+        std::vector<unsigned int> cubeRemap;
+        size_t cubeVertexCount = MeshOptimizer::weldVertices(vertices3D, cubeInputVertices, cubeVertexSize, cubeRemap);
+        std::vector<float> cubeVertices(cubeVertexCount * 5);
+        MeshOptimizer::remapVertexBuffer(cubeVertices.data(), vertices3D, cubeInputVertices, cubeVertexSize, cubeRemap);
+        std::vector<unsigned int> cubeIndices(cubeRemap.size()), cubeCacheOrder(cubeRemap.size());
+        MeshOptimizer::optimizeVertexCache(cubeCacheOrder.data(), cubeRemap.data(), cubeRemap.size(), cubeVertexCount);
+        MeshOptimizer::optimizeOverdraw(cubeIndices.data(), cubeCacheOrder.data(), cubeCacheOrder.size(), cubeVertices.data(), cubeVertexCount, cubeVertexSize);
+        {
+            VertexCacheStats welded = MeshOptimizer::analyzeVertexCache(cubeRemap.data(), cubeRemap.size(), cubeVertexCount);
+            VertexCacheStats optimized = MeshOptimizer::analyzeVertexCache(cubeIndices.data(), cubeIndices.size(), cubeVertexCount);
+            // without an index buffer every vertex is transformed: ACMR 3, ATVR 1 relative to the 36 input vertices
+            std::cout << std::fixed << std::setprecision(3) << "Cube mesh: " << cubeInputVertices << " vertices welded to " << cubeVertexCount
+                << ", ACMR 3.000 -> " << welded.acmr << " (welded) -> " << optimized.acmr << " (optimized), ATVR "
+                << static_cast<float>(cubeInputVertices) / cubeVertexCount << " -> " << welded.atvr << " -> " << optimized.atvr << std::endl;
+        }
+        VertexSource cubeSource;
+        cubeSource.count = cubeVertexCount;
+        cubeSource.position = { cubeVertices.data(), cubeVertexSize };
+        cubeSource.texCoord = { cubeVertices.data() + 3, cubeVertexSize };
+        mesh.quantization = mesh.format.encode(cubeSource, mesh.vertexStorage);
+        mesh.indexStorage = std::move(cubeIndices);
+        mesh.vertexCount = cubeVertexCount;
+        mesh.indexCount = mesh.indexStorage.size();
+        mesh.vertices = mesh.vertexStorage.data();
+        mesh.indices = mesh.indexStorage.data();
+        std::cout << "Cube vertex format: " << mesh.format.getStride() << " bytes per vertex (" << cubeVertexSize << " as float)" << std::endl;
+    }
+    else
+    {
+        // scale the mesh into the unit cube around the origin, so it takes the place of a cube
+        glm::vec3 extent = mesh.maximum - mesh.minimum;
+        float fit = 1.0f / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+        glm::vec3 center = (mesh.minimum + mesh.maximum) * 0.5f;
+        mesh.quantization.scale *= fit;
+        mesh.quantization.offset = (mesh.quantization.offset - center) * fit;
+    }
+    const GLsizei cubeIndexCount = static_cast<GLsizei>(mesh.indexCount);
+    setVertexQuantization(fallbackShader, mesh.quantization);
+    setVertexQuantization(fallbackInstancedShader, mesh.quantization);
 
-    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,    1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,    1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,    0.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,    0.0f, 0.0f,
-    };
-    unsigned int VBO_3D, VAO_3D;
+    unsigned int VBO_3D, EBO_3D, VAO_3D;
     glGenBuffers(1, &VBO_3D);
+    glGenBuffers(1, &EBO_3D);
     glGenVertexArrays(1, &VAO_3D);
 
     glBindVertexArray(VAO_3D);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO_3D);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices3D), &vertices3D, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * mesh.format.getStride(), mesh.vertices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_3D);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * sizeof(unsigned int), mesh.indices, GL_STATIC_DRAW);
+
+    glBindVertexBuffer(0, VBO_3D, 0, mesh.format.getStride());
+    mesh.format.setup(0);
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    glm::vec3 cubePositions[] = {
-        glm::vec3(0.0f,  0.0f,  0.0f),
-        glm::vec3(2.0f,  5.0f, -15.0f),
-        glm::vec3(-1.5f, -2.2f, -2.5f),
-        glm::vec3(-3.8f, -2.0f, -12.3f),
-        glm::vec3(2.4f, -0.4f, -3.5f),
-        glm::vec3(-1.7f,  3.0f, -7.5f),
-        glm::vec3(1.3f, -2.0f, -2.5f),
-        glm::vec3(1.5f,  2.0f, -2.5f),
-        glm::vec3(1.5f,  0.2f, -1.5f),
-        glm::vec3(-1.3f,  1.0f, -1.5f)
-    };
+    std::vector<glm::vec3> cubePositions = createCubePositions(options.cubes);
+    unsigned int cubeCount = static_cast<unsigned int>(cubePositions.size());
+
+    // transforms of the cube field, every third cube is animated with a spinning child each frame
+    SceneStore cubeScene;
+    std::vector<unsigned int> cubeNodes;
+    createCubeScene(cubePositions, cubeScene, cubeNodes);
+    cubeScene.update(&threadPool);
+
+    // the cubes only rotate around their centers, so the bounding spheres never change
+    BoundingSpheres cubeBounds;
+    cubeBounds.resize(cubeCount);
+    for (unsigned int i = 0; i < cubeCount; i++)
+    {
+        cubeBounds.set(i, cubePositions[i], CUBE_RADIUS);
+    }
+    std::vector<unsigned int> visibleCubes(cubeCount);
+    std::vector<unsigned int> visibleNodes(cubeCount); // the SceneStore objects with the world matrices of visibleCubes
+    for (unsigned int i = 0; i < cubeCount; i++)
+    {
+        visibleCubes[i] = i;
+    }
+    // the hierarchy holds the boxes around the bounding spheres, they contain the cubes in every rotation
+    BoundingBoxes cubeBoxes;
+    cubeBoxes.resize(cubeCount);
+    for (unsigned int i = 0; i < cubeCount; i++)
+    {
+        cubeBoxes.set(i, cubePositions[i] - glm::vec3(CUBE_RADIUS), cubePositions[i] + glm::vec3(CUBE_RADIUS));
+    }
+    Bvh cubeBvh;
+    {
+        std::chrono::steady_clock::time_point bvhStart = std::chrono::steady_clock::now();
+        cubeBvh.build(cubeBoxes, &threadPool);
+        std::cout << std::fixed << std::setprecision(3) << "Built the cube hierarchy with " << cubeBvh.getNodes().size() << " nodes in "
+            << 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - bvhStart).count() << " ms" << std::endl;
+    }
+
+    // the cubes are their own occluders, a loaded mesh doesn't have to fill the cube
+    OcclusionCuller occlusionCuller(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    bool occlusionCulling = options.culling && options.occlusionCulling && !meshLoaded && !options.gpuCulling;
+    std::vector<unsigned int> occluders;
+    unsigned long long statsTested = 0, statsOccluded = 0, totalTested = 0, totalOccluded = 0;
+
+    // GPU driven path: bounds and models are uploaded once, the culling result never comes back to the CPU
+    std::unique_ptr<GpuCuller> gpuCuller;
+    if (options.gpuCulling && !computeShaders)
+    {
+        std::cout << "ERROR GPU culling needs compute shaders (OpenGL 4.3), the cubes are culled on the CPU" << std::endl;
+    }
+    else if (options.gpuCulling)
+    {
+        std::vector<unsigned int> animatedCubes(cubeCount);
+        for (unsigned int i = 0; i < cubeCount; i++)
+        {
+            animatedCubes[i] = 0 == i % 3U ? 1 : 0;
+        }
+        // the roots without the spin, the compute shader applies it
+        std::vector<glm::mat4> cubeModels(cubeScene.getWorldMatrices(), cubeScene.getWorldMatrices() + cubeCount);
+        gpuCuller = std::make_unique<GpuCuller>("shader/cull.comp", cubeBounds, cubeModels, animatedCubes, cubeIndexCount);
+        std::cout << "GPU culling, drawn with " << (GpuCuller::hasDrawCount() ? "glMultiDrawElementsIndirectCount"
+            : "glMultiDrawElementsIndirect (no draw count support, culled cubes keep empty commands)") << std::endl;
+    }
+
+    // per frame data is streamed through the ring buffer: the camera block and the instance matrices,
+    // binding 1 of the instanced VAO is rebound to the frame offset. The ring aligns offsets in the whole buffer,
+    // so the camera block binds at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT in every section
+    UniformBuffer<CameraBlock> cameraUniforms(CAMERA_BINDING);
+    RingBuffer frameRing(UniformBuffer<CameraBlock>::getFrameSize() + cubeCount * sizeof(glm::mat4));
+
+    unsigned int VAO_INSTANCED;
+    glGenVertexArrays(1, &VAO_INSTANCED);
+
+    glBindVertexArray(VAO_INSTANCED);
+
+    glBindVertexBuffer(0, VBO_3D, 0, mesh.format.getStride());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_3D);
+    mesh.format.setup(0);
+
+    // a mat4 attribute is passed as four vec4 columns
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        glVertexAttribFormat(3 + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+        glVertexAttribBinding(3 + column, 1);
+        glEnableVertexAttribArray(3 + column);
+    }
+    glVertexBindingDivisor(1, 1);
+
+    glBindVertexArray(0);
 
     // draw wireframe mode
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    glm::mat4 model(1.0f);
-    model *= glm::toMat4(glm::angleAxis(glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection = glm::perspective(glm::radians(camera.Fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
-    shader.use();
-    shader.set("texture1", 0);
-    shader.set("texture2", 1);
-    unsigned int visible = shader.getSetLocation("visible");
     float visible_value = 0.2f;
-    unsigned int localID = shader.getSetLocation("local");
-    unsigned int modelID = shader.getSetLocation("model");
-    unsigned int viewID = shader.getSetLocation("view");
-    unsigned int projectionID = shader.getSetLocation("projection");
+    fallbackShader.checkUniformBlock<CameraBlock>("Camera");
+    fallbackInstancedShader.checkUniformBlock<CameraBlock>("Camera");
 
     glEnable(GL_DEPTH_TEST);
-    double frameTime = glfwGetTime();
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetScrollCallback(window, scrollCallback);
+    // headless runs are benchmarks, never throttle them
+    FramePacer framePacer(options.headless ? FramePacingMode::UNCAPPED : FRAME_PACING, FRAME_RATE);
+    double statsTime = 0.0, statsCpuTime = 0.0;
+    unsigned int statsFrames = 0;
+    unsigned long long statsCubes = 0, totalVisibleCubes = 0;
+    double totalTime = 0.0, totalCpuTime = 0.0;
+    if (!options.headless)
+    {
+        glfwSwapInterval(framePacer.getSwapInterval());
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+    }
     // render Loop
-    while (!glfwWindowShouldClose(window))
+    for (unsigned int frame = 0; options.frames == 0 || frame < options.frames; frame++)
     {
-        if (frameTime + FRAME_TIME > glfwGetTime())
+        if (window != NULL && glfwWindowShouldClose(window))
+        {
+            break;
+        }
+        framePacer.waitForNextFrame();
+        profiler.beginFrame();
+        double currentTime = options.headless ? frame * HEADLESS_FRAME_TIME : glfwGetTime();
+        if (frame > 0)
+        {
+            totalTime += framePacer.getFrameTime();
+            totalCpuTime += framePacer.getCpuTime();
+        }
+        statsTime += framePacer.getFrameTime();
+        statsCpuTime += framePacer.getCpuTime();
+        statsFrames++;
+        if (window != NULL && statsTime >= FRAME_STATS_INTERVAL)
+        {
+            std::ostringstream title;
+            title << std::fixed << std::setprecision(2) << "MyFirstWindow | " << statsFrames / statsTime << " FPS | CPU "
+                << 1000.0 * statsCpuTime / statsFrames << " ms/frame (" << 100.0 * statsCpuTime / statsTime << "%) | GPU "
+                << profiler.getGpuStats("frame").avg << " ms/frame | "
+                << statsCubes / statsTime / 1e6 << " M cubes/s | " << frameRing.getStallCount() << " GPU stalls | ";
+            if (occlusionCulling)
+            {
+                title << 100.0 * statsOccluded / std::max(statsTested, 1ULL) << "% occluded in " << profiler.getCpuStats("occlusion").avg << " ms | ";
+            }
+            title << describeCubeQueries(cubeBvh, camera);
+            glfwSetWindowTitle(window, title.str().c_str());
+            statsTime = statsCpuTime = 0.0;
+            statsFrames = 0;
+            statsCubes = 0;
+            statsTested = statsOccluded = 0;
+        }
+
+        if (window != NULL)
         {
-            continue;
+            CpuScope inputScope(profiler, "input");
+            processInput(window, &visible_value);
         }
-        frameTime = glfwGetTime();
 
-        processInput(window, &visible_value);
+        // switch to the textured programs as soon as both are linked. isReady() only polls with
+        // KHR_parallel_shader_compile, without it the first call waits for the driver to finish the build
+        if (cubeShader == &fallbackShader && shader.isReady() && instancedShader.isReady())
+        {
+            shader.set("texture1", 0);
+            shader.set("texture2", 1);
+            shader.checkUniformBlock<CameraBlock>("Camera");
+            instancedShader.set("texture1", 0);
+            instancedShader.set("texture2", 1);
+            setVertexQuantization(shader, mesh.quantization);
+            setVertexQuantization(instancedShader, mesh.quantization);
+            instancedShader.checkUniformBlock<CameraBlock>("Camera");
+            cubeShader = &shader;
+            instancedCubeShader = &instancedShader;
+            std::cout << std::fixed << std::setprecision(3) << "Textured shaders ready after "
+                << 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << " ms (frame " << frame << ")" << std::endl;
+            const ShaderCacheStats& shaderStats = Shader::getCacheStats();
+            std::cout << std::fixed << std::setprecision(3) << "Shader startup: " << shaderStats.compiled << " compiled in " << 1000.0 * shaderStats.compileTime << " ms, "
+                << shaderStats.loaded << " loaded from cache in " << 1000.0 * shaderStats.loadTime << " ms";
+            if (shaderStats.rejected > 0)
+            {
+                std::cout << ", " << shaderStats.rejected << " cached binaries rejected by the driver";
+            }
+            std::cout << (parallelShaderCompile ? ", parallel compile" : "") << std::endl;
+        }
 
         // rendering
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glm::mat4 transform = glm::mat4(1.0f);
         view = camera.GetViewMatrix();
         projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
-        shader.use();
-        shader.set(visible, visible_value);
-        shader.setMat4(localID, transform);
-        shader.setMat4(modelID, model);
-        shader.setMat4(viewID, view);
-        shader.setMat4(projectionID, projection);
+        {
+            ProfileScope textureScope(profiler, "texture upload");
+            textureLoader.update();
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+        {
+            ProfileScope uniformScope(profiler, "uniform upload");
+            cubeShader->use();
+            cubeShader->set("visible", visible_value);
 
-#if false // Draw Planes
-        glBindVertexArray(VAO);
-
-        transform = glm::translate(transform, glm::vec3(0.5f, -0.5f, 0.0f));
-        // better use Quaternion, because of Gimbal Lock :(
-        transform *= glm::mat4_cast(glm::angleAxis((float)glfwGetTime() * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f))); // glm::rotate(transRot, (float)glfwGetTime() * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-        transform = glm::mat4(1.0f);
-        transform = glm::translate(transform, glm::vec3(-0.5f, 0.5f, 0.0f));
-        float time = abs(0.5f * sin(glfwGetTime())) + 0.5f;
-        transform = glm::scale(transform, glm::vec3(time, time, time));
-        shader.setMat4(localID, transform);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-#endif
+            frameRing.beginFrame();
+            CameraBlock cameraBlock;
+            cameraBlock.view = view;
+            cameraBlock.projection = projection;
+            cameraBlock.viewProjection = projection * view;
+            cameraUniforms.update(frameRing, cameraBlock);
+        }
 
-        // Draw 10 Cubes
-        glBindVertexArray(VAO_3D);
-        glm::mat4 rotation = glm::toMat4(glm::angleAxis((float)glfwGetTime() * glm::radians(50.0f), glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f))));
-        for (unsigned int i = 0; i < 10; i++)
         {
-            glm::mat4 model = glm::mat4(1.0f);
+            ProfileScope drawScope(profiler, "draw");
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            textureLoader.bind(texture1, 0);
+            textureLoader.bind(texture2, 1);
+
+#if false // Draw Planes
+            glBindVertexArray(VAO);
+
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f));
+            // better use Quaternion, because of Gimbal Lock :(
+            transform *= glm::mat4_cast(glm::angleAxis((float)currentTime * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f))); // glm::rotate(transRot, (float)glfwGetTime() * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+            // the shader only gets the final matrix, the plane transform is applied on the CPU
+            shader.setMat4("model", transform);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
             transform = glm::mat4(1.0f);
-            transform *= (0 == i % 3U ? rotation : glm::mat4(1.0f));
-            shader.setMat4(localID, transform);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model *= glm::toMat4(glm::angleAxis(glm::radians(angle), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f))));
-            shader.setMat4(modelID, model);
+            transform = glm::translate(transform, glm::vec3(-0.5f, 0.5f, 0.0f));
+            float time = abs(0.5f * sin(currentTime)) + 0.5f;
+            transform = glm::scale(transform, glm::vec3(time, time, time));
+            shader.setMat4("model", transform);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+#endif
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            // Draw Cubes, only the ones in the view frustum
+            glm::quat spin = glm::angleAxis((float)currentTime * glm::radians(50.0f), glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f)));
+            if (gpuCuller)
+            {
+                {
+                    ProfileScope cullingScope(profiler, "gpu culling");
+                    gpuCuller->cull(Frustum::fromMatrix(projection * view), glm::toMat4(spin));
+                }
+                instancedCubeShader->use();
+                instancedCubeShader->set("visible", visible_value);
+
+                glBindVertexArray(VAO_INSTANCED);
+                glBindVertexBuffer(1, gpuCuller->getModelBuffer(), 0, sizeof(glm::mat4));
+                gpuCuller->draw();
+                statsCubes += cubeCount;
+            }
+            // the transforms and the frustum culling don't depend on each other, the transforms run as a job while
+            // the render thread culls. The profiler isn't thread safe, the job only records its start and end
+            Job* transformJob = NULL;
+            unsigned int transformScope = profiler.getScope("transforms");
+            Profiler::Clock::time_point transformStart, transformEnd;
+            if (!gpuCuller)
+            {
+                transformJob = threadPool.create([&]()
+                    {
+                        transformStart = Profiler::Clock::now();
+                        animateCubes(cubeScene, cubeNodes, spin, &threadPool);
+                        transformEnd = Profiler::Clock::now();
+                    });
+                threadPool.run(transformJob);
+            }
+            unsigned int visibleCount = gpuCuller ? 0 : cubeCount;
+            if (options.culling && !gpuCuller)
+            {
+                CpuScope cullingScope(profiler, "culling");
+                Frustum frustum = Frustum::fromMatrix(projection * view);
+                visibleCount = static_cast<unsigned int>(options.hierarchicalCulling ? cubeBvh.cull(frustum, visibleCubes)
+                    : FrustumCuller::cull(frustum, cubeBounds, visibleCubes));
+            }
+            if (transformJob != NULL)
+            {
+                threadPool.wait(transformJob);
+                profiler.addCpuTime(transformScope, transformStart, transformEnd);
+            }
+            if (occlusionCulling && visibleCount > 0)
+            {
+                CpuScope occlusionScope(profiler, "occlusion");
+                glm::mat4 viewProjection = projection * view;
+                // the nearest cubes cover the most pixels
+                occluders.assign(visibleCubes.begin(), visibleCubes.begin() + visibleCount);
+                if (occluders.size() > OCCLUDER_COUNT)
+                {
+                    std::nth_element(occluders.begin(), occluders.begin() + OCCLUDER_COUNT, occluders.end(), [&](unsigned int a, unsigned int b)
+                        {
+                            glm::vec3 toA = cubePositions[a] - camera.Position, toB = cubePositions[b] - camera.Position;
+                            return glm::dot(toA, toA) < glm::dot(toB, toB);
+                        });
+                    occluders.resize(OCCLUDER_COUNT);
+                }
+                occlusionCuller.clear();
+                for (unsigned int i : occluders)
+                {
+                    occlusionCuller.addBoxOccluder(viewProjection * cubeScene.getWorld(cubeNodes[i]), glm::vec3(-0.5f), glm::vec3(0.5f));
+                }
+                occlusionCuller.rasterize(&threadPool);
+                visibleCount = static_cast<unsigned int>(occlusionCuller.cull(viewProjection, cubeBoxes, visibleCubes, visibleCount, &threadPool));
+                statsTested += occlusionCuller.getStats().tested;
+                statsOccluded += occlusionCuller.getStats().occluded;
+                totalTested += occlusionCuller.getStats().tested;
+                totalOccluded += occlusionCuller.getStats().occluded;
+            }
+            statsCubes += visibleCount;
+            totalVisibleCubes += visibleCount;
+            RingAllocation instances;
+            if (options.instancing && visibleCount > 0)
+            {
+                instances = frameRing.allocate(visibleCount * sizeof(glm::mat4));
+            }
+            // the ring holds every cube, it's only NULL if the buffer couldn't be mapped
+            if (instances.data != NULL)
+            {
+                {
+                    CpuScope instanceScope(profiler, "instance upload");
+                    for (unsigned int k = 0; k < visibleCount; k++)
+                    {
+                        visibleNodes[k] = cubeNodes[visibleCubes[k]];
+                    }
+                    cubeScene.write(visibleNodes.data(), visibleCount, static_cast<glm::mat4*>(instances.data));
+                }
+
+                instancedCubeShader->use();
+                instancedCubeShader->set("visible", visible_value);
+
+                glBindVertexArray(VAO_INSTANCED);
+                glBindVertexBuffer(1, frameRing.ID, instances.offset, sizeof(glm::mat4));
+                glDrawElementsInstanced(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0, visibleCount);
+            }
+            else if (!options.instancing && !gpuCuller)
+            {
+                glBindVertexArray(VAO_3D);
+            }
+            for (unsigned int k = 0; !options.instancing && k < visibleCount; k++)
+            {
+                cubeShader->setMat4("model", cubeScene.getWorld(cubeNodes[visibleCubes[k]]));
+
+                glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
+            }
+        }
+        frameRing.endFrame();
+
+        if (window != NULL)
+        {
+            {
+                CpuScope swapScope(profiler, "swap");
+                glfwSwapBuffers(window);
+            }
+            CpuScope inputScope(profiler, "input");
+            glfwPollEvents();
+        }
+        else
+        {
+            // there is no swap to wait on, finish the frame so the frame time includes the GPU work
+            CpuScope swapScope(profiler, "swap");
+            glFinish();
         }
+        profiler.endFrame();
+        if (frame == 0)
+        {
+            std::cout << std::fixed << std::setprecision(3) << "First frame after "
+                << 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
+        }
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    if (options.headless)
+    {
+        unsigned int measuredFrames = options.frames > 1 ? options.frames - 1 : 1;
+        std::cout << std::fixed << std::setprecision(3) << "Rendered " << options.frames << " frames, "
+            << 1000.0 * totalTime / measuredFrames << " ms/frame, CPU " << 1000.0 * totalCpuTime / measuredFrames << " ms/frame, "
+            << static_cast<double>(cubeCount) * measuredFrames / totalTime / 1e6 << " M cubes/s (" << cubeCount << " cubes, ";
+        if (gpuCuller)
+        {
+            std::cout << gpuCuller->readVisibleCount() << " visible in the last frame, GPU culled";
+        }
+        else
+        {
+            std::cout << totalVisibleCubes / options.frames << " visible on average, " << (options.instancing ? "instanced" : "one draw per cube");
+            if (occlusionCulling)
+            {
+                std::cout << ", " << 100.0 * totalOccluded / std::max(totalTested, 1ULL) << "% of the tested cubes occluded in "
+                    << profiler.getCpuStats("occlusion").avg << " ms/frame";
+            }
+        }
+        std::cout << "), "
+            << frameRing.getStallCount() << " GPU stalls (" << 1000.0 * frameRing.getStallTime() << " ms)" << std::endl;
+        std::cout << describeCubeQueries(cubeBvh, camera) << std::endl;
+        if (!options.output.empty())
+        {
+            headless.saveFramebuffer(options.output.c_str());
+        }
+    }
+    profiler.printStats();
+    if (!options.trace.empty())
+    {
+        profiler.writeChromeTrace(options.trace.c_str());
     }
 
+    gpuCuller.reset();
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteVertexArrays(1, &VAO_3D);
     glDeleteBuffers(1, &VBO_3D);
+    glDeleteBuffers(1, &EBO_3D);
+    glDeleteVertexArrays(1, &VAO_INSTANCED);
+    frameRing.remove();
+    textureLoader.remove();
+    profiler.remove();
     shader.remove();
+    instancedShader.remove();
+    fallbackShader.remove();
+    fallbackInstancedShader.remove();
+    Shader::setAssetArchive(NULL);
+    archive.close();
 
-    glfwTerminate();
+    if (options.headless)
+    {
+        headless.destroy();
+    }
+    else
+    {
+        glfwTerminate();
+    }
     return 0;
 }
 
+/*
+* @brief	the image decoded like TextureLoader does, with its mip chain
+*/
+bool loadSoftwareTexture(const char* path, const MipSettings& settings, AssetArchive& archive, ThreadPool& pool, MipChain& chain)
+{
+    std::string_view archived = archive.isOpen() ? archive.view(path) : std::string_view();
+    int width, height, channels;
+    unsigned char* pixels = !archived.empty() ? stbi_load_from_memory(reinterpret_cast<const unsigned char*>(archived.data()), static_cast<int>(archived.size()),
+        &width, &height, &channels, 4) : stbi_load(path, &width, &height, &channels, 4);
+    if (pixels == NULL)
+    {
+        std::cout << "ERROR couldn't load Texture (Path: " << path << " )" << std::endl;
+        return false;
+    }
+    MipGenerator::generate(pixels, width, height, settings, chain, &pool);
+    stbi_image_free(pixels);
+    return true;
+}
+
+/*
+* @brief	render the cube field with SoftwareRenderer instead of OpenGL. Headless runs don't create any context,
+*			a window only presents the color buffer with a blit
+*/
+int runSoftwareBackend(Options& options, std::chrono::steady_clock::time_point startTime)
+{
+    GLFWwindow* window = NULL;
+    unsigned int presentTexture = 0, presentFramebuffer = 0;
+    if (options.headless)
+    {
+        if (options.frames == 0)
+        {
+            options.frames = HEADLESS_FRAMES;
+        }
+    }
+    else
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "MyFirstWindow", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to initalized a Window :(" << std::endl;
+            glfwTerminate();
+            return 1;
+        }
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to intalized GLAD" << std::endl;
+            return 2;
+        }
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+
+        // the color buffer is uploaded into this texture and blitted to the window every frame
+        glGenTextures(1, &presentTexture);
+        glBindTexture(GL_TEXTURE_2D, presentTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &presentFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFramebuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, presentTexture, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    AssetArchive archive;
+    if (!options.archive.empty())
+    {
+        archive.open(options.archive.c_str());
+    }
+    ThreadPool threadPool;
+#if defined(SOFTWARE_RENDERER_AVX2)
+    std::cout << "Software rendering, AVX2, " << threadPool.getThreadCount() + 1 << " threads" << std::endl;
+#elif defined(SOFTWARE_RENDERER_SSE2)
+    std::cout << "Software rendering, SSE2, " << threadPool.getThreadCount() + 1 << " threads" << std::endl;
+#else
+    std::cout << "Software rendering, scalar, " << threadPool.getThreadCount() + 1 << " threads" << std::endl;
+#endif
+
+    // the mesh decoded to floats like the vertex shader sees it, the cube is only welded
+    SoftwareMesh mesh;
+    if (!options.mesh.empty())
+    {
+        MeshData meshData;
+        if (MeshLoader::load(options.mesh.c_str(), meshData, &threadPool, MESH_CACHE_DIRECTORY))
+        {
+            glm::vec3 extent = meshData.maximum - meshData.minimum;
+            float fit = 1.0f / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+            glm::vec3 center = (meshData.minimum + meshData.maximum) * 0.5f;
+            meshData.quantization.scale *= fit;
+            meshData.quantization.offset = (meshData.quantization.offset - center) * fit;
+            mesh.positions.resize(meshData.vertexCount);
+            mesh.texCoords.resize(meshData.vertexCount);
+            for (size_t i = 0; i < meshData.vertexCount; i++)
+            {
+                const unsigned char* vertex = meshData.vertices + i * meshData.format.getStride();
+                meshData.format.decode(vertex, meshData.quantization, VertexSemantic::POSITION, &mesh.positions[i].x);
+                meshData.format.decode(vertex, meshData.quantization, VertexSemantic::TEXCOORD, &mesh.texCoords[i].x);
+            }
+            mesh.indices.assign(meshData.indices, meshData.indices + meshData.indexCount);
+            std::cout << "Mesh " << options.mesh << ": " << mesh.indices.size() / 3 << " triangles, " << mesh.positions.size() << " vertices" << std::endl;
+        }
+    }
+    if (mesh.indices.empty())
+    {
+        const size_t cubeVertexSize = 5 * sizeof(float);
+        const size_t cubeInputVertices = sizeof(vertices3D) / cubeVertexSize;
+        size_t cubeVertexCount = MeshOptimizer::weldVertices(vertices3D, cubeInputVertices, cubeVertexSize, mesh.indices);
+        std::vector<float> cubeVertices(cubeVertexCount * 5);
+        MeshOptimizer::remapVertexBuffer(cubeVertices.data(), vertices3D, cubeInputVertices, cubeVertexSize, mesh.indices);
+        for (size_t i = 0; i < cubeVertexCount; i++)
+        {
+            mesh.positions.push_back(glm::vec3(cubeVertices[5 * i], cubeVertices[5 * i + 1], cubeVertices[5 * i + 2]));
+            mesh.texCoords.push_back(glm::vec2(cubeVertices[5 * i + 3], cubeVertices[5 * i + 4]));
+        }
+    }
+
+    stbi_set_flip_vertically_on_load(true);
+    MipChain texture1, texture2;
+    loadSoftwareTexture("textures/container.jpg", MipSettings(), archive, threadPool, texture1);
+    MipSettings cutoutMips;
+    cutoutMips.alphaCutoff = 0.5f;
+    loadSoftwareTexture("textures/awesomeface.png", cutoutMips, archive, threadPool, texture2);
+
+    std::vector<glm::vec3> cubePositions = createCubePositions(options.cubes);
+    unsigned int cubeCount = static_cast<unsigned int>(cubePositions.size());
+    SceneStore cubeScene;
+    std::vector<unsigned int> cubeNodes;
+    createCubeScene(cubePositions, cubeScene, cubeNodes);
+    BoundingSpheres cubeBounds;
+    BoundingBoxes cubeBoxes;
+    cubeBounds.resize(cubeCount);
+    cubeBoxes.resize(cubeCount);
+    for (unsigned int i = 0; i < cubeCount; i++)
+    {
+        cubeBounds.set(i, cubePositions[i], CUBE_RADIUS);
+        cubeBoxes.set(i, cubePositions[i] - glm::vec3(CUBE_RADIUS), cubePositions[i] + glm::vec3(CUBE_RADIUS));
+    }
+    // front to back order from the hierarchy lets the depth test reject most hidden pixels before they are shaded
+    Bvh cubeBvh;
+    cubeBvh.build(cubeBoxes, &threadPool);
+    std::vector<unsigned int> visibleCubes(cubeCount);
+    std::vector<unsigned int> visibleNodes(cubeCount); // the SceneStore objects with the world matrices of visibleCubes
+    for (unsigned int i = 0; i < cubeCount; i++)
+    {
+        visibleCubes[i] = i;
+    }
+    std::vector<glm::mat4> instanceModels(cubeCount);
+
+    SoftwareRenderer renderer(SCR_WIDTH, SCR_HEIGHT);
+    Profiler profiler(240, 3, false);
+    profiler.setTracing(!options.trace.empty());
+    FramePacer framePacer(options.headless ? FramePacingMode::UNCAPPED : FRAME_PACING, FRAME_RATE);
+    if (window != NULL)
+    {
+        glfwSwapInterval(framePacer.getSwapInterval());
+    }
+    float visible_value = 0.2f;
+    double statsTime = 0.0, totalTime = 0.0, totalCpuTime = 0.0;
+    unsigned int statsFrames = 0;
+    unsigned long long totalVisibleCubes = 0, totalTriangles = 0;
+    for (unsigned int frame = 0; options.frames == 0 || frame < options.frames; frame++)
+    {
+        if (window != NULL && glfwWindowShouldClose(window))
+        {
+            break;
+        }
+        framePacer.waitForNextFrame();
+        profiler.beginFrame();
+        double currentTime = options.headless ? frame * HEADLESS_FRAME_TIME : glfwGetTime();
+        if (frame > 0)
+        {
+            totalTime += framePacer.getFrameTime();
+            totalCpuTime += framePacer.getCpuTime();
+        }
+        statsTime += framePacer.getFrameTime();
+        statsFrames++;
+        if (window != NULL && statsTime >= FRAME_STATS_INTERVAL)
+        {
+            std::ostringstream title;
+            title << std::fixed << std::setprecision(2) << "MyFirstWindow | software | " << statsFrames / statsTime << " FPS | vertex "
+                << profiler.getCpuStats("vertex").avg << " ms | raster " << profiler.getCpuStats("raster").avg << " ms | "
+                << renderer.getStats().triangles << " triangles";
+            glfwSetWindowTitle(window, title.str().c_str());
+            statsTime = 0.0;
+            statsFrames = 0;
+        }
+        if (window != NULL)
+        {
+            CpuScope inputScope(profiler, "input");
+            processInput(window, &visible_value);
+        }
+
+        glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f) * camera.GetViewMatrix();
+        {
+            CpuScope transformScope(profiler, "transforms");
+            animateCubes(cubeScene, cubeNodes, glm::angleAxis((float)currentTime * glm::radians(50.0f), glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f))), &threadPool);
+        }
+        unsigned int visibleCount = cubeCount;
+        if (options.culling)
+        {
+            CpuScope cullingScope(profiler, "culling");
+            Frustum frustum = Frustum::fromMatrix(viewProjection);
+            visibleCount = static_cast<unsigned int>(options.hierarchicalCulling ? cubeBvh.cull(frustum, visibleCubes)
+                : FrustumCuller::cull(frustum, cubeBounds, visibleCubes));
+        }
+        totalVisibleCubes += visibleCount;
+        {
+            CpuScope vertexScope(profiler, "vertex");
+            for (unsigned int k = 0; k < visibleCount; k++)
+            {
+                visibleNodes[k] = cubeNodes[visibleCubes[k]];
+            }
+            cubeScene.write(visibleNodes.data(), visibleCount, instanceModels.data());
+            renderer.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+            renderer.setTextures(&texture1, &texture2, visible_value);
+            renderer.draw(viewProjection, instanceModels.data(), visibleCount, mesh, &threadPool);
+        }
+        {
+            CpuScope rasterScope(profiler, "raster");
+            renderer.render(&threadPool);
+        }
+        totalTriangles += renderer.getStats().triangles;
+
+        if (window != NULL)
+        {
+            {
+                CpuScope swapScope(profiler, "swap");
+                int framebufferWidth, framebufferHeight;
+                glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+                glBindTexture(GL_TEXTURE_2D, presentTexture);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, renderer.getColor().data());
+                glBindTexture(GL_TEXTURE_2D, 0);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFramebuffer);
+                glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, framebufferWidth, framebufferHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+                glfwSwapBuffers(window);
+            }
+            CpuScope inputScope(profiler, "input");
+            glfwPollEvents();
+        }
+        profiler.endFrame();
+        if (frame == 0)
+        {
+            std::cout << std::fixed << std::setprecision(3) << "First frame after "
+                << 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
+        }
+    }
+
+    if (options.headless)
+    {
+        unsigned int measuredFrames = options.frames > 1 ? options.frames - 1 : 1;
+        std::cout << std::fixed << std::setprecision(3) << "Rendered " << options.frames << " frames, "
+            << 1000.0 * totalTime / measuredFrames << " ms/frame, CPU " << 1000.0 * totalCpuTime / measuredFrames << " ms/frame on the render thread, "
+            << static_cast<double>(cubeCount) * measuredFrames / totalTime / 1e6 << " M cubes/s (" << cubeCount << " cubes, " << totalVisibleCubes / options.frames
+            << " visible on average, " << totalTriangles / options.frames << " triangles per frame, software)" << std::endl;
+        if (!options.output.empty())
+        {
+            renderer.saveFramebuffer(options.output.c_str());
+        }
+    }
+    profiler.printStats();
+    if (!options.trace.empty())
+    {
+        profiler.writeChromeTrace(options.trace.c_str());
+    }
+    archive.close();
+
+    if (window != NULL)
+    {
+        glDeleteFramebuffers(1, &presentFramebuffer);
+        glDeleteTextures(1, &presentTexture);
+        glfwTerminate();
+    }
+    return 0;
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            options.frames = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            options.output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cubes") == 0 && i + 1 < argc)
+        {
+            options.cubes = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--no-instancing") == 0)
+        {
+            options.instancing = false;
+        }
+        else if (strcmp(argv[i], "--no-shader-cache") == 0)
+        {
+            options.shaderCache = false;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            options.trace = argv[++i];
+        }
+        else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc)
+        {
+            options.archive = argv[++i];
+        }
+        else if (strcmp(argv[i], "--float-vertices") == 0)
+        {
+            options.compactVertices = false;
+        }
+        else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+        {
+            options.mesh = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-culling") == 0)
+        {
+            options.culling = false;
+        }
+        else if (strcmp(argv[i], "--flat-culling") == 0)
+        {
+            options.hierarchicalCulling = false;
+        }
+        else if (strcmp(argv[i], "--gpu-culling") == 0)
+        {
+            options.gpuCulling = true;
+        }
+        else if (strcmp(argv[i], "--no-occlusion-culling") == 0)
+        {
+            options.occlusionCulling = false;
+        }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "software") == 0 || strcmp(argv[i], "opengl") == 0)
+            {
+                options.softwareBackend = strcmp(argv[i], "software") == 0;
+            }
+            else
+            {
+                std::cout << "Unknown backend <" << argv[i] << ">, using opengl" << std::endl;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option <" << argv[i] << ">" << std::endl;
+        }
+    }
+    return options;
+}
+
+/*
+* @brief	positions of the cube field, the first 10 cubes are the classic ones and the rest is scattered in front of the camera
+*/
+std::vector<glm::vec3> createCubePositions(unsigned int count)
+{
+    std::vector<glm::vec3> positions = {
+        glm::vec3(0.0f,  0.0f,  0.0f),
+        glm::vec3(2.0f,  5.0f, -15.0f),
+        glm::vec3(-1.5f, -2.2f, -2.5f),
+        glm::vec3(-3.8f, -2.0f, -12.3f),
+        glm::vec3(2.4f, -0.4f, -3.5f),
+        glm::vec3(-1.7f,  3.0f, -7.5f),
+        glm::vec3(1.3f, -2.0f, -2.5f),
+        glm::vec3(1.5f,  2.0f, -2.5f),
+        glm::vec3(1.5f,  0.2f, -1.5f),
+        glm::vec3(-1.3f,  1.0f, -1.5f)
+    };
+    positions.resize(std::min<size_t>(positions.size(), count));
+
+    // roughly 8 units^3 per cube, so the density stays the same for every scene size
+    float extent = 2.0f * std::cbrt(static_cast<float>(count));
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> distribution(-0.5f * extent, 0.5f * extent);
+    while (positions.size() < count)
+    {
+        positions.push_back(glm::vec3(distribution(random), distribution(random), distribution(random) - 0.5f * extent));
+    }
+    return positions;
+}
+
+/*
+* @brief	a root per cube with its translation and fixed rotation, every third cube gets a child that spins
+*
+* @param	cubeNodes	receives the object whose world matrix draws the cube
+*/
+void createCubeScene(const std::vector<glm::vec3>& positions, SceneStore& scene, std::vector<unsigned int>& cubeNodes)
+{
+    cubeNodes.resize(positions.size());
+    for (unsigned int i = 0; i < positions.size(); i++)
+    {
+        float angle = 20.0f * i;
+        cubeNodes[i] = static_cast<unsigned int>(scene.add(positions[i], glm::angleAxis(glm::radians(angle), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)))));
+    }
+    // the children follow all roots, breadth first, and stay in consecutive blocks
+    for (unsigned int i = 0; i < positions.size(); i += 3)
+    {
+        cubeNodes[i] = static_cast<unsigned int>(scene.add(glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f), static_cast<int>(i)));
+    }
+}
+
+/*
+* @brief	every third cube spins around its center, only the spinning children are recomputed
+*/
+void animateCubes(SceneStore& scene, const std::vector<unsigned int>& cubeNodes, const glm::quat& spin, ThreadPool* pool)
+{
+    for (size_t i = 0; i < cubeNodes.size(); i += 3)
+    {
+        scene.setRotation(cubeNodes[i], spin);
+    }
+    scene.update(pool);
+}
+
+/*
+* @brief	UNORM16 positions of the VertexFormat are stored relative to the bounds of the mesh, the programs scale them back
+*/
+void setVertexQuantization(Shader& shader, const VertexQuantization& quantization)
+{
+    shader.set("positionScale", quantization.scale.x, quantization.scale.y, quantization.scale.z);
+    shader.set("positionOffset", quantization.offset.x, quantization.offset.y, quantization.offset.z);
+}
+
+/*
+* @brief	the cube picked along the camera front and the cube nearest to the camera, both answered by the hierarchy
+*/
+std::string describeCubeQueries(const Bvh& bvh, const Camera& camera)
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2);
+    BvhRayHit hit;
+    if (bvh.raycast(camera.Position, camera.Front, PICK_DISTANCE, hit))
+    {
+        text << "picked cube " << hit.index << " at " << hit.distance;
+    }
+    else
+    {
+        text << "no cube picked";
+    }
+    unsigned int nearest;
+    float distance;
+    if (bvh.nearest(camera.Position, std::numeric_limits<float>::infinity(), nearest, distance))
+    {
+        text << ", nearest cube " << nearest << " at " << distance;
+    }
+    return text.str();
+}
+
 void processInput(GLFWwindow* window, float* value)
 {
     double currentFrame = glfwGetTime();
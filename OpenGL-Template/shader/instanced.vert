@@ -0,0 +1,18 @@
+#version 330 core
+#include "vertexFormat.glsl"
+layout (location = 3) in mat4 aModel; // per instance, occupies the locations 3 to 6
+
+out vec2 texCoord;
+
+layout (std140) uniform Camera
+{
+   mat4 view;
+   mat4 projection;
+   mat4 viewProjection;
+};
+
+void main()
+{
+   gl_Position = viewProjection * aModel * vec4(decodePosition(), 1.0f);
+   texCoord = decodeTexCoord();
+}
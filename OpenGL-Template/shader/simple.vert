@@ -1,19 +1,21 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
-layout (location = 2) in vec2 aTexCoord;
+#include "vertexFormat.glsl"
 
 //out vec3 outColor;
 out vec2 texCoord;
 
-uniform mat4 local;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+   mat4 view;
+   mat4 projection;
+   mat4 viewProjection;
+};
+
+uniform mat4 model; // the final world matrix, hierarchies are resolved by SceneStore
 
 void main()
 {
-   gl_Position = projection * view * model * local * vec4(aPos, 1.0f);
-   //outColor = aColor;
-   texCoord = aTexCoord;
-}
\ No newline at end of file
+   gl_Position = viewProjection * model * vec4(decodePosition(), 1.0f);
+   //outColor = decodeColor(); // needs a color attribute in the VertexFormat
+   texCoord = decodeTexCoord();
+}
@@ -0,0 +1,6 @@
+// 32 bit float positions and texture coordinates, the programs replace this file with the code generated
+// by VertexFormat::getShaderDecode() (registered with Shader::setInclude)
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+vec3 decodePosition() { return aPos; }
+vec2 decodeTexCoord() { return aTexCoord; }
@@ -0,0 +1,4 @@
+// From https://github.com/nothings/stb/blob/master/stb_image.h
+// The implementation lives in its own translation unit because the loaders include stb_image.h as well
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
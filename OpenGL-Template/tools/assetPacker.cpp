@@ -0,0 +1,142 @@
+// Packs shaders and textures into one archive that the template maps with --archive <file.pak>
+// Usage: asset-packer <output.pak> <file or directory>... [--align <bytes>] [--compression auto|lz4|none]
+//
+// The entry names are the paths as they are given, relative to the working directory, so run the packer from the
+// directory the template runs in (E.g.: asset-packer assets.pak shader textures).
+// auto compresses everything with LZ4 except JPG and PNG, they are already compressed.
+#include "AssetArchive.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+bool readFile(const std::filesystem::path& path, std::vector<unsigned char>& data)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cout << "ERROR couldn't read File (Path: " << path.string() << " )" << std::endl;
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+AssetCompression chooseCompression(const std::filesystem::path& path, const std::string& mode)
+{
+    if (mode == "none")
+    {
+        return AssetCompression::NONE;
+    }
+    if (mode == "lz4")
+    {
+        return AssetCompression::LZ4;
+    }
+    std::string extension = path.extension().string();
+    for (char& c : extension)
+    {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" ? AssetCompression::NONE : AssetCompression::LZ4;
+}
+
+bool addInput(const std::filesystem::path& path, const std::string& mode, std::vector<ArchiveInput>& inputs)
+{
+    ArchiveInput input;
+    input.name = path.lexically_normal().generic_string();
+    input.compression = chooseCompression(path, mode);
+    if (!readFile(path, input.data))
+    {
+        return false;
+    }
+    inputs.push_back(std::move(input));
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: asset-packer <output.pak> <file or directory>... [--align <bytes>] [--compression auto|lz4|none]" << std::endl;
+        return 1;
+    }
+    const char* output = argv[1];
+    uint32_t alignment = AssetArchive::DEFAULT_ALIGNMENT;
+    std::string mode = "auto";
+    std::vector<std::filesystem::path> paths;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--align") == 0 && i + 1 < argc)
+        {
+            alignment = static_cast<uint32_t>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+        {
+            mode = argv[++i];
+            if (mode != "auto" && mode != "lz4" && mode != "none")
+            {
+                std::cout << "Unknown compression <" << mode << ">, use auto, lz4 or none" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    std::vector<ArchiveInput> inputs;
+    for (const std::filesystem::path& path : paths)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error))
+        {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path, error))
+            {
+                if (entry.is_regular_file() && !addInput(entry.path(), mode, inputs))
+                {
+                    return 1;
+                }
+            }
+        }
+        else if (!addInput(path, mode, inputs))
+        {
+            return 1;
+        }
+    }
+
+    if (!AssetArchive::write(output, inputs, alignment))
+    {
+        return 1;
+    }
+
+    // read the archive back, so the summary shows what was actually stored
+    AssetArchive archive;
+    if (!archive.open(output))
+    {
+        return 1;
+    }
+    uint64_t original = 0, stored = 0;
+    for (const ArchiveEntry& entry : archive.getEntries())
+    {
+        std::cout << std::left << std::setw(40) << archive.getName(entry) << std::right << std::setw(12) << entry.originalSize << " -> "
+            << std::setw(10) << entry.size << (entry.compression == AssetCompression::LZ4 ? " lz4" : "") << std::endl;
+        if (archive.view(archive.getName(entry)).size() != entry.originalSize)
+        {
+            return 1;
+        }
+        original += entry.originalSize;
+        stored += entry.size;
+    }
+    std::cout << std::fixed << std::setprecision(2) << output << ": " << archive.getEntries().size() << " entries, " << original / 1024.0 << " KiB -> "
+        << stored / 1024.0 << " KiB, aligned to " << alignment << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Offline texture compressor: converts a JPG/PNG into a block compressed DDS with a full mip chain
+// Usage: texture-compressor <input image> <output.dds> [--format bc1|bc3|bc7] [--srgb] [--no-mipmaps] [--no-flip]
+//                           [--mip-filter box|kaiser] [--linear] [--alpha-cutoff <0..1>]
+//
+// The mip chain is generated by MipGenerator, gamma correct unless --linear is given (normal maps, masks).
+// --alpha-cutoff keeps the alpha test coverage of cutout textures the same in every level.
+//
+// The image is flipped vertically by default so the rows are stored bottom row first like OpenGL expects,
+// the same orientation main.cpp uses with stbi_set_flip_vertically_on_load(true).
+#include "stb_image.h"
+
+#include "BlockCompressor.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: texture-compressor <input image> <output.dds> [--format bc1|bc3|bc7] [--srgb] [--no-mipmaps] [--no-flip]"
+            << " [--mip-filter box|kaiser] [--linear] [--alpha-cutoff <0..1>]" << std::endl;
+        return 1;
+    }
+    const char* input = argv[1];
+    const char* output = argv[2];
+    std::string format = "bc7";
+    bool srgb = false, mipmaps = true, flip = true;
+    MipSettings mipSettings;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            format = argv[++i];
+        }
+        else if (strcmp(argv[i], "--srgb") == 0)
+        {
+            srgb = true;
+        }
+        else if (strcmp(argv[i], "--no-mipmaps") == 0)
+        {
+            mipmaps = false;
+        }
+        else if (strcmp(argv[i], "--no-flip") == 0)
+        {
+            flip = false;
+        }
+        else if (strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc)
+        {
+            std::string filter = argv[++i];
+            if (filter != "box" && filter != "kaiser")
+            {
+                std::cout << "Unknown mip filter <" << filter << ">, use box or kaiser" << std::endl;
+                return 1;
+            }
+            mipSettings.filter = filter == "box" ? MipFilter::BOX : MipFilter::KAISER;
+        }
+        else if (strcmp(argv[i], "--linear") == 0)
+        {
+            mipSettings.srgb = false;
+        }
+        else if (strcmp(argv[i], "--alpha-cutoff") == 0 && i + 1 < argc)
+        {
+            mipSettings.alphaCutoff = static_cast<float>(atof(argv[++i]));
+        }
+        else
+        {
+            std::cout << "Unknown option <" << argv[i] << ">" << std::endl;
+            return 1;
+        }
+    }
+
+    GLenum internalFormat;
+    if (format == "bc1")
+    {
+        internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    }
+    else if (format == "bc3")
+    {
+        internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    else if (format == "bc7")
+    {
+        internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    else
+    {
+        std::cout << "Unknown format <" << format << ">, use bc1, bc3 or bc7" << std::endl;
+        return 1;
+    }
+
+    stbi_set_flip_vertically_on_load(flip);
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(input, &width, &height, &channels, 4);
+    if (pixels == NULL)
+    {
+        std::cout << "Failed to load texture (Path: " << input << " )" << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool;
+    CompressedImage image;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool compressed = BlockCompressor::compress(internalFormat, pixels, width, height, mipmaps, image, &pool, mipSettings);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stbi_image_free(pixels);
+    if (!compressed || !TextureContainer::saveDDS(output, image))
+    {
+        return 1;
+    }
+
+    // the uncompressed size includes the mip chain as glGenerateMipmap would create it
+    size_t uncompressed = 0;
+    for (const CompressedLevel& level : image.levels)
+    {
+        uncompressed += static_cast<size_t>(level.width) * level.height * 4;
+    }
+    std::cout << std::fixed << std::setprecision(2) << input << " -> " << output << ": " << width << "x" << height << " " << format
+        << (srgb ? " sRGB" : "") << ", " << image.levels.size() << " levels, " << image.getByteSize() / 1024.0 << " KiB (RGBA8 "
+        << uncompressed / 1024.0 << " KiB, " << static_cast<double>(uncompressed) / image.getByteSize() << "x smaller) in "
+        << 1000.0 * seconds << " ms" << std::endl;
+    return 0;
+}